@@ -1,20 +1,47 @@
-#pragma once
-
-#include "HAL/Event.h"
-#include "Misc/ScopeLock.h"
-#include <chrono>
-
-
-
-    
-class CondWait {
-public:
-    CondWait();
-    ~CondWait();
-    void signal();
-    int wait(FCriticalSection& mutex);
-    int waitTimeout(FCriticalSection& mutex, unsigned int ms);
-
-private:
-    FEvent* event;
-};
+#pragma once
+
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeLock.h"
+#include <chrono>
+#include <condition_variable>
+
+
+
+    
+/**
+ * Condition variable that works on top of a FCriticalSection.
+ * The waits take a predicate that is evaluated while the mutex is held,
+ * so a signal sent by a thread that changed the state under the same
+ * mutex can't be lost.
+ */
+class CondWait {
+public:
+    CondWait();
+    ~CondWait();
+    void signal();
+    void broadcast();
+
+    /* mutex must be locked, returns when pred() is true */
+    template <typename Predicate>
+    void wait(FCriticalSection& mutex, Predicate pred) {
+        LockAdapter lock(mutex);
+        cond.wait(lock, pred);
+    }
+
+    /* mutex must be locked, returns the value of pred() after at most ms milliseconds */
+    template <typename Predicate>
+    bool waitTimeout(FCriticalSection& mutex, unsigned int ms, Predicate pred) {
+        LockAdapter lock(mutex);
+        return cond.wait_for(lock, std::chrono::milliseconds(ms), pred);
+    }
+
+private:
+    struct LockAdapter {
+        explicit LockAdapter(FCriticalSection& m) : mutex(m) {}
+        void lock() { mutex.Lock(); }
+        void unlock() { mutex.Unlock(); }
+        FCriticalSection& mutex;
+    };
+
+    std::condition_variable_any cond;
+};
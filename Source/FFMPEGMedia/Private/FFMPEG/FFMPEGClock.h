@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 class FFMPEGPacketQueue;
 
 class FFMPEGClock
@@ -27,10 +29,10 @@ private:
     double pts_drift;     /* clock base minus time at which we updated the clock */
     double last_updated;
     double speed;
-    int serial;           /* clock is based on a packet with this serial */
+    std::atomic<int> serial; /* clock is based on a packet with this serial */
     bool paused;
 
-    int* queue_serial;
+    const std::atomic<int>* queue_serial;
 
     //int *queue_serial;    /* pointer to the current packet queue serial, used for obsolete clock detection */
 };
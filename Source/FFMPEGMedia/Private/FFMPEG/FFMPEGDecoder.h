@@ -1,50 +1,60 @@
-#pragma once
-
-
-#include "CondWait.h"
-#include "FFMPEGPacketQueue.h"
-#include "FFMPEGFrameQueue.h"
-#include <thread>
-#include <functional>
-
-extern "C" {
-#include <libavcodec/avcodec.h>
-}
-
-
-class FFMPEGDecoder
-{
-public:
-    FFMPEGDecoder();
-    ~FFMPEGDecoder();
-
-    void Init(AVCodecContext *avctx, FFMPEGPacketQueue *queue, CondWait *empty_queue_cond);
-    int DecodeFrame( AVFrame *frame, AVSubtitle *sub);
-    void SetDecoderReorderPts ( int pts );
-    void Abort(FFMPEGFrameQueue* fq);
-    void Destroy();
-    int Start(std::function<int (void *)> thread_func, void *arg );
-
-    AVCodecContext* GetAvctx();
-    int GetPktSerial();
-    int GetFinished();
-    
-    void SetTime ( int64_t start_pts, AVRational  start_pts_tb);
-    void SetFinished ( int finished );
-
-private:
-    int decoder_reorder_pts;
-    FFMPEGPacketQueue *queue;
-    AVCodecContext *avctx;
-    int pkt_serial;
-    int finished;
-    bool packet_pending;
-    CondWait *empty_queue_cond;
-    int64_t start_pts;
-    AVRational start_pts_tb;
-    int64_t next_pts;
-    AVRational next_pts_tb;
-
-    std::thread *decoder_tid;
-};
-
+#pragma once
+
+
+#include "CondWait.h"
+#include "FFMPEGPacketQueue.h"
+#include "FFMPEGFrameQueue.h"
+#include <atomic>
+#include <functional>
+#include "HAL/PlatformAffinity.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class FRunnableThread;
+
+class FFMPEGDecoder
+{
+public:
+    FFMPEGDecoder();
+    ~FFMPEGDecoder();
+
+    void Init(AVCodecContext *avctx, FFMPEGPacketQueue *queue, std::function<void ()> empty_queue_callback);
+    /* called on the decoder thread before every packet goes to the codec, the codec settings can change there */
+    void SetPacketCallback(std::function<void ()> packet_callback);
+    int DecodeFrame( AVFrame *frame, AVSubtitle *sub);
+    void SetDecoderReorderPts ( int pts );
+    void Abort(FFMPEGFrameQueue* fq);
+    void Destroy();
+    int Start(std::function<int (void *)> thread_func, void *arg, const TCHAR *thread_name, EThreadPriority priority = TPri_Normal, uint64 affinity_mask = FPlatformAffinity::GetNoAffinityMask());
+
+    AVCodecContext* GetAvctx();
+    int GetPktSerial();
+    int GetFinished();
+    /* seconds spent in the codec per decoded frame, waiting for packets isn't counted */
+    double GetDecodeTimePerFrame() const;
+    
+    void SetTime ( int64_t start_pts, AVRational  start_pts_tb);
+    void SetFinished ( int finished );
+
+private:
+    int decoder_reorder_pts;
+    FFMPEGPacketQueue *queue;
+    AVCodecContext *avctx;
+    int pkt_serial;
+    int finished;
+    bool packet_pending;
+    std::function<void ()> empty_queue_callback;
+    std::function<void ()> packet_callback;
+    int64_t start_pts;
+    AVRational start_pts_tb;
+    int64_t next_pts;
+    AVRational next_pts_tb;
+
+    FRunnableThread *decoder_tid;
+
+    std::atomic<int64_t> decode_time;   /* microseconds */
+    std::atomic<int64_t> decoded_frames;
+};
+
@@ -0,0 +1,99 @@
+#include "FFMPEGDecoderThreading.h"
+
+extern "C" {
+    #include "libavutil/cpu.h"
+}
+
+/* past this the threads mostly wait on each other */
+#define DECODER_MAX_THREADS 16
+/* frame threads a live source can use when the codec doesn't have slice threads, one frame of latency */
+#define DECODER_LIVE_FRAME_THREADS 2
+
+
+std::atomic<int> FFMPEGDecoderThreadingPolicy::num_video_decoders(0);
+
+FFMPEGDecoderThreading FFMPEGDecoderThreadingPolicy::Choose(const AVCodec *codec, const AVCodecContext *avctx, bool live, int max_threads) {
+    FFMPEGDecoderThreading threading = { 0, 1, "single threaded codec" };
+    bool frame_threads = (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS) != 0;
+    bool slice_threads = (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) != 0;
+
+    if (avctx->codec_type != AVMEDIA_TYPE_VIDEO) {
+        /* audio and subtitle packets are too small to split, the extra threads would only sleep */
+        if (max_threads > 0 && (frame_threads || slice_threads)) {
+            threading.thread_type = frame_threads ? FF_THREAD_FRAME : FF_THREAD_SLICE;
+            threading.thread_count = FFMIN(max_threads, DECODER_MAX_THREADS);
+            threading.reason = "configured";
+        }
+        return threading;
+    }
+
+    if (avctx->hw_device_ctx || (codec->capabilities & AV_CODEC_CAP_HARDWARE)) {
+        /* the device decodes, more threads only add surfaces and latency */
+        threading.reason = "hardware decoder";
+        return threading;
+    }
+
+    if (!frame_threads && !slice_threads)
+        return threading;
+
+    int count;
+    if (max_threads > 0) {
+        count = max_threads;
+        threading.reason = "configured";
+    } else {
+        /* this decoder isn't counted yet */
+        int decoders = num_video_decoders.load() + 1;
+        int cores = FFMAX(av_cpu_count() / decoders, 1);
+        count = FFMIN(GetResolutionThreads(avctx->width, avctx->height), cores);
+        threading.reason = live ? "live, by resolution" : "file, by resolution";
+    }
+
+    if (live && slice_threads) {
+        threading.thread_type = FF_THREAD_SLICE;
+    } else if (frame_threads) {
+        threading.thread_type = FF_THREAD_FRAME;
+        if (live && max_threads <= 0) {
+            count = FFMIN(count, DECODER_LIVE_FRAME_THREADS);
+            threading.reason = "live, no slice threads";
+        }
+    } else {
+        threading.thread_type = FF_THREAD_SLICE;
+    }
+
+    threading.thread_count = FFMAX(1, FFMIN(count, DECODER_MAX_THREADS));
+    return threading;
+}
+
+int FFMPEGDecoderThreadingPolicy::GetResolutionThreads(int width, int height) {
+    int64_t pixels = (int64_t)width * height;
+
+    if (pixels <= 0)
+        return 4;   /* unknown until the first frame */
+    if (pixels <= 640 * 480)
+        return 2;
+    if (pixels <= 1280 * 720)
+        return 4;
+    if (pixels <= 1920 * 1080)
+        return 8;
+    return 12;
+}
+
+void FFMPEGDecoderThreadingPolicy::AddVideoDecoder() {
+    num_video_decoders++;
+}
+
+void FFMPEGDecoderThreadingPolicy::RemoveVideoDecoder() {
+    num_video_decoders--;
+}
+
+int FFMPEGDecoderThreadingPolicy::GetNumVideoDecoders() {
+    return num_video_decoders;
+}
+
+const char* FFMPEGDecoderThreadingPolicy::GetThreadTypeName(int thread_type) {
+    if (thread_type == FF_THREAD_FRAME)
+        return "frame";
+    if (thread_type == FF_THREAD_SLICE)
+        return "slice";
+    return "none";
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+extern "C" {
+    #include "libavcodec/avcodec.h"
+}
+
+/* threading picked for a decoder, reason is a static string shown in the stats */
+struct FFMPEGDecoderThreading {
+    int thread_type;    /* FF_THREAD_FRAME, FF_THREAD_SLICE or 0 */
+    int thread_count;
+    const char *reason;
+};
+
+/**
+ * Picks the thread type and count of a decoder before it's opened.
+ *
+ * Frame threading decodes N frames at once, the fastest way to go through a
+ * file, but the decoder holds N-1 frames before the first one comes out, so
+ * live sources use slice threads when the codec has them. The number of
+ * threads follows the resolution, a small picture doesn't have enough work
+ * for many threads, and the cores are split between the video decoders open
+ * in the process so several players don't oversubscribe the machine.
+ */
+class FFMPEGDecoderThreadingPolicy
+{
+public:
+    /* max_threads > 0 forces the thread count, the type is still picked from the codec */
+    static FFMPEGDecoderThreading Choose(const AVCodec *codec, const AVCodecContext *avctx, bool live, int max_threads);
+
+    /* the open video decoders sharing the cores */
+    static void AddVideoDecoder();
+    static void RemoveVideoDecoder();
+    static int GetNumVideoDecoders();
+
+    static const char* GetThreadTypeName(int thread_type);
+
+private:
+    static int GetResolutionThreads(int width, int height);
+
+    static std::atomic<int> num_video_decoders;
+};
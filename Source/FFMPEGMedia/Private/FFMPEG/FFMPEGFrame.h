@@ -1,5 +1,8 @@
 #pragma once
 
+#include "IMediaTextureSample.h"
+#include "Templates/SharedPointer.h"
+
 extern "C" {
     #include <libavcodec/avcodec.h>
 }
@@ -26,6 +29,7 @@ public:
     bool  IsUploaded();
     bool  IsVerticalFlip();
     AVSubtitle& GetSub();
+    TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> GetSample();
     
     void UpdateFrame(AVFrame* src_frame, double pts, double duration, int64_t pos, int serial);
     void UpdateSize(FFMPEGFrame *vp);
@@ -39,6 +43,7 @@ public:
     void SetHeight(int height);
     void SetUploaded(bool u);
     void SetVerticalFlip(bool v);
+    void SetSample(TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> s);
 
     double GetDifference( FFMPEGFrame* nextvp, double max );
 
@@ -55,4 +60,5 @@ private:
     AVRational sar;
     bool uploaded;
     bool flip_v;
+    TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> sample;   /* converted ahead of presentation */
 };
@@ -0,0 +1,230 @@
+#include "FFMPEGFrameAllocator.h"
+
+extern "C" {
+    #include "libavcodec/avcodec.h"
+    #include "libavutil/buffer.h"
+    #include "libavutil/imgutils.h"
+    #include "libavutil/pixdesc.h"
+}
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#elif PLATFORM_LINUX || PLATFORM_ANDROID
+#include <stdlib.h>
+#include <sys/mman.h>
+
+/* transparent huge pages are only worth it for buffers that span a whole page */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+/* the decoders may read a little past the last plane, like in the default allocator */
+#define FRAME_ALLOCATOR_PADDING 16
+
+FFMPEGFrameAllocator::FFMPEGFrameAllocator()
+    : pool(NULL)
+    , frame_size(0)
+    , format(AV_PIX_FMT_NONE)
+    , width(0)
+    , height(0)
+    , huge_pages(false)
+    , gets(0)
+    , misses(0)
+{
+    for (int i = 0; i < 4; i++) {
+        linesize[i] = 0;
+        plane_offset[i] = -1;
+    }
+}
+
+
+FFMPEGFrameAllocator::~FFMPEGFrameAllocator()
+{
+    Reset();
+}
+
+void FFMPEGFrameAllocator::Init(AVCodecContext *avctx, bool huge_pages) {
+    FScopeLock lock(&mutex);
+
+    ReleasePool();
+    this->huge_pages = huge_pages;
+    gets = 0;
+    misses = 0;
+
+    if (avctx->pix_fmt != AV_PIX_FMT_NONE && avctx->width > 0 && avctx->height > 0)
+        Configure(avctx, avctx->pix_fmt, avctx->width, avctx->height);
+}
+
+void FFMPEGFrameAllocator::Reset() {
+    FScopeLock lock(&mutex);
+    ReleasePool();
+}
+
+void FFMPEGFrameAllocator::ReleasePool() {
+    /* buffers still referenced by frames or samples keep the pool alive */
+    av_buffer_pool_uninit(&pool);
+    for (int i = 0; i < 4; i++) {
+        linesize[i] = 0;
+        plane_offset[i] = -1;
+    }
+    frame_size = 0;
+    format = AV_PIX_FMT_NONE;
+    width = 0;
+    height = 0;
+}
+
+bool FFMPEGFrameAllocator::Configure(AVCodecContext *avctx, AVPixelFormat fmt, int w, int h) {
+    if (pool && format == fmt && width == w && height == h)
+        return true;
+
+    ReleasePool();
+
+    /* same padding as the default allocator, with the line sizes aligned
+       for both the decoder and the conversion kernels */
+    int aligned_w = w;
+    int aligned_h = h;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    int unaligned;
+    avcodec_align_dimensions2(avctx, &aligned_w, &aligned_h, stride_align);
+
+    do {
+        if (av_image_fill_linesizes(linesize, fmt, aligned_w) < 0)
+            return false;
+        aligned_w += aligned_w & ~(aligned_w - 1);
+
+        unaligned = 0;
+        for (int i = 0; i < 4; i++)
+            unaligned |= linesize[i] % FFMAX(stride_align[i], FRAME_ALLOCATOR_ALIGN);
+    } while (unaligned);
+
+    /* the planes follow each other in the frame buffer, with the padded heights.
+       The line sizes are multiples of the alignment so every plane starts aligned */
+    uint8_t *data[4] = { NULL };
+    int total = av_image_fill_pointers(data, fmt, aligned_h, (uint8_t*)FRAME_ALLOCATOR_ALIGN, linesize);
+    if (total < 0)
+        return false;
+
+    for (int i = 0; i < 4; i++)
+        plane_offset[i] = data[i] ? (int)(data[i] - data[0]) : -1;
+
+    frame_size = total;
+    pool = av_buffer_pool_init2(total + FRAME_ALLOCATOR_PADDING, this, Alloc, NULL);
+    if (!pool) {
+        ReleasePool();
+        return false;
+    }
+
+    format = fmt;
+    width = w;
+    height = h;
+    return true;
+}
+
+int FFMPEGFrameAllocator::GetBuffer(AVCodecContext *avctx, AVFrame *frame, int flags) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    int desc_flags = AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+    desc_flags |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+
+    /* hardware frames, palettes and codecs that can't render into
+       user buffers are left to the default allocator */
+    if (avctx->codec_type != AVMEDIA_TYPE_VIDEO || avctx->hw_frames_ctx || !desc || (desc->flags & desc_flags) ||
+        !avctx->codec || !(avctx->codec->capabilities & AV_CODEC_CAP_DR1))
+        return avcodec_default_get_buffer2(avctx, frame, flags);
+
+    {
+        FScopeLock lock(&mutex);
+
+        if (!Configure(avctx, (AVPixelFormat)frame->format, frame->width, frame->height))
+            return avcodec_default_get_buffer2(avctx, frame, flags);
+
+        frame->buf[0] = av_buffer_pool_get(pool);
+        if (!frame->buf[0])
+            return AVERROR(ENOMEM);
+        gets++;
+
+        for (int i = 0; i < 4 && plane_offset[i] >= 0; i++) {
+            frame->data[i] = frame->buf[0]->data + plane_offset[i];
+            frame->linesize[i] = linesize[i];
+        }
+    }
+
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+int64 FFMPEGFrameAllocator::GetHits() const {
+    return gets - misses;
+}
+
+int64 FFMPEGFrameAllocator::GetMisses() const {
+    return misses;
+}
+
+int64 FFMPEGFrameAllocator::GetFrameSize() const {
+    FScopeLock lock(&mutex);
+    return frame_size;
+}
+
+AVBufferRef* FFMPEGFrameAllocator::Alloc(void *opaque, int size) {
+    FFMPEGFrameAllocator *allocator = (FFMPEGFrameAllocator*)opaque;
+    uint8_t *data = NULL;
+    bool huge = false;
+    bool zeroed = false;
+
+    allocator->misses++;
+
+#if PLATFORM_WINDOWS
+    /* needs the "Lock pages in memory" privilege, without it the buffer comes from FMemory */
+    SIZE_T large_page = GetLargePageMinimum();
+    if (allocator->huge_pages && large_page && (SIZE_T)size >= large_page) {
+        SIZE_T rounded = Align((SIZE_T)size, large_page);
+        data = (uint8_t*)VirtualAlloc(NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        huge = data != NULL;
+        /* committed pages are zero filled by the system */
+        zeroed = huge;
+    }
+#elif PLATFORM_LINUX || PLATFORM_ANDROID
+    if (allocator->huge_pages && size >= HUGE_PAGE_SIZE) {
+        size_t rounded = Align((size_t)size, (size_t)HUGE_PAGE_SIZE);
+        if (posix_memalign((void**)&data, HUGE_PAGE_SIZE, rounded) == 0) {
+#ifdef MADV_HUGEPAGE
+            madvise(data, rounded, MADV_HUGEPAGE);
+#endif
+            huge = true;
+        } else {
+            data = NULL;
+        }
+    }
+#endif
+
+    if (!data)
+        data = (uint8_t*)FMemory::Malloc(size, FRAME_ALLOCATOR_ALIGN);
+    if (!data)
+        return NULL;
+
+    /* like av_buffer_allocz, the decoders may read the padding */
+    if (!zeroed)
+        FMemory::Memzero(data, size);
+
+    /* a non null opaque tells Free the buffer didn't come from FMemory */
+    AVBufferRef *buf = av_buffer_create(data, size, Free, huge ? data : NULL, 0);
+    if (!buf)
+        Free(huge ? data : NULL, data);
+    return buf;
+}
+
+void FFMPEGFrameAllocator::Free(void *opaque, uint8_t *data) {
+#if PLATFORM_WINDOWS
+    if (opaque) {
+        VirtualFree(data, 0, MEM_RELEASE);
+        return;
+    }
+#elif PLATFORM_LINUX || PLATFORM_ANDROID
+    if (opaque) {
+        free(data);
+        return;
+    }
+#endif
+    FMemory::Free(data);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+
+extern "C" {
+    #include "libavutil/pixfmt.h"
+}
+
+/* the plane pointers and line sizes are aligned for the widest SIMD loads */
+#define FRAME_ALLOCATOR_ALIGN 64
+
+struct AVBufferPool;
+struct AVBufferRef;
+struct AVCodecContext;
+struct AVFrame;
+
+/**
+ * get_buffer2 implementation that hands out the video frames from an
+ * AVBufferPool. Each frame is a single pooled buffer with its planes laid out
+ * one after the other, so a semi-planar frame can be handed to the texture
+ * sample as is. The pool is sized for the stream dimensions and pixel format
+ * and rebuilt when they change, so once playback is running the decoder keeps
+ * getting back the buffers the frame queue released.
+ */
+class FFMPEGFrameAllocator
+{
+public:
+    FFMPEGFrameAllocator();
+    ~FFMPEGFrameAllocator();
+
+    /* sizes the pool for the codec parameters, has to be called before avcodec_open2.
+       huge_pages backs the buffers with large pages where the platform has them */
+    void Init(AVCodecContext *avctx, bool huge_pages);
+    void Reset();
+
+    int GetBuffer(AVCodecContext *avctx, AVFrame *frame, int flags);
+
+    int64 GetHits() const;
+    int64 GetMisses() const;
+    /* bytes of one pooled frame */
+    int64 GetFrameSize() const;
+
+private:
+    bool Configure(AVCodecContext *avctx, AVPixelFormat format, int width, int height);
+    void ReleasePool();
+
+    static AVBufferRef* Alloc(void *opaque, int size);
+    static void Free(void *opaque, uint8_t *data);
+
+    mutable FCriticalSection mutex;
+
+    AVBufferPool *pool;
+    int linesize[4];
+    /* offset of each plane in the frame buffer, -1 for the planes the format doesn't have */
+    int plane_offset[4];
+    int frame_size;
+
+    AVPixelFormat format;
+    int width;
+    int height;
+    bool huge_pages;
+
+    std::atomic<int64> gets;
+    std::atomic<int64> misses;
+};
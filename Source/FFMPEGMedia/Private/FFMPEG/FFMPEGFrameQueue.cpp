@@ -1,160 +1,282 @@
-#include "FFMPEGFrameQueue.h"
-#include "FFMPEGFrame.h"
-
-
-FFMPEGFrameQueue::FFMPEGFrameQueue()
-{
-    for ( int i = 0; i < FRAME_QUEUE_SIZE; i++) {
-        queue[i] = new FFMPEGFrame();
-    }
-
-    rindex = 0;
-    windex = 0;
-    size = 0;
-    max_size = 0;
-    keep_last = 0;
-    rindex_shown = 0;
-    pktq = NULL;
-}
-
-
-FFMPEGFrameQueue::~FFMPEGFrameQueue()
-{
-    Destroy();
-    for (int i = 0; i < FRAME_QUEUE_SIZE; i++) {
-        if ( queue[i] ) delete queue[i];
-        queue[i] = NULL;
-    }
-}
-
-int FFMPEGFrameQueue::Init( FFMPEGPacketQueue *_pktq, int _max_size, int _keep_last) {
-    this->pktq = _pktq;
-    this->max_size = FFMIN(_max_size, FRAME_QUEUE_SIZE);
-    this->keep_last = !!_keep_last;
-    for (int i = 0; i < this->max_size; i++)
-        if (!(queue[i]->Init()))
-            return AVERROR(ENOMEM);
-    return 0;
-}
-
-void FFMPEGFrameQueue::Destroy() {
-    
-    for (int i = 0; i < max_size; i++) {
-        FFMPEGFrame *vp = queue[i];
-        if ( vp) vp->Destroy();
-    }
-    
-    rindex = 0;
-    windex = 0;
-    size = 0;
-    max_size = 0;
-    keep_last = 0;
-    rindex_shown = 0;
-    pktq = NULL;
-}
-
-void FFMPEGFrameQueue::Signal() {
-    mutex.Lock();
-    cond.signal();
-    mutex.Unlock();
-}
-
-FFMPEGFrame *FFMPEGFrameQueue::Peek() {
-    return queue[(rindex + rindex_shown) % max_size];
-}
-
-FFMPEGFrame *FFMPEGFrameQueue::PeekNext() {
-    return queue[(rindex + rindex_shown + 1) % max_size];
-}
-
-FFMPEGFrame *FFMPEGFrameQueue::PeekLast() {
-    return queue[rindex];
-}
-
-FFMPEGFrame *FFMPEGFrameQueue::PeekWritable() {
-    mutex.Lock();
-    while (size >= max_size &&
-        !pktq->IsAbortRequest()) {
-        cond.wait(mutex);
-    }
-    mutex.Unlock();
-
-    if (pktq->IsAbortRequest())
-        return NULL;
-
-    return queue[windex];
-}
-FFMPEGFrame *FFMPEGFrameQueue::PeekReadable() {
-    mutex.Lock();
-    while (size - rindex_shown <= 0 &&
-        !pktq->IsAbortRequest()) {
-        cond.wait(mutex);
-    }
-    mutex.Unlock();
-
-    if (pktq->IsAbortRequest())
-        return NULL;
-
-    return queue[(rindex + rindex_shown) % max_size];
-}
-
-int FFMPEGFrameQueue::QueuePicture( AVFrame *src_frame, double pts, double duration, int64_t pos, int serial) {
-    
-    FFMPEGFrame *vp = PeekWritable();
-    if (!vp )
-        return -1;
-
-    vp->UpdateFrame(src_frame, pts, duration, pos, serial);
-    av_frame_move_ref(vp->GetFrame(), src_frame);
-
-    Push();
-    return 0;
-}
-
-void FFMPEGFrameQueue::Push() {
-    if (++windex == max_size)
-        windex = 0;
-    mutex.Lock();
-    size++;
-    cond.signal();
-    mutex.Unlock();
-}
-
-void FFMPEGFrameQueue::Next() {
-    if (keep_last && !rindex_shown) {
-        rindex_shown = 1;
-        return;
-    }
-    queue[rindex]->UnRef();
-    if (++rindex == max_size)
-        rindex = 0;
-    mutex.Lock();
-    size--;
-    cond.signal();
-    mutex.Unlock();
-   
-}
-
-void FFMPEGFrameQueue::Lock() {
-    mutex.Lock();
-}
-
-void FFMPEGFrameQueue::Unlock() {
-    mutex.Unlock();
-}
-
-int FFMPEGFrameQueue::GetNumRemaining() {
-     return size - rindex_shown;
-}
-
-int64_t FFMPEGFrameQueue::GetQueueLastPos() {
-    FFMPEGFrame *fp = queue[rindex];
-    if (rindex_shown && fp->GetSerial() == pktq->GetSerial())
-        return fp->GetPos();
-    else
-        return -1;
-}
-
-int  FFMPEGFrameQueue::GetIndexShown() {
-    return rindex_shown;
-}
+#include "FFMPEGFrameQueue.h"
+#include "FFMPEGFrame.h"
+
+
+static inline uint64_t SlotSeq(uint64_t pos, int stage) {
+    return pos * 4 + stage;
+}
+
+FFMPEGFrameQueue::FFMPEGFrameQueue()
+{
+    slots = NULL;
+    windex = 0;
+    rindex = 0;
+    rindex_shown = 0;
+    cindex = 0;
+    max_size = 0;
+    keep_last = 0;
+    depth = 0;
+    waiters = 0;
+    pktq = NULL;
+}
+
+
+FFMPEGFrameQueue::~FFMPEGFrameQueue()
+{
+    Destroy();
+}
+
+int FFMPEGFrameQueue::Init( FFMPEGPacketQueue *_pktq, int _max_size, int _keep_last) {
+    Destroy();
+
+    this->pktq = _pktq;
+    this->keep_last = !!_keep_last;
+    /* keep_last holds on to the shown frame, it needs one more slot to make progress */
+    this->max_size = FFMIN(FFMAX(_max_size, 1 + this->keep_last), FRAME_QUEUE_MAX_SIZE);
+    this->depth = this->max_size;
+    windex = 0;
+    rindex = 0;
+    rindex_shown = 0;
+    cindex = 0;
+
+    /* new[] only aligns to the default boundary before C++17 */
+    slots = (FFMPEGFrameSlot*)FMemory::Malloc(sizeof(FFMPEGFrameSlot) * this->max_size, alignof(FFMPEGFrameSlot));
+    for (int i = 0; i < this->max_size; i++) {
+        new (&slots[i]) FFMPEGFrameSlot();
+        slots[i].seq = SlotSeq(i, FRAME_SLOT_EMPTY);
+        slots[i].frame = new FFMPEGFrame();
+    }
+    for (int i = 0; i < this->max_size; i++) {
+        if (!(slots[i].frame->Init()))
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+void FFMPEGFrameQueue::Destroy() {
+    
+    if (slots) {
+        for (int i = 0; i < max_size; i++) {
+            FFMPEGFrame *vp = slots[i].frame;
+            if ( vp) {
+                vp->Destroy();
+                delete vp;
+            }
+            slots[i].~FFMPEGFrameSlot();
+        }
+        FMemory::Free(slots);
+        slots = NULL;
+    }
+    
+    windex = 0;
+    rindex = 0;
+    rindex_shown = 0;
+    cindex = 0;
+    max_size = 0;
+    keep_last = 0;
+    depth = 0;
+    pktq = NULL;
+}
+
+FFMPEGFrameSlot *FFMPEGFrameQueue::GetSlot(uint64_t pos) {
+    return &slots[pos % max_size];
+}
+
+void FFMPEGFrameQueue::WakeWaiters() {
+    /* the seq_cst stores that published the change are ordered before this load */
+    if (waiters.load() > 0) {
+        mutex.Lock();
+        cond.broadcast();
+        mutex.Unlock();
+    }
+}
+
+template <typename Predicate>
+void FFMPEGFrameQueue::WaitFor(Predicate pred) {
+    if (pred())
+        return;
+
+    mutex.Lock();
+    waiters++;
+    cond.wait(mutex, pred);
+    waiters--;
+    mutex.Unlock();
+}
+
+void FFMPEGFrameQueue::Signal() {
+    mutex.Lock();
+    cond.broadcast();
+    mutex.Unlock();
+}
+
+FFMPEGFrame *FFMPEGFrameQueue::Peek() {
+    return GetSlot(rindex.load(std::memory_order_relaxed) + rindex_shown.load(std::memory_order_relaxed))->frame;
+}
+
+FFMPEGFrame *FFMPEGFrameQueue::PeekNext() {
+    return GetSlot(rindex.load(std::memory_order_relaxed) + rindex_shown.load(std::memory_order_relaxed) + 1)->frame;
+}
+
+FFMPEGFrame *FFMPEGFrameQueue::PeekLast() {
+    return GetSlot(rindex.load(std::memory_order_relaxed))->frame;
+}
+
+FFMPEGFrame *FFMPEGFrameQueue::PeekWritable() {
+    uint64_t w = windex.load(std::memory_order_relaxed);
+    FFMPEGFrameSlot *slot = GetSlot(w);
+
+    /* the slot is free once the reader released it on the previous lap */
+    WaitFor([this, slot, w] {
+        return (slot->seq.load() == SlotSeq(w, FRAME_SLOT_EMPTY) && w - rindex.load() < (uint64_t)depth.load()) ||
+            pktq->IsAbortRequest();
+    });
+
+    if (pktq->IsAbortRequest())
+        return NULL;
+
+    return slot->frame;
+}
+FFMPEGFrame *FFMPEGFrameQueue::PeekReadable() {
+    uint64_t r = rindex.load(std::memory_order_relaxed) + rindex_shown.load(std::memory_order_relaxed);
+    FFMPEGFrameSlot *slot = GetSlot(r);
+
+    WaitFor([this, slot, r] {
+        return slot->seq.load() >= SlotSeq(r, FRAME_SLOT_PUSHED) || pktq->IsAbortRequest();
+    });
+
+    if (pktq->IsAbortRequest())
+        return NULL;
+
+    return slot->frame;
+}
+
+int FFMPEGFrameQueue::QueuePicture( AVFrame *src_frame, double pts, double duration, int64_t pos, int serial) {
+    
+    FFMPEGFrame *vp = PeekWritable();
+    if (!vp )
+        return -1;
+
+    vp->UpdateFrame(src_frame, pts, duration, pos, serial);
+    av_frame_move_ref(vp->GetFrame(), src_frame);
+
+    Push();
+    return 0;
+}
+
+void FFMPEGFrameQueue::Push() {
+    uint64_t w = windex.load(std::memory_order_relaxed);
+    GetSlot(w)->seq.store(SlotSeq(w, FRAME_SLOT_PUSHED));
+    windex.store(w + 1);
+    WakeWaiters();
+    if (push_callback)
+        push_callback();
+}
+
+void FFMPEGFrameQueue::SetPushCallback(std::function<void ()> callback) {
+    push_callback = callback;
+}
+
+void FFMPEGFrameQueue::Next() {
+    if (keep_last && !rindex_shown) {
+        rindex_shown = 1;
+        return;
+    }
+
+    uint64_t r = rindex.load(std::memory_order_relaxed);
+    FFMPEGFrameSlot *slot = GetSlot(r);
+
+    /* take the frame away from the convert task if it didn't get to it yet,
+       otherwise wait until it's done with it */
+    uint64_t pushed = SlotSeq(r, FRAME_SLOT_PUSHED);
+    if (!slot->seq.compare_exchange_strong(pushed, SlotSeq(r, FRAME_SLOT_DONE))) {
+        WaitFor([slot, r] {
+            return slot->seq.load() != SlotSeq(r, FRAME_SLOT_CONVERTING);
+        });
+    }
+
+    slot->frame->UnRef();
+    rindex.store(r + 1);
+    slot->seq.store(SlotSeq(r + max_size, FRAME_SLOT_EMPTY));
+    WakeWaiters();
+}
+
+int FFMPEGFrameQueue::SetDepth(int _depth) {
+    depth = FFMIN(FFMAX(_depth, 1 + keep_last), max_size);
+    return depth;
+}
+
+int FFMPEGFrameQueue::GetDepth() const {
+    return depth;
+}
+
+FFMPEGFrame *FFMPEGFrameQueue::PeekConvertible() {
+    for (;;) {
+        if (pktq->IsAbortRequest())
+            return NULL;
+
+        FFMPEGFrameSlot *slot = GetSlot(cindex);
+        uint64_t seq = slot->seq.load();
+        uint64_t c = cindex;
+
+        if (seq >= SlotSeq(c, FRAME_SLOT_DONE)) {
+            /* dropped by the reader before it was converted */
+            cindex++;
+            continue;
+        }
+
+        if (seq == SlotSeq(c, FRAME_SLOT_PUSHED)) {
+            if (slot->seq.compare_exchange_strong(seq, SlotSeq(c, FRAME_SLOT_CONVERTING)))
+                return slot->frame;
+            continue;
+        }
+
+        /* not pushed yet, the push callback tells when it is */
+        return NULL;
+    }
+}
+
+void FFMPEGFrameQueue::NextConverted() {
+    GetSlot(cindex)->seq.store(SlotSeq(cindex, FRAME_SLOT_DONE));
+    cindex++;
+    WakeWaiters();
+}
+
+bool FFMPEGFrameQueue::IsConverted(FFMPEGFrame *vp) {
+    for (int i = 0; i < max_size; i++) {
+        if (slots[i].frame == vp)
+            return !IsPendingConversion(&slots[i]);
+    }
+    return true;
+}
+
+bool FFMPEGFrameQueue::IsPendingConversion(FFMPEGFrameSlot *slot) {
+    int stage = (int)(slot->seq.load() & 3);
+    return stage == FRAME_SLOT_PUSHED || stage == FRAME_SLOT_CONVERTING;
+}
+
+void FFMPEGFrameQueue::Lock() {
+    mutex.Lock();
+}
+
+void FFMPEGFrameQueue::Unlock() {
+    mutex.Unlock();
+}
+
+int FFMPEGFrameQueue::GetNumRemaining() const {
+    /* rindex first, windex never falls behind it */
+    uint64_t r = rindex.load();
+    uint64_t w = windex.load();
+    return FFMAX((int)(w - r) - rindex_shown.load(), 0);
+}
+
+int64_t FFMPEGFrameQueue::GetQueueLastPos() {
+    FFMPEGFrame *fp = GetSlot(rindex.load(std::memory_order_relaxed))->frame;
+    if (rindex_shown && fp->GetSerial() == pktq->GetSerial())
+        return fp->GetPos();
+    else
+        return -1;
+}
+
+int  FFMPEGFrameQueue::GetIndexShown() const {
+    return rindex_shown;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <mutex>
+#include <atomic>
+#include <functional>
 #include "FFMPEGPacketQueue.h"
 
 
@@ -7,14 +9,35 @@
 #define FFMAX(a,b) ((a) > (b) ? (a) : (b))
 #endif
 
+/* default depths, the players can change them with the settings or the media options */
 #define VIDEO_PICTURE_QUEUE_SIZE 3
 #define SUBPICTURE_QUEUE_SIZE 16
 #define SAMPLE_QUEUE_SIZE 9
-#define FRAME_QUEUE_SIZE FFMAX(SAMPLE_QUEUE_SIZE, FFMAX(VIDEO_PICTURE_QUEUE_SIZE, SUBPICTURE_QUEUE_SIZE))
+#define FRAME_QUEUE_MAX_SIZE 128
 
 class FFMPEGFrame;
 struct AVFrame;
 
+/* the sequence of a slot is 4 * its position in the stream plus its stage */
+#define FRAME_SLOT_EMPTY      0
+#define FRAME_SLOT_PUSHED     1
+#define FRAME_SLOT_CONVERTING 2
+#define FRAME_SLOT_DONE       3
+
+/* one slot per cache line so the threads working on neighbour frames don't share lines,
+   the array is allocated with the same alignment by Init */
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FFMPEGFrameSlot {
+    std::atomic<uint64_t> seq;
+    FFMPEGFrame *frame;
+};
+
+/**
+ * Ring of decoded frames with one producer (the decoder), one reader and
+ * optionally a convert task walking between them. Each slot carries a
+ * sequence number that tells which lap and stage it is in, so handing a
+ * frame over is a single atomic store and the mutex is only taken by a
+ * thread that has to block or by the one waking it.
+ */
 class FFMPEGFrameQueue
 {
 public:
@@ -35,25 +58,54 @@ public:
     FFMPEGFrame *PeekReadable();
     void Push();
     void Next();
+
+    /* limits the frames the producer can queue, between 1 + keep_last and the size given to Init.
+       Returns the depth applied, more than asked when below the minimum */
+    int SetDepth(int depth);
+    int GetDepth() const;
+
+    /* called by Push after the frame is published, set before the producer starts */
+    void SetPushCallback(std::function<void ()> callback);
+
+    /* the convert task walks the pushed frames ahead of the reader, NULL when it caught up with the producer */
+    FFMPEGFrame *PeekConvertible();
+    void NextConverted();
+    bool IsConverted(FFMPEGFrame *vp);
     
 
     void Lock();
     void Unlock();
 
     int64_t GetQueueLastPos();
-    int GetNumRemaining();
-    int GetIndexShown();
+    int GetNumRemaining() const;
+    int GetIndexShown() const;
 
 private:
+    FFMPEGFrameSlot *GetSlot(uint64_t pos);
+    bool IsPendingConversion(FFMPEGFrameSlot *slot);
+    void WakeWaiters();
+    template <typename Predicate> void WaitFor(Predicate pred);
     
-    FFMPEGFrame* queue[FRAME_QUEUE_SIZE];
-    int rindex;
-    int windex;
-    int size;
+    /* allocated by Init for max_size frames */
+    FFMPEGFrameSlot *slots;
     int max_size;
     int keep_last;
-    int rindex_shown;
+    std::atomic<int> depth;
+
+    /* written by the producer */
+    std::atomic<uint64_t> windex;
+    char pad0[PLATFORM_CACHE_LINE_SIZE];
+    /* written by the reader */
+    std::atomic<uint64_t> rindex;
+    std::atomic<int> rindex_shown;
+    char pad1[PLATFORM_CACHE_LINE_SIZE];
+    /* only used by the convert task */
+    uint64_t cindex;
+    char pad2[PLATFORM_CACHE_LINE_SIZE];
+
+    std::atomic<int> waiters;
     FCriticalSection mutex;
     CondWait cond;
     FFMPEGPacketQueue *pktq;
-};
\ No newline at end of file
+    std::function<void ()> push_callback;
+};
@@ -1,203 +1,312 @@
-#include "FFMPEGPacketQueue.h"
-
-extern "C" {
-    #include <inttypes.h>
-    #include "libavcodec/avcodec.h"
-}
-
-struct MyAVPacketList {
-    AVPacket pkt;
-    struct MyAVPacketList *next;
-    int serial;
-};
-
-typedef struct MyAVPacketList MyAVPacketList;
-
-AVPacket* FFMPEGPacketQueue::flush_pkt_queue = NULL;
-std::mutex  flush_pkt_queue_mutex;
-
-FFMPEGPacketQueue::FFMPEGPacketQueue()
-{
-    
-    first_pkt = NULL;
-    last_pkt = NULL;
-    nb_packets = 0;
-    size = 0;
-    duration = 0;
-    abort_request = true;
-    serial = 0;
-}
-
-
-FFMPEGPacketQueue::~FFMPEGPacketQueue()
-{
-     Flush();
-}
-
-AVPacket* FFMPEGPacketQueue::FlushPkt() {
-    if ( flush_pkt_queue == NULL) {
-        flush_pkt_queue_mutex.lock();
-        if ( flush_pkt_queue == NULL) {
-            flush_pkt_queue = new AVPacket();
-            av_init_packet(flush_pkt_queue);
-            flush_pkt_queue->data = (uint8_t *)flush_pkt_queue;
-        }
-        flush_pkt_queue_mutex.unlock();
-    }
-    return flush_pkt_queue;
-}
-
-int FFMPEGPacketQueue::Put(AVPacket *pkt) {
-    int ret;
-
-    mutex.Lock();
-    ret = PutPrivate( pkt);
-    mutex.Unlock();
-
-    if (pkt != FlushPkt() && ret < 0)
-        av_packet_unref(pkt);
-
-    return ret;
-}
-
-int FFMPEGPacketQueue::PutNullPacket(int stream_index) {
-    AVPacket pkt1, *pkt = &pkt1;
-    av_init_packet(pkt);
-    pkt->data = NULL;
-    pkt->size = 0;
-    pkt->stream_index = stream_index;
-    return Put(pkt);
-}
-
-int FFMPEGPacketQueue::PutPrivate(AVPacket *pkt) {
-    MyAVPacketList *pkt1;
-
-    if (abort_request)
-        return -1;
-
-    pkt1 = new MyAVPacketList();
-    if (!pkt1)
-        return -1;
-    pkt1->pkt = *pkt;
-    pkt1->next = NULL;
-    if (pkt == FlushPkt())
-        serial++;
-    pkt1->serial = serial;
-
-    if (!last_pkt)
-        first_pkt = pkt1;
-    else
-        last_pkt->next = pkt1;
-    last_pkt = pkt1;
-    nb_packets++;
-    size += pkt1->pkt.size + sizeof(*pkt1);
-    duration += pkt1->pkt.duration;
-    /* XXX: should duplicate packet data in DV case */
-    cond.signal();
-    return 0;
-}
-
-int  FFMPEGPacketQueue::Get(AVPacket *pkt, int block, int *_serial) {
-    MyAVPacketList *pkt1;
-    int ret;
-
-    mutex.Lock();
-
-    for (;;) {
-        if (abort_request) {
-            ret = -1;
-            break;
-        }
-
-        pkt1 = first_pkt;
-        if (pkt1) {
-            first_pkt = pkt1->next;
-            if (!first_pkt)
-                last_pkt = NULL;
-            nb_packets--;
-            size -= pkt1->pkt.size + sizeof(*pkt1);
-            duration -= pkt1->pkt.duration;
-            *pkt = pkt1->pkt;
-            if (_serial)
-                *_serial = pkt1->serial;
-            delete pkt1;
-            ret = 1;
-            break;
-        }
-        else if (!block) {
-            ret = 0;
-            break;
-        }
-        else {
-            cond.wait(mutex);
-        }
-    }
-    mutex.Unlock();
-    return ret;
-}
-
-
-void FFMPEGPacketQueue::Abort() {
-    mutex.Lock();
-    abort_request = true;
-    cond.signal();
-    mutex.Unlock();
-}
-
-void FFMPEGPacketQueue::Start() {
-    mutex.Lock();
-    abort_request = false;
-    PutPrivate(FlushPkt());
-    mutex.Unlock();
-}
-
-void FFMPEGPacketQueue::Flush() {
-    MyAVPacketList *pkt, *pkt1;
-
-    mutex.Lock();
-    for (pkt = first_pkt; pkt; pkt = pkt1) {
-        pkt1 = pkt->next;
-        av_packet_unref(&pkt->pkt);
-        delete pkt;
-    }
-    last_pkt = NULL;
-    first_pkt = NULL;
-    nb_packets = 0;
-    size = 0;
-    duration = 0;
-    mutex.Unlock();
-}
-
-int FFMPEGPacketQueue::PutFlush() {
-    return Put(FlushPkt());
-}
-
-int FFMPEGPacketQueue::GetSize() {
-    return size;
-}
-
-int FFMPEGPacketQueue::GetSerial() {
-    return serial;
-}
-
-bool FFMPEGPacketQueue::IsAbortRequest() {
-    return abort_request;
-}
-
-int FFMPEGPacketQueue::GetNumPackets() {
-    return nb_packets;
-}
-
-int FFMPEGPacketQueue::GetDuration() {
-    return duration;    
-}
-
-bool FFMPEGPacketQueue::IsFlushPacket( void* data) {
-    if ( flush_pkt_queue != NULL) {
-        return flush_pkt_queue->data == data;
-    }
-    return false;
-}
-
-
-
+#include "FFMPEGPacketQueue.h"
+
+#include <thread>
+
+extern "C" {
+    #include <inttypes.h>
+    #include "libavcodec/avcodec.h"
+}
+
+struct MyAVPacketSlot {
+    AVPacket pkt;
+    int serial;
+    bool used;
+};
+
+typedef struct MyAVPacketSlot MyAVPacketSlot;
+
+AVPacket* FFMPEGPacketQueue::flush_pkt_queue = NULL;
+std::mutex  flush_pkt_queue_mutex;
+
+FFMPEGPacketQueue::FFMPEGPacketQueue()
+{
+    static_assert((PACKET_QUEUE_MIN_CAPACITY & (PACKET_QUEUE_MIN_CAPACITY - 1)) == 0, "PACKET_QUEUE_MIN_CAPACITY must be a power of two");
+    static_assert((PACKET_QUEUE_MAX_CAPACITY & (PACKET_QUEUE_MAX_CAPACITY - 1)) == 0, "PACKET_QUEUE_MAX_CAPACITY must be a power of two");
+
+    capacity = 0;
+    slots = NULL;
+    write_index = 0;
+    read_index = 0;
+    release_index = 0;
+    nb_packets = 0;
+    size = 0;
+    duration = 0;
+    abort_request = true;
+    serial = 0;
+    puts = 0;
+    reused_slots = 0;
+    flushes = 0;
+    flushed_packets = 0;
+    peak_packets = 0;
+    consumer_waiting = false;
+    producer_waiting = false;
+}
+
+
+FFMPEGPacketQueue::~FFMPEGPacketQueue()
+{
+     Flush();
+     delete [] slots;
+     slots = NULL;
+}
+
+AVPacket* FFMPEGPacketQueue::FlushPkt() {
+    if ( flush_pkt_queue == NULL) {
+        flush_pkt_queue_mutex.lock();
+        if ( flush_pkt_queue == NULL) {
+            flush_pkt_queue = new AVPacket();
+            av_init_packet(flush_pkt_queue);
+            flush_pkt_queue->data = (uint8_t *)flush_pkt_queue;
+        }
+        flush_pkt_queue_mutex.unlock();
+    }
+    return flush_pkt_queue;
+}
+
+int FFMPEGPacketQueue::Put(AVPacket *pkt) {
+    int ret;
+
+    ret = PutPrivate( pkt);
+
+    if (pkt != FlushPkt() && ret < 0)
+        av_packet_unref(pkt);
+
+    return ret;
+}
+
+int FFMPEGPacketQueue::PutNullPacket(int stream_index) {
+    AVPacket pkt1, *pkt = &pkt1;
+    av_init_packet(pkt);
+    pkt->data = NULL;
+    pkt->size = 0;
+    pkt->stream_index = stream_index;
+    return Put(pkt);
+}
+
+int FFMPEGPacketQueue::PutPrivate(AVPacket *pkt) {
+    MyAVPacketSlot *pkt1;
+
+    if (abort_request)
+        return -1;
+
+    uint32_t w = write_index.load(std::memory_order_relaxed);
+    if (w - release_index.load(std::memory_order_acquire) >= capacity) {
+        if (!WaitWritable())
+            return -1;
+    }
+
+    pkt1 = &slots[w & (capacity - 1)];
+    pkt1->pkt = *pkt;
+    if (pkt == FlushPkt())
+        serial++;
+    pkt1->serial = serial.load(std::memory_order_relaxed);
+
+    int packets = ++nb_packets;
+    size += pkt1->pkt.size + sizeof(*pkt1);
+    duration += pkt1->pkt.duration;
+
+    puts.fetch_add(1, std::memory_order_relaxed);
+    if (pkt1->used)
+        reused_slots.fetch_add(1, std::memory_order_relaxed);
+    pkt1->used = true;
+    if (packets > peak_packets.load(std::memory_order_relaxed))
+        peak_packets.store(packets, std::memory_order_relaxed);
+
+    /* publish the slot, the store must be ordered before reading consumer_waiting */
+    write_index.store(w + 1);
+    if (consumer_waiting) {
+        mutex.Lock();
+        not_empty.signal();
+        mutex.Unlock();
+    }
+    return 0;
+}
+
+bool FFMPEGPacketQueue::PopPrivate(AVPacket *pkt, int *_serial) {
+    uint32_t r = read_index.load(std::memory_order_acquire);
+
+    /* claim the slot first, Flush may take the pending slots at the same time */
+    do {
+        if (r == write_index.load(std::memory_order_acquire))
+            return false;
+    } while (!read_index.compare_exchange_weak(r, r + 1));
+
+    /* the producer can't reuse the slot before it's released */
+    MyAVPacketSlot *pkt1 = &slots[r & (capacity - 1)];
+    *pkt = pkt1->pkt;
+    if (_serial)
+        *_serial = pkt1->serial;
+
+    nb_packets--;
+    size -= pkt->size + sizeof(*pkt1);
+    duration -= pkt->duration;
+
+    ReleaseSlots(r, r + 1);
+    return true;
+}
+
+void FFMPEGPacketQueue::ReleaseSlots(uint32_t first, uint32_t last) {
+    /* the slots go back in ring order, an earlier claim of the other side is released first */
+    while (release_index.load(std::memory_order_acquire) != first)
+        std::this_thread::yield();
+    release_index.store(last, std::memory_order_release);
+
+    if (producer_waiting) {
+        mutex.Lock();
+        not_full.signal();
+        mutex.Unlock();
+    }
+}
+
+bool FFMPEGPacketQueue::WaitWritable() {
+    mutex.Lock();
+    producer_waiting = true;
+    not_full.wait(mutex, [this] {
+        return abort_request || write_index.load(std::memory_order_relaxed) - release_index.load() < capacity;
+    });
+    producer_waiting = false;
+    mutex.Unlock();
+    return !abort_request;
+}
+
+int  FFMPEGPacketQueue::Get(AVPacket *pkt, int block, int *_serial) {
+    for (;;) {
+        if (abort_request)
+            return -1;
+
+        if (PopPrivate(pkt, _serial))
+            return 1;
+
+        if (!block)
+            return 0;
+
+        mutex.Lock();
+        consumer_waiting = true;
+        not_empty.wait(mutex, [this] {
+            return abort_request || read_index.load() != write_index.load();
+        });
+        consumer_waiting = false;
+        mutex.Unlock();
+    }
+}
+
+
+void FFMPEGPacketQueue::Abort() {
+    mutex.Lock();
+    abort_request = true;
+    not_empty.signal();
+    not_full.signal();
+    mutex.Unlock();
+}
+
+void FFMPEGPacketQueue::Start() {
+    if (!slots)
+        SetCapacity(PACKET_QUEUE_MIN_CAPACITY);
+    abort_request = false;
+    PutPrivate(FlushPkt());
+}
+
+int FFMPEGPacketQueue::SetCapacity(int packets) {
+    /* the slots can only be replaced while neither the reader nor the decoder use them */
+    if (!abort_request)
+        return capacity;
+
+    uint32_t new_capacity = FMath::RoundUpToPowerOfTwo((uint32_t)FFMAX(packets, 1));
+    new_capacity = FFMIN(FFMAX(new_capacity, (uint32_t)PACKET_QUEUE_MIN_CAPACITY), (uint32_t)PACKET_QUEUE_MAX_CAPACITY);
+    if (slots && new_capacity == capacity)
+        return capacity;
+
+    Flush();
+    delete [] slots;
+    slots = new MyAVPacketSlot[new_capacity]();
+    capacity = new_capacity;
+
+    /* the ring restarts at the first slot, the packet counters were released by the flush */
+    write_index = 0;
+    read_index = 0;
+    release_index = 0;
+    return capacity;
+}
+
+int FFMPEGPacketQueue::GetCapacity() const {
+    return capacity;
+}
+
+void FFMPEGPacketQueue::Flush() {
+    uint32_t r = read_index.load(std::memory_order_acquire);
+    uint32_t w;
+
+    /* claim every published slot at once, the decoder may be popping concurrently */
+    do {
+        w = write_index.load(std::memory_order_acquire);
+    } while (!read_index.compare_exchange_weak(r, w));
+
+    if (r == w)
+        return;
+
+    /* the whole chain is released with one update of the shared counters */
+    int released_size = 0;
+    int64_t released_duration = 0;
+    for (uint32_t i = r; i != w; i++) {
+        MyAVPacketSlot *pkt = &slots[i & (capacity - 1)];
+        released_size += pkt->pkt.size + sizeof(*pkt);
+        released_duration += pkt->pkt.duration;
+        av_packet_unref(&pkt->pkt);
+    }
+
+    nb_packets -= (int)(w - r);
+    size -= released_size;
+    duration -= released_duration;
+    flushes.fetch_add(1, std::memory_order_relaxed);
+    flushed_packets.fetch_add(w - r, std::memory_order_relaxed);
+
+    ReleaseSlots(r, w);
+}
+
+int FFMPEGPacketQueue::PutFlush() {
+    return Put(FlushPkt());
+}
+
+int FFMPEGPacketQueue::GetSize() const {
+    return size;
+}
+
+int FFMPEGPacketQueue::GetSerial() const {
+    return serial.load(std::memory_order_acquire);
+}
+
+bool FFMPEGPacketQueue::IsAbortRequest() const {
+    return abort_request;
+}
+
+bool FFMPEGPacketQueue::IsFull() const {
+    return write_index.load(std::memory_order_relaxed) - release_index.load(std::memory_order_relaxed) >= capacity;
+}
+
+int FFMPEGPacketQueue::GetNumPackets() const {
+    return nb_packets;
+}
+
+int64_t FFMPEGPacketQueue::GetDuration() const {
+    return duration;
+}
+
+FFMPEGPacketQueueStats FFMPEGPacketQueue::GetStats() const {
+    FFMPEGPacketQueueStats stats;
+    stats.puts = puts;
+    stats.reused_slots = reused_slots;
+    stats.flushes = flushes;
+    stats.flushed_packets = flushed_packets;
+    stats.peak_packets = peak_packets;
+    return stats;
+}
+
+bool FFMPEGPacketQueue::IsFlushPacket( void* data) {
+    if ( flush_pkt_queue != NULL) {
+        return flush_pkt_queue->data == data;
+    }
+    return false;
+}
+
+
+
@@ -2,11 +2,34 @@
 
 #include "CondWait.h"
 #include <mutex>
+#include <atomic>
 
-struct MyAVPacketList;
+/* bounds of the packet slots in each ring, the capacity is a power of two
+   sized for the stream when it's opened */
+#define PACKET_QUEUE_MIN_CAPACITY 64
+#define PACKET_QUEUE_MAX_CAPACITY 8192
+
+struct MyAVPacketSlot;
 struct AVPacket;
 
+/* slot usage counters, the slots are allocated when the queue is sized and recycled in ring order,
+   reused_slots counts the puts into a slot that already held a packet */
+struct FFMPEGPacketQueueStats {
+    int64_t puts;
+    int64_t reused_slots;
+    int64_t flushes;
+    int64_t flushed_packets;
+    int peak_packets;
+};
 
+/**
+ * Bounded single-producer/single-consumer ring of packets.
+ * The read thread is the only producer and the decoder the only consumer,
+ * Flush claims the pending slots from the read side so it can be called
+ * from the producer while the decoder is still running.
+ * A claimed slot is only handed back to the producer once its packet was
+ * taken out, in ring order, so a put never overwrites a slot being read.
+ */
 class FFMPEGPacketQueue
 {
 public:
@@ -20,29 +43,56 @@ public:
     void Start();
     void Abort();
     void Flush();
-    int GetSize();
-    bool IsAbortRequest();
-    int GetSerial();
-    int GetNumPackets();
-    int GetDuration();
+    int SetCapacity(int packets);
+    int GetCapacity() const;
+    int GetSize() const;
+    bool IsAbortRequest() const;
+    bool IsFull() const;
+    int GetSerial() const;
+    int GetNumPackets() const;
+    int64_t GetDuration() const;
     static bool IsFlushPacket( void* data);
+    FFMPEGPacketQueueStats GetStats() const;
 
 protected:
 
     AVPacket* FlushPkt();
     int PutPrivate(AVPacket *pkt);
+    bool PopPrivate(AVPacket *pkt, int *serial);
+    bool WaitWritable();
+    void ReleaseSlots(uint32_t first, uint32_t last);
 
     static AVPacket* flush_pkt_queue;
 
-    MyAVPacketList *first_pkt, *last_pkt;
-    int nb_packets;
-    int size;
-    int64_t duration;
-    bool abort_request;
-    int serial;
-    
+    MyAVPacketSlot *slots;
+    uint32_t capacity;
+
+    /* producer and consumer indices live on their own cache lines */
+    char pad0[PLATFORM_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> write_index;
+    char pad1[PLATFORM_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> read_index;
+    std::atomic<uint32_t> release_index;
+    char pad2[PLATFORM_CACHE_LINE_SIZE];
+
+    std::atomic<int> nb_packets;
+    std::atomic<int> size;
+    std::atomic<int64_t> duration;
+    std::atomic<bool> abort_request;
+    std::atomic<int> serial;
+
+    std::atomic<int64_t> puts;
+    std::atomic<int64_t> reused_slots;
+    std::atomic<int64_t> flushes;
+    std::atomic<int64_t> flushed_packets;
+    std::atomic<int> peak_packets;
+
+    /* only touched when the ring is empty or full */
+    std::atomic<bool> consumer_waiting;
+    std::atomic<bool> producer_waiting;
     FCriticalSection mutex;
-    CondWait cond;
+    CondWait not_empty;
+    CondWait not_full;
 
     friend class FFMPEGClock;
 
@@ -0,0 +1,100 @@
+#include "FFMPEGPipelineState.h"
+
+FFMPEGPipelineState::FFMPEGPipelineState()
+{
+    state = EPipelineState::Closed;
+    aborted = false;
+    commands = 0;
+    generation = 0;
+}
+
+
+FFMPEGPipelineState::~FFMPEGPipelineState()
+{
+}
+
+void FFMPEGPipelineState::Start(EPipelineState s) {
+    mutex.Lock();
+    aborted = false;
+    commands = 0;
+    state = s;
+    generation++;
+    cond.broadcast();
+    mutex.Unlock();
+    Changed();
+}
+
+void FFMPEGPipelineState::Abort() {
+    mutex.Lock();
+    aborted = true;
+    state = EPipelineState::Closed;
+    generation++;
+    cond.broadcast();
+    mutex.Unlock();
+    Changed();
+}
+
+bool FFMPEGPipelineState::IsAborted() const {
+    return aborted;
+}
+
+void FFMPEGPipelineState::Set(EPipelineState s) {
+    mutex.Lock();
+    bool changed = state != s;
+    if (changed) {
+        state = s;
+        generation++;
+        cond.broadcast();
+    }
+    mutex.Unlock();
+    if (changed)
+        Changed();
+}
+
+EPipelineState FFMPEGPipelineState::Get() const {
+    return state;
+}
+
+bool FFMPEGPipelineState::IsPlaying() const {
+    return state == EPipelineState::Playing;
+}
+
+void FFMPEGPipelineState::Notify() {
+    mutex.Lock();
+    cond.broadcast();
+    mutex.Unlock();
+    Changed();
+}
+
+void FFMPEGPipelineState::Post(EPipelineCommand command) {
+    /* under the mutex so a waiter can't miss it between its check and its wait */
+    mutex.Lock();
+    commands |= (uint32)command;
+    if (command != EPipelineCommand::Read)
+        generation++;
+    cond.broadcast();
+    mutex.Unlock();
+    if (command != EPipelineCommand::Read)
+        Changed();
+}
+
+bool FFMPEGPipelineState::Take(EPipelineCommand command) {
+    return (commands.fetch_and(~(uint32)command) & (uint32)command) != 0;
+}
+
+bool FFMPEGPipelineState::IsPending(EPipelineCommand command) const {
+    return (commands & (uint32)command) != 0;
+}
+
+uint32 FFMPEGPipelineState::GetGeneration() const {
+    return generation;
+}
+
+void FFMPEGPipelineState::SetChangeCallback(std::function<void ()> callback) {
+    change_callback = callback;
+}
+
+void FFMPEGPipelineState::Changed() {
+    if (change_callback)
+        change_callback();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CondWait.h"
+#include <atomic>
+#include <functional>
+
+enum class EPipelineState : uint8 {
+    Closed = 0,
+    Prerolling,     /* decoding until the first frame is ready */
+    Playing,
+    Paused,
+    Stopped
+};
+
+/* one shot requests posted to the pipeline threads, they stay pending until taken */
+enum class EPipelineCommand : uint32 {
+    Read = 1 << 0,  /* the read thread has work: a stream was opened or a packet queue drained */
+    Seek = 1 << 1   /* a seek is waiting for the read thread */
+};
+
+/**
+ * Playback state and command channel shared by the pipeline threads.
+ * Threads that have nothing to do in the current state block on it
+ * instead of polling, and are woken up on every state change and command.
+ * The state, the abort flag and the commands are atomics, so they can be
+ * checked from any thread without taking the mutex.
+ */
+class FFMPEGPipelineState
+{
+public:
+    FFMPEGPipelineState();
+    ~FFMPEGPipelineState();
+
+    void Start(EPipelineState state);
+    void Abort();
+    bool IsAborted() const;
+
+    void Set(EPipelineState state);
+    EPipelineState Get() const;
+    bool IsPlaying() const;
+
+    /* wakes the waiters so they re-evaluate flags that aren't part of the state */
+    void Notify();
+
+    /* sets the command and wakes the waiters */
+    void Post(EPipelineCommand command);
+    /* clears the command, returns whether it was pending */
+    bool Take(EPipelineCommand command);
+    bool IsPending(EPipelineCommand command) const;
+
+    /* changes with every state change, abort and seek, but not with Read which only concerns the reader */
+    uint32 GetGeneration() const;
+
+    /* called outside the mutex whenever the waiters are woken, except for Read, for the stages running as tasks */
+    void SetChangeCallback(std::function<void ()> callback);
+
+    /* blocks until pred() is true or the pipeline is aborted, returns false when aborted */
+    template <typename Predicate>
+    bool Wait(Predicate pred) {
+        mutex.Lock();
+        cond.wait(mutex, [this, &pred] { return aborted || pred(); });
+        bool ret = !aborted;
+        mutex.Unlock();
+        return ret;
+    }
+
+    /* blocks until pred() is true, the pipeline is aborted or ms milliseconds passed, returns pred() || aborted */
+    template <typename Predicate>
+    bool WaitTimeout(unsigned int ms, Predicate pred) {
+        mutex.Lock();
+        bool ret = cond.waitTimeout(mutex, ms, [this, &pred] { return aborted || pred(); });
+        mutex.Unlock();
+        return ret;
+    }
+
+private:
+    void Changed();
+
+    std::atomic<EPipelineState> state;
+    std::atomic<bool> aborted;
+    std::atomic<uint32> commands;
+    std::atomic<uint32> generation;
+    FCriticalSection mutex;
+    CondWait cond;
+    std::function<void ()> change_callback;
+};
@@ -0,0 +1,156 @@
+#include "FFMPEGSliceScaler.h"
+#include "Async/ParallelFor.h"
+
+extern "C" {
+    #include "libavutil/frame.h"
+    #include "libavutil/imgutils.h"
+    #include "libavutil/pixdesc.h"
+    #include "libswscale/swscale.h"
+}
+
+FFMPEGSliceScaler::FFMPEGSliceScaler()
+{
+}
+
+
+FFMPEGSliceScaler::~FFMPEGSliceScaler()
+{
+    Reset();
+}
+
+void FFMPEGSliceScaler::Reset() {
+    for (SwsContext* ctx : contexts) {
+        sws_freeContext(ctx);
+    }
+    contexts.Empty();
+    overlap_buffers.Empty();
+}
+
+static void OffsetPlanes(const AVPixFmtDescriptor *desc, int y, uint8_t *const data[4], const int linesize[4], uint8_t *out[4]) {
+    for (int i = 0; i < 4; i++) {
+        /* only the chroma planes are subsampled, the alpha plane has the luma height */
+        int shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+        out[i] = data[i] ? data[i] + (ptrdiff_t)linesize[i] * (y >> shift) : NULL;
+    }
+}
+
+bool FFMPEGSliceScaler::Scale(const AVFrame *frame, int dst_width, int dst_height, AVPixelFormat dst_format,
+                               uint8_t *const dst[4], const int dst_stride[4], int slices) {
+    const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    const AVPixFmtDescriptor *dst_desc = av_pix_fmt_desc_get(dst_format);
+    int width = frame->width;
+    int height = frame->height;
+
+    if (!src_desc || !dst_desc || dst_width <= 0 || dst_height <= 0)
+        return false;
+
+    /* palettes and bitstream formats can't be split by rows */
+    if ((src_desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM)) || (dst_desc->flags & AV_PIX_FMT_FLAG_PAL))
+        slices = 1;
+
+    /* a slice scaled on its own has its own vertical ratio and its filter stops at
+       the slice edges, which shows as seams, only same size conversions are split */
+    if (dst_width != width || dst_height != height)
+        slices = 1;
+
+    slices = FMath::Clamp(slices, 1, FMath::Max(1, height / SLICE_SCALER_MIN_ROWS));
+
+    /* every slice has to start on a chroma row of both images */
+    int log2_chroma_h = FMath::Max(src_desc->log2_chroma_h, dst_desc->log2_chroma_h);
+    int align = 1 << log2_chroma_h;
+    TArray<int, TInlineAllocator<64>> rows;
+
+    for (int i = 0; i <= slices; i++) {
+        int y = i == slices ? height : AlignDown((int)((int64)i * height / slices), align);
+        if (i > 0 && y <= rows.Last()) {
+            /* too small to split, convert it in one go */
+            rows = { 0, height };
+            slices = 1;
+            break;
+        }
+        rows.Add(y);
+    }
+
+    /* the vertical chroma filter clamps at the edges of its input, a slice of subsampled
+       chroma is converted with the rows around it so its edges don't show as seams */
+    int overlap = (slices > 1 && log2_chroma_h > 0) ? SLICE_SCALER_OVERLAP_CHROMA_ROWS << log2_chroma_h : 0;
+    TArray<int, TInlineAllocator<64>> tops;
+    TArray<int, TInlineAllocator<64>> bottoms;
+
+    for (int i = 0; i < slices; i++) {
+        tops.Add(FMath::Max(rows[i] - overlap, 0));
+        bottoms.Add(FMath::Min(rows[i + 1] + overlap, height));
+    }
+
+    while (contexts.Num() < slices) {
+        contexts.Add(NULL);
+    }
+
+    for (int i = 0; i < slices; i++) {
+        contexts[i] = sws_getCachedContext(contexts[i], width, bottoms[i] - tops[i], (AVPixelFormat)frame->format,
+            dst_width, slices == 1 ? dst_height : bottoms[i] - tops[i], dst_format, SWS_BICUBIC, NULL, NULL, NULL);
+        if (!contexts[i])
+            return false;
+    }
+
+    int overlap_linesize[4] = { 0 };
+    size_t overlap_offsets[5] = { 0 };
+
+    if (overlap > 0) {
+        int max_rows = 0;
+        for (int i = 0; i < slices; i++) {
+            max_rows = FMath::Max(max_rows, bottoms[i] - tops[i]);
+        }
+
+        /* the overlapping output keeps the destination strides */
+        for (int p = 0; p < 4; p++) {
+            int shift = (p == 1 || p == 2) ? dst_desc->log2_chroma_h : 0;
+            int plane_rows = dst[p] ? AV_CEIL_RSHIFT(max_rows, shift) : 0;
+            overlap_offsets[p + 1] = overlap_offsets[p] + (size_t)dst_stride[p] * plane_rows;
+            overlap_linesize[p] = dst[p] ? av_image_get_linesize(dst_format, dst_width, p) : 0;
+        }
+
+        while (overlap_buffers.Num() < slices) {
+            overlap_buffers.AddDefaulted();
+        }
+
+        for (int i = 0; i < slices; i++) {
+            overlap_buffers[i].SetNumUninitialized((int32)overlap_offsets[4], false);
+        }
+    }
+
+    ParallelFor(slices, [&](int32 i) {
+        uint8_t *src_slice[4];
+        uint8_t *dst_slice[4];
+
+        OffsetPlanes(src_desc, tops[i], frame->data, frame->linesize, src_slice);
+
+        if (overlap == 0) {
+            OffsetPlanes(dst_desc, rows[i], dst, dst_stride, dst_slice);
+            sws_scale(contexts[i], src_slice, frame->linesize, 0, rows[i + 1] - rows[i], dst_slice, dst_stride);
+            return;
+        }
+
+        uint8_t *out[4];
+        for (int p = 0; p < 4; p++) {
+            out[p] = dst[p] ? overlap_buffers[i].GetData() + overlap_offsets[p] : NULL;
+        }
+
+        sws_scale(contexts[i], src_slice, frame->linesize, 0, bottoms[i] - tops[i], out, dst_stride);
+
+        /* only the rows of this slice go to the destination */
+        OffsetPlanes(dst_desc, rows[i], dst, dst_stride, dst_slice);
+
+        for (int p = 0; p < 4; p++) {
+            if (!dst[p])
+                continue;
+            int shift = (p == 1 || p == 2) ? dst_desc->log2_chroma_h : 0;
+            int first = (rows[i] - tops[i]) >> shift;
+            int count = AV_CEIL_RSHIFT(rows[i + 1], shift) - (rows[i] >> shift);
+            av_image_copy_plane(dst_slice[p], dst_stride[p], out[p] + (ptrdiff_t)dst_stride[p] * first, dst_stride[p],
+                overlap_linesize[p], count);
+        }
+    }, slices == 1);
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+extern "C" {
+    #include "libavutil/pixfmt.h"
+}
+
+/* slices shorter than this aren't worth a worker */
+#define SLICE_SCALER_MIN_ROWS 64
+
+/* chroma rows each slice reads past its edges, the bicubic filter spans 4 of them */
+#define SLICE_SCALER_OVERLAP_CHROMA_ROWS 4
+
+struct AVFrame;
+struct SwsContext;
+
+/**
+ * Converts a frame in horizontal slices, each slice has its own SwsContext
+ * and runs on a task graph worker. Scale returns once every slice is done.
+ * Frames that change size are scaled by a single context, the filters of
+ * separate slices would leave seams at their edges.
+ * When either format has subsampled chroma rows, each slice also converts
+ * the rows the chroma filter needs around it into its own buffer and only
+ * copies its own rows out, so the slice edges match a single conversion.
+ */
+class FFMPEGSliceScaler
+{
+public:
+    FFMPEGSliceScaler();
+    ~FFMPEGSliceScaler();
+
+    /* converts the frame to dst_width x dst_height, in slices when the size doesn't change */
+    bool Scale(const AVFrame *frame, int dst_width, int dst_height, AVPixelFormat dst_format,
+               uint8_t *const dst[4], const int dst_stride[4], int slices);
+    void Reset();
+
+protected:
+    TArray<SwsContext*> contexts;
+
+    /* per slice output of the overlapping rows */
+    TArray<TArray<uint8>> overlap_buffers;
+};
@@ -0,0 +1,396 @@
+#include "FFMPEGTaskPool.h"
+#include "LambdaFunctionRunnable.h"
+
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+#include "Math/UnrealMathUtility.h"
+#include <cmath>
+
+
+#define TASK_IDLE    0  /* parked or sleeping */
+#define TASK_QUEUED  1
+#define TASK_RUNNING 2
+#define TASK_WOKEN   3  /* woken while running, queued again when the run ends */
+#define TASK_DONE    4
+
+class FFMPEGTask {
+public:
+    FFMPEGTask(std::function<double ()> _func, FFMPEGTaskPriority _priority) : func(_func), state(TASK_IDLE), priority(_priority), cancelled(false), timer(0) {}
+
+    std::function<double ()> func;
+    std::atomic<int> state;
+    std::atomic<FFMPEGTaskPriority> priority;
+    std::atomic<bool> cancelled;
+    /* bumped by every wake, the timers set before it are ignored */
+    std::atomic<uint64_t> timer;
+};
+
+/* index of the worker running on this thread, -1 on the other threads */
+static thread_local int worker_index = -1;
+static thread_local FFMPEGTask *current_task = NULL;
+
+FFMPEGTaskPool& FFMPEGTaskPool::Get() {
+    static FFMPEGTaskPool pool;
+    return pool;
+}
+
+FFMPEGTaskPool::FFMPEGTaskPool() {
+    started = false;
+    quit = false;
+    queued = 0;
+    for (int p = 0; p < FFMPEG_TASK_PRIORITIES; p++)
+        queued_by_priority[p] = 0;
+    idle = 0;
+    next_queue = 0;
+    worker_priority = TPri_Normal;
+    worker_affinity_mask = FPlatformAffinity::GetNoAffinityMask();
+    worker_settings = 0;
+    num_tasks = 0;
+    num_runs = 0;
+    num_steals = 0;
+    timers_changed = 0;
+    next_deadline = HUGE_VAL;
+}
+
+FFMPEGTaskPool::~FFMPEGTaskPool() {
+    Shutdown();
+    for (WorkerQueue *q : queues)
+        delete q;
+}
+
+void FFMPEGTaskPool::Start() {
+    mutex.Lock();
+    if (!started && !quit) {
+        /* keep two workers on small machines so a stage waiting on another one can't starve it */
+        int n = FMath::Max(FPlatformMisc::NumberOfCores(), 2);
+        for (int i = 0; i < n; i++)
+            queues.push_back(new WorkerQueue());
+        for (int i = 0; i < n; i++) {
+            workers.push_back(LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGWorker"), [this, i] {
+                WorkerLoop(i);
+            }, (EThreadPriority)worker_priority.load(), worker_affinity_mask.load()));
+        }
+        started = true;
+    }
+    mutex.Unlock();
+}
+
+void FFMPEGTaskPool::Shutdown() {
+    mutex.Lock();
+    quit = true;
+    cond.broadcast();
+    mutex.Unlock();
+
+    for (FRunnableThread *worker : workers) {
+        if (worker) {
+            worker->WaitForCompletion();
+            delete worker;
+        }
+    }
+    workers.clear();
+
+    mutex.Lock();
+    timers = std::priority_queue<Timer>();
+    mutex.Unlock();
+    /* Push checks quit under the same lock, nothing is queued after this */
+    for (WorkerQueue *q : queues) {
+        q->mutex.Lock();
+        for (int p = 0; p < FFMPEG_TASK_PRIORITIES; p++) {
+            for (const FFMPEGTaskRef& task : q->tasks[p]) {
+                task->state = TASK_DONE;
+                Finish(task.get());
+            }
+            q->tasks[p].clear();
+        }
+        q->mutex.Unlock();
+    }
+}
+
+void FFMPEGTaskPool::SetWorkerThreadSettings(EThreadPriority priority, uint64 affinity_mask) {
+    mutex.Lock();
+    if (worker_priority != priority || worker_affinity_mask != affinity_mask) {
+        worker_priority = priority;
+        worker_affinity_mask = affinity_mask;
+        worker_settings++;
+        /* the idle workers apply them when they wake up */
+        cond.broadcast();
+    }
+    mutex.Unlock();
+}
+
+FFMPEGTaskRef FFMPEGTaskPool::Schedule(std::function<double ()> func, double delay, FFMPEGTaskPriority priority) {
+    if (!started)
+        Start();
+
+    /* nothing would ever run it */
+    if (quit)
+        return FFMPEGTaskRef();
+
+    FFMPEGTaskRef task = std::make_shared<FFMPEGTask>(func, priority);
+    num_tasks++;
+
+    if (delay > 0.0) {
+        AddTimer(task, task->timer.load(), delay);
+    } else {
+        task->state = TASK_QUEUED;
+        Push(task);
+    }
+    return task;
+}
+
+void FFMPEGTaskPool::SetPriority(const FFMPEGTaskRef& task, FFMPEGTaskPriority priority) {
+    if (task)
+        task->priority = priority;
+}
+
+void FFMPEGTaskPool::Wake(const FFMPEGTaskRef& task) {
+    if (!task)
+        return;
+
+    int s = task->state.load();
+    for (;;) {
+        if (s == TASK_IDLE) {
+            if (task->state.compare_exchange_weak(s, TASK_QUEUED)) {
+                task->timer++;
+                Push(task);
+                return;
+            }
+        } else if (s == TASK_RUNNING) {
+            if (task->state.compare_exchange_weak(s, TASK_WOKEN))
+                return;
+        } else {
+            /* already queued, woken or done */
+            return;
+        }
+    }
+}
+
+void FFMPEGTaskPool::Cancel(const FFMPEGTaskRef& task) {
+    if (!task)
+        return;
+
+    task->cancelled = true;
+    if (current_task == task.get())
+        return;
+
+    /* the worker checks the flag after marking the task running, one of the two sees the other */
+    cancel_mutex.Lock();
+    cancel_cond.wait(cancel_mutex, [&task] {
+        int s = task->state.load();
+        return s != TASK_RUNNING && s != TASK_WOKEN;
+    });
+    cancel_mutex.Unlock();
+
+    /* a parked or sleeping task is never picked up again, release it here */
+    int s = TASK_IDLE;
+    if (task->state.compare_exchange_strong(s, TASK_DONE))
+        Finish(task.get());
+}
+
+int FFMPEGTaskPool::GetNumWorkers() const {
+    return (int)queues.size();
+}
+
+int FFMPEGTaskPool::GetNumTasks() const {
+    return num_tasks;
+}
+
+uint64_t FFMPEGTaskPool::GetNumRuns() const {
+    return num_runs;
+}
+
+uint64_t FFMPEGTaskPool::GetNumSteals() const {
+    return num_steals;
+}
+
+void FFMPEGTaskPool::Finish(FFMPEGTask *task) {
+    /* drop what the function captured, the handle may outlive the owner */
+    task->func = nullptr;
+    num_tasks--;
+}
+
+void FFMPEGTaskPool::Run(const FFMPEGTaskRef& task) {
+    task->state = TASK_RUNNING;
+
+    if (task->cancelled) {
+        task->state = TASK_DONE;
+        Finish(task.get());
+        cancel_mutex.Lock();
+        cancel_cond.broadcast();
+        cancel_mutex.Unlock();
+        return;
+    }
+
+    current_task = task.get();
+    double next = task->func();
+    current_task = NULL;
+    num_runs++;
+
+    if (next == FFMPEG_TASK_DONE || task->cancelled) {
+        task->state = TASK_DONE;
+        Finish(task.get());
+    } else if (next == FFMPEG_TASK_PARK || next > 0.0) {
+        /* read before going idle so a wake coming in between invalidates the timer */
+        uint64_t id = task->timer.load();
+        int s = TASK_RUNNING;
+        if (task->state.compare_exchange_strong(s, TASK_IDLE)) {
+            if (next > 0.0)
+                AddTimer(task, id, next);
+        } else {
+            task->state = TASK_QUEUED;
+            Push(task);
+        }
+    } else {
+        task->state = TASK_QUEUED;
+        Push(task);
+    }
+
+    if (task->cancelled) {
+        cancel_mutex.Lock();
+        cancel_cond.broadcast();
+        cancel_mutex.Unlock();
+    }
+}
+
+void FFMPEGTaskPool::Push(const FFMPEGTaskRef& task) {
+    if (quit) {
+        task->state = TASK_DONE;
+        Finish(task.get());
+        return;
+    }
+
+    int n = (int)queues.size();
+    int index = worker_index >= 0 ? worker_index : (int)(next_queue++ % n);
+    WorkerQueue *q = queues[index];
+    FFMPEGTaskPriority priority = task->priority;
+
+    q->mutex.Lock();
+    if (quit) {
+        /* Shutdown already emptied the queues, release the task like it does */
+        q->mutex.Unlock();
+        task->state = TASK_DONE;
+        Finish(task.get());
+        return;
+    }
+    q->tasks[priority].push_back(task);
+    q->mutex.Unlock();
+
+    /* an idle worker counts itself before checking queued, one of the two sees the other */
+    queued_by_priority[priority]++;
+    queued++;
+    if (idle.load() > 0) {
+        mutex.Lock();
+        cond.signal();
+        mutex.Unlock();
+    }
+}
+
+FFMPEGTaskRef FFMPEGTaskPool::Pop(int index) {
+    int n = (int)queues.size();
+
+    for (int p = 0; p < FFMPEG_TASK_PRIORITIES; p++) {
+        if (queued_by_priority[p].load() <= 0)
+            continue;
+
+        for (int i = 0; i < n; i++) {
+            WorkerQueue *q = queues[(index + i) % n];
+            std::deque<FFMPEGTaskRef>& tasks = q->tasks[p];
+            FFMPEGTaskRef task;
+
+            q->mutex.Lock();
+            if (!tasks.empty()) {
+                /* the owner takes the oldest task, thieves the newest one */
+                if (i == 0) {
+                    task = tasks.front();
+                    tasks.pop_front();
+                } else {
+                    task = tasks.back();
+                    tasks.pop_back();
+                }
+            }
+            q->mutex.Unlock();
+
+            if (task) {
+                queued_by_priority[p]--;
+                queued--;
+                if (i != 0)
+                    num_steals++;
+                return task;
+            }
+        }
+    }
+    return FFMPEGTaskRef();
+}
+
+void FFMPEGTaskPool::AddTimer(const FFMPEGTaskRef& task, uint64_t id, double delay) {
+    double deadline = FPlatformTime::Seconds() + delay;
+
+    mutex.Lock();
+    timers.push({ deadline, id, task });
+    if (deadline < next_deadline) {
+        next_deadline = deadline;
+        /* the idle workers sleep until the previous deadline */
+        timers_changed++;
+        cond.signal();
+    }
+    mutex.Unlock();
+}
+
+void FFMPEGTaskPool::FireTimers() {
+    std::vector<FFMPEGTaskRef> due;
+    double now = FPlatformTime::Seconds();
+
+    mutex.Lock();
+    while (!timers.empty() && timers.top().deadline <= now) {
+        const Timer& t = timers.top();
+        if (t.task->timer.load() == t.id)
+            due.push_back(t.task);
+        timers.pop();
+    }
+    next_deadline = timers.empty() ? HUGE_VAL : timers.top().deadline;
+    mutex.Unlock();
+
+    for (const FFMPEGTaskRef& task : due)
+        Wake(task);
+}
+
+void FFMPEGTaskPool::WorkerLoop(int index) {
+    worker_index = index;
+    /* checked once at start too, the settings may change before this thread runs */
+    int settings = -1;
+
+    while (!quit) {
+        if (settings != worker_settings.load()) {
+            mutex.Lock();
+            settings = worker_settings;
+            EThreadPriority priority = (EThreadPriority)worker_priority.load();
+            uint64 affinity_mask = worker_affinity_mask;
+            mutex.Unlock();
+            LambdaFunctionRunnable::ApplyToCurrentThread(priority, affinity_mask);
+        }
+
+        if (FPlatformTime::Seconds() >= next_deadline.load())
+            FireTimers();
+
+        FFMPEGTaskRef task = Pop(index);
+        if (task) {
+            Run(task);
+            continue;
+        }
+
+        mutex.Lock();
+        idle++;
+        uint64_t changed = timers_changed;
+        auto ready = [this, changed, settings] {
+            return queued.load() > 0 || quit || timers_changed != changed || worker_settings != settings;
+        };
+        double wait = next_deadline.load() - FPlatformTime::Seconds();
+        if (std::isinf(wait)) {
+            cond.wait(mutex, ready);
+        } else if (wait > 0.0) {
+            cond.waitTimeout(mutex, (unsigned int)(wait * 1000.0) + 1, ready);
+        }
+        idle--;
+        mutex.Unlock();
+    }
+}
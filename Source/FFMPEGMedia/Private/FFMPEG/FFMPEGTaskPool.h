@@ -0,0 +1,131 @@
+#pragma once
+
+#include "CondWait.h"
+#include "HAL/PlatformAffinity.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+class FRunnableThread;
+class FFMPEGTask;
+
+typedef std::shared_ptr<FFMPEGTask> FFMPEGTaskRef;
+
+/* a task returns the delay in seconds before its next run, 0 runs it again after the other queued tasks, or one of these */
+#define FFMPEG_TASK_DONE  (-1.0)    /* the task is finished, it won't run again */
+#define FFMPEG_TASK_PARK  (-2.0)    /* the task runs again when it's woken up */
+
+/* queued tasks of a higher priority run first, on every worker */
+enum FFMPEGTaskPriority {
+    FFMPEG_TASK_AUDIO = 0,  /* the audio render, it shares the workers with the video stages and must not starve behind them */
+    FFMPEG_TASK_HIGH,
+    FFMPEG_TASK_NORMAL,
+    FFMPEG_TASK_LOW,
+    FFMPEG_TASK_PRIORITIES
+};
+
+/**
+ * Process wide pool of worker threads running the pipeline stages of every
+ * player as resumable tasks.
+ *
+ * A task is a function that does a bounded amount of work and returns when
+ * it would have to block: it either sleeps for the delay it returns or parks
+ * until Wake is called, which is how a queue that gets a new frame resumes
+ * the stage waiting on it. Each worker runs the tasks of its own queue in
+ * order and steals from the others when it runs out, so a player with a
+ * lot of work spreads over the idle workers. A worker always picks the
+ * highest priority task queued anywhere in the pool, so the stages of the
+ * players that matter most run first when there are more tasks than cores.
+ *
+ * The workers are started with the first task and there is one per core,
+ * whatever the number of players.
+ */
+class FFMPEGTaskPool
+{
+public:
+    static FFMPEGTaskPool& Get();
+
+    /* stops the workers, the tasks still queued are released without running again */
+    void Shutdown();
+
+    /* priority and cores of the workers, the running workers switch to them before their next task */
+    void SetWorkerThreadSettings(EThreadPriority priority, uint64 affinity_mask);
+
+    /* runs func after delay seconds, and then for as long as it doesn't return FFMPEG_TASK_DONE.
+       Returns an empty ref once the pool is shut down */
+    FFMPEGTaskRef Schedule(std::function<double ()> func, double delay = 0.0, FFMPEGTaskPriority priority = FFMPEG_TASK_NORMAL);
+
+    /* used the next time the task is queued */
+    void SetPriority(const FFMPEGTaskRef& task, FFMPEGTaskPriority priority);
+
+    /* runs a parked or sleeping task now, a task woken while running runs again right after */
+    void Wake(const FFMPEGTaskRef& task);
+
+    /* the task doesn't run anymore once this returns, called from the task itself it finishes after the current run */
+    void Cancel(const FFMPEGTaskRef& task);
+
+    int GetNumWorkers() const;
+    int GetNumTasks() const;
+    uint64_t GetNumRuns() const;
+    uint64_t GetNumSteals() const;
+
+private:
+    FFMPEGTaskPool();
+    ~FFMPEGTaskPool();
+
+    struct Timer {
+        double deadline;
+        uint64_t id;
+        FFMPEGTaskRef task;
+        bool operator<(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    /* one queue per worker and priority, on its own cache line */
+    struct WorkerQueue {
+        FCriticalSection mutex;
+        std::deque<FFMPEGTaskRef> tasks[FFMPEG_TASK_PRIORITIES];
+        char pad[PLATFORM_CACHE_LINE_SIZE];
+    };
+
+    void Start();
+    void WorkerLoop(int index);
+    void Run(const FFMPEGTaskRef& task);
+    void Finish(FFMPEGTask *task);
+    void Push(const FFMPEGTaskRef& task);
+    FFMPEGTaskRef Pop(int index);
+    void AddTimer(const FFMPEGTaskRef& task, uint64_t id, double delay);
+    void FireTimers();
+
+    std::vector<WorkerQueue*> queues;
+    std::vector<FRunnableThread*> workers;
+    std::atomic<bool> started;
+    std::atomic<bool> quit;
+
+    std::atomic<int> queued;
+    std::atomic<int> queued_by_priority[FFMPEG_TASK_PRIORITIES];
+    std::atomic<int> idle;
+    std::atomic<unsigned int> next_queue;
+
+    std::atomic<int> worker_priority;
+    std::atomic<uint64> worker_affinity_mask;
+    /* bumped by every settings change */
+    std::atomic<int> worker_settings;
+
+    std::atomic<int> num_tasks;
+    std::atomic<uint64_t> num_runs;
+    std::atomic<uint64_t> num_steals;
+
+    /* protects the timers and the idle workers, which sleep until the first deadline */
+    FCriticalSection mutex;
+    CondWait cond;
+    std::priority_queue<Timer> timers;
+    uint64_t timers_changed;
+    std::atomic<double> next_deadline;
+
+    /* signaled when a cancelled task stops running */
+    FCriticalSection cancel_mutex;
+    CondWait cancel_cond;
+};
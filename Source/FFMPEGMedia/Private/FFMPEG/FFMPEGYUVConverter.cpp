@@ -0,0 +1,425 @@
+#include "FFMPEGYUVConverter.h"
+#include "FFMPEGSliceScaler.h"
+#include "Async/ParallelFor.h"
+
+#include <string.h>
+
+extern "C" {
+    #include "libavutil/frame.h"
+    #include "libavutil/pixfmt.h"
+}
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define YUV_CONVERTER_X86 1
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define YUV_CONVERTER_AVX2_TARGET
+    #else
+        #define YUV_CONVERTER_AVX2_TARGET __attribute__((target("avx2")))
+    #endif
+#else
+    #define YUV_CONVERTER_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define YUV_CONVERTER_NEON 1
+    #include <arm_neon.h>
+#else
+    #define YUV_CONVERTER_NEON 0
+#endif
+
+#define YUV_FIX 13
+#define YUV_ROUND (1 << (YUV_FIX - 1))
+
+typedef void (*ConvertRowFunc)(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+    uint8_t *dst, int width, const FFMPEGYUVCoefficients &c);
+
+FFMPEGYUVCoefficients FFMPEGYUVCoefficients::Get(bool rec709, bool full_range) {
+    double kr = rec709 ? 0.2126 : 0.299;
+    double kb = rec709 ? 0.0722 : 0.114;
+    double kg = 1.0 - kr - kb;
+    double y_scale = full_range ? 1.0 : 255.0 / 219.0;
+    double c_scale = full_range ? 1.0 : 255.0 / 224.0;
+    double fix = (double)(1 << YUV_FIX);
+
+    FFMPEGYUVCoefficients c;
+    c.y_offset = full_range ? 0 : 16;
+    c.y = FMath::RoundToInt(y_scale * fix);
+    c.vr = FMath::RoundToInt(2.0 * (1.0 - kr) * c_scale * fix);
+    c.ug = FMath::RoundToInt(2.0 * (1.0 - kb) * kb / kg * c_scale * fix);
+    c.vg = FMath::RoundToInt(2.0 * (1.0 - kr) * kr / kg * c_scale * fix);
+    c.ub = FMath::RoundToInt(2.0 * (1.0 - kb) * c_scale * fix);
+    return c;
+}
+
+static FORCEINLINE uint8_t ClampPixel(int v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/* reference kernel, the vector kernels must give the same result */
+static void ConvertRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+    uint8_t *dst, int width, const FFMPEGYUVCoefficients &c) {
+    for (int x = 0; x < width; x++) {
+        int yy = (y[x] - c.y_offset) * c.y + YUV_ROUND;
+        int uu = u[x >> 1] - 128;
+        int vv = v[x >> 1] - 128;
+
+        dst[0] = ClampPixel((yy + c.ub * uu) >> YUV_FIX);
+        dst[1] = ClampPixel((yy - c.ug * uu - c.vg * vv) >> YUV_FIX);
+        dst[2] = ClampPixel((yy + c.vr * vv) >> YUV_FIX);
+        dst[3] = a ? a[x] : 255;
+        dst += 4;
+    }
+}
+
+#if YUV_CONVERTER_X86
+
+static FORCEINLINE __m128i LoadChroma4(const uint8_t *p) {
+    int32_t w;
+    memcpy(&w, p, sizeof(w));
+    return _mm_cvtsi32_si128(w);
+}
+
+/* (lo, hi) 16 bit coefficient pairs for _mm_madd_epi16 */
+static FORCEINLINE int32_t CoefficientPair(int lo, int hi) {
+    return (int32_t)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo);
+}
+
+static void ConvertRowSSE2(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+    uint8_t *dst, int width, const FFMPEGYUVCoefficients &c) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i y_offset = _mm_set1_epi16((short)c.y_offset);
+    const __m128i uv_offset = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi32(YUV_ROUND);
+    const __m128i cy = _mm_set1_epi16((short)c.y);
+    const __m128i cr = _mm_set1_epi32(CoefficientPair(0, c.vr));
+    const __m128i cg = _mm_set1_epi32(CoefficientPair(-c.ug, -c.vg));
+    const __m128i cb = _mm_set1_epi32(CoefficientPair(c.ub, 0));
+    const __m128i opaque = _mm_set1_epi16(255);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i y16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + x)), zero), y_offset);
+        __m128i u16 = _mm_sub_epi16(_mm_unpacklo_epi8(LoadChroma4(u + x / 2), zero), uv_offset);
+        __m128i v16 = _mm_sub_epi16(_mm_unpacklo_epi8(LoadChroma4(v + x / 2), zero), uv_offset);
+
+        /* one chroma sample for every two pixels */
+        u16 = _mm_unpacklo_epi16(u16, u16);
+        v16 = _mm_unpacklo_epi16(v16, v16);
+        __m128i uv_lo = _mm_unpacklo_epi16(u16, v16);
+        __m128i uv_hi = _mm_unpackhi_epi16(u16, v16);
+
+        __m128i y_lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y16, zero), cy), round);
+        __m128i y_hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y16, zero), cy), round);
+
+        __m128i r = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(y_lo, _mm_madd_epi16(uv_lo, cr)), YUV_FIX),
+            _mm_srai_epi32(_mm_add_epi32(y_hi, _mm_madd_epi16(uv_hi, cr)), YUV_FIX));
+        __m128i g = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(y_lo, _mm_madd_epi16(uv_lo, cg)), YUV_FIX),
+            _mm_srai_epi32(_mm_add_epi32(y_hi, _mm_madd_epi16(uv_hi, cg)), YUV_FIX));
+        __m128i b = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(y_lo, _mm_madd_epi16(uv_lo, cb)), YUV_FIX),
+            _mm_srai_epi32(_mm_add_epi32(y_hi, _mm_madd_epi16(uv_hi, cb)), YUV_FIX));
+        __m128i a16 = a ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x)), zero) : opaque;
+
+        __m128i br = _mm_packus_epi16(b, r);
+        __m128i ga = _mm_packus_epi16(g, a16);
+        __m128i bg = _mm_unpacklo_epi8(br, ga);
+        __m128i ra = _mm_unpackhi_epi8(br, ga);
+
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i*)(dst + x * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+
+    ConvertRowScalar(y + x, u + x / 2, v + x / 2, a ? a + x : NULL, dst + x * 4, width - x, c);
+}
+
+YUV_CONVERTER_AVX2_TARGET
+static __m256i DuplicateChromaAVX2(const uint8_t *p, __m128i uv_offset) {
+    __m128i c16 = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p)), uv_offset);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(c16, c16)), _mm_unpackhi_epi16(c16, c16), 1);
+}
+
+YUV_CONVERTER_AVX2_TARGET
+static void ConvertRowAVX2(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+    uint8_t *dst, int width, const FFMPEGYUVCoefficients &c) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i y_offset = _mm256_set1_epi16((short)c.y_offset);
+    const __m128i uv_offset = _mm_set1_epi16(128);
+    const __m256i round = _mm256_set1_epi32(YUV_ROUND);
+    const __m256i cy = _mm256_set1_epi16((short)c.y);
+    const __m256i cr = _mm256_set1_epi32(CoefficientPair(0, c.vr));
+    const __m256i cg = _mm256_set1_epi32(CoefficientPair(-c.ug, -c.vg));
+    const __m256i cb = _mm256_set1_epi32(CoefficientPair(c.ub, 0));
+    const __m256i opaque = _mm256_set1_epi16(255);
+    int x = 0;
+
+    /* the unpacks work inside each 128 bit lane, pixels 0-7 stay in the low lane and 8-15 in the high one */
+    for (; x + 16 <= width; x += 16) {
+        __m256i y16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x))), y_offset);
+        __m256i u16 = DuplicateChromaAVX2(u + x / 2, uv_offset);
+        __m256i v16 = DuplicateChromaAVX2(v + x / 2, uv_offset);
+        __m256i uv_lo = _mm256_unpacklo_epi16(u16, v16);
+        __m256i uv_hi = _mm256_unpackhi_epi16(u16, v16);
+
+        __m256i y_lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y16, zero), cy), round);
+        __m256i y_hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y16, zero), cy), round);
+
+        __m256i r = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(y_lo, _mm256_madd_epi16(uv_lo, cr)), YUV_FIX),
+            _mm256_srai_epi32(_mm256_add_epi32(y_hi, _mm256_madd_epi16(uv_hi, cr)), YUV_FIX));
+        __m256i g = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(y_lo, _mm256_madd_epi16(uv_lo, cg)), YUV_FIX),
+            _mm256_srai_epi32(_mm256_add_epi32(y_hi, _mm256_madd_epi16(uv_hi, cg)), YUV_FIX));
+        __m256i b = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(y_lo, _mm256_madd_epi16(uv_lo, cb)), YUV_FIX),
+            _mm256_srai_epi32(_mm256_add_epi32(y_hi, _mm256_madd_epi16(uv_hi, cb)), YUV_FIX));
+        __m256i a16 = a ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + x))) : opaque;
+
+        __m256i br = _mm256_packus_epi16(b, r);
+        __m256i ga = _mm256_packus_epi16(g, a16);
+        __m256i bg = _mm256_unpacklo_epi8(br, ga);
+        __m256i ra = _mm256_unpackhi_epi8(br, ga);
+        __m256i px_lo = _mm256_unpacklo_epi16(bg, ra);
+        __m256i px_hi = _mm256_unpackhi_epi16(bg, ra);
+
+        _mm256_storeu_si256((__m256i*)(dst + x * 4), _mm256_permute2x128_si256(px_lo, px_hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + x * 4 + 32), _mm256_permute2x128_si256(px_lo, px_hi, 0x31));
+    }
+
+    ConvertRowScalar(y + x, u + x / 2, v + x / 2, a ? a + x : NULL, dst + x * 4, width - x, c);
+}
+
+static bool CpuHasAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    /* the OS has to save the ymm registers too */
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#if YUV_CONVERTER_NEON
+
+static FORCEINLINE int16x4x2_t DuplicateChromaNEON(const uint8_t *p) {
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    int16x8_t c16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(w)))), vdupq_n_s16(128));
+    int16x4_t c4 = vget_low_s16(c16);
+    return vzip_s16(c4, c4);
+}
+
+static void ConvertRowNEON(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+    uint8_t *dst, int width, const FFMPEGYUVCoefficients &c) {
+    const int16x8_t y_offset = vdupq_n_s16((int16_t)c.y_offset);
+    const int16_t cy = (int16_t)c.y;
+    const int16_t cr = (int16_t)c.vr;
+    const int16_t cug = (int16_t)c.ug;
+    const int16_t cvg = (int16_t)c.vg;
+    const int16_t cb = (int16_t)c.ub;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x))), y_offset);
+        int16x4x2_t u16 = DuplicateChromaNEON(u + x / 2);
+        int16x4x2_t v16 = DuplicateChromaNEON(v + x / 2);
+
+        int32x4_t y_lo = vmull_n_s16(vget_low_s16(y16), cy);
+        int32x4_t y_hi = vmull_n_s16(vget_high_s16(y16), cy);
+
+        int32x4_t r_lo = vmlal_n_s16(y_lo, v16.val[0], cr);
+        int32x4_t r_hi = vmlal_n_s16(y_hi, v16.val[1], cr);
+        int32x4_t g_lo = vmlsl_n_s16(vmlsl_n_s16(y_lo, u16.val[0], cug), v16.val[0], cvg);
+        int32x4_t g_hi = vmlsl_n_s16(vmlsl_n_s16(y_hi, u16.val[1], cug), v16.val[1], cvg);
+        int32x4_t b_lo = vmlal_n_s16(y_lo, u16.val[0], cb);
+        int32x4_t b_hi = vmlal_n_s16(y_hi, u16.val[1], cb);
+
+        /* the rounding shift matches the scalar YUV_ROUND */
+        uint8x8x4_t px;
+        px.val[0] = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(b_lo, YUV_FIX), vqrshrn_n_s32(b_hi, YUV_FIX)));
+        px.val[1] = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(g_lo, YUV_FIX), vqrshrn_n_s32(g_hi, YUV_FIX)));
+        px.val[2] = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(r_lo, YUV_FIX), vqrshrn_n_s32(r_hi, YUV_FIX)));
+        px.val[3] = a ? vld1_u8(a + x) : vdup_n_u8(255);
+        vst4_u8(dst + x * 4, px);
+    }
+
+    ConvertRowScalar(y + x, u + x / 2, v + x / 2, a ? a + x : NULL, dst + x * 4, width - x, c);
+}
+
+#endif
+
+static ConvertRowFunc GetRowFunc(FFMPEGYUVConverter::EKernel kernel) {
+    switch (kernel) {
+#if YUV_CONVERTER_X86
+    case FFMPEGYUVConverter::EKernel::SSE2:
+        return ConvertRowSSE2;
+    case FFMPEGYUVConverter::EKernel::AVX2:
+        return ConvertRowAVX2;
+#endif
+#if YUV_CONVERTER_NEON
+    case FFMPEGYUVConverter::EKernel::NEON:
+        return ConvertRowNEON;
+#endif
+    default:
+        return ConvertRowScalar;
+    }
+}
+
+bool FFMPEGYUVConverter::IsSupported(int format) {
+    switch (format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVA420P:
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_P010LE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void FFMPEGYUVConverter::GetColorSpace(const AVFrame *frame, bool *rec709, bool *full_range) {
+    /* untagged HD content is most likely BT.709 */
+    *rec709 = frame->colorspace == AVCOL_SPC_BT709 || (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height > 576);
+    *full_range = frame->color_range == AVCOL_RANGE_JPEG
+        || frame->format == AV_PIX_FMT_YUVJ420P || frame->format == AV_PIX_FMT_YUVJ422P;
+}
+
+bool FFMPEGYUVConverter::IsKernelAvailable(EKernel kernel) {
+    switch (kernel) {
+    case EKernel::Scalar:
+        return true;
+#if YUV_CONVERTER_X86
+    case EKernel::SSE2:
+        return true;
+    case EKernel::AVX2: {
+        static const bool has_avx2 = CpuHasAVX2();
+        return has_avx2;
+    }
+#endif
+#if YUV_CONVERTER_NEON
+    case EKernel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+FFMPEGYUVConverter::EKernel FFMPEGYUVConverter::GetBestKernel() {
+    static const EKernel best = [] {
+        for (int k = (int)EKernel::Count - 1; k > 0; k--) {
+            if (IsKernelAvailable((EKernel)k))
+                return (EKernel)k;
+        }
+        return EKernel::Scalar;
+    }();
+    return best;
+}
+
+const TCHAR* FFMPEGYUVConverter::GetKernelName(EKernel kernel) {
+    switch (kernel) {
+    case EKernel::SSE2:
+        return TEXT("SSE2");
+    case EKernel::AVX2:
+        return TEXT("AVX2");
+    case EKernel::NEON:
+        return TEXT("NEON");
+    default:
+        return TEXT("Scalar");
+    }
+}
+
+void FFMPEGYUVConverter::ConvertRows(const AVFrame *frame, uint8_t *dst, int dst_stride, const FFMPEGYUVCoefficients &coefs,
+    int first_row, int last_row, EKernel kernel) {
+    ConvertRowFunc convert_row = GetRowFunc(kernel);
+    int width = frame->width;
+    int chroma_width = (width + 1) / 2;
+    int chroma_shift = (frame->format == AV_PIX_FMT_YUV422P || frame->format == AV_PIX_FMT_YUVJ422P) ? 0 : 1;
+    bool semi_planar = frame->format == AV_PIX_FMT_NV12 || frame->format == AV_PIX_FMT_P010LE;
+    bool high_depth = frame->format == AV_PIX_FMT_P010LE;
+
+    /* semi-planar and 10 bit rows are unpacked to 8 bit planar rows first */
+    TArray<uint8_t> temp;
+    uint8_t *temp_y = NULL;
+    uint8_t *temp_u = NULL;
+    uint8_t *temp_v = NULL;
+    if (semi_planar) {
+        temp.SetNumUninitialized(width + chroma_width * 2);
+        temp_y = temp.GetData();
+        temp_u = temp_y + width;
+        temp_v = temp_u + chroma_width;
+    }
+
+    for (int row = first_row; row < last_row; row++) {
+        const uint8_t *y = frame->data[0] + (ptrdiff_t)frame->linesize[0] * row;
+        const uint8_t *u = frame->data[1] + (ptrdiff_t)frame->linesize[1] * (row >> chroma_shift);
+        const uint8_t *v = semi_planar ? NULL : frame->data[2] + (ptrdiff_t)frame->linesize[2] * (row >> chroma_shift);
+        const uint8_t *a = frame->format == AV_PIX_FMT_YUVA420P ? frame->data[3] + (ptrdiff_t)frame->linesize[3] * row : NULL;
+
+        if (high_depth) {
+            /* p010 keeps the 10 bits in the high bits of each sample */
+            const uint16_t *y16 = (const uint16_t*)y;
+            const uint16_t *uv16 = (const uint16_t*)u;
+            for (int x = 0; x < width; x++)
+                temp_y[x] = (uint8_t)(y16[x] >> 8);
+            for (int x = 0; x < chroma_width; x++) {
+                temp_u[x] = (uint8_t)(uv16[2 * x] >> 8);
+                temp_v[x] = (uint8_t)(uv16[2 * x + 1] >> 8);
+            }
+            y = temp_y;
+            u = temp_u;
+            v = temp_v;
+        } else if (semi_planar) {
+            for (int x = 0; x < chroma_width; x++) {
+                temp_u[x] = u[2 * x];
+                temp_v[x] = u[2 * x + 1];
+            }
+            u = temp_u;
+            v = temp_v;
+        }
+
+        convert_row(y, u, v, a, dst + (ptrdiff_t)dst_stride * row, width, coefs);
+    }
+}
+
+bool FFMPEGYUVConverter::Convert(const AVFrame *frame, uint8_t *dst, int dst_stride, int slices) {
+    if (!IsSupported(frame->format))
+        return false;
+
+    bool rec709, full_range;
+    GetColorSpace(frame, &rec709, &full_range);
+    const FFMPEGYUVCoefficients coefs = FFMPEGYUVCoefficients::Get(rec709, full_range);
+    const EKernel kernel = GetBestKernel();
+
+    int height = frame->height;
+    slices = FMath::Clamp(slices, 1, FMath::Max(1, height / SLICE_SCALER_MIN_ROWS));
+    int slice_height = FMath::DivideAndRoundUp(height, slices);
+    slices = FMath::DivideAndRoundUp(height, slice_height);
+
+    ParallelFor(slices, [&](int32 i) {
+        int first_row = i * slice_height;
+        ConvertRows(frame, dst, dst_stride, coefs, first_row, FMath::Min(first_row + slice_height, height), kernel);
+    }, slices == 1);
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct AVFrame;
+
+/* 13 bit fixed point YUV to RGB coefficients */
+struct FFMPEGYUVCoefficients
+{
+    int y_offset;
+    int y;
+    int vr;
+    int ug;
+    int vg;
+    int ub;
+
+    static FFMPEGYUVCoefficients Get(bool rec709, bool full_range);
+};
+
+/**
+ * YUV to BGRA conversion for the formats the decoders usually output,
+ * yuv420p, yuv422p, yuva420p, nv12 and p010. The chroma is replicated
+ * instead of interpolated and the row kernel is picked from the CPU features.
+ */
+class FFMPEGYUVConverter
+{
+public:
+    enum class EKernel : uint8 {
+        Scalar = 0,
+        SSE2,
+        AVX2,
+        NEON,
+        Count
+    };
+
+    static bool IsSupported(int format);
+    static void GetColorSpace(const AVFrame *frame, bool *rec709, bool *full_range);
+
+    static bool IsKernelAvailable(EKernel kernel);
+    static EKernel GetBestKernel();
+    static const TCHAR* GetKernelName(EKernel kernel);
+
+    /* converts the whole frame with the best kernel, split in slices on the task graph */
+    static bool Convert(const AVFrame *frame, uint8_t *dst, int dst_stride, int slices);
+
+    /* converts rows [first_row, last_row) */
+    static void ConvertRows(const AVFrame *frame, uint8_t *dst, int dst_stride, const FFMPEGYUVCoefficients &coefs,
+        int first_row, int last_row, EKernel kernel);
+};
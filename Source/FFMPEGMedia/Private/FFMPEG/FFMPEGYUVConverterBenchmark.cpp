@@ -0,0 +1,124 @@
+#include "FFMPEGYUVConverter.h"
+#include "FFMPEGMediaPrivate.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+extern "C" {
+    #include "libavutil/frame.h"
+    #include "libavutil/pixdesc.h"
+    #include "libswscale/swscale.h"
+}
+
+/* PSNR of the color channels, the alpha is copied as is by every backend */
+static double ComputePSNR(const TArray<uint8>& a, const TArray<uint8>& b) {
+    double error = 0.0;
+    int64 count = 0;
+    for (int32 i = 0; i < a.Num(); i++) {
+        if ((i & 3) == 3)
+            continue;
+        double d = (double)a[i] - (double)b[i];
+        error += d * d;
+        count++;
+    }
+    if (error == 0.0)
+        return INFINITY;
+    return 10.0 * FMath::LogX(10.0, 255.0 * 255.0 / (error / count));
+}
+
+static void FillTestFrame(AVFrame *frame, FRandomStream& random) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    bool high_depth = frame->format == AV_PIX_FMT_P010LE;
+
+    for (int p = 0; p < 4 && frame->data[p]; p++) {
+        int rows = (p == 1 || p == 2) ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = frame->data[p] + (ptrdiff_t)frame->linesize[p] * y;
+            if (high_depth) {
+                uint16_t *row16 = (uint16_t*)row;
+                for (int x = 0; x < frame->width; x++)
+                    row16[x] = (uint16_t)(((x + y + random.RandRange(0, 63)) & 0x3ff) << 6);
+            } else {
+                for (int x = 0; x < frame->linesize[p]; x++)
+                    row[x] = (uint8_t)((x + y + random.RandRange(0, 31)) & 0xff);
+            }
+        }
+    }
+}
+
+static void BenchmarkYUVConversion(const TArray<FString>& Args) {
+    const int iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 5;
+    const FIntPoint sizes[] = { FIntPoint(1920, 1080), FIntPoint(3840, 2160), FIntPoint(7680, 4320) };
+    const AVPixelFormat formats[] = { AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVA420P, AV_PIX_FMT_P010LE };
+    FRandomStream random(0x46464d50);
+
+    for (const FIntPoint& size : sizes) {
+        for (AVPixelFormat format : formats) {
+            AVFrame *frame = av_frame_alloc();
+            if (!frame)
+                continue;
+            frame->width = size.X;
+            frame->height = size.Y;
+            frame->format = format;
+            frame->colorspace = AVCOL_SPC_BT709;
+            frame->color_range = AVCOL_RANGE_MPEG;
+            if (av_frame_get_buffer(frame, 64) < 0) {
+                av_frame_free(&frame);
+                continue;
+            }
+            FillTestFrame(frame, random);
+
+            const int stride = size.X * 4;
+            const double mpix = (double)size.X * size.Y * iterations / 1000000.0;
+            const FFMPEGYUVCoefficients coefs = FFMPEGYUVCoefficients::Get(true, false);
+            const FString name = FString::Printf(TEXT("%s %dx%d"), ANSI_TO_TCHAR(av_get_pix_fmt_name(format)), size.X, size.Y);
+
+            TArray<uint8> reference;
+            TArray<uint8> output;
+            reference.SetNumUninitialized(stride * size.Y);
+            output.SetNumUninitialized(stride * size.Y);
+            FFMPEGYUVConverter::ConvertRows(frame, reference.GetData(), stride, coefs, 0, size.Y, FFMPEGYUVConverter::EKernel::Scalar);
+
+            for (int k = 0; k < (int)FFMPEGYUVConverter::EKernel::Count; k++) {
+                FFMPEGYUVConverter::EKernel kernel = (FFMPEGYUVConverter::EKernel)k;
+                if (!FFMPEGYUVConverter::IsKernelAvailable(kernel))
+                    continue;
+
+                double start = FPlatformTime::Seconds();
+                for (int i = 0; i < iterations; i++)
+                    FFMPEGYUVConverter::ConvertRows(frame, output.GetData(), stride, coefs, 0, size.Y, kernel);
+                double elapsed = FPlatformTime::Seconds() - start;
+
+                int32 mismatches = 0;
+                for (int32 i = 0; i < output.Num(); i++)
+                    mismatches += output[i] != reference[i];
+
+                UE_LOG(LogFFMPEGMedia, Display, TEXT("%s %s: %.1f MPix/s, %s"), *name, FFMPEGYUVConverter::GetKernelName(kernel),
+                    mpix / elapsed, mismatches == 0 ? TEXT("bit exact") : *FString::Printf(TEXT("%d bytes differ from scalar"), mismatches));
+            }
+
+            struct SwsContext *sws = sws_getContext(size.X, size.Y, format, size.X, size.Y, AV_PIX_FMT_BGRA, SWS_BICUBIC, NULL, NULL, NULL);
+            if (sws) {
+                sws_setColorspaceDetails(sws, sws_getCoefficients(SWS_CS_ITU709), 0, sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+
+                uint8_t *dst[4] = { output.GetData(), NULL, NULL, NULL };
+                int dst_stride[4] = { stride, 0, 0, 0 };
+                double start = FPlatformTime::Seconds();
+                for (int i = 0; i < iterations; i++)
+                    sws_scale(sws, frame->data, frame->linesize, 0, size.Y, dst, dst_stride);
+                double elapsed = FPlatformTime::Seconds() - start;
+
+                UE_LOG(LogFFMPEGMedia, Display, TEXT("%s libswscale: %.1f MPix/s, PSNR %.2f dB against the scalar kernel"), *name,
+                    mpix / elapsed, ComputePSNR(reference, output));
+                sws_freeContext(sws);
+            }
+
+            av_frame_free(&frame);
+        }
+    }
+}
+
+static FAutoConsoleCommand BenchmarkYUVConversionCommand(
+    TEXT("FFMPEGMedia.BenchmarkYUVConversion"),
+    TEXT("Compares the YUV to BGRA kernels with libswscale at 1080p, 4K and 8K. Optional argument: iterations per size."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkYUVConversion));
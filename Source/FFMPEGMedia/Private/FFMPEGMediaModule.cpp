@@ -6,6 +6,7 @@
 #include "Modules/ModuleManager.h"
 
 #include "IFFMPEGMediaModule.h"
+#include "IFFMPEGMediaPlayer.h"
 #include "Core.h"
 #include "Interfaces/IPluginManager.h"
 
@@ -27,6 +28,7 @@ extern  "C" {
 }
 
 #include "FFMPEGMediaPlayer.h"
+#include "FFMPEGTaskPool.h"
 
 
 
@@ -111,6 +113,16 @@ public:
         return protocols;
 	}
 
+	virtual IFFMPEGMediaPlayer* GetFFMPEGPlayer(const TSharedPtr<IMediaPlayer, ESPMode::ThreadSafe>& Player) override
+	{
+		if (!Player.IsValid() || Player->GetPlayerPluginGUID() != FFFMPEGMediaPlayer::GetStaticPlayerPluginGUID())
+		{
+			return nullptr;
+		}
+
+		return static_cast<FFFMPEGMediaPlayer*>(Player.Get());
+	}
+
 public:
 
     static void  log_callback(void*, int level , const char* format, va_list arglist ) {
@@ -226,6 +238,9 @@ public:
 			//MediaModule->UnregisterCaptureSupport(*this);
 		}
 
+        // the players are gone, stop the workers before unloading the libraries they ran
+        FFMPEGTaskPool::Get().Shutdown();
+
         if (AVDeviceLibrary) FPlatformProcess::FreeDllHandle(AVDeviceLibrary);
         if (AVFilterLibrary) FPlatformProcess::FreeDllHandle(AVFilterLibrary);
         if (PostProcLibrary) FPlatformProcess::FreeDllHandle(PostProcLibrary);
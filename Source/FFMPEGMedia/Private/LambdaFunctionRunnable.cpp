@@ -1,22 +1,57 @@
 #include "LambdaFunctionRunnable.h"
 
+#include "HAL/PlatformProcess.h"
 
-LambdaFunctionRunnable::LambdaFunctionRunnable(std::function<void()> f) {
+#if PLATFORM_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+LambdaFunctionRunnable::LambdaFunctionRunnable(std::function<void()> f, EThreadPriority priority, uint64 affinityMask) {
 	_f = f;
+	_priority = priority;
+	_affinityMask = affinityMask;
 }
-FRunnableThread* LambdaFunctionRunnable::RunThreaded(FString threadName, std::function<void()> f) {
+FRunnableThread* LambdaFunctionRunnable::RunThreaded(FString threadName, std::function<void()> f, EThreadPriority priority, uint64 affinityMask) {
 	static int currentThread = 0;
-	LambdaFunctionRunnable* runnable = new LambdaFunctionRunnable(f);
+	LambdaFunctionRunnable* runnable = new LambdaFunctionRunnable(f, priority, affinityMask);
 	FString _threadName = threadName + FString::FromInt(currentThread++);
-	runnable->thread = FRunnableThread::Create(runnable, *_threadName);
+	runnable->thread = FRunnableThread::Create(runnable, *_threadName, 0, priority, affinityMask);
 	return  runnable->thread;
 }
 
+void LambdaFunctionRunnable::ApplyToCurrentThread(EThreadPriority priority, uint64 affinityMask) {
+	FRunnableThread* current = FRunnableThread::GetRunnableThread();
+	if (current) {
+		current->SetThreadPriority(priority);
+	}
+	FPlatformProcess::SetThreadAffinityMask(affinityMask);
+
+#if PLATFORM_LINUX
+	//The normal threads are SCHED_OTHER, the scheduler ignores their pthread priority and uses the nice value of the thread instead.
+	//It's relative to the main thread, lowering it needs CAP_SYS_NICE or a RLIMIT_NICE allowance, without them the thread keeps the priority it has.
+	int niceValue = getpriority(PRIO_PROCESS, (id_t)getpid());
+	switch (priority) {
+	case TPri_Lowest: niceValue += 10; break;
+	case TPri_BelowNormal: niceValue += 5; break;
+	case TPri_SlightlyBelowNormal: niceValue += 2; break;
+	case TPri_AboveNormal: niceValue -= 5; break;
+	case TPri_Highest: niceValue -= 10; break;
+	case TPri_TimeCritical: niceValue -= 15; break;
+	default: break;
+	}
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), niceValue);
+#endif
+}
+
 uint32 LambdaFunctionRunnable::Run() {
+	ApplyToCurrentThread(_priority, _affinityMask);
 	_f();
 	return 0;
 }
 
 void LambdaFunctionRunnable::Exit() {
 	delete this;
-}
\ No newline at end of file
+}
@@ -1,16 +1,21 @@
-#pragma once
-
-#include <HAL/RunnableThread.h>
-#include <functional>
-#include <HAL/Runnable.h>
-
-class LambdaFunctionRunnable : public FRunnable {
-public:
-	static FRunnableThread* RunThreaded(FString threadName, std::function<void()> f);
-	void Exit() override;
-	uint32	Run()	override;
-protected:
-	LambdaFunctionRunnable(std::function<void()> f);
-	std::function<void()> _f;
-	FRunnableThread* thread;
+#pragma once
+
+#include <HAL/RunnableThread.h>
+#include <functional>
+#include <HAL/Runnable.h>
+#include <HAL/PlatformAffinity.h>
+
+class LambdaFunctionRunnable : public FRunnable {
+public:
+	static FRunnableThread* RunThreaded(FString threadName, std::function<void()> f, EThreadPriority priority = TPri_Normal, uint64 affinityMask = FPlatformAffinity::GetNoAffinityMask());
+	/** Sets the priority and the cores of the calling thread */
+	static void ApplyToCurrentThread(EThreadPriority priority, uint64 affinityMask);
+	void Exit() override;
+	uint32	Run()	override;
+protected:
+	LambdaFunctionRunnable(std::function<void()> f, EThreadPriority priority, uint64 affinityMask);
+	std::function<void()> _f;
+	EThreadPriority _priority;
+	uint64 _affinityMask;
+	FRunnableThread* thread;
 };
\ No newline at end of file
@@ -0,0 +1,231 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaDecoderCache.h"
+#include "FFMPEGMediaPrivate.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/OutputDevice.h"
+#include "Misc/ScopeLock.h"
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/pixdesc.h"
+}
+
+
+/* Local helpers
+ *****************************************************************************/
+
+namespace FFMPEGMediaDecoderCache
+{
+	/** Delay before a device type that failed once is tried again. */
+	const double FirstRetryDelay = 5.0;
+
+	/** Longest delay between two tries. */
+	const double MaxRetryDelay = 300.0;
+}
+
+
+/* FFFMPEGMediaDecoderKey interface
+ *****************************************************************************/
+
+FFFMPEGMediaDecoderKey FFFMPEGMediaDecoderKey::FromParameters(const AVCodecParameters* Parameters)
+{
+	// the demuxers set either the pixel format or the raw sample size, some neither
+	const AVPixFmtDescriptor* Descriptor = av_pix_fmt_desc_get((AVPixelFormat)Parameters->format);
+	const int32 BitDepth = (Descriptor != nullptr) ? Descriptor->comp[0].depth : Parameters->bits_per_raw_sample;
+
+	return { (int32)Parameters->codec_id, Parameters->profile, BitDepth };
+}
+
+
+/* FFFMPEGMediaDecoderCache interface
+ *****************************************************************************/
+
+FFFMPEGMediaDecoderCache& FFFMPEGMediaDecoderCache::Get()
+{
+	static FFFMPEGMediaDecoderCache Cache;
+	return Cache;
+}
+
+
+bool FFFMPEGMediaDecoderCache::FindDecoders(int32 CodecId, bool bHardwareAccelerated, TArray<const AVCodec*>& OutDecoders) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const TArray<const AVCodec*>* Found = (bHardwareAccelerated ? HardwareCandidates : SoftwareDecoders).Find(CodecId);
+
+	if (Found == nullptr)
+	{
+		return false;
+	}
+
+	OutDecoders = *Found;
+
+	return true;
+}
+
+
+void FFFMPEGMediaDecoderCache::AddDecoders(int32 CodecId, bool bHardwareAccelerated, const TArray<const AVCodec*>& InDecoders)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	(bHardwareAccelerated ? HardwareCandidates : SoftwareDecoders).Add(CodecId, InDecoders);
+}
+
+
+bool FFFMPEGMediaDecoderCache::FindHardwareDecoder(const FFFMPEGMediaDecoderKey& Key, const AVCodec*& OutDecoder, AVHWDeviceType& OutDeviceType) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const FHardwareDecoder* Found = HardwareDecoders.Find(Key);
+
+	if ((Found == nullptr) || ((Found->RetryTime > 0.0) && (FPlatformTime::Seconds() >= Found->RetryTime)))
+	{
+		return false;
+	}
+
+	OutDecoder = Found->Decoder;
+	OutDeviceType = Found->DeviceType;
+
+	return true;
+}
+
+
+void FFFMPEGMediaDecoderCache::SetHardwareDecoder(const FFFMPEGMediaDecoderKey& Key, const AVCodec* Decoder, AVHWDeviceType DeviceType, bool bRetry)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// probed again once the first device type that failed can be tried again
+	const double RetryTime = ((Decoder == nullptr) && bRetry) ? FPlatformTime::Seconds() + FFMPEGMediaDecoderCache::FirstRetryDelay : 0.0;
+
+	HardwareDecoders.Add(Key, { Decoder, (Decoder != nullptr) ? DeviceType : AV_HWDEVICE_TYPE_NONE, RetryTime });
+}
+
+
+void FFFMPEGMediaDecoderCache::RemoveHardwareDecoder(const FFFMPEGMediaDecoderKey& Key)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	HardwareDecoders.Remove(Key);
+}
+
+
+bool FFFMPEGMediaDecoderCache::IsDeviceTypeUnusable(AVHWDeviceType DeviceType) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const FDeviceType* Found = DeviceTypes.Find((int32)DeviceType);
+
+	if ((Found == nullptr) || (Found->Error == 0))
+	{
+		return false;
+	}
+
+	return (Found->Error == AVERROR(ENOSYS)) || (FPlatformTime::Seconds() < Found->RetryTime);
+}
+
+
+bool FFFMPEGMediaDecoderCache::IsDeviceTypeUnsupported(AVHWDeviceType DeviceType) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const FDeviceType* Found = DeviceTypes.Find((int32)DeviceType);
+
+	return (Found != nullptr) && (Found->Error == AVERROR(ENOSYS));
+}
+
+
+void FFFMPEGMediaDecoderCache::SetDeviceTypeResult(AVHWDeviceType DeviceType, int Error)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	FDeviceType& Entry = DeviceTypes.FindOrAdd((int32)DeviceType);
+
+	if (Error >= 0)
+	{
+		Entry = { 0, 0, 0.0 };
+		return;
+	}
+
+	// the device type isn't built in, anything else may work on the next try
+	Entry.Error = Error;
+	Entry.NumFailures++;
+	Entry.RetryTime = FPlatformTime::Seconds() + GetRetryDelay(Entry.NumFailures);
+}
+
+
+void FFFMPEGMediaDecoderCache::Dump(FOutputDevice& Ar) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const double Now = FPlatformTime::Seconds();
+
+	Ar.Logf(TEXT("FFMPEG decoder cache: %d streams probed"), HardwareDecoders.Num());
+
+	for (const auto& Pair : HardwareDecoders)
+	{
+		const FFFMPEGMediaDecoderKey& Key = Pair.Key;
+		const FHardwareDecoder& Entry = Pair.Value;
+		const char* ProfileName = avcodec_profile_name((AVCodecID)Key.CodecId, Key.Profile);
+
+		const FString Stream = FString::Printf(TEXT("%s %s %d bit"), UTF8_TO_TCHAR(avcodec_get_name((AVCodecID)Key.CodecId)),
+			(ProfileName != nullptr) ? UTF8_TO_TCHAR(ProfileName) : TEXT("unknown profile"), Key.BitDepth);
+
+		if (Entry.Decoder != nullptr)
+		{
+			Ar.Logf(TEXT("  %s: %s on %s"), *Stream, UTF8_TO_TCHAR(Entry.Decoder->name), UTF8_TO_TCHAR(av_hwdevice_get_type_name(Entry.DeviceType)));
+		}
+		else if (Entry.RetryTime > 0.0)
+		{
+			Ar.Logf(TEXT("  %s: no hardware decoder, probed again in %.0f s"), *Stream, FMath::Max(Entry.RetryTime - Now, 0.0));
+		}
+		else
+		{
+			Ar.Logf(TEXT("  %s: no hardware decoder"), *Stream);
+		}
+	}
+
+	for (const auto& Pair : DeviceTypes)
+	{
+		const FDeviceType& Entry = Pair.Value;
+		const FString TypeName = UTF8_TO_TCHAR(av_hwdevice_get_type_name((AVHWDeviceType)Pair.Key));
+
+		if (Entry.Error == 0)
+		{
+			Ar.Logf(TEXT("  device %s: usable"), *TypeName);
+		}
+		else if (Entry.Error == AVERROR(ENOSYS))
+		{
+			Ar.Logf(TEXT("  device %s: not supported by the FFMPEG build"), *TypeName);
+		}
+		else
+		{
+			Ar.Logf(TEXT("  device %s: failed %d times, tried again in %.0f s"), *TypeName, Entry.NumFailures, FMath::Max(Entry.RetryTime - Now, 0.0));
+		}
+	}
+}
+
+
+/* FFFMPEGMediaDecoderCache implementation
+ *****************************************************************************/
+
+double FFFMPEGMediaDecoderCache::GetRetryDelay(int32 NumFailures)
+{
+	const int32 NumDoublings = FMath::Clamp(NumFailures - 1, 0, 16);
+
+	return FMath::Min(FFMPEGMediaDecoderCache::FirstRetryDelay * (double)(1 << NumDoublings), FFMPEGMediaDecoderCache::MaxRetryDelay);
+}
+
+
+/* Console commands
+ *****************************************************************************/
+
+static FAutoConsoleCommandWithOutputDevice DumpDecoderCacheCommand(
+	TEXT("FFMPEGMedia.DecoderCache"),
+	TEXT("Lists the hardware decoders and devices the FFMPEG players found so far."),
+	FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+	{
+		FFFMPEGMediaDecoderCache::Get().Dump(Ar);
+	}));
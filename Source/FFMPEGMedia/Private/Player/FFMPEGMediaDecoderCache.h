@@ -0,0 +1,162 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/Array.h"
+#include "Containers/Map.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/TypeHash.h"
+
+extern "C" {
+#include "libavutil/hwcontext.h"
+}
+
+class FOutputDevice;
+
+struct AVCodec;
+struct AVCodecParameters;
+
+
+/**
+ * What a hardware decoder is picked for.
+ *
+ * The hardware decoders often only handle some profiles and bit depths of a
+ * codec, a 10 bit stream can't reuse the decoder picked for an 8 bit one.
+ */
+struct FFFMPEGMediaDecoderKey
+{
+	int32 CodecId;
+	int32 Profile;
+	int32 BitDepth;
+
+	/** Get the key of a stream. */
+	static FFFMPEGMediaDecoderKey FromParameters(const AVCodecParameters* Parameters);
+
+	bool operator==(const FFFMPEGMediaDecoderKey& Other) const
+	{
+		return (CodecId == Other.CodecId) && (Profile == Other.Profile) && (BitDepth == Other.BitDepth);
+	}
+
+	friend uint32 GetTypeHash(const FFFMPEGMediaDecoderKey& Key)
+	{
+		return HashCombine(HashCombine(::GetTypeHash(Key.CodecId), ::GetTypeHash(Key.Profile)), ::GetTypeHash(Key.BitDepth));
+	}
+};
+
+
+/**
+ * Process wide cache of the decoder and hardware device probing.
+ *
+ * Finding the decoders of a codec walks every registered codec, and finding
+ * a hardware decoder that works opens each candidate and tries to create its
+ * devices one by one. It's done the first time a codec is opened and every
+ * open after that reuses the result. Two players opening the same codec at
+ * once may both probe it, the results are the same.
+ *
+ * A device type the FFMPEG build doesn't support is never tried again. Other
+ * device failures can go away, a busy or lost GPU for instance, so the type
+ * is tried again after a delay that doubles with each failure, and a codec
+ * that found no hardware decoder because of them is probed again.
+ */
+class FFFMPEGMediaDecoderCache
+{
+public:
+
+	/** Get the cache singleton. */
+	static FFFMPEGMediaDecoderCache& Get();
+
+	/**
+	 * Get the decoders found for a codec.
+	 *
+	 * @param CodecId The codec.
+	 * @param bHardwareAccelerated Whether the hardware accelerated or the software decoders are wanted.
+	 * @param OutDecoders Will contain the decoders, in the order they are tried.
+	 * @return false if they weren't looked for yet.
+	 */
+	bool FindDecoders(int32 CodecId, bool bHardwareAccelerated, TArray<const AVCodec*>& OutDecoders) const;
+
+	/** Store the decoders found for a codec. */
+	void AddDecoders(int32 CodecId, bool bHardwareAccelerated, const TArray<const AVCodec*>& Decoders);
+
+	/**
+	 * Get the hardware decoder and device picked for a stream.
+	 *
+	 * @param Key The codec, profile and bit depth of the stream.
+	 * @param OutDecoder Will contain the decoder, nullptr if no hardware decoder works for the stream.
+	 * @param OutDeviceType Will contain the device type of the decoder.
+	 * @return false if the stream wasn't probed yet, or has to be probed again.
+	 */
+	bool FindHardwareDecoder(const FFFMPEGMediaDecoderKey& Key, const AVCodec*& OutDecoder, AVHWDeviceType& OutDeviceType) const;
+
+	/**
+	 * Store the hardware decoder picked for a stream.
+	 *
+	 * @param Key The codec, profile and bit depth of the stream.
+	 * @param Decoder The decoder, nullptr if none works.
+	 * @param DeviceType The device type of the decoder.
+	 * @param bRetry Whether a device failure that can go away left the stream without a decoder, it's probed again later.
+	 */
+	void SetHardwareDecoder(const FFFMPEGMediaDecoderKey& Key, const AVCodec* Decoder, AVHWDeviceType DeviceType, bool bRetry);
+
+	/** Forget the hardware decoder of a stream, the next open probes it again. */
+	void RemoveHardwareDecoder(const FFFMPEGMediaDecoderKey& Key);
+
+	/** Check if a device of the given type shouldn't be tried now, the FFMPEG build doesn't support it or it failed recently. */
+	bool IsDeviceTypeUnusable(AVHWDeviceType DeviceType) const;
+
+	/** Check if the FFMPEG build doesn't support the device type, it's never tried again. */
+	bool IsDeviceTypeUnsupported(AVHWDeviceType DeviceType) const;
+
+	/**
+	 * Store how creating a device of the given type went.
+	 *
+	 * @param DeviceType The device type.
+	 * @param Error What av_hwdevice_ctx_create returned.
+	 */
+	void SetDeviceTypeResult(AVHWDeviceType DeviceType, int Error);
+
+	/** Write the cached results to the given device. */
+	void Dump(FOutputDevice& Ar) const;
+
+private:
+
+	struct FHardwareDecoder
+	{
+		const AVCodec* Decoder;
+		AVHWDeviceType DeviceType;
+
+		/** When the stream is probed again, 0 if the result is kept. */
+		double RetryTime;
+	};
+
+	struct FDeviceType
+	{
+		/** The error of the last try, 0 if the device could be created. */
+		int Error;
+
+		/** Failures in a row. */
+		int32 NumFailures;
+
+		/** When the device type can be tried again. */
+		double RetryTime;
+	};
+
+	/** Get the time a failed device type can be tried again after. */
+	static double GetRetryDelay(int32 NumFailures);
+
+	/** Hardware accelerated decoders by codec. */
+	TMap<int32, TArray<const AVCodec*>> HardwareCandidates;
+
+	/** Software decoders by codec. */
+	TMap<int32, TArray<const AVCodec*>> SoftwareDecoders;
+
+	/** Hardware decoders by codec, profile and bit depth. */
+	TMap<FFFMPEGMediaDecoderKey, FHardwareDecoder> HardwareDecoders;
+
+	/** How creating a device went, by device type. */
+	TMap<int32, FDeviceType> DeviceTypes;
+
+	/** Protects the maps. */
+	mutable FCriticalSection CriticalSection;
+};
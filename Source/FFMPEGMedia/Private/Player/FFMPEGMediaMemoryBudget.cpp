@@ -0,0 +1,175 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaMemoryBudget.h"
+#include "FFMPEGMediaPrivate.h"
+#include "FFMPEGMediaSettings.h"
+#include "FFMPEGMediaTracks.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "Misc/ScopeLock.h"
+
+
+/* Local helpers
+ *****************************************************************************/
+
+namespace FFMPEGMediaMemoryBudget
+{
+	/** Convert a budget setting in MB to bytes, 0 means no limit. */
+	int64 ToBytes(int32 MegaBytes)
+	{
+		return (MegaBytes > 0) ? (int64)MegaBytes * 1024 * 1024 : MAX_int64;
+	}
+
+	/** Weight of a player's share. */
+	int64 GetWeight(int32 Priority)
+	{
+		return (int64)FMath::Max(Priority, 0) + 1;
+	}
+}
+
+
+/* FFFMPEGMediaMemoryBudget interface
+ *****************************************************************************/
+
+FFFMPEGMediaMemoryBudget& FFFMPEGMediaMemoryBudget::Get()
+{
+	static FFFMPEGMediaMemoryBudget Budget;
+	return Budget;
+}
+
+
+void FFFMPEGMediaMemoryBudget::Register(FFFMPEGMediaTracks* Tracks, int32 Priority, const FString& Url)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	Entries.RemoveAll([Tracks](const FEntry& Entry) { return Entry.Tracks == Tracks; });
+	Entries.Add({ Tracks, Priority, Url });
+	Rebalance();
+}
+
+
+void FFFMPEGMediaMemoryBudget::Unregister(FFFMPEGMediaTracks* Tracks)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	Entries.RemoveAll([Tracks](const FEntry& Entry) { return Entry.Tracks == Tracks; });
+	Rebalance();
+}
+
+
+void FFFMPEGMediaMemoryBudget::SetPriority(FFFMPEGMediaTracks* Tracks, int32 Priority)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Tracks == Tracks)
+		{
+			Entry.Priority = Priority;
+		}
+	}
+
+	Rebalance();
+}
+
+
+int32 FFFMPEGMediaMemoryBudget::GetPriority(const FFFMPEGMediaTracks* Tracks) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	for (const FEntry& Entry : Entries)
+	{
+		if (Entry.Tracks == Tracks)
+		{
+			return Entry.Priority;
+		}
+	}
+
+	return 0;
+}
+
+
+void FFFMPEGMediaMemoryBudget::DumpUsage(FOutputDevice& Ar) const
+{
+	const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+	struct FUsage
+	{
+		const FFFMPEGMediaTracks* Tracks;
+		int32 Priority;
+		FString Url;
+		int64 PacketBytes;
+		int64 FrameBytes;
+	};
+
+	TArray<FUsage> Usages;
+
+	// the usage is read from atomics, the output device may take locks of its own and is called once the entries are copied
+	{
+		FScopeLock Lock(&CriticalSection);
+
+		for (const FEntry& Entry : Entries)
+		{
+			FUsage& Usage = Usages.Add_GetRef({ Entry.Tracks, Entry.Priority, Entry.Url, 0, 0 });
+			Entry.Tracks->GetMemoryUsage(Usage.PacketBytes, Usage.FrameBytes);
+		}
+	}
+
+	int64 TotalPackets = 0;
+	int64 TotalFrames = 0;
+
+	Ar.Logf(TEXT("FFMPEG memory budget: %d players, packets %d MB, frames %d MB (0 is unlimited)"),
+		Usages.Num(), Settings->MemoryBudgetPacketsMB, Settings->MemoryBudgetFramesMB);
+
+	for (const FUsage& Usage : Usages)
+	{
+		TotalPackets += Usage.PacketBytes;
+		TotalFrames += Usage.FrameBytes;
+
+		Ar.Logf(TEXT("  %p priority %d: packets %.1f MB, frames %.1f MB - %s"), Usage.Tracks, Usage.Priority,
+			Usage.PacketBytes / (1024.0 * 1024.0), Usage.FrameBytes / (1024.0 * 1024.0), *Usage.Url);
+	}
+
+	Ar.Logf(TEXT("  total: packets %.1f MB, frames %.1f MB"), TotalPackets / (1024.0 * 1024.0), TotalFrames / (1024.0 * 1024.0));
+}
+
+
+/* FFFMPEGMediaMemoryBudget implementation
+ *****************************************************************************/
+
+void FFFMPEGMediaMemoryBudget::Rebalance()
+{
+	const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+	const int64 PacketBudget = FFMPEGMediaMemoryBudget::ToBytes(Settings->MemoryBudgetPacketsMB);
+	const int64 FrameBudget = FFMPEGMediaMemoryBudget::ToBytes(Settings->MemoryBudgetFramesMB);
+
+	int64 TotalWeight = 0;
+
+	for (const FEntry& Entry : Entries)
+	{
+		TotalWeight += FFMPEGMediaMemoryBudget::GetWeight(Entry.Priority);
+	}
+
+	for (const FEntry& Entry : Entries)
+	{
+		const int64 Weight = FFMPEGMediaMemoryBudget::GetWeight(Entry.Priority);
+		const int64 PacketShare = (PacketBudget == MAX_int64) ? MAX_int64 : PacketBudget / TotalWeight * Weight;
+		const int64 FrameShare = (FrameBudget == MAX_int64) ? MAX_int64 : FrameBudget / TotalWeight * Weight;
+
+		Entry.Tracks->SetMemoryBudget(PacketShare, FrameShare);
+	}
+}
+
+
+/* Console commands
+ *****************************************************************************/
+
+static FAutoConsoleCommandWithOutputDevice DumpMemoryBudgetCommand(
+	TEXT("FFMPEGMedia.MemoryUsage"),
+	TEXT("Lists the packet and decoded frame memory used by every FFMPEG player."),
+	FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+	{
+		FFFMPEGMediaMemoryBudget::Get().DumpUsage(Ar);
+	}));
@@ -0,0 +1,67 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/Array.h"
+#include "Containers/UnrealString.h"
+#include "HAL/CriticalSection.h"
+
+class FFFMPEGMediaTracks;
+class FOutputDevice;
+
+
+/**
+ * Process wide memory budget shared by all the FFMPEG players.
+ *
+ * Every track collection registers itself with a priority, the packet and
+ * decoded frame budgets from the settings are split between them in
+ * proportion to their priorities. Each player keeps its queues inside its
+ * share, so registering a new player shrinks the queues of the others.
+ */
+class FFFMPEGMediaMemoryBudget
+{
+public:
+
+	/** Get the budget singleton. */
+	static FFFMPEGMediaMemoryBudget& Get();
+
+	/**
+	 * Add a player to the budget and rebalance the shares.
+	 *
+	 * @param Tracks The player's track collection.
+	 * @param Priority Weight of the player's share, higher priorities get more memory.
+	 * @param Url The URL of the media the player opened, for DumpUsage.
+	 */
+	void Register(FFFMPEGMediaTracks* Tracks, int32 Priority, const FString& Url);
+
+	/** Remove a player from the budget and give its share to the others. */
+	void Unregister(FFFMPEGMediaTracks* Tracks);
+
+	/** Change the priority of a registered player. */
+	void SetPriority(FFFMPEGMediaTracks* Tracks, int32 Priority);
+
+	/** Get the priority of a registered player, 0 if it isn't registered. */
+	int32 GetPriority(const FFFMPEGMediaTracks* Tracks) const;
+
+	/** Write the budget and the usage of every player to the given device. */
+	void DumpUsage(FOutputDevice& Ar) const;
+
+private:
+
+	struct FEntry
+	{
+		FFFMPEGMediaTracks* Tracks;
+		int32 Priority;
+		FString Url;
+	};
+
+	/** Hand out the shares, the lock must be held. */
+	void Rebalance();
+
+	/** The registered players. */
+	TArray<FEntry> Entries;
+
+	/** Protects the entries. */
+	mutable FCriticalSection CriticalSection;
+};
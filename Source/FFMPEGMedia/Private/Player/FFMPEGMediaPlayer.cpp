@@ -103,6 +103,12 @@ FName FFFMPEGMediaPlayer::GetPlayerName() const
 }
 
 FGuid FFFMPEGMediaPlayer::GetPlayerPluginGUID() const 
+{
+    return GetStaticPlayerPluginGUID();
+}
+
+
+const FGuid& FFFMPEGMediaPlayer::GetStaticPlayerPluginGUID()
 {
     // {938BEEB4-2E88-450E-9C1C-6109456279B3}
     static FGuid PlayerPluginGUID(0x938beeb4, 0x2e88450e, 0x9c1c6109, 0x456279b3);
@@ -152,6 +158,8 @@ bool FFFMPEGMediaPlayer::Open(const FString& Url, const IMediaOptions* Options,
 
     const bool Precache = (Options != nullptr) ? Options->GetMediaOption("PrecacheFile", false) : false;
 
+    Tracks->SetQueueDepths(Options);
+
     return InitializePlayer(nullptr, Url, Precache, PlayerOptions);
 }
 
@@ -162,7 +170,7 @@ bool FFFMPEGMediaPlayer::Open(const FString& Url, const IMediaOptions* Options)
 }
 
 
-bool FFFMPEGMediaPlayer::Open(const TSharedRef<FArchive, ESPMode::ThreadSafe>& Archive, const FString& OriginalUrl, const IMediaOptions* /*Options*/)
+bool FFFMPEGMediaPlayer::Open(const TSharedRef<FArchive, ESPMode::ThreadSafe>& Archive, const FString& OriginalUrl, const IMediaOptions* Options)
 {
 	Close();
 
@@ -178,6 +186,8 @@ bool FFFMPEGMediaPlayer::Open(const TSharedRef<FArchive, ESPMode::ThreadSafe>& A
         return false;
     }
 
+    Tracks->SetQueueDepths(Options);
+
     return InitializePlayer(Archive, OriginalUrl, false, nullptr);
 }
 
@@ -229,6 +239,78 @@ void FFFMPEGMediaPlayer::TickInput(FTimespan DeltaTime, FTimespan Timecode)
 }
 
 
+/* IFFMPEGMediaPlayer interface
+ *****************************************************************************/
+
+void FFFMPEGMediaPlayer::SetMaxOutputResolution(const FIntPoint& Resolution)
+{
+	Tracks->SetMaxOutputResolution(Resolution);
+}
+
+
+FIntPoint FFFMPEGMediaPlayer::GetMaxOutputResolution() const
+{
+	return Tracks->GetMaxOutputResolution();
+}
+
+
+void FFFMPEGMediaPlayer::SetOutputLOD(int32 Level)
+{
+	Tracks->SetOutputLOD(Level);
+}
+
+
+int32 FFFMPEGMediaPlayer::GetOutputLOD() const
+{
+	return Tracks->GetOutputLOD();
+}
+
+
+void FFFMPEGMediaPlayer::SetMemoryPriority(int32 Priority)
+{
+	Tracks->SetMemoryPriority(Priority);
+}
+
+
+int32 FFFMPEGMediaPlayer::GetMemoryPriority() const
+{
+	return Tracks->GetMemoryPriority();
+}
+
+
+void FFFMPEGMediaPlayer::GetMemoryUsage(int64& OutPacketBytes, int64& OutFrameBytes) const
+{
+	Tracks->GetMemoryUsage(OutPacketBytes, OutFrameBytes);
+}
+
+
+void FFFMPEGMediaPlayer::SetQoS(EFFMPEGMediaQoS QoS)
+{
+	Tracks->SetQoS(QoS);
+}
+
+
+EFFMPEGMediaQoS FFFMPEGMediaPlayer::GetQoS() const
+{
+	return Tracks->GetQoS();
+}
+
+
+/* IMediaCache interface
+ *****************************************************************************/
+
+bool FFFMPEGMediaPlayer::QueryCacheState(EMediaCacheState State, TRangeSet<FTimespan>& OutTimeRanges) const
+{
+	return Tracks->QueryCacheState(State, OutTimeRanges);
+}
+
+
+int32 FFFMPEGMediaPlayer::GetSampleCount(EMediaCacheState State) const
+{
+	return Tracks->GetSampleCount(State);
+}
+
+
 
 /* FFFMPEGMediaPlayer implementation
  *****************************************************************************/
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "FFMPEGMediaPrivate.h"
+#include "IFFMPEGMediaPlayer.h"
 
 
 
@@ -27,6 +28,7 @@ struct AVClass;
  */
 class FFFMPEGMediaPlayer
 	: public IMediaPlayer
+	, public IFFMPEGMediaPlayer
 	, protected IMediaCache
     , protected IMediaView
     
@@ -65,6 +67,29 @@ public:
 	virtual void TickFetch(FTimespan DeltaTime, FTimespan Timecode) override;
 	virtual void TickInput(FTimespan DeltaTime, FTimespan Timecode) override;
 
+	//~ IFFMPEGMediaPlayer interface
+
+	virtual void SetMaxOutputResolution(const FIntPoint& Resolution) override;
+	virtual FIntPoint GetMaxOutputResolution() const override;
+	virtual void SetOutputLOD(int32 Level) override;
+	virtual int32 GetOutputLOD() const override;
+	virtual void SetMemoryPriority(int32 Priority) override;
+	virtual int32 GetMemoryPriority() const override;
+	virtual void GetMemoryUsage(int64& OutPacketBytes, int64& OutFrameBytes) const override;
+	virtual void SetQoS(EFFMPEGMediaQoS QoS) override;
+	virtual EFFMPEGMediaQoS GetQoS() const override;
+
+protected:
+
+	//~ IMediaCache interface
+
+	virtual bool QueryCacheState(EMediaCacheState State, TRangeSet<FTimespan>& OutTimeRanges) const override;
+	virtual int32 GetSampleCount(EMediaCacheState State) const override;
+
+public:
+
+	/** The GUID returned by GetPlayerPluginGUID. */
+	static const FGuid& GetStaticPlayerPluginGUID();
 
 
 protected:
@@ -0,0 +1,98 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/LockFreeList.h"
+#include "Templates/SharedPointer.h"
+
+
+/**
+ * Lock free pool of media samples.
+ *
+ * Works like TMediaObjectPool, but the released objects go to a lock free
+ * list so the decoding threads never wait on each other or on the game
+ * thread to get a sample. The object type must implement IMediaPoolable.
+ */
+template<typename ObjectType>
+class TFFMPEGMediaSamplePool
+{
+	/** Free list, shared with the samples in flight so they can be released after the pool is gone. */
+	class FStorage
+	{
+	public:
+
+		/** Destructor. */
+		~FStorage()
+		{
+			Reset();
+		}
+
+		/** Get a free object or create a new one. */
+		ObjectType* Acquire()
+		{
+			ObjectType* Object = FreeList.Pop();
+
+			if (Object == nullptr)
+			{
+				Object = new ObjectType();
+			}
+
+			Object->InitializePoolable();
+
+			return Object;
+		}
+
+		/** Return an object to the free list. */
+		void Release(ObjectType* Object)
+		{
+			Object->ShutdownPoolable();
+			FreeList.Push(Object);
+		}
+
+		/** Delete the free objects. */
+		void Reset()
+		{
+			while (ObjectType* Object = FreeList.Pop())
+			{
+				delete Object;
+			}
+		}
+
+	private:
+
+		/** The free objects. */
+		TLockFreePointerListUnordered<ObjectType, PLATFORM_CACHE_LINE_SIZE> FreeList;
+	};
+
+public:
+
+	/** Default constructor. */
+	TFFMPEGMediaSamplePool()
+		: Storage(MakeShared<FStorage, ESPMode::ThreadSafe>())
+	{ }
+
+public:
+
+	/** Get a shared object from the pool, the object returns to the pool when the last reference is gone. */
+	TSharedRef<ObjectType, ESPMode::ThreadSafe> AcquireShared()
+	{
+		TSharedRef<FStorage, ESPMode::ThreadSafe> StorageRef = Storage;
+
+		return MakeShareable(Storage->Acquire(), [StorageRef](ObjectType* Object)
+		{
+			StorageRef->Release(Object);
+		});
+	}
+
+	/** Delete the free objects, the objects in use come back to the pool when released. */
+	void Reset()
+	{
+		Storage->Reset();
+	}
+
+private:
+
+	/** The free list. */
+	TSharedRef<FStorage, ESPMode::ThreadSafe> Storage;
+};
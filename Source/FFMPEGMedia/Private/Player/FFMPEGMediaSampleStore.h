@@ -0,0 +1,272 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/Array.h"
+#include "IMediaTimeSource.h"
+#include "Math/Range.h"
+#include "Misc/Timespan.h"
+#include "Templates/SharedPointer.h"
+
+#include <atomic>
+
+
+/**
+ * Small store of media samples served by time.
+ *
+ * The samples are kept in the order they are presented. A fetch skips the
+ * samples that ended before the requested range one by one and keeps the ones
+ * that start after it, so a fetch that misses never empties the store.
+ *
+ * Every seek and loop starts a new sequence, samples with an older sequence
+ * index in their time stamp are stale whatever their time, so the store
+ * drops them instead of being flushed.
+ *
+ * The store isn't thread safe, except for Num, the caller serializes the
+ * producers and the consumer.
+ */
+template<typename SampleType>
+class TFFMPEGMediaSampleStore
+{
+public:
+
+	typedef TSharedPtr<SampleType, ESPMode::ThreadSafe> FSamplePtr;
+
+	/** Default constructor. */
+	TFFMPEGMediaSampleStore()
+		: NumSamples(0)
+		, NumStale(0)
+		, SequenceIndex(0)
+		, FetchTime(FTimespan::MinValue())
+		, FetchSequenceIndex(INDEX_NONE)
+	{ }
+
+public:
+
+	/** Get the number of samples in the store, can be called from any thread. */
+	int32 Num() const
+	{
+		return NumSamples;
+	}
+
+	/** Get the number of samples skipped because they were too old when fetched. */
+	int64 GetNumStale() const
+	{
+		return NumStale;
+	}
+
+	/**
+	 * Start a new sequence, can be called from any thread.
+	 *
+	 * The samples of the previous sequences are dropped by the next call to
+	 * Enqueue, Fetch or RemoveStale.
+	 *
+	 * @param InSequenceIndex The sequence index of the samples to keep.
+	 */
+	void SetSequenceIndex(int64 InSequenceIndex)
+	{
+		SequenceIndex = InSequenceIndex;
+	}
+
+	/** Get the sequence index of the samples the store keeps. */
+	int64 GetSequenceIndex() const
+	{
+		return SequenceIndex;
+	}
+
+	/**
+	 * Add a sample after the ones already in the store.
+	 *
+	 * @param Sample The sample to add.
+	 * @return false if the sample belongs to a previous sequence.
+	 */
+	template<typename InSampleType>
+	bool Enqueue(const TSharedRef<InSampleType, ESPMode::ThreadSafe>& Sample)
+	{
+		RemoveStale();
+
+		if (Sample->GetTime().SequenceIndex < SequenceIndex)
+		{
+			++NumStale;
+			return false;
+		}
+
+		Samples.Add(Sample);
+		NumSamples = Samples.Num();
+
+		return true;
+	}
+
+	/**
+	 * Get the sample for the given time range.
+	 *
+	 * The samples before the first one overlapping the range are removed,
+	 * samples after the range are kept for the next fetches.
+	 *
+	 * @param TimeRange The time range the sample has to overlap.
+	 * @param OutSample Will contain the sample.
+	 * @return true if a sample was returned.
+	 */
+	bool Fetch(const TRange<FTimespan>& TimeRange, FSamplePtr& OutSample)
+	{
+		RemoveStale();
+
+		if (TimeRange.HasLowerBound())
+		{
+			FetchTime = TimeRange.GetLowerBoundValue();
+			FetchSequenceIndex = SequenceIndex;
+		}
+
+		int32 Found = INDEX_NONE;
+
+		for (int32 Index = 0; Index < Samples.Num(); ++Index)
+		{
+			if (Overlaps(Samples[Index], TimeRange))
+			{
+				Found = Index;
+				break;
+			}
+		}
+
+		if (Found == INDEX_NONE)
+		{
+			// only drop what the clock already passed
+			int32 NumOld = 0;
+
+			while ((NumOld < Samples.Num()) && (GetEnd(Samples[NumOld]) <= TimeRange.GetLowerBoundValue()))
+			{
+				++NumOld;
+			}
+
+			Remove(NumOld, true);
+
+			return false;
+		}
+
+		OutSample = Samples[Found];
+		Remove(Found, true);
+		Remove(1, false);
+
+		return true;
+	}
+
+	/** Get the next sample without removing it. */
+	bool Peek(FSamplePtr& OutSample) const
+	{
+		if (Samples.Num() == 0)
+		{
+			return false;
+		}
+
+		OutSample = Samples[0];
+
+		return true;
+	}
+
+	/** Remove the next sample. */
+	bool Pop()
+	{
+		if (Samples.Num() == 0)
+		{
+			return false;
+		}
+
+		Remove(1, false);
+
+		return true;
+	}
+
+	/**
+	 * Check whether a sample would never be fetched.
+	 *
+	 * A sample of a previous sequence is refused by Enqueue, and one ending
+	 * before the range of the last fetch is skipped by the next one, so the
+	 * producers don't need to make it.
+	 *
+	 * @param Time The time stamp of the sample.
+	 * @param Duration The duration of the sample.
+	 * @return true if the sample would be thrown away.
+	 */
+	bool IsBehindFetch(const FMediaTimeStamp& Time, FTimespan Duration) const
+	{
+		if (Time.SequenceIndex < SequenceIndex)
+		{
+			return true;
+		}
+
+		return (Time.SequenceIndex == FetchSequenceIndex) && (Time.Time + Duration <= FetchTime);
+	}
+
+	/** Remove the samples of the previous sequences. */
+	void RemoveStale()
+	{
+		const int64 Current = SequenceIndex;
+		int32 NumOld = 0;
+
+		// sequences only grow, the old samples are the first ones
+		while ((NumOld < Samples.Num()) && (Samples[NumOld]->GetTime().SequenceIndex < Current))
+		{
+			++NumOld;
+		}
+
+		Remove(NumOld, true);
+	}
+
+	/** Remove all the samples. */
+	void Flush()
+	{
+		Samples.Reset();
+		NumSamples = 0;
+		FetchSequenceIndex = INDEX_NONE;
+	}
+
+protected:
+
+	static FTimespan GetEnd(const FSamplePtr& Sample)
+	{
+		return Sample->GetTime().Time + Sample->GetDuration();
+	}
+
+	static bool Overlaps(const FSamplePtr& Sample, const TRange<FTimespan>& TimeRange)
+	{
+		const FTimespan Time = Sample->GetTime().Time;
+		return TimeRange.Overlaps(TRange<FTimespan>(Time, FMath::Max(GetEnd(Sample), Time + 1)));
+	}
+
+	void Remove(int32 Count, bool Stale)
+	{
+		if (Count <= 0)
+		{
+			return;
+		}
+
+		Samples.RemoveAt(0, Count, false);
+		NumSamples = Samples.Num();
+
+		if (Stale)
+		{
+			NumStale += Count;
+		}
+	}
+
+private:
+
+	/** The samples in the order they were added. */
+	TArray<FSamplePtr> Samples;
+
+	/** Copy of Samples.Num() for the producers. */
+	std::atomic<int32> NumSamples;
+
+	/** Samples removed without being fetched. */
+	std::atomic<int64> NumStale;
+
+	/** Samples with a lower sequence index are stale. */
+	std::atomic<int64> SequenceIndex;
+
+	/** Start of the time range of the last fetch. */
+	FTimespan FetchTime;
+
+	/** Sequence index of the store at the last fetch, INDEX_NONE before the first one. */
+	int64 FetchSequenceIndex;
+};
@@ -1,162 +1,246 @@
-// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreTypes.h"
-#include "Containers/Array.h"
-#include "IMediaTextureSample.h"
-#include "MediaObjectPool.h"
-#include "MediaSampleQueue.h"
-#include "Math/IntPoint.h"
-#include "Misc/Timespan.h"
-
-
-/**
- * Texture sample generated by FFMPEGMedia player.
- */
-class FFFMPEGMediaTextureSample
-	: public IMediaTextureSample
-	, public IMediaPoolable
-{
-public:
-
-	/** Default constructor. */
-	FFFMPEGMediaTextureSample()
-		: Dim(FIntPoint::ZeroValue)
-		, Duration(FTimespan::Zero())
-		, OutputDim(FIntPoint::ZeroValue)
-		, SampleFormat(EMediaTextureSampleFormat::Undefined)
-		, Stride(0)
-		, Time(FTimespan::Zero())
-	{ }
-
-	/** Virtual destructor. */
-	virtual ~FFFMPEGMediaTextureSample() { }
-
-public:
-
-	/**
-	 * Initialize the sample.
-	 *
-	 * @param InBuffer The sample's data buffer.
-	 * @param InSize Size of the buffer.
-	 * @param InDim The sample buffer's width and height (in pixels).
-	 * @param InOutputDim The sample's output width and height (in pixels).
-	 * @param InSampleFormat The sample format.
-	 * @param InStride Number of bytes per pixel row.
-	 * @param InTime The sample time (relative to presentation clock).
-	 * @param InDuration The duration for which the sample is valid.
-	 */
-	bool Initialize(
-		const void* InBuffer,
-		uint32 InSize,
-		const FIntPoint& InDim,
-		uint32 InStride,
-		FTimespan InTime,
-		FTimespan InDuration)
-	{
-		if ((InBuffer == nullptr) || (InSize == 0) || (InStride == 0))
-		{
-			return false;
-		}
-
-		if ((InStride * InDim.Y) > InSize)
-		{
-			return false;
-		}
-
-       
-		Buffer.Reset(InSize);
-		Buffer.Append((uint8*)InBuffer, InSize);
-		Duration = InDuration;
-		Dim = InDim;
-		SampleFormat = EMediaTextureSampleFormat::CharBGRA;
-		Stride = InStride;
-		Time = InTime;
-
-		return true;
-	}
-
-public:
-
-	//~ IMediaTextureSample interface
-
-	virtual const void* GetBuffer() override
-	{
-		return Buffer.GetData();
-	}
-
-	virtual FIntPoint GetDim() const override
-	{
-		return Dim;
-	}
-
-	virtual FTimespan GetDuration() const override
-	{
-		return Duration;
-	}
-
-	virtual EMediaTextureSampleFormat GetFormat() const override
-	{
-		return SampleFormat;
-	}
-
-	virtual FIntPoint GetOutputDim() const override
-	{
-		return Dim;
-	}
-
-	virtual uint32 GetStride() const override
-	{
-		return Stride;
-	}
-
-#if WITH_ENGINE
-	virtual FRHITexture* GetTexture() const override
-	{
-		return nullptr;
-	}
-#endif //WITH_ENGINE
-
-	virtual FMediaTimeStamp GetTime() const override
-	{
-		return Time;
-	}
-
-	virtual bool IsCacheable() const override
-	{
-		return true;
-	}
-
-	virtual bool IsOutputSrgb() const override
-	{
-		return true;
-	}
-
-private:
-
-	/** The sample's data buffer. */
-	TArray<uint8> Buffer;
-
-	/** Width and height of the texture sample. */
-	FIntPoint Dim;
-
-	/** Duration for which the sample is valid. */
-	FTimespan Duration;
-
-	/** Width and height of the output. */
-	FIntPoint OutputDim;
-
-	/** The sample format. */
-	EMediaTextureSampleFormat SampleFormat;
-
-	/** Number of bytes per pixel row. */
-	uint32 Stride;
-
-	/** Presentation for which the sample was generated. */
-	FMediaTimeStamp Time;
-};
-
-
-/** Implements a pool for WMF texture samples. */
-class FFFMPEGMediaTextureSamplePool : public TMediaObjectPool<FFFMPEGMediaTextureSample> { };
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/Array.h"
+#include "IMediaTextureSample.h"
+#include "MediaObjectPool.h"
+#include "FFMPEGMediaSamplePool.h"
+#include "MediaSampleQueue.h"
+#include "Math/IntPoint.h"
+#include "Math/Matrix.h"
+#include "MediaShaders.h"
+#include "Misc/Timespan.h"
+
+extern "C" {
+    #include "libavutil/buffer.h"
+}
+
+
+/**
+ * Texture sample generated by FFMPEGMedia player.
+ */
+class FFFMPEGMediaTextureSample
+	: public IMediaTextureSample
+	, public IMediaPoolable
+{
+public:
+
+	/** Default constructor. */
+	FFFMPEGMediaTextureSample()
+		: BufferRef(nullptr)
+		, Data(nullptr)
+		, Dim(FIntPoint::ZeroValue)
+		, Duration(FTimespan::Zero())
+		, FullRange(false)
+		, OutputDim(FIntPoint::ZeroValue)
+		, SampleFormat(EMediaTextureSampleFormat::Undefined)
+		, Stride(0)
+		, Time(FTimespan::Zero())
+		, YUVToRGBMatrix(&GetConversionMatrix(false, false))
+	{ }
+
+	/** Virtual destructor. */
+	virtual ~FFFMPEGMediaTextureSample()
+	{
+		ReleaseBuffer();
+	}
+
+public:
+
+	/**
+	 * Initialize the sample.
+	 *
+	 * The sample takes ownership of the buffer reference and exposes the
+	 * pixels without copying them, the reference is dropped when the sample
+	 * is returned to its pool.
+	 *
+	 * @param InBufferRef Reference to the buffer holding the pixels.
+	 * @param InData First pixel of the image, must be inside the referenced buffer.
+	 * @param InDim The sample buffer's width and height (in pixels).
+	 * @param InOutputDim The sample's output width and height (in pixels).
+	 * @param InSampleFormat The sample format.
+	 * @param InStride Number of bytes per pixel row.
+	 * @param InTime The sample time (relative to presentation clock) and sequence index.
+	 * @param InDuration The duration for which the sample is valid.
+	 */
+	bool Initialize(
+		AVBufferRef* InBufferRef,
+		const uint8* InData,
+		const FIntPoint& InDim,
+		const FIntPoint& InOutputDim,
+		EMediaTextureSampleFormat InSampleFormat,
+		uint32 InStride,
+		const FMediaTimeStamp& InTime,
+		FTimespan InDuration)
+	{
+		ReleaseBuffer();
+
+		if ((InBufferRef == nullptr) || (InData == nullptr) || (InStride == 0))
+		{
+			av_buffer_unref(&InBufferRef);
+			return false;
+		}
+
+		if ((InData < InBufferRef->data) || (InData + (SIZE_T)InStride * InDim.Y > InBufferRef->data + InBufferRef->size))
+		{
+			av_buffer_unref(&InBufferRef);
+			return false;
+		}
+
+		BufferRef = InBufferRef;
+		Data = InData;
+		Duration = InDuration;
+		Dim = InDim;
+		OutputDim = InOutputDim;
+		SampleFormat = InSampleFormat;
+		Stride = InStride;
+		Time = InTime;
+		FullRange = false;
+		YUVToRGBMatrix = &GetConversionMatrix(false, false);
+
+		return true;
+	}
+
+	/**
+	 * Set the color space used by the GPU to convert YUV samples.
+	 *
+	 * @param bRec709 Whether the sample uses BT.709 instead of BT.601 coefficients.
+	 * @param bFullRange Whether the luma uses the full 0-255 range.
+	 */
+	void SetColorSpace(bool bRec709, bool bFullRange)
+	{
+		FullRange = bFullRange;
+		YUVToRGBMatrix = &GetConversionMatrix(bRec709, bFullRange);
+	}
+
+	/** Get the YUV to RGB conversion matrix for the given color space. */
+	static const FMatrix& GetConversionMatrix(bool bRec709, bool bFullRange)
+	{
+		if (bRec709)
+		{
+			return bFullRange ? MediaShaders::YuvToRgbRec709Unscaled : MediaShaders::YuvToRgbRec709Scaled;
+		}
+
+		return bFullRange ? MediaShaders::YuvToRgbRec601Unscaled : MediaShaders::YuvToRgbRec601Scaled;
+	}
+
+public:
+
+	//~ IMediaTextureSample interface
+
+	virtual const void* GetBuffer() override
+	{
+		return Data;
+	}
+
+	virtual FIntPoint GetDim() const override
+	{
+		return Dim;
+	}
+
+	virtual FTimespan GetDuration() const override
+	{
+		return Duration;
+	}
+
+	virtual EMediaTextureSampleFormat GetFormat() const override
+	{
+		return SampleFormat;
+	}
+
+	virtual FIntPoint GetOutputDim() const override
+	{
+		return OutputDim;
+	}
+
+	virtual uint32 GetStride() const override
+	{
+		return Stride;
+	}
+
+#if WITH_ENGINE
+	virtual FRHITexture* GetTexture() const override
+	{
+		return nullptr;
+	}
+#endif //WITH_ENGINE
+
+	virtual FMediaTimeStamp GetTime() const override
+	{
+		return Time;
+	}
+
+	virtual bool IsCacheable() const override
+	{
+		return true;
+	}
+
+	virtual bool IsOutputSrgb() const override
+	{
+		return true;
+	}
+
+	virtual const FMatrix& GetYUVToRGBMatrix() const override
+	{
+		return *YUVToRGBMatrix;
+	}
+
+	virtual bool GetFullRange() const override
+	{
+		return FullRange;
+	}
+
+public:
+
+	//~ IMediaPoolable interface
+
+	virtual void ShutdownPoolable() override
+	{
+		ReleaseBuffer();
+	}
+
+private:
+
+	/** Drops the reference to the pixel buffer so it can go back to its pool. */
+	void ReleaseBuffer()
+	{
+		av_buffer_unref(&BufferRef);
+		Data = nullptr;
+	}
+
+	/** Reference to the buffer holding the sample's pixels. */
+	AVBufferRef* BufferRef;
+
+	/** First pixel of the sample, points into BufferRef. */
+	const uint8* Data;
+
+	/** Width and height of the texture sample. */
+	FIntPoint Dim;
+
+	/** Duration for which the sample is valid. */
+	FTimespan Duration;
+
+	/** Whether the YUV samples use the full range. */
+	bool FullRange;
+
+	/** Width and height of the output. */
+	FIntPoint OutputDim;
+
+	/** The sample format. */
+	EMediaTextureSampleFormat SampleFormat;
+
+	/** Number of bytes per pixel row. */
+	uint32 Stride;
+
+	/** Presentation for which the sample was generated. */
+	FMediaTimeStamp Time;
+
+	/** Matrix used to convert YUV samples to RGB. */
+	const FMatrix* YUVToRGBMatrix;
+};
+
+
+/** Implements a pool for WMF texture samples. */
+class FFFMPEGMediaTextureSamplePool : public TFFMPEGMediaSamplePool<FFFMPEGMediaTextureSample> { };
@@ -1,2872 +1,3710 @@
-// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
-
-#include "FFMPEGMediaTracks.h"
-#include "FFMPEGMediaPrivate.h"
-#include "LambdaFunctionRunnable.h"
-#include "FFMPEGMediaSettings.h"
-
-#include "FFMPEGDecoder.h"
-#include "FFMPEGFrame.h"
-
-#include "IMediaOptions.h"
-#include "MediaHelpers.h"
-#include "Misc/ScopeLock.h"
-#include "UObject/Class.h"
-#include "IMediaBinarySample.h"
-#include "IMediaEventSink.h"
-#include "MediaPlayerOptions.h"
-
-
-#if WITH_ENGINE
-	#include "Engine/Engine.h"
-#endif
-
-#include "FFMPEGMediaBinarySample.h"
-#include "FFMPEGMediaOverlaySample.h"
-#include "FFMPEGMediaAudioSample.h"
-#include "FFMPEGMediaTextureSample.h"
-
-extern  "C" {
-#include "libavformat/avformat.h"
-#include "libavcodec/avcodec.h"
-#include "libavutil/imgutils.h"
-#include "libavutil/hwcontext.h"
-#include "libavutil/time.h"
-#include "libswscale/swscale.h"
-#include "libswresample/swresample.h"
-
-}
-
-#define MAX_QUEUE_SIZE (15 * 1024 * 1024)
-
-#define MIN_FRAMES 30
-
-/* polls for possible required screen refresh at least this often, should be less than 1/fps */
-#define REFRESH_RATE 0.01
-
-/* AV sync correction is done if above the maximum AV sync threshold */
-#define AV_SYNC_THRESHOLD_MAX 0.1
-
-/* no AV sync correction is done if below the minimum AV sync threshold */
-#define AV_SYNC_THRESHOLD_MIN 0.04
-/* AV sync correction is done if above the maximum AV sync threshold */
-#define AV_SYNC_THRESHOLD_MAX 0.1
-/* If a frame duration is longer than this, it will not be duplicated to compensate AV sync */
-#define AV_SYNC_FRAMEDUP_THRESHOLD 0.1
-
-#define EXTERNAL_CLOCK_MIN_FRAMES 2
-#define EXTERNAL_CLOCK_MAX_FRAMES 10
-
-/* external clock speed adjustment constants for realtime sources based on buffer fullness */
-#define EXTERNAL_CLOCK_SPEED_MIN  0.900
-#define EXTERNAL_CLOCK_SPEED_MAX  1.010
-#define EXTERNAL_CLOCK_SPEED_STEP 0.001
-
-/* Minimum  audio buffer size, in samples. */
-#define AUDIO_MIN_BUFFER_SIZE 512
-
-/* Calculate actual buffer size keeping in mind not cause too frequent audio callbacks */
-#define AUDIO_MAX_CALLBACKS_PER_SEC 30
-
-/* no AV correction is done if too big error */
-#define AV_NOSYNC_THRESHOLD 10.0
-
-/* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
-#define AUDIO_DIFF_AVG_NB   20
-
-/* maximum audio speed change to get correct sync */
-#define SAMPLE_CORRECTION_PERCENT_MAX 10
-
-
-#define LOCTEXT_NAMESPACE "FFMPEGMediaTracks"
-
-
-
-
-
-/* FFFMPEGMediaTracks structors
- *****************************************************************************/
-
-FFFMPEGMediaTracks::FFFMPEGMediaTracks()
-	: AudioSamplePool(new FFFMPEGMediaAudioSamplePool)
-	, FormatContext(NULL)
-	, MediaSourceChanged(false)
-	, SelectedAudioTrack(INDEX_NONE)
-	, SelectedCaptionTrack(INDEX_NONE)
-	, SelectedMetadataTrack(INDEX_NONE)
-	, SelectedVideoTrack(INDEX_NONE)
-	, SelectionChanged(false)
-	, VideoSamplePool(new FFFMPEGMediaTextureSamplePool)
-	, CurrentRate(0.0f)
-  , CurrentState (EMediaState::Closed)
-  , LastState (EMediaState::Closed)
-	, CurrentTime(FTimespan::Zero())
-  , Duration(FTimespan::Zero())
-  , ShouldLoop(false)
-  , bPrerolled(false)
-	, imgConvertCtx(NULL)
-	, readThread(nullptr)
-	, audioThread(nullptr)
-	, videoThread(nullptr)
-	, subtitleThread(nullptr)
-	, displayThread(nullptr)
-	, audioStream(NULL)
-	, videoStream(NULL)
-	, subTitleStream(NULL)
-	, video_ctx(NULL)
-	, hw_device_ctx(NULL)
-	, hw_frames_ctx(NULL)
-	, swrContext(NULL)
-	, aborted(false)
-  , displayRunning(false)
-  , step(false)  
-  , seekReq(false)
-  , seekPos(0)
-  , seekRel(0)
-  , seekFlags(0)
-  , queueAttachmentsReq(false)
-  , videoStreamIdx(-1)
-  , audioStreamIdx(-1)
-  , subtitleStreamIdx(-1)
-  , forceRefresh(false)
-  , frameDropsLate(0)
-  , frameDropsEarly(0)
-  , frameTimer(0.0)
-  , maxFrameDuration(0.0)
-  , realtime(false)
-  , audioBuf(NULL)
-  , audioBuf1(NULL)
-  , audioBufSize(0)
-  , audioBuf1Size(0)
-  , audioClockSerial(0)
-  , audioClock(0)
-  , audioCallbackTime(0)
-  , audioDiffAvgCoef(0)
-  , audioDiffThreshold(0)
-  , audioDiffAvgCount(0)
-  , audioDiffCum(0)
-  , totalStreams(0)
-	, currentStreams(0)
-	, hwAccelPixFmt(AV_PIX_FMT_NONE)
-	, hwAccelDeviceType(AV_HWDEVICE_TYPE_NONE){
-    
-}
-
-
-FFFMPEGMediaTracks::~FFFMPEGMediaTracks()
-{
-	Shutdown();
-
-	delete AudioSamplePool;
-	AudioSamplePool = nullptr;
-
-	delete VideoSamplePool;
-	VideoSamplePool = nullptr;
-}
-
-
-/* FFFMPEGMediaTracks interface
- *****************************************************************************/
-
-void FFFMPEGMediaTracks::AppendStats(FString &OutStats) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	// audio tracks
-	OutStats += TEXT("Audio Tracks\n");
-	
-	if (AudioTracks.Num() == 0)
-	{
-		OutStats += TEXT("\tnone\n");
-	}
-	else
-	{
-		for (const FTrack& Track : AudioTracks)
-		{
-			OutStats += FString::Printf(TEXT("\t%s\n"), *Track.DisplayName.ToString());
-			OutStats += TEXT("\t\tNot implemented yet");
-		}
-	}
-
-	// video tracks
-	OutStats += TEXT("Video Tracks\n");
-
-	if (VideoTracks.Num() == 0)
-	{
-		OutStats += TEXT("\tnone\n");
-	}
-	else
-	{
-		for (const FTrack& Track : VideoTracks)
-		{
-			OutStats += FString::Printf(TEXT("\t%s\n"), *Track.DisplayName.ToString());
-			OutStats += TEXT("\t\tNot implemented yet");
-		}
-	}
-}
-
-
-void FFFMPEGMediaTracks::ClearFlags()
-{
-	FScopeLock Lock(&CriticalSection);
-
-	MediaSourceChanged = false;
-	SelectionChanged = false;
-}
-
-void FFFMPEGMediaTracks::GetEvents(TArray<EMediaEvent>& OutEvents) {
-    EMediaEvent Event;
-
-    while (DeferredEvents.Dequeue(Event))
-    {
-        OutEvents.Add(Event);
-    }
-}
-
-
-
-void FFFMPEGMediaTracks::GetFlags(bool& OutMediaSourceChanged, bool& OutSelectionChanged) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	OutMediaSourceChanged = MediaSourceChanged;
-	OutSelectionChanged = SelectionChanged;
-}
-
-
-void FFFMPEGMediaTracks::Initialize(AVFormatContext* ic, const FString& Url, const FMediaPlayerOptions* PlayerOptions )
-{
-	Shutdown();
-    
-    FMediaPlayerTrackOptions TrackOptions;
-    if (PlayerOptions != nullptr)
-    {
-        TrackOptions = PlayerOptions->Tracks;
-    }
-    
-   
-	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: Initializing (media source %p)"), this, ic);
-
-	FScopeLock Lock(&CriticalSection);
-
-	MediaSourceChanged = true;
-	SelectionChanged = true;
-
-	if (!ic)
-	{
-        CurrentState = EMediaState::Error;
-		return;
-	}
-
-
-    if (pictq.Init(&videoq, VIDEO_PICTURE_QUEUE_SIZE, 1) < 0) {
-        Shutdown();
-        CurrentState = EMediaState::Error;
-        return ;
-    }
-
-    realtime = IsRealtime(ic) != 0;
-
-    if (subpq.Init(&subtitleq, SUBPICTURE_QUEUE_SIZE, 0) < 0) {
-        Shutdown();
-        CurrentState = EMediaState::Error;
-        return;
-    }
-
-    if (sampq.Init(&audioq, SAMPLE_QUEUE_SIZE, 1) < 0) {
-        Shutdown();
-        CurrentState = EMediaState::Error;
-        return;
-    }
-
-    vidclk.Init(&videoq);
-    audclk.Init(&audioq);
-    extclk.Init(&extclk);
-    
-    this->FormatContext = ic;
-    audioClockSerial = -1;
-
-    CurrentState = EMediaState::Preparing;
-
-    //
-
-    bool AllStreamsAdded = true;
-
-    for (int i = 0; i < (int)ic->nb_streams; i++) {
-        AVStream *st = ic->streams[i];
-        bool streamAdded = AddStreamToTracks(i, false, TrackOptions, Info);
-        AllStreamsAdded &= streamAdded;
-        if ( streamAdded) {
-            totalStreams++;
-        }
-        enum AVMediaType type = st->codecpar->codec_type;
-        st->discard = AVDISCARD_ALL;
-    }
-
-    if (!AllStreamsAdded)
-    {
-        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Not all available streams were added to the track collection"), this);
-    }
-
-    int64_t duration = ic->duration + (ic->duration <= INT64_MAX - 5000 ? 5000 : 0);
-
-    Duration = duration * 10;
-
-    maxFrameDuration = (ic->iformat->flags & AVFMT_TS_DISCONT) ? 10.0 : 3600.0;
-
-    SetRate(0.0f);
-
-    DeferredEvents.Enqueue(EMediaEvent::MediaOpened);
-    //Start the read thread
-
-    aborted = false;
-
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-    sychronizationType = Settings->SyncType;
-
-    readThread = LambdaFunctionRunnable::RunThreaded(TEXT("ReadThread"), [this] {
-        ReadThread();
-    }); 
-    
-
-}
-
-void FFFMPEGMediaTracks::ReInitialize()
-{
-	/*if (MediaSource != NULL)
-	{
-		TComPtr<IMFMediaSource> lMediaSource = WmfMedia::ResolveMediaSource(nullptr, SourceUrl, false);
-		int32 lTrack = GetSelectedTrack(EMediaTrackType::Video);
-		int32 lFormat = GetTrackFormat(EMediaTrackType::Video, lTrack);
-		Initialize(lMediaSource, SourceUrl);
-		SetTrackFormat(EMediaTrackType::Video, lTrack, lFormat);
-		SelectTrack(EMediaTrackType::Video, lTrack);
-	}*/
-}
-
-void FFFMPEGMediaTracks::Shutdown()
-{
-	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: Shutting down (context %p)"), this, FormatContext);
-
-    aborted = true;
-    displayRunning = false;
-
-    maxFrameDuration = 0.0;
-
-    /* close each stream */
-    if (SelectedAudioTrack >= 0)
-        StreamComponentClose(audioStreamIdx);
-    if (SelectedCaptionTrack >= 0)
-        StreamComponentClose(subtitleStreamIdx);
-    if (SelectedVideoTrack >= 0)
-        StreamComponentClose(videoStreamIdx);
-
-    videoStreamIdx = -1;
-    audioStreamIdx = -1;
-    subtitleStreamIdx = -1;
-    
-    if ( displayThread != nullptr) {
-        displayThread->WaitForCompletion();
-        displayThread = nullptr;
-    }
-    
-    if ( readThread != nullptr) {
-        readThread->WaitForCompletion();
-        readThread = nullptr;
-    }
-    if ( audioThread != nullptr) {
-        audioThread->WaitForCompletion();
-        audioThread = nullptr;
-    }
-    if ( videoThread != nullptr) {
-        videoThread->Kill(true);
-        videoThread = nullptr;
-    }
-    if ( subtitleThread != nullptr) {
-        subtitleThread->WaitForCompletion();
-        subtitleThread = nullptr;
-    }
-    
-    
-    
-    
-    if ( imgConvertCtx ) {
-        sws_freeContext(imgConvertCtx);
-        imgConvertCtx = NULL;
-    }
-    
-    hwaccel_retrieve_data = nullptr;
-    auddec = MakeShareable(new FFMPEGDecoder());
-    viddec = MakeShareable(new FFMPEGDecoder());
-    subdec= MakeShareable(new FFMPEGDecoder());
-   
-
-     /*hw_device_ctx(NULL)
-    , hw_frames_ctx(NULL)
-    , hwaccel_ctx(NULL)
-    , hwAccelPixFmt(AV_PIX_FMT_NONE)*/
-    
-	FScopeLock Lock(&CriticalSection);
-
-    pictq.Destroy();
-    subpq.Destroy();
-    sampq.Destroy();
-
-    audioq.Flush();
-    videoq.Flush();
-    subtitleq.Flush();
-    
-	AudioSamplePool->Reset();
-	VideoSamplePool->Reset();
-
-	SelectedAudioTrack = INDEX_NONE;
-	SelectedCaptionTrack = INDEX_NONE;
-	SelectedMetadataTrack = INDEX_NONE;
-	SelectedVideoTrack = INDEX_NONE;
-
-    frameDropsLate = 0;
-    frameDropsEarly = 0;
-
-	AudioTracks.Empty();
-	MetadataTracks.Empty();
-	CaptionTracks.Empty();
-	VideoTracks.Empty();
-
-	Info.Empty();
-
-	MediaSourceChanged = false;
-	SelectionChanged = false;
-    bPrerolled = false;
-    
-    CurrentState =  EMediaState::Closed;
-
-    currentStreams = 0;
-    totalStreams = 0;
-    frameTimer = 0.0;
-    maxFrameDuration = 0.0;
-    dataBuffer.Reset();
-}
-
-void FFFMPEGMediaTracks::TickInput(FTimespan DeltaTime, FTimespan Timecode) {
-    TargetTime = Timecode;
-
-    double time = Timecode.GetTotalSeconds();
-    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: TimeCode %.3f"), this, (float)time);
-}
-
-
-/* IMediaSamples interface
- *****************************************************************************/
-
-bool FFFMPEGMediaTracks::FetchAudio(TRange<FTimespan> TimeRange, TSharedPtr<IMediaAudioSample, ESPMode::ThreadSafe>& OutSample)
-{
-	TSharedPtr<IMediaAudioSample, ESPMode::ThreadSafe> Sample;
-
-    FTimespan timeSpan = TimeRange.Size<FTimespan>();
-
-    double time = timeSpan.GetTotalSeconds();
-    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: TimeCode %.3f"), this, (float)time);
-
-
-	if (!AudioSampleQueue.Peek(Sample))
-	{
-		return false;
-	}
-
-	const FTimespan SampleTime = Sample->GetTime().Time;
-
-	if (!TimeRange.Overlaps(TRange<FTimespan>(SampleTime, SampleTime + Sample->GetDuration())))
-	{
-        AudioSampleQueue.RequestFlush();
-		return false;
-	}
-
-	if (!AudioSampleQueue.Dequeue(Sample))
-	{
-		return false;
-	}
-
-
-    
-
-	OutSample = Sample;
-
-	return true;
-}
-
-
-bool FFFMPEGMediaTracks::FetchCaption(TRange<FTimespan> TimeRange, TSharedPtr<IMediaOverlaySample, ESPMode::ThreadSafe>& OutSample)
-{
-	TSharedPtr<IMediaOverlaySample, ESPMode::ThreadSafe> Sample;
-
-	if (!CaptionSampleQueue.Peek(Sample))
-	{
-		return false;
-	}
-
-    const FTimespan SampleTime = Sample->GetTime().Time;
-
-	if (!TimeRange.Overlaps(TRange<FTimespan>(SampleTime, SampleTime + Sample->GetDuration())))
-	{
-        CaptionSampleQueue.RequestFlush();
-		return false;
-	}
-
-	if (!CaptionSampleQueue.Dequeue(Sample))
-	{
-		return false;
-	}
-
-	OutSample = Sample;
-
-	return true;
-}
-
-
-bool FFFMPEGMediaTracks::FetchMetadata(TRange<FTimespan> TimeRange, TSharedPtr<IMediaBinarySample, ESPMode::ThreadSafe>& OutSample)
-{
-	TSharedPtr<IMediaBinarySample, ESPMode::ThreadSafe> Sample;
-
-	if (!MetadataSampleQueue.Peek(Sample))
-	{
-		return false;
-	}
-
-    const FTimespan SampleTime = Sample->GetTime().Time;
-
-	if (!TimeRange.Overlaps(TRange<FTimespan>(SampleTime, SampleTime + Sample->GetDuration())))
-	{
-		return false;
-	}
-
-	if (!MetadataSampleQueue.Dequeue(Sample))
-	{
-		return false;
-	}
-
-	OutSample = Sample;
-
-	return true;
-}
-
-
-bool FFFMPEGMediaTracks::FetchVideo(TRange<FTimespan> TimeRange, TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe>& OutSample)
-{
-	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample;
-
-	if (!VideoSampleQueue.Peek(Sample))
-	{
-		return false;
-	}
-
-	const FTimespan SampleTime = Sample->GetTime().Time;
-
-	if (!TimeRange.Overlaps(TRange<FTimespan>(SampleTime, SampleTime + Sample->GetDuration())))
-	{
-        VideoSampleQueue.RequestFlush();
-     	return false;
-	}
-
-	if (!VideoSampleQueue.Dequeue(Sample))
-	{
-		return false;
-	}
-
-	OutSample = Sample;
-
-	return true;
-}
-
-
-void FFFMPEGMediaTracks::FlushSamples()
-{
-	AudioSampleQueue.RequestFlush();
-	CaptionSampleQueue.RequestFlush();
-	MetadataSampleQueue.RequestFlush();
-	VideoSampleQueue.RequestFlush();
-}
-
-bool  FFFMPEGMediaTracks::PeekVideoSampleTime(FMediaTimeStamp& TimeStamp) {
-
-    TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample;
-    if (!VideoSampleQueue.Peek(Sample))
-    {
-        return false;
-    }
-    TimeStamp = FMediaTimeStamp(Sample->GetTime());
-    return true;
-
-}
-
-
-/* IMediaTracks interface
- *****************************************************************************/
-
-bool FFFMPEGMediaTracks::GetAudioTrackFormat(int32 TrackIndex, int32 FormatIndex, FMediaAudioTrackFormat& OutFormat) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	const FFormat* Format = GetAudioFormat(TrackIndex, FormatIndex);
-	
-	if (Format == nullptr)
-	{
-		return false; // format not found
-	}
-
-	OutFormat.BitsPerSample = Format->Audio.FrameSize*8;
-	OutFormat.NumChannels = Format->Audio.NumChannels;
-	OutFormat.SampleRate = Format->Audio.SampleRate;
-	OutFormat.TypeName = Format->TypeName;
-
-	return true;
-}
-
-
-int32 FFFMPEGMediaTracks::GetNumTracks(EMediaTrackType TrackType) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		return AudioTracks.Num();
-
-	case EMediaTrackType::Metadata:
-		return MetadataTracks.Num();
-
-	case EMediaTrackType::Caption:
-		return CaptionTracks.Num();
-
-	case EMediaTrackType::Video:
-		return VideoTracks.Num();
-
-	default:
-		break; // unsupported track type
-	}
-
-	return 0;
-}
-
-
-int32 FFFMPEGMediaTracks::GetNumTrackFormats(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		if (AudioTracks.IsValidIndex(TrackIndex))
-		{
-			//return AudioTracks[TrackIndex].Formats.Num();
-            return 1;
-		}
-
-	case EMediaTrackType::Metadata:
-		if (MetadataTracks.IsValidIndex(TrackIndex))
-		{
-			return 1;
-		}
-
-	case EMediaTrackType::Caption:
-		if (CaptionTracks.IsValidIndex(TrackIndex))
-		{
-			return 1;
-		}
-
-	case EMediaTrackType::Video:
-		if (VideoTracks.IsValidIndex(TrackIndex))
-		{
-			//return VideoTracks[TrackIndex].Formats.Num();
-            return 1;
-		}
-
-	default:
-		break; // unsupported track type
-	}
-
-	return 0;
-}
-
-
-int32 FFFMPEGMediaTracks::GetSelectedTrack(EMediaTrackType TrackType) const
-{
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		return SelectedAudioTrack;
-
-	case EMediaTrackType::Caption:
-		return SelectedCaptionTrack;
-
-	case EMediaTrackType::Metadata:
-		return SelectedMetadataTrack;
-
-	case EMediaTrackType::Video:
-		return SelectedVideoTrack;
-
-	default:
-		break; // unsupported track type
-	}
-
-	return INDEX_NONE;
-}
-
-
-FText FFFMPEGMediaTracks::GetTrackDisplayName(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		if (AudioTracks.IsValidIndex(TrackIndex))
-		{
-			return AudioTracks[TrackIndex].DisplayName;
-		}
-		break;
-	
-	case EMediaTrackType::Metadata:
-		if (MetadataTracks.IsValidIndex(TrackIndex))
-		{
-			return MetadataTracks[TrackIndex].DisplayName;
-		}
-		break;
-
-	case EMediaTrackType::Caption:
-		if (CaptionTracks.IsValidIndex(TrackIndex))
-		{
-			return CaptionTracks[TrackIndex].DisplayName;
-		}
-		break;
-
-	case EMediaTrackType::Video:
-		if (VideoTracks.IsValidIndex(TrackIndex))
-		{
-			return VideoTracks[TrackIndex].DisplayName;
-		}
-		break;
-
-	default:
-		break; // unsupported track type
-	}
-
-	return FText::GetEmpty();
-}
-
-
-int32 FFFMPEGMediaTracks::GetTrackFormat(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	const FTrack* Track = GetTrack(TrackType, TrackIndex);
-	return (Track != nullptr) ? 0/*Track->SelectedFormat*/ : INDEX_NONE;
-}
-
-
-
-FString FFFMPEGMediaTracks::GetTrackLanguage(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		if (AudioTracks.IsValidIndex(TrackIndex))
-		{
-			return AudioTracks[TrackIndex].Language;
-		}
-		break;
-
-	case EMediaTrackType::Metadata:
-		if (MetadataTracks.IsValidIndex(TrackIndex))
-		{
-			return MetadataTracks[TrackIndex].Language;
-		}
-		break;
-
-	case EMediaTrackType::Caption:
-		if (CaptionTracks.IsValidIndex(TrackIndex))
-		{
-			return CaptionTracks[TrackIndex].Language;
-		}
-		break;
-
-	case EMediaTrackType::Video:
-		if (VideoTracks.IsValidIndex(TrackIndex))
-		{
-			return VideoTracks[TrackIndex].Language;
-		}
-		break;
-
-	default:
-		break; // unsupported track type
-	}
-
-	return FString();
-}
-
-
-FString FFFMPEGMediaTracks::GetTrackName(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		if (AudioTracks.IsValidIndex(TrackIndex))
-		{
-			return AudioTracks[TrackIndex].Name;
-		}
-		break;
-
-	case EMediaTrackType::Metadata:
-		if (MetadataTracks.IsValidIndex(TrackIndex))
-		{
-			return MetadataTracks[TrackIndex].Name;
-		}
-		break;
-
-	case EMediaTrackType::Caption:
-		if (CaptionTracks.IsValidIndex(TrackIndex))
-		{
-			return CaptionTracks[TrackIndex].Name;
-		}
-		break;
-
-	case EMediaTrackType::Video:
-		if (VideoTracks.IsValidIndex(TrackIndex))
-		{
-			return VideoTracks[TrackIndex].Name;
-		}
-		break;
-
-	default:
-		break; // unsupported track type
-	}
-
-	return FString();
-}
-
-
-bool FFFMPEGMediaTracks::GetVideoTrackFormat(int32 TrackIndex, int32 FormatIndex, FMediaVideoTrackFormat& OutFormat) const
-{
-	FScopeLock Lock(&CriticalSection);
-
-	const FFormat* Format = GetVideoFormat(TrackIndex, FormatIndex);
-	
-	if (Format == nullptr)
-	{
-		return false; // format not found
-	}
-
-	OutFormat.Dim = Format->Video.OutputDim;
-	OutFormat.FrameRate = Format->Video.FrameRate;
-	OutFormat.FrameRates = TRange<float>(Format->Video.FrameRate);
-	OutFormat.TypeName = Format->TypeName;
-
-	return true;
-}
-
-
-
-bool FFFMPEGMediaTracks::SelectTrack(EMediaTrackType TrackType, int32 TrackIndex)
-{
-	if (!FormatContext)
-	{
-		return false; // not initialized
-	}
-
-	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Selecting %s track %i"), this, *MediaUtils::TrackTypeToString(TrackType), TrackIndex);
-
-	FScopeLock Lock(&CriticalSection);
-
-	int32* SelectedTrack = nullptr;
-	TArray<FTrack>* Tracks = nullptr;
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		SelectedTrack = &SelectedAudioTrack;
-		Tracks = &AudioTracks;
-		break;
-
-	case EMediaTrackType::Caption:
-		SelectedTrack = &SelectedCaptionTrack;
-		Tracks = &CaptionTracks;
-		break;
-
-	case EMediaTrackType::Metadata:
-		SelectedTrack = &SelectedMetadataTrack;
-		Tracks = &MetadataTracks;
-		break;
-
-	case EMediaTrackType::Video:
-		SelectedTrack = &SelectedVideoTrack;
-		Tracks = &VideoTracks;
-		break;
-
-	default:
-		return false; // unsupported track type
-	}
-
-	check(SelectedTrack != nullptr);
-	check(Tracks != nullptr);
-
-	if (TrackIndex == *SelectedTrack)
-	{
-		return true; // already selected
-	}
-
-	if ((TrackIndex != INDEX_NONE) && !Tracks->IsValidIndex(TrackIndex))
-	{
-		return false; // invalid track
-	}
-
-	// deselect stream for old track
-	if (*SelectedTrack != INDEX_NONE)
-	{
-        const int StreamIndex = (*Tracks)[*SelectedTrack].StreamIndex;
-        StreamComponentClose(StreamIndex);
-
-        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Disabled stream %i"), this, StreamIndex);
-			
-		*SelectedTrack = INDEX_NONE;
-		SelectionChanged = true;
-        currentStreams--;
-       
-	}
-
-	// select stream for new track
-	if (TrackIndex != INDEX_NONE)
-	{
-		const int StreamIndex = (*Tracks)[TrackIndex].StreamIndex;
-        const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-
-        if (TrackType != EMediaTrackType::Audio || (TrackType == EMediaTrackType::Audio && !Settings->DisableAudio) ) {
-            StreamComponentOpen(StreamIndex);
-            currentStreams++;
-		    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Enabled stream %i"), this, StreamIndex);
-        }
-
-		*SelectedTrack = TrackIndex;
-		SelectionChanged = true;
-
-        if (TrackType == EMediaTrackType::Video) {
-            StartDisplayThread();
-        }
-        else if (TrackType == EMediaTrackType::Audio) {
-
-            srcAudio =  (*Tracks)[TrackIndex].Format.Audio;
-            targetAudio = srcAudio;
-
-            audioDiffAvgCoef  = exp(log(0.01) / AUDIO_DIFF_AVG_NB);
-            audioDiffAvgCount = 0;
-        
-            audioDiffThreshold = (double)(targetAudio.HardwareSize) / targetAudio.BytesPerSec;
-
-            StartAudioRenderThread();
-        }
-	}
-
-	return true;
-}
-
-
-bool FFFMPEGMediaTracks::SetTrackFormat(EMediaTrackType TrackType, int32 TrackIndex, int32 FormatIndex)
-{
-	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Setting format on %s track %i to %i"), this, *MediaUtils::TrackTypeToString(TrackType), TrackIndex, FormatIndex);
-
-	FScopeLock Lock(&CriticalSection);
-
-	TArray<FTrack>* Tracks = nullptr;
-
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		Tracks = &AudioTracks;
-		break;
-
-	case EMediaTrackType::Caption:
-		Tracks = &CaptionTracks;
-		break;
-
-	case EMediaTrackType::Metadata:
-		Tracks = &MetadataTracks;
-		break;
-
-	case EMediaTrackType::Video:
-		Tracks = &VideoTracks;
-		break;
-
-	default:
-		return false; // unsupported track type
-	};
-
-	check(Tracks != nullptr);
-
-	if (!Tracks->IsValidIndex(TrackIndex))
-	{
-		return false; // invalid track index
-	}
-
-
-	return true;
-}
-
-
-bool FFFMPEGMediaTracks::SetVideoTrackFrameRate(int32 TrackIndex, int32 FormatIndex, float FrameRate)
-{
-	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Setting frame rate on format %i of video track %i to %f"), this, FormatIndex, TrackIndex, FrameRate);
-
-	FScopeLock Lock(&CriticalSection);
-
-	const FFormat* Format = GetVideoFormat(TrackIndex, FormatIndex);
-
-	if (Format == nullptr)
-	{
-		return false; // format not found
-	}
-
-	if (Format->Video.FrameRate == FrameRate)
-	{
-		return true; // frame rate already set
-	}
-
-	
-    return false;
-}
-
-
-/* IMediaControls interface
- *****************************************************************************/
-
-
-bool FFFMPEGMediaTracks::CanControl(EMediaControl Control) const {
-    if (!bPrerolled)
-    {
-        return false;
-    }
-
-    if (Control == EMediaControl::Pause)
-    {
-        return (CurrentState == EMediaState::Playing);
-    }
-
-    if (Control == EMediaControl::Resume)
-    {
-        return (CurrentState != EMediaState::Playing);
-    }
-
-    if ((Control == EMediaControl::Scrub) || (Control == EMediaControl::Seek))
-    {
-        return true;
-    }
-
-    return false;
-}
-
-FTimespan FFFMPEGMediaTracks::GetDuration() const
-{
-    return Duration;
-}
-
-float FFFMPEGMediaTracks::GetRate() const {
-    return CurrentRate;
-}
-EMediaState FFFMPEGMediaTracks::GetState() const {
-    return CurrentState;
-}
-EMediaStatus FFFMPEGMediaTracks::GetStatus() const
-{
-    //TODO: 
-    return EMediaStatus::None;
-}
-
-TRangeSet<float> FFFMPEGMediaTracks::GetSupportedRates(EMediaRateThinning Thinning) const {
-    TRangeSet<float> Result;
-
-    //Result.Add(TRange<float>(PlayerItem.canPlayFastReverse ? -8.0f : -1.0f, 0.0f));
-    //Result.Add(TRange<float>(0.0f, PlayerItem.canPlayFastForward ? 8.0f : 0.0f));
-
-    Result.Add(TRange<float>(0.0f, 1.0f));
-
-    return Result;
-}
-
-FTimespan FFFMPEGMediaTracks::GetTime() const {
-    return CurrentTime;    
-}
-
-bool FFFMPEGMediaTracks::IsLooping() const {
-    return ShouldLoop;
-}
-
-bool FFFMPEGMediaTracks::Seek(const FTimespan& Time) {
-    int64_t pos = Time.GetTicks()/10;
-    StreamSeek(pos, 0, 0);
-    return true;
-}
-
-bool FFFMPEGMediaTracks::SetLooping(bool Looping) {
-    ShouldLoop = Looping;   
-    return true;
-}
-
-bool FFFMPEGMediaTracks::SetRate(float Rate) {
-    CurrentRate = Rate;
-
-
-    if (bPrerolled) {
-        if (FMath::IsNearlyZero(Rate))
-        {
-            CurrentState = EMediaState::Paused;
-            DeferredEvents.Enqueue(EMediaEvent::PlaybackSuspended);
-        }
-        else
-        {
-            CurrentState = EMediaState::Playing;
-            DeferredEvents.Enqueue(EMediaEvent::PlaybackResumed);
-        }
-    }
-
-    return true;
-}
-
-
-/* FFFMPEGMediaTracks implementation
- *****************************************************************************/
-
-bool FFFMPEGMediaTracks::AddStreamToTracks(uint32 StreamIndex, bool IsVideoDevice, const FMediaPlayerTrackOptions& TrackOptions, FString& OutInfo)
-{
-	OutInfo += FString::Printf(TEXT("Stream %i\n"), StreamIndex);
-
-
-    AVStream* StreamDescriptor = FormatContext->streams[StreamIndex];
-    AVCodecParameters* CodecParams = StreamDescriptor->codecpar;
-    AVMediaType MediaType = CodecParams->codec_type;
-    
-    if ( MediaType != AVMEDIA_TYPE_VIDEO && MediaType != AVMEDIA_TYPE_AUDIO && MediaType != AVMEDIA_TYPE_SUBTITLE) {
-        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Unsupported major type %s of stream %i"), this,av_get_media_type_string(MediaType), StreamIndex);
-        OutInfo += TEXT("\tUnsupported stream type\n");
-
-        return false;
-    }
-
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-
-   if ( Settings->DisableAudio && MediaType == AVMEDIA_TYPE_AUDIO ) {
-       return false;
-   }
-
-	// create & add track
-	FTrack* Track = nullptr;
-	int32 TrackIndex = INDEX_NONE;
-	int32* SelectedTrack = nullptr;
-
-	if (MediaType == AVMEDIA_TYPE_AUDIO)
-	{
-		SelectedTrack = &SelectedAudioTrack;
-		TrackIndex = AudioTracks.AddDefaulted();
-		Track = &AudioTracks[TrackIndex];
-	}
-	else if (MediaType == AVMEDIA_TYPE_SUBTITLE)
-	{
-		SelectedTrack = &SelectedCaptionTrack;
-		TrackIndex = CaptionTracks.AddDefaulted();
-		Track = &CaptionTracks[TrackIndex];
-	}
-	else if (MediaType == AVMEDIA_TYPE_VIDEO)
-	{
-		SelectedTrack = &SelectedVideoTrack;
-		TrackIndex = VideoTracks.AddDefaulted();
-		Track = &VideoTracks[TrackIndex];
-	}
-
-	check(Track != nullptr);
-	check(TrackIndex != INDEX_NONE);
-	check(SelectedTrack != nullptr);
-    
-   
-
-    const FString TypeName =  avcodec_get_name(CodecParams->codec_id);
-    OutInfo += FString::Printf(TEXT("\t\tCodec: %s\n"), *TypeName);
-
-    if ( FormatContext->metadata ) {
-        AVDictionaryEntry *t = av_dict_get(FormatContext->metadata, "language", NULL, 0);
-        if ( t ) {
-            Track->Language = t->value;    
-        } 
-        
-    }
-
-    if (MediaType == AVMEDIA_TYPE_AUDIO)
-    {
-        int samples = FFMAX(AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(CodecParams->sample_rate / AUDIO_MAX_CALLBACKS_PER_SEC));
-
-        Track->Format = { 
-            MediaType,
-            CodecParams->codec_id,
-            TypeName, 
-            {
-                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, 1, AV_SAMPLE_FMT_S16, 1),
-                (uint32)CodecParams->channels,
-                (uint32)CodecParams->sample_rate,
-                CodecParams->channel_layout,
-                AV_SAMPLE_FMT_S16,
-                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, CodecParams->sample_rate,  AV_SAMPLE_FMT_S16, 1),
-                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, samples, AV_SAMPLE_FMT_S16, 1)
-            }, 
-            {0} 
-        };
-
-        OutInfo += FString::Printf(TEXT("\t\tChannels: %i\n"), Track->Format.Audio.NumChannels);
-        OutInfo += FString::Printf(TEXT("\t\tSample Rate: %i Hz\n"),  Track->Format.Audio.SampleRate);
-        OutInfo += FString::Printf(TEXT("\t\tBits Per Sample: %i\n"),  Track->Format.Audio.FrameSize * 8);
-
-    } else if ( MediaType == AVMEDIA_TYPE_VIDEO) {
-              
-        float fps = av_q2d(StreamDescriptor->r_frame_rate);
-        if (fps < 0.000025) {
-            fps = av_q2d(StreamDescriptor->avg_frame_rate);
-        }
-
-     
-
-        OutInfo += FString::Printf(TEXT("\t\tFrame Rate: %g fps\n"), fps);
-
-        int line_sizes[4] = {0};
-        av_image_fill_linesizes(line_sizes, (AVPixelFormat)CodecParams->format, CodecParams->width);
-
-        FIntPoint OutputDim = {CodecParams->width, CodecParams->height};
-
-        OutInfo += FString::Printf(TEXT("\t\tDimensions: %i x %i\n"), OutputDim.X, OutputDim.Y);
-
-
-        Track->Format = {
-            MediaType,
-            CodecParams->codec_id,
-            TypeName,
-            {
-               0
-            },
-            {
-                0
-            }
-        };
-
-        Track->Format.Video.BitRate = CodecParams->bit_rate;
-        Track->Format.Video.OutputDim = OutputDim;
-        Track->Format.Video.FrameRate = fps;
-        Track->Format.Video.LineSize[0] = line_sizes[0];
-        Track->Format.Video.LineSize[1] = line_sizes[1];
-        Track->Format.Video.LineSize[2] = line_sizes[2];
-        Track->Format.Video.LineSize[3] = line_sizes[3];
-
-    } else {
-        Track->Format = {
-            MediaType,
-            CodecParams->codec_id,
-            TypeName,
-            {
-               0
-            },
-            {
-               0
-            }
-        };
-    }
-    
-
-	Track->DisplayName = (Track->Name.IsEmpty())
-		? FText::Format(LOCTEXT("UnnamedStreamFormat", "Unnamed Track (Stream {0})"), FText::AsNumber((uint32)StreamIndex))
-		: FText::FromString(Track->Name);
-
-	
-	Track->StreamIndex = StreamIndex;
-    
-    if (MediaType == AVMEDIA_TYPE_SUBTITLE && TrackOptions.Caption == INDEX_NONE) {
-        return false;
-    }
-
-	return true;
-}
-
-
-
-
-const FFFMPEGMediaTracks::FFormat* FFFMPEGMediaTracks::GetAudioFormat(int32 TrackIndex, int32 FormatIndex) const
-{
-	if (AudioTracks.IsValidIndex(TrackIndex))
-	{
-		const FTrack& Track = AudioTracks[TrackIndex];
-		return &Track.Format;
-	}
-
-	return nullptr;
-}
-
-
-const FFFMPEGMediaTracks::FTrack* FFFMPEGMediaTracks::GetTrack(EMediaTrackType TrackType, int32 TrackIndex) const
-{
-	switch (TrackType)
-	{
-	case EMediaTrackType::Audio:
-		if (AudioTracks.IsValidIndex(TrackIndex))
-		{
-			return &AudioTracks[TrackIndex];
-		}
-
-	case EMediaTrackType::Metadata:
-		if (MetadataTracks.IsValidIndex(TrackIndex))
-		{
-			return &MetadataTracks[TrackIndex];
-		}
-
-	case EMediaTrackType::Caption:
-		if (CaptionTracks.IsValidIndex(TrackIndex))
-		{
-			return &CaptionTracks[TrackIndex];
-		}
-
-	case EMediaTrackType::Video:
-		if (VideoTracks.IsValidIndex(TrackIndex))
-		{
-			return &VideoTracks[TrackIndex];
-		}
-
-	default:
-		break; // unsupported track type
-	}
-
-	return nullptr;
-}
-
-
-const FFFMPEGMediaTracks::FFormat* FFFMPEGMediaTracks::GetVideoFormat(int32 TrackIndex, int32 FormatIndex) const
-{
-	if (VideoTracks.IsValidIndex(TrackIndex))
-	{
-		const FTrack& Track = VideoTracks[TrackIndex];
-
-		
-		return &Track.Format;
-		
-	}
-
-	return nullptr;
-}
-
-
-/************************************************************************/
-/* FFMPEGMediaTracks Implementation                                    */
-/************************************************************************/
-
-bool FFFMPEGMediaTracks::isHwAccel(const AVCodec* codec) {
-    const AVCodecHWConfig *config;
-    enum AVHWDeviceType type;
-
-     if (!avcodec_get_hw_config(codec, 0)) {
-         return false;
-     }
-     bool ret = false;
-     for (int i = 0; ; i++) {
-         config = avcodec_get_hw_config(codec, i);
-         if (!config)
-             break;
-
-         type = config->device_type;
-
-         if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
-             continue;
-
-        
-         const char* type_name = av_hwdevice_get_type_name(type);
-         UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Format found: %s"), UTF8_TO_TCHAR(type_name) );
-         ret = true;
-     }
-
-     return ret;
-}
-
-TArray<const AVCodec*>  FFFMPEGMediaTracks::FindDecoders(int codecId, bool hwaccell) {
-   
-    TArray<const AVCodec*> codecs;
-    TArray<const AVCodec*> candidates;
-
-    void* iter = NULL;
-    const AVCodec* codec = av_codec_iterate(&iter);
-    
-    while (codec) {
-        if (codec->id == codecId && av_codec_is_decoder(codec)) {
-            candidates.Add(codec);
-        }
-        codec = av_codec_iterate(&iter);
-    }
-
-    if (hwaccell) {
-
-        TArray<const AVCodec*> tmp;
-
-        candidates.Sort([](const AVCodec a, const AVCodec b) {
-            FString aname = a.name;
-            FString bname = b.name;
-            return aname < bname;
-        });
-
-        for ( int i = 0; i < candidates.Num(); i++) {
-            FString name = candidates[i]->name;
-            if ( name.Contains(TEXT("cuda"))  || name.Contains(TEXT("cuvid"))) {
-                tmp.Add((candidates[i]));
-                candidates.RemoveAt(i);
-                i--;
-            }
-        }
-        
-
-        tmp.Insert(candidates, tmp.Num()); 
-       
-        for (const AVCodec* c : tmp) {
-            if (isHwAccel(c)) {
-                codecs.Add(c);
-            }
-        }
-    }
-
-    if (candidates.Num() > 0) {
-        if (!hwaccell) {
-            for (const AVCodec* c : candidates) {
-                if (!isHwAccel(c)) {
-                    codecs.Add(c);
-                }
-            }
-        }
-    }
-
-    return codecs;
-}
-
-AVHWDeviceType FFFMPEGMediaTracks::FindBetterDeviceType(const AVCodec* codec, int& lastSelection) {
-    const AVCodecHWConfig *config;
-    enum AVHWDeviceType type;
-    TArray<enum AVHWDeviceType> availableTypes;
-    for (int i = 0; ; i++) {
-        config = avcodec_get_hw_config(codec, i);
-        if (!config)
-            break;
-
-        type = config->device_type;
-
-        if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
-            continue;
-
-        availableTypes.Add(type);
-    }
-
-    if (availableTypes.Num() == 0 ) {
-        lastSelection = -1;
-        return AV_HWDEVICE_TYPE_NONE;
-    }
-
-
-    const enum AVHWDeviceType* possibleType =  availableTypes.FindByKey(AV_HWDEVICE_TYPE_CUDA);
-    if ( possibleType && (lastSelection < 1) ) {
-        lastSelection = 1;
-        return *possibleType;
-    }
-
-    possibleType = availableTypes.FindByKey(AV_HWDEVICE_TYPE_VIDEOTOOLBOX);
-    if (possibleType && (lastSelection < 2)) {
-        lastSelection = 2;
-        return *possibleType;
-    }
-
-    possibleType = availableTypes.FindByKey(AV_HWDEVICE_TYPE_OPENCL);
-    if (possibleType && (lastSelection < 3)) {
-        lastSelection = 3;
-        return *possibleType;
-    }
-
-    if ( lastSelection < 4) lastSelection = 4;
-    else lastSelection++;
-
-    if ( (lastSelection - 4) < availableTypes.Num() ) {
-        return availableTypes[lastSelection - 4];
-    }
-
-    lastSelection = -1;
-    return AV_HWDEVICE_TYPE_NONE;
-}
-
-
-int FFFMPEGMediaTracks::StreamHasEnoughPackets(AVStream *st, int stream_id, FFMPEGPacketQueue *queue) {
-    return stream_id < 0 ||
-        queue->IsAbortRequest() ||
-        (st->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
-        queue->GetNumPackets() > MIN_FRAMES && (!queue->GetDuration() || av_q2d(st->time_base) * queue->GetDuration() > 1.0);
-}
-
-
-enum AVPixelFormat FFFMPEGMediaTracks::GetFormatCallback(AVCodecContext *s, const enum AVPixelFormat *pix_fmts) {
-    const enum AVPixelFormat *p;
-    //int ret;
-    FFFMPEGMediaTracks* tracks = (FFFMPEGMediaTracks*)s->opaque;
-    for (p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
-        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(*p);
-        const AVCodecHWConfig  *config = NULL;
-        int i;
-
-        if (!(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
-            break;
-
-        for (i = 0;; i++) {
-            config = avcodec_get_hw_config(s->codec, i);
-            if (!config)
-                break;
-            if (!(config->methods &
-                AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
-                continue;
-            if (config->pix_fmt == *p)
-                break;
-        }
-
-        if (config) {
-            if (config->device_type != tracks->hwAccelDeviceType) {
-                // Different hwaccel offered, ignore.
-                continue;
-            }
-
-        } else {
-            continue;
-           
-        }
-
-      
-        tracks->hwAccelPixFmt = *p;
-        break;
-
-    }
-
-    return *p;
-}
-
-
-int FFFMPEGMediaTracks::StreamComponentOpen(int stream_index) {
-
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-
-    AVCodecContext *avctx;
-    const AVCodec *codec;
-    const char *forced_codec_name = NULL;
-    AVDictionary *opts = NULL;
-
-    AVDictionaryEntry *t = NULL;
-    int ret = 0;
-    
-    int stream_lowres = 0;
-
-    if (stream_index < 0 || stream_index >= (int)FormatContext->nb_streams)
-        return -1;
-
-    avctx = avcodec_alloc_context3(NULL);
-
-    ret = avcodec_parameters_to_context(avctx, FormatContext->streams[stream_index]->codecpar);
-    if (ret < 0) {
-        avcodec_free_context(&avctx);
-        return ret;
-    }
-    avctx->pkt_timebase = FormatContext->streams[stream_index]->time_base;
-    
-#ifdef UE_BUILD_DEBUG
-    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ) {
-        UE_LOG(LogFFMPEGMedia, Display, TEXT("Video Codec: %s "), UTF8_TO_TCHAR(avcodec_get_name( avctx->codec_id)));
-    }
-    
-    if (avctx->codec_type == AVMEDIA_TYPE_AUDIO ) {
-        UE_LOG(LogFFMPEGMedia, Display, TEXT("Audio Codec: %s "), UTF8_TO_TCHAR(avcodec_get_name( avctx->codec_id)));
-    }
-#endif
-   
-
-    if (Settings->UseHardwareAcceleratedCodecs && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-        TArray<const AVCodec*> hwCodecs = FindDecoders(avctx->codec_id, true);
-        codec = NULL;
-
-        for (const AVCodec* hwCodec : hwCodecs) {
-            AVCodecContext* avctx2 = avcodec_alloc_context3(NULL);
-            avcodec_parameters_to_context(avctx2, FormatContext->streams[stream_index]->codecpar);
-            if (avcodec_open2(avctx2, hwCodec, NULL) >= 0) {
-                AVBufferRef *device_ref = NULL;
-                int lastSelection = 0;
-                while (lastSelection >= 0) {
-                    enum AVHWDeviceType type = FindBetterDeviceType(hwCodec, lastSelection);
-                    ret = av_hwdevice_ctx_create(&device_ref, type, NULL, NULL, 0);
-                    if (ret < 0) {
-                        hw_device_ctx = NULL;
-                        hwAccelDeviceType = AV_HWDEVICE_TYPE_NONE;
-                        hwaccel_retrieve_data = nullptr;
-                    }
-                    else {
-                        hw_device_ctx = device_ref;
-                        avctx->hw_device_ctx = av_buffer_ref(device_ref);
-
-                        const char* type_name = av_hwdevice_get_type_name(type);
-                        UE_LOG(LogFFMPEGMedia, Display, TEXT("Using hardware context type: %s"), UTF8_TO_TCHAR(type_name));
-
-                        hwAccelDeviceType = type;
-                        hwaccel_retrieve_data = HWAccelRetrieveDataCallback;
-                        codec = hwCodec;
-
-                        avctx->opaque = this;
-                        avctx->get_format = GetFormatCallback;
-                        avctx->thread_safe_callbacks = 1;
-
-                        break;
-                    }
-                }
-            }
-            avcodec_free_context(&avctx2);
-            if (codec) break;
-        }
-        if (!codec) {
-            codec = avcodec_find_decoder(avctx->codec_id);
-        }
-    } else {
-        codec = avcodec_find_decoder(avctx->codec_id);
-    }
-
-    if ( !codec) {
-        const AVCodecDescriptor * desc = avcodec_descriptor_get(avctx->codec_id);
-        UE_LOG(LogFFMPEGMedia, Error, TEXT("coudn't find a decoder for %s"), UTF8_TO_TCHAR(desc->long_name));
-        return -1;
-    }
-    
-    
-    UE_LOG(LogFFMPEGMedia, Display, TEXT("Using codec: %s - %d"), UTF8_TO_TCHAR(codec->name), codec->id);
-    
-
-    avctx->codec_id = codec->id;
-    if (stream_lowres > codec->max_lowres) {
-        UE_LOG(LogFFMPEGMedia, Warning, TEXT("The maximum value for lowres supported by the decoder is %d"), codec->max_lowres);
-        stream_lowres = codec->max_lowres;
-    }
-     avctx->lowres = stream_lowres;
-
-    if (Settings->SpeedUpTricks)
-        avctx->flags2 |= AV_CODEC_FLAG2_FAST;
-
-
-    int thread_count = 0;
-    if ( avctx->codec_type == AVMEDIA_TYPE_VIDEO ) thread_count = Settings->VideoThreads;
-    if ( avctx->codec_type == AVMEDIA_TYPE_AUDIO ) thread_count = Settings->AudioThreads;
-
-    if (!thread_count) {
-        thread_count = av_cpu_count();
-    }
-
-    thread_count = FFMAX(1, FFMIN(thread_count, 16));
-    avctx->thread_count = thread_count;
-    av_dict_set(&opts, "threads", TCHAR_TO_UTF8(*FString::FromInt(thread_count)), 0);
-
-    if (stream_lowres)
-        av_dict_set_int(&opts, "lowres", stream_lowres, 0);
-    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO || avctx->codec_type == AVMEDIA_TYPE_AUDIO)
-        av_dict_set(&opts, "refcounted_frames", "1", 0);
-
-    if (Settings->ZeroLatencyStreaming && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-        av_dict_set(&opts, "tune", "zerolatency", 0);
-    }
-
-    if ((ret = avcodec_open2(avctx, codec, &opts)) < 0) {
-        if (Settings->UseHardwareAcceleratedCodecs && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-            UE_LOG(LogFFMPEGMedia, Warning, TEXT("Coudn't open the hwaccel codec, trying a different one"));
-            codec = avcodec_find_decoder(avctx->codec_id);
-            avctx->codec_id = codec->id;
-            if (stream_lowres > codec->max_lowres) {
-                UE_LOG(LogFFMPEGMedia, Warning, TEXT("The maximum value for lowres supported by the decoder is %d"),  codec->max_lowres);
-                stream_lowres =  codec->max_lowres;
-            }
-            avctx->lowres= stream_lowres;
-            if ( thread_count > 0) {
-                avctx->thread_count =thread_count;
-            }
-
-            if ((ret = avcodec_open2(avctx, codec, &opts)) < 0) {
-                avcodec_free_context(&avctx);
-                return ret;
-            }
-
-        }
-        else {
-            avcodec_free_context(&avctx);
-            return ret;
-        }
-    }
-  
-    eof = 0;
-    FormatContext->streams[stream_index]->discard = AVDISCARD_DEFAULT;
-
-    switch (avctx->codec_type) {
-    case AVMEDIA_TYPE_AUDIO:
-        audioStream = FormatContext->streams[stream_index];
-        audioStreamIdx = stream_index;
-        auddec->Init(avctx, &audioq, &continueReadCond);
-        if ((FormatContext->iformat->flags & (AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH | AVFMT_NO_BYTE_SEEK)) && !FormatContext->iformat->read_seek) {
-            auddec->SetTime(audioStream->start_time, audioStream->time_base);
-        }
-        if ((ret = auddec->Start([this](void * data) {return AudioThread();}, NULL)) < 0) {
-            av_dict_free(&opts);
-            return ret;
-        }
-        break;
-    case AVMEDIA_TYPE_VIDEO:
-        videoStream = FormatContext->streams[stream_index];
-        videoStreamIdx = stream_index;
-        viddec->Init(avctx, &videoq, &continueReadCond);
-        if ((ret = viddec->Start([this](void * data) {return VideoThread();}, NULL)) < 0) {
-            av_dict_free(&opts);
-            return ret;
-        }
-        queueAttachmentsReq = true;
-        video_ctx = avctx;
-        break;
-    case AVMEDIA_TYPE_SUBTITLE:
-        subTitleStream = FormatContext->streams[stream_index];
-        subtitleStreamIdx = stream_index;
-        subdec->Init(avctx, &subtitleq, &continueReadCond);
-        if ((ret = subdec->Start([this](void * data) {return SubtitleThread();}, NULL)) < 0) {
-            av_dict_free(&opts);
-            return ret;
-        }
-        break;
-    default:
-        break;
-    }
-
-    av_dict_free(&opts);
-
-    return ret;
-
-}
-void FFFMPEGMediaTracks::StreamComponentClose(int stream_index) {
-    AVCodecParameters *codecpar;
-
-    if (stream_index < 0 || stream_index >= (int)FormatContext->nb_streams)
-        return;
-    codecpar = FormatContext->streams[stream_index]->codecpar;
-
-    switch (codecpar->codec_type) {
-    case AVMEDIA_TYPE_AUDIO:
-        auddec->Abort(&sampq);
-        StopAudioRenderThread();
-    
-        auddec->Destroy();
-        swr_free(&swrContext);
-        swrContext = NULL;
-        av_freep(&audioBuf1);
-        audioBuf1Size = 0;
-        audioBuf = NULL;
-        audioClock = 0;
-        break;
-    case AVMEDIA_TYPE_VIDEO:
-        viddec->Abort(&pictq);
-        StopDisplayThread();
-
-        video_ctx = NULL;
-        viddec->Destroy();
-        SelectedVideoTrack = -1;
-
-        if ( hw_device_ctx ) {
-            av_buffer_unref(&hw_device_ctx); 
-        }
-       
-        hwaccel_retrieve_data = nullptr;
-        hwAccelPixFmt = AV_PIX_FMT_NONE;
-       
-
-        break;
-    case AVMEDIA_TYPE_SUBTITLE:
-        subdec->Abort(&subpq);
-        subdec->Destroy();
-        break;
-    default:
-        break;
-    }
-
-    FormatContext->streams[stream_index]->discard = AVDISCARD_ALL;
-    switch (codecpar->codec_type) {
-    case AVMEDIA_TYPE_AUDIO:
-        audioStream = NULL;
-        SelectedAudioTrack = -1;
-        break;
-    case AVMEDIA_TYPE_VIDEO:
-        videoStream = NULL;
-        SelectedVideoTrack = -1;
-        break;
-    case AVMEDIA_TYPE_SUBTITLE:
-        subTitleStream = NULL;
-        SelectedCaptionTrack = -1;
-        break;
-    default:
-        break;
-    }
-}
-
-void FFFMPEGMediaTracks::StepToNextFrame() {
-    if (CurrentState == EMediaState::Paused) {
-        SetRate(1.0f);
-        StreamTogglePause();
-    }
-
-    step = 1;
-}
-
-void FFFMPEGMediaTracks::StreamTogglePause() {
-    if (CurrentState == EMediaState::Paused) {
-        frameTimer += av_gettime_relative() / 1000000.0 - vidclk.GetLastUpdated();
-        if (readPauseReturn != AVERROR(ENOSYS)) {
-            vidclk.SetPaused(false);
-        }
-        vidclk.Set(vidclk.Get(), vidclk.GetSerial());
-    }
-    extclk.Set(extclk.Get(), extclk.GetSerial());
-    bool paused = CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped;
-    paused = !paused;
-
-    audclk.SetPaused(paused);
-    vidclk.SetPaused(paused);
-    extclk.SetPaused(paused);
-}
-
-double FFFMPEGMediaTracks::ComputeTargetDelay(double delay) {
-    double sync_threshold, diff = 0;
-
-    /* update delay to follow master synchronisation source */
-    if (getMasterSyncType() != ESynchronizationType::VideoMaster) {
-        /* if video is slave, we try to correct big delays by
-            duplicating or deleting a FFMPEGFrame */
-        diff = vidclk.Get() - GetMasterClock();
-
-        /* skip or repeat frame. We take into account the
-            delay to compute the threshold. I still don't know
-            if it is the best guess */
-        sync_threshold = FFMAX(AV_SYNC_THRESHOLD_MIN, FFMIN(AV_SYNC_THRESHOLD_MAX, delay));
-        if (!isnan(diff) && fabs(diff) < maxFrameDuration) {
-            if (diff <= -sync_threshold)
-                delay = FFMAX(0, delay + diff);
-            else if (diff >= sync_threshold && delay > AV_SYNC_FRAMEDUP_THRESHOLD)
-                delay = delay + diff;
-            else if (diff >= sync_threshold)
-                delay = 2 * delay;
-        }
-    }
-
-    /*OFX_LOGP(ofx_trace,  "video: delay=%0.3f A-V=%f\n",
-            delay, -diff);*/
-
-    return delay;
-}
-
-ESynchronizationType FFFMPEGMediaTracks::getMasterSyncType() {
-
-    if (sychronizationType == ESynchronizationType::VideoMaster) {
-        if (videoStream)
-            return ESynchronizationType::VideoMaster;
-        else
-            return ESynchronizationType::AudioMaster;
-    }
-    else if (sychronizationType == ESynchronizationType::AudioMaster) {
-        if (audioStream)
-            return ESynchronizationType::AudioMaster;
-        else if (videoStream)
-            return ESynchronizationType::VideoMaster;
-    }
-    
-    return ESynchronizationType::ExternalClock;
-}
-
-void FFFMPEGMediaTracks::UpdateVideoPts(double pts, int64_t pos, int serial) {
-    vidclk.Set(pts, serial);
-    extclk.SyncToSlave(&vidclk);
-}
-
-void FFFMPEGMediaTracks::CheckExternalClockSpeed() {
-    if (videoStreamIdx >= 0 && videoq.GetNumPackets() <= EXTERNAL_CLOCK_MIN_FRAMES ||
-        audioStreamIdx >= 0 && audioq.GetNumPackets() <= EXTERNAL_CLOCK_MIN_FRAMES) {
-        extclk.SetSpeed(FFMAX(EXTERNAL_CLOCK_SPEED_MIN, extclk.GetSpeed() - EXTERNAL_CLOCK_SPEED_STEP));
-    }
-    else if ((videoStreamIdx < 0 || videoq.GetNumPackets() > EXTERNAL_CLOCK_MAX_FRAMES) &&
-        (audioStreamIdx < 0 || audioq.GetNumPackets() > EXTERNAL_CLOCK_MAX_FRAMES)) {
-        extclk.SetSpeed(FFMIN(EXTERNAL_CLOCK_SPEED_MAX, extclk.GetSpeed() + EXTERNAL_CLOCK_SPEED_STEP));
-    }
-    else {
-        double speed = extclk.GetSpeed();
-        if (speed != 1.0)
-            extclk.SetSpeed(speed + EXTERNAL_CLOCK_SPEED_STEP * (1.0 - speed) / fabs(1.0 - speed));
-    }
-}
-
-double FFFMPEGMediaTracks::GetMasterClock() {
-    double val;
-
-    switch (getMasterSyncType()) {
-    case ESynchronizationType::VideoMaster:
-        val = vidclk.Get();
-        break;
-    case ESynchronizationType::AudioMaster:
-        val = audclk.Get();
-        break;
-    default:
-        val = extclk.Get();
-        break;
-    }
-    return val;
-}
-
-int FFFMPEGMediaTracks::UploadTexture(FFMPEGFrame* vp, AVFrame *frame, struct SwsContext **img_convert_ctx) {
-    
-    int size = av_image_get_buffer_size(AV_PIX_FMT_RGBA, frame->width, frame->height, 1);
-
-    int bufSize = size + 1;
-
-    if (dataBuffer.Num() != bufSize) {
-        dataBuffer.Reset();
-        dataBuffer.AddUninitialized(bufSize);
-        check(dataBuffer.Num() == bufSize);
-    }
-    int ret = 0;
-    int pitch[4] = { 0, 0, 0, 0 };
-    ret = av_image_fill_linesizes(pitch, AV_PIX_FMT_BGRA, frame->width);
-
-    uint8_t* data[4] = { 0 };
-    av_image_fill_pointers(data, AV_PIX_FMT_BGRA, frame->height, dataBuffer.GetData(), pitch);
-
-
-    *img_convert_ctx = sws_getCachedContext(*img_convert_ctx,
-        frame->width, frame->height, (AVPixelFormat)frame->format, frame->width, frame->height, AV_PIX_FMT_BGRA, SWS_BICUBIC, NULL, NULL, NULL);
-
-
-    if (*img_convert_ctx != NULL) {
-        sws_scale(*img_convert_ctx, frame->data, frame->linesize, 0, frame->height, data, pitch);
-    }
-    else {
-        UE_LOG(LogFFMPEGMedia, Error, TEXT("Cannot initialize the conversion context"));
-        ret = -1;
-        return ret;
-    }
-
-
-    FScopeLock Lock(&CriticalSection);
-    const TSharedRef<FFFMPEGMediaTextureSample, ESPMode::ThreadSafe> TextureSample = VideoSamplePool->AcquireShared();
-
-    FIntPoint Dim = {frame->width, frame->height};
-
-    FTimespan time = FTimespan::FromSeconds(vp->GetPts());
-    FTimespan duration = FTimespan::FromSeconds(vp->GetDuration());
-
-    if (TextureSample->Initialize(
-        dataBuffer.GetData(),
-        dataBuffer.Num()-1,
-        Dim,
-        pitch[0],
-        time,
-        duration))
-    {
-        VideoSampleQueue.Enqueue(TextureSample);
-    }
-
-
-    return ret;
-}
-
-void FFFMPEGMediaTracks::VideoDisplay () {
-    if (videoStream) {
-            FFMPEGFrame *vp;
-            FFMPEGFrame *sp = NULL;
-            
-
-            vp = pictq.PeekLast();
-            if (subTitleStream) {
-                if (subpq.GetNumRemaining() > 0) {
-                    sp = subpq.Peek();
-
-                    if (vp->GetPts() >= sp->GetPts() + ((float)sp->GetSub().start_display_time / 1000)) {
-                        if (!sp->IsUploaded()) {
-                            
-                            int i;
-                            if (!sp->GetWidth() || !sp->GetHeight()) {
-                                sp->UpdateSize(vp);
-                            }
-                            
-                            FTimespan Time = FTimespan::FromSeconds(sp->GetPts());
-                            FTimespan CurrentDuration = FTimespan::FromSeconds(sp->GetDuration());
-
-                            for (i = 0; i < (int)sp->GetSub().num_rects; i++) {
-                                AVSubtitleRect *sub_rect = sp->GetSub().rects[i];
-                                sub_rect->x = av_clip(sub_rect->x, 0, sp->GetWidth());
-                                sub_rect->y = av_clip(sub_rect->y, 0, sp->GetHeight());
-                                sub_rect->w = av_clip(sub_rect->w, 0, sp->GetWidth() - sub_rect->x);
-                                sub_rect->h = av_clip(sub_rect->h, 0, sp->GetHeight() - sub_rect->y);
-
-                                if ( sub_rect->type == SUBTITLE_TEXT ||  sub_rect->type == SUBTITLE_ASS) {
-                                    FScopeLock Lock(&CriticalSection);
-
-                                    const auto CaptionSample = MakeShared<FFFMPEGMediaOverlaySample, ESPMode::ThreadSafe>();
-
-                                    if (CaptionSample->Initialize(sub_rect->type == SUBTITLE_TEXT?sub_rect->text:sub_rect->ass, FVector2D(sub_rect->x, sub_rect->y), Time, CurrentDuration))
-                                    {
-                                        CaptionSampleQueue.Enqueue(CaptionSample);
-                                    }
-                                }
-
-                            }
-                            sp->SetUploaded(true);
-                        }
-                    }
-                    else
-                        sp = NULL;
-                }
-            }
-
-            if (!vp->IsUploaded()) {
-                vp->SetVerticalFlip(vp->GetFrame()->linesize[0] < 0);
-                if (UploadTexture(vp, vp->GetFrame(), &imgConvertCtx) < 0)
-                    return;
-                vp->SetUploaded(true);
-                
-            } 
-        }   
-}
-
-void FFFMPEGMediaTracks::StreamSeek( int64_t pos, int64_t rel, int seek_by_bytes) {
-    if (!seekReq) {
-        seekPos = pos;
-        seekRel = rel;
-        seekFlags &= ~AVSEEK_FLAG_BYTE;
-        if (seek_by_bytes)
-            seekFlags |= AVSEEK_FLAG_BYTE;
-        seekReq = 1;
-        continueReadCond.signal();
-    }
-}
-
-int FFFMPEGMediaTracks::ReadThread() {
-
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-
-    FCriticalSection wait_mutex;
-    AVPacket pkt1, *pkt = &pkt1;
-    int64_t stream_start_time;
-    int pkt_in_play_range = 0;
-
-    int scan_all_pmts_set = 0;
-    int64_t pkt_ts;
-    int ret = 0;
-    int read_pause_return = -1;
-
-    bool paused = CurrentState == EMediaState::Paused;
-    bool last_paused = false;
-
-    
-
-    for (;;) {
-        if (aborted)
-            break;
-
-        if (currentStreams < totalStreams) {
-            wait_mutex.Lock();
-            continueReadCond.waitTimeout(wait_mutex, 10);
-            wait_mutex.Unlock();
-            continue;
-        }
-
-        paused = ( CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped);
-
-        
-
-        if (paused != last_paused) {
-            last_paused = paused;
-
-            if (paused)
-                read_pause_return = av_read_pause(FormatContext);
-            else
-                av_read_play(FormatContext);
-        }      
-
-        if (  seekReq ) {
-            int64_t seek_target = seekPos;
-            int64_t seek_min = seekRel > 0 ? seek_target - seekRel + 2 : INT64_MIN;
-            int64_t seek_max = seekRel < 0 ? seek_target - seekRel - 2 : INT64_MAX;
-
-            ret = avformat_seek_file(FormatContext, -1, seek_min, seek_target, seek_max, seekFlags);
-            if (ret < 0) {
-                UE_LOG(LogFFMPEGMedia, Error, TEXT("%s: error while seeking"), UTF8_TO_TCHAR(FormatContext->url));
-            } else {
-                if (SelectedAudioTrack  != INDEX_NONE) {
-                    audioq.Flush();
-                    audioq.PutFlush();
-                }
-                if (SelectedCaptionTrack != INDEX_NONE) {
-                    subtitleq.Flush();
-                    subtitleq.PutFlush();
-                }
-                if (SelectedVideoTrack != INDEX_NONE) {
-                    videoq.Flush();
-                    videoq.PutFlush();
-                }
-                if (seekFlags & AVSEEK_FLAG_BYTE) {
-                    extclk.Set(NAN, 0);
-                }
-                else {
-                    extclk.Set(seek_target / (double)AV_TIME_BASE, 0);
-                }
-
-                FlushSamples();
-                DeferredEvents.Enqueue(EMediaEvent::SeekCompleted);
-            }
-            seekReq = false;
-            queueAttachmentsReq = true;
-            eof = 0;
-            
-            if (CurrentState == EMediaState::Paused)
-                StepToNextFrame();
-        }
-
-
-        if (queueAttachmentsReq) {
-            if (videoStream && videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC) {
-                AVPacket copy = { 0 };
-                if ((ret = av_packet_ref(&copy, &videoStream->attached_pic)) < 0) {
-                    return -1;
-                }
-
-                videoq.Put(&copy);
-                videoq.PutNullPacket(videoStreamIdx);
-            }
-            queueAttachmentsReq = false;
-        }
-
-        if (!Settings->UseInfiniteBuffer &&
-            (audioq.GetSize() + videoq.GetSize() + subtitleq.GetSize() > MAX_QUEUE_SIZE
-                || (StreamHasEnoughPackets(audioStream, audioStreamIdx, &audioq) &&
-                    StreamHasEnoughPackets(videoStream, videoStreamIdx, &videoq) &&
-                    StreamHasEnoughPackets(subTitleStream, subtitleStreamIdx, &subtitleq)))) {
-            /* wait 20 ms */
-            wait_mutex.Lock();
-            continueReadCond.waitTimeout(wait_mutex, 20);
-            wait_mutex.Unlock();
-            continue;
-        }
-
-        if (!paused &&
-            (!audioStream || (auddec->GetFinished() == audioq.GetSerial() && sampq.GetNumRemaining() == 0)) &&
-            (!videoStream || (viddec->GetFinished() == videoq.GetSerial() && pictq.GetNumRemaining() == 0))) {
-            
-            FlushSamples();
-            
-            if (ShouldLoop) {
-                DeferredEvents.Enqueue(EMediaEvent::PlaybackEndReached);
-                StreamSeek(0, 0, 0);
-            }
-            else {
-                CurrentState = EMediaState::Stopped;
-                DeferredEvents.Enqueue(EMediaEvent::PlaybackEndReached);
-                DeferredEvents.Enqueue(EMediaEvent::PlaybackSuspended);
-                bPrerolled = false;
-            }
-        }
-        try {
-            ret = av_read_frame(FormatContext, pkt);
-		} catch(...) {
-		    ret = -1;
-		}
-
-        if (ret < 0) {
-            if ((ret == AVERROR_EOF || avio_feof(FormatContext->pb)) && !eof) {
-                if (videoStreamIdx >= 0)
-                    videoq.PutNullPacket(videoStreamIdx);
-                if (audioStreamIdx >= 0)
-                    audioq.PutNullPacket(audioStreamIdx);
-                if (subtitleStreamIdx >= 0)
-                    subtitleq.PutNullPacket(subtitleStreamIdx);
-                eof = 1;
-            }
-            if (FormatContext->pb && FormatContext->pb->error)
-                break;
-
-            wait_mutex.Lock();
-            continueReadCond.waitTimeout(wait_mutex, 5);
-            wait_mutex.Unlock();
-            continue;
-        }
-        else {
-            eof = 0;
-        }
-        /* check if packet is in play range specified by user, then queue, otherwise discard */
-        stream_start_time = FormatContext->streams[pkt->stream_index]->start_time;
-        pkt_ts = pkt->pts == AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
-
-        pkt_in_play_range = 1;
-        if (pkt->stream_index == audioStreamIdx && pkt_in_play_range) {
-            audioq.Put(pkt);
-        }
-        else if (pkt->stream_index == videoStreamIdx && pkt_in_play_range
-            && !(videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
-            videoq.Put(pkt);
-        }
-        else if (pkt->stream_index == subtitleStreamIdx && pkt_in_play_range) {
-            subtitleq.Put(pkt);
-        }
-        else {
-            av_packet_unref(pkt);
-        }
-    }
-    return 0;
-}
-
-int FFFMPEGMediaTracks::AudioThread() {
-  
-    AVFrame *frame = av_frame_alloc();
-    FFMPEGFrame *af;
-
-    int got_frame = 0;
-    AVRational tb;
-    int ret = 0;
-
-    if (!frame)
-        return AVERROR(ENOMEM);
-
-    do {
-        if ((got_frame = auddec->DecodeFrame(frame, NULL)) < 0) {
-            av_frame_free(&frame);
-            return ret;
-        }
-
-        if (got_frame) {
-            tb = { 1, frame->sample_rate };
-            af = sampq.PeekWritable();
-            if (!af) {
-                av_frame_free(&frame);
-                return ret;
-            }
-
-            af->SetPts((frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb));
-            af->SetPos(frame->pkt_pos);
-            af->SetSerial(auddec->GetPktSerial());
-            af->SetDuration(av_q2d({ frame->nb_samples, frame->sample_rate }));
-
-            av_frame_move_ref(af->GetFrame(), frame);
-            sampq.Push();
-
-        }
-    } while (ret >= 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF);
-
-    av_frame_free(&frame);
-    return ret;
-}
-
-int FFFMPEGMediaTracks::SubtitleThread() {
-    FFMPEGFrame *sp;
-    int got_subtitle;
-    double pts;
-
-    for (;;) {
-        sp = subpq.PeekWritable();
-        if (!sp)
-            return 0;
-
-        if ((got_subtitle = subdec->DecodeFrame(NULL, &sp->GetSub())) < 0)
-            break;
-
-        pts = 0;
-
-        if (got_subtitle && sp->GetSub().format == 0) {
-            if (sp->GetSub().pts != AV_NOPTS_VALUE)
-                pts = sp->GetSub().pts / (double)AV_TIME_BASE;
-
-
-            sp->SetPts(pts);
-            sp->SetSerial(subdec->GetPktSerial());
-            sp->SetWidth(subdec->GetAvctx()->width);
-            sp->SetHeight(subdec->GetAvctx()->height);
-            sp->SetUploaded(false);
-
-            /* now we can update the picture count */
-            subpq.Push();
-        }
-        else if (got_subtitle) {
-            avsubtitle_free(&sp->GetSub());
-        }
-    }
-    return 0;
-}
-
-int FFFMPEGMediaTracks::SynchronizeAudio( int nb_samples) {
-     int wanted_nb_samples = nb_samples;
-
-        /* if not master, then we try to remove or add samples to correct the clock */
-        if (getMasterSyncType() != ESynchronizationType::AudioMaster) {
-            double diff, avg_diff;
-            int min_nb_samples, max_nb_samples;
-
-            diff = audclk.Get() - GetMasterClock();
-
-            if (!isnan(diff) && fabs(diff) < AV_NOSYNC_THRESHOLD) {
-                audioDiffCum = diff + audioDiffAvgCoef * audioDiffCum;
-                if (audioDiffAvgCount < AUDIO_DIFF_AVG_NB) {
-                    /* not enough measures to have a correct estimate */
-                    audioDiffAvgCount++;
-                } else {
-                    /* estimate the A-V difference */
-                    avg_diff = audioDiffCum * (1.0 - audioDiffAvgCoef);
-
-                    if (fabs(avg_diff) >= audioDiffThreshold) {
-                        wanted_nb_samples = nb_samples + (int)(diff * srcAudio.SampleRate);
-                        min_nb_samples = ((nb_samples * (100 - SAMPLE_CORRECTION_PERCENT_MAX) / 100));
-                        max_nb_samples = ((nb_samples * (100 + SAMPLE_CORRECTION_PERCENT_MAX) / 100));
-                        wanted_nb_samples = av_clip(wanted_nb_samples, min_nb_samples, max_nb_samples);
-                    }
-                    /*OFX_LOGP(ofx_trace, "diff=%f adiff=%f sample_diff=%d apts=%0.3f %f\n",
-                            diff, avg_diff, wanted_nb_samples - nb_samples,
-                            audioClock, audioDiffThreshold);*/
-                }
-            } else {
-                /* too big difference : may be initial PTS errors, so
-                   reset A-V filter */
-                audioDiffAvgCount = 0;
-                audioDiffCum       = 0;
-            }
-        }
-
-        return wanted_nb_samples;
-}
-
-int FFFMPEGMediaTracks::AudioDecodeFrame(FTimespan& time, FTimespan& duration) {
-    int data_size, resampled_data_size;
-    int64_t dec_channel_layout;
-    av_unused double audio_clock0;
-    int wanted_nb_samples;
-    FFMPEGFrame *af;
-
-    if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped)
-        return -1;
-
-    do {
-#if defined(_WIN32)
-        while (sampq.GetNumRemaining() == 0) {
-            if ((av_gettime_relative() - audioCallbackTime) > 1000000LL * targetAudio.HardwareSize /  targetAudio.BytesPerSec / 2)
-                return -1;
-            av_usleep(1000);
-        }
-#endif
-        af = sampq.PeekReadable();
-        if (!af)
-            return -1;
-        sampq.Next();
-    } while (af->GetSerial() != audioq.GetSerial());
-
-    data_size = av_samples_get_buffer_size(NULL, af->GetFrame()->channels, af->GetFrame()->nb_samples, (AVSampleFormat)af->GetFrame()->format, 1);
-
-    dec_channel_layout =
-        (af->GetFrame()->channel_layout && af->GetFrame()->channels == av_get_channel_layout_nb_channels(af->GetFrame()->channel_layout)) ?
-        af->GetFrame()->channel_layout : av_get_default_channel_layout(af->GetFrame()->channels);
-    wanted_nb_samples = SynchronizeAudio(af->GetFrame()->nb_samples);
-
-    if (getMasterSyncType() == ESynchronizationType::AudioMaster) {
-        CurrentTime = FTimespan::FromSeconds(af->GetPts());
-        //CurrentTime = FTimespan::FromSeconds(audclk.get());
-    }
-
-    if (af->GetFrame()->format != srcAudio.Format ||
-        dec_channel_layout != srcAudio.ChannelLayout ||
-        af->GetFrame()->sample_rate != srcAudio.SampleRate||
-        (wanted_nb_samples != af->GetFrame()->nb_samples && !swrContext)) {
-        swr_free(&swrContext);
-        swrContext = swr_alloc_set_opts(NULL,
-            targetAudio.ChannelLayout, targetAudio.Format,targetAudio.SampleRate,
-            dec_channel_layout, (AVSampleFormat)af->GetFrame()->format, af->GetFrame()->sample_rate,
-            0, NULL);
-        if (!swrContext || swr_init(swrContext) < 0) {
-            UE_LOG(LogFFMPEGMedia, Error, 
-                TEXT("Cannot create sample rate converter for conversion of %d Hz %s %d channels to %d Hz %s %d channels!"),
-                af->GetFrame()->sample_rate, UTF8_TO_TCHAR( av_get_sample_fmt_name((AVSampleFormat)af->GetFrame()->format)), af->GetFrame()->channels,
-                targetAudio.SampleRate,  UTF8_TO_TCHAR(av_get_sample_fmt_name(targetAudio.Format)), targetAudio.NumChannels);
-            swr_free(&swrContext);
-            return -1;
-        }
-        srcAudio.ChannelLayout = dec_channel_layout;
-        srcAudio.NumChannels = af->GetFrame()->channels;
-        srcAudio.SampleRate = af->GetFrame()->sample_rate;
-        srcAudio.Format = (AVSampleFormat)af->GetFrame()->format;
-    }
-
-    if (swrContext) {
-        const uint8_t **in = (const uint8_t **)af->GetFrame()->extended_data;
-        uint8_t **out = &audioBuf1;
-        int out_count = (int64_t)wanted_nb_samples * targetAudio.SampleRate / af->GetFrame()->sample_rate + 256;
-        int out_size = av_samples_get_buffer_size(NULL, targetAudio.NumChannels, out_count,targetAudio.Format, 0);
-        int len2;
-        if (out_size < 0) {
-            UE_LOG(LogFFMPEGMedia, Error,  TEXT("av_samples_get_buffer_size() failed"));
-            return -1;
-        }
-        if (wanted_nb_samples != af->GetFrame()->nb_samples) {
-            if (swr_set_compensation(swrContext, (wanted_nb_samples - af->GetFrame()->nb_samples) * targetAudio.SampleRate / af->GetFrame()->sample_rate,
-                wanted_nb_samples *targetAudio.SampleRate / af->GetFrame()->sample_rate) < 0) {
-                UE_LOG(LogFFMPEGMedia, Error,  TEXT("swr_set_compensation() failed"));
-                return -1;
-            }
-        }
-        av_fast_malloc(&audioBuf1, &audioBuf1Size, out_size);
-        if (!audioBuf1)
-            return AVERROR(ENOMEM);
-        len2 = swr_convert(swrContext, out, out_count, in, af->GetFrame()->nb_samples);
-        if (len2 < 0) {
-            UE_LOG(LogFFMPEGMedia, Error,  TEXT("swr_convert() failed"));
-            return -1;
-        }
-        if (len2 == out_count) {
-            UE_LOG(LogFFMPEGMedia, Warning,  TEXT("audio buffer is probably too small"));
-            if (swr_init(swrContext) < 0)
-                swr_free(&swrContext);
-        }
-        audioBuf = audioBuf1;
-        resampled_data_size = len2 * targetAudio.NumChannels * av_get_bytes_per_sample(targetAudio.Format);
-    }
-    else {
-        audioBuf = af->GetFrame()->data[0];
-        resampled_data_size = data_size;
-    }
-
-    audio_clock0 = audioClock;
-    /* update the audio clock with the pts */
-    if (!isnan(af->GetPts()))
-        audioClock = af->GetPts() + (double)af->GetFrame()->nb_samples / af->GetFrame()->sample_rate;
-    else
-        audioClock = NAN;
-    audioClockSerial = af->GetSerial();
-
-    time = FTimespan::FromSeconds(audioClock);
-    duration = FTimespan::FromSeconds(af->GetDuration());
-    
-    return resampled_data_size;
-}
-
-
-
-void FFFMPEGMediaTracks::RenderAudio() {
-    int audio_size, len1;
-
-    audioCallbackTime = av_gettime_relative();
-    FTimespan time = 0;
-    FTimespan duration = 0;
-
-    audio_size = AudioDecodeFrame(time, duration);
-    if (audio_size < 0) {
-        /* if error, just output silence */
-        audioBuf = NULL;
-        audioBufSize = AUDIO_MIN_BUFFER_SIZE / targetAudio.FrameSize * targetAudio.FrameSize;
-    }
-    else {
-        audioBufSize = audio_size;
-    }
-    len1 = audioBufSize ;
-
-    if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped) {
-        //Ignore the frame
-    } else {
-        if ( audioBuf != NULL ) {
-            FScopeLock Lock(&CriticalSection);
-            const TSharedRef<FFFMPEGMediaAudioSample, ESPMode::ThreadSafe> AudioSample = AudioSamplePool->AcquireShared();
-
-            if (AudioSample->Initialize((uint8_t *)audioBuf, len1, targetAudio.NumChannels, targetAudio.SampleRate, time, duration))
-            {
-                AudioSampleQueue.Enqueue(AudioSample);
-            }
-        }
-    }
-
-    if (!isnan(audioClock)) {
-        audclk.SetAt(audioClock - (double)(2 * targetAudio.HardwareSize + audioBufSize) / targetAudio.BytesPerSec, audioClockSerial, audioCallbackTime / 1000000.0);
-        extclk.SyncToSlave(&audclk);
-    }
-      
-}
-
-void FFFMPEGMediaTracks::StartDisplayThread() {
-    StopDisplayThread();
-    displayRunning = true;
-    displayThread = LambdaFunctionRunnable::RunThreaded("DisplayThread", [this](){
-       DisplayThread(); 
-    });
-}
-
-void FFFMPEGMediaTracks::StopDisplayThread() {
-    if (displayRunning && displayThread) {        
-        displayThread = nullptr;
-    }
-    displayRunning = false;
-}
-
-void FFFMPEGMediaTracks::StartAudioRenderThread() {
-    StopDisplayThread();
-    audioRunning = true;
-    audioRenderThread = LambdaFunctionRunnable::RunThreaded("AudioRenderThread", [this]() {
-        AudioRenderThread();
-    });
-}
-
-void FFFMPEGMediaTracks::StopAudioRenderThread() {
-	bool wasAudioRunning = audioRunning;
-	audioRunning = false;
-
-	if (audioRenderThread && wasAudioRunning) {
-		audioRenderThread->WaitForCompletion();
-		audioRenderThread = nullptr;
-	}
-}
-
-int FFFMPEGMediaTracks::DisplayThread() {
-    double remaining_time = 0.0;
-
-    while (displayRunning) {
-        if (remaining_time > 0.0)
-            av_usleep((int64_t)(remaining_time * 1000000.0));
-        remaining_time = REFRESH_RATE;
-        if (bPrerolled && CurrentState == EMediaState::Playing || forceRefresh  ) {
-            VideoRefresh(&remaining_time);   
-        }
-    }
-    return 0;
-}
-
-int FFFMPEGMediaTracks::AudioRenderThread() {
-    double remaining_time = 0.0;
-
-    
-    int64_t startTime =  av_gettime_relative();
-    while (audioRunning) {
-        if ( bPrerolled) {
-            RenderAudio();
-            int64_t endTime =  av_gettime_relative();
-            int64_t dif = endTime - startTime;
-            if ( dif < 33333) {
-                av_usleep(33333 - dif);
-            }
-            startTime = endTime;
-        }
-        
-    }
-    return 0;
-}
-
-
-void FFFMPEGMediaTracks::VideoRefresh(double *remaining_time) {
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-    double time;
-
-    FFMPEGFrame *sp, *sp2;
-
-    if (CurrentState == EMediaState::Playing && getMasterSyncType() == ESynchronizationType::ExternalClock && realtime)
-        CheckExternalClockSpeed();
-
-      if (videoStream) {
-        bool retry = true;
-
-        while (retry && displayRunning) {
-            if (pictq.GetNumRemaining() == 0) {
-                // nothing to do, no picture to display in the queue
-            } else {
-                double last_duration, duration, delay;
-                FFMPEGFrame *vp, *lastvp;
-
-
-                /* dequeue the picture */
-                lastvp = pictq.PeekLast();
-                vp = pictq.Peek();
-                ESynchronizationType sync_type = getMasterSyncType();
-                if ( sync_type  == ESynchronizationType::VideoMaster) {
-                    //CurrentTime = FTimespan::FromSeconds(vidclk.get());
-                    CurrentTime = FTimespan::FromSeconds(vp->GetPts());
-                } else if (sync_type == ESynchronizationType::ExternalClock) {
-                    CurrentTime = FTimespan::FromSeconds(extclk.Get());
-                }
-
-
-                if (vp->GetSerial() != videoq.GetSerial()) {
-                    pictq.Next();
-                    continue;
-                }
-
-                if (lastvp->GetSerial() != vp->GetSerial())
-                    frameTimer = av_gettime_relative() / 1000000.0;
-
-                if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped) {
-                    if (forceRefresh && pictq.GetIndexShown())
-                        VideoDisplay();
-                   
-                    forceRefresh = false;
-                    return;
-                }
-
-               
-                /* compute nominal last_duration */
-                last_duration = lastvp->GetDifference(vp, maxFrameDuration);
-                delay = ComputeTargetDelay(last_duration);
-
-                time= av_gettime_relative()/1000000.0;
-                if (time < frameTimer + delay) {
-                    *remaining_time = FFMIN(frameTimer + delay - time, *remaining_time);
-                    if (forceRefresh && pictq.GetIndexShown())
-                        VideoDisplay();
-
-                    forceRefresh = false;
-                    return;
-                }
-
-
-                frameTimer += delay;
-                if (delay > 0 && time - frameTimer > AV_SYNC_THRESHOLD_MAX)
-                    frameTimer = time;
-
-                pictq.Lock();
-                if (!isnan(vp->GetPts()))
-                    UpdateVideoPts(vp->GetPts(), vp->GetPos(), vp->GetSerial());
-                pictq.Unlock();
-
-                if (pictq.GetNumRemaining() > 1) {
-                    FFMPEGFrame *nextvp = pictq.PeekNext();
-                    duration = vp->GetDifference(nextvp, maxFrameDuration);
-                    if(!step && (Settings->AllowFrameDrop && getMasterSyncType() != ESynchronizationType::VideoMaster) && time > frameTimer + duration){
-                        frameDropsLate++;
-                        pictq.Next();
-                        continue;
-                    }
-                }
-
-                if (subTitleStream) {
-                        while (subpq.GetNumRemaining() > 0) {
-                            sp = subpq.Peek();
-
-                            if (subpq.GetNumRemaining() > 1)
-                                sp2 = subpq.PeekNext();
-                            else
-                                sp2 = NULL;
-
-                            if (sp->GetSerial() != subtitleq.GetSerial()
-                                    || (vidclk.GetPts() > (sp->GetPts() + ((float) sp->GetSub().end_display_time / 1000)))
-                                    || (sp2 && vidclk.GetPts() > (sp2->GetPts() + ((float) sp2->GetSub().start_display_time / 1000))))
-                            {
-                                subpq.Next();
-                            } else {
-                                break;
-                            }
-                        }
-                }
-
-                pictq.Next();
-                forceRefresh = true;
-
-                if (step && CurrentState == EMediaState::Playing)
-                    StreamTogglePause();
-
-                retry = false;
-            }
-        }
-
-        /* display picture */
-        if (forceRefresh && pictq.GetIndexShown())
-            VideoDisplay();
-    }
-    forceRefresh = false;
- /*   if (show_status) {
-        static int64_t last_time;
-        int64_t cur_time;
-        int aqsize, vqsize, sqsize;
-        double av_diff;
-
-        cur_time = av_gettime_relative();
-        if (!last_time || (cur_time - last_time) >= 30000) {
-            aqsize = 0;
-            vqsize = 0;
-            sqsize = 0;
-            if (audioStream)
-                aqsize = audioq.get_size();
-            if (videoStream)
-                vqsize = videoq.get_size();
-            if (subTitleStream)
-                sqsize = subtitleq.get_size();
-            av_diff = 0;
-            if (audioStream && videoStream)
-                av_diff = audclk.get() - vidclk.get();
-            else if (videoStream)
-                av_diff = get_master_clock(is) - vidclk.get();
-            else if (audioStream)
-                av_diff = get_master_clock(is) - audclk.get();
-            / *av_log(NULL, AV_LOG_INFO,
-                   "%7.2f %s:%7.3f fd=%4d aq=%5dKB vq=%5dKB sq=%5dB f=%"PRId64"/%"PRId64"   \r",
-                   get_master_clock(is),
-                   (audioStream && videoStream) ? "A-V" : (videoStream ? "M-V" : (audioStream ? "M-A" : "   ")),
-                   av_diff,
-                   frameDropsEarly + frameDropsLate,
-                   aqsize / 1024,
-                   vqsize / 1024,
-                   sqsize,
-                   videoStream ? viddec.avctx->pts_correction_num_faulty_dts : 0,
-                   videoStream ? viddec.avctx->pts_correction_num_faulty_pts : 0);* /
-            fflush(stdout);
-            last_time = cur_time;
-        }
-    }*/
-
-
-
-}
-
-
-int FFFMPEGMediaTracks::GetVideoFrame(AVFrame *frame) {
-
-    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
-
-    int got_picture = viddec->DecodeFrame(frame, NULL);
-
-    if (got_picture < 0)
-        return -1;
-
-    if ( got_picture ) {
-        if ( !bPrerolled) {
-            bPrerolled = true;
-            SetRate(CurrentRate);
-        }
-
-        if (hwaccel_retrieve_data && frame->format == hwAccelPixFmt) {
-            int err = hwaccel_retrieve_data(video_ctx, frame);
-            if (err < 0) {
-                av_frame_unref(frame);
-                return -1;
-            }
-        }
-
-        double dpts = NAN;
-
-        if (frame->pts != AV_NOPTS_VALUE)
-            dpts = av_q2d(videoStream->time_base) * frame->pts;
-
-        frame->sample_aspect_ratio = av_guess_sample_aspect_ratio(FormatContext, videoStream, frame);
-
-
-        if ((Settings->AllowFrameDrop && getMasterSyncType() != ESynchronizationType::VideoMaster)) {
-            if (frame->pts != AV_NOPTS_VALUE) {
-                double diff = dpts - GetMasterClock();
-                if (!isnan(diff) && fabs(diff) < AV_NOSYNC_THRESHOLD &&
-                    diff /*- frame_last_filter_delay*/ < 0 &&
-                    viddec->GetPktSerial() == vidclk.GetSerial() &&
-                    videoq.GetNumPackets()) {
-                    frameDropsEarly++;
-                    av_frame_unref(frame);
-                    got_picture = 0;
-                }
-            }
-        }
-    }
-
-    return got_picture;
-}
-
-int FFFMPEGMediaTracks::VideoThread() {
-
-    AVFrame *frame = av_frame_alloc();
-    double pts;
-    double duration;
-    int ret;
-    AVRational tb = videoStream->time_base;
-    AVRational frame_rate = av_guess_frame_rate(FormatContext, videoStream, NULL);
-
-    if (!frame) {
-        return AVERROR(ENOMEM);
-    }
-
-    for (;;) {
-        ret = GetVideoFrame(frame);
-        if (ret < 0) {
-            av_frame_free(&frame);
-            return 0;
-        }
-        if (!ret)
-            continue;
-
-        duration = (frame_rate.num && frame_rate.den ? av_q2d({ frame_rate.den, frame_rate.num }) : 0);
-        pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb);
-        ret = pictq.QueuePicture(frame, pts, duration, frame->pkt_pos, viddec->GetPktSerial());
-        
-        av_frame_unref(frame);
-
-        if (ret < 0) {
-            av_frame_free(&frame);
-            return 0;
-        }
-    }
-
-    av_frame_free(&frame);
-    return 0;
-}
-
-
-int FFFMPEGMediaTracks::HWAccelRetrieveDataCallback(AVCodecContext *avctx, AVFrame *input) {
-    FFFMPEGMediaTracks *ist = (FFFMPEGMediaTracks*)avctx->opaque;
-    AVFrame *output = NULL;
-    //enum AVPixelFormat output_format = ist->hwaccel_output_format;
-    enum AVPixelFormat output_format = AV_PIX_FMT_NONE;
-    int err;
-
-    if (input->format == output_format) {
-        // Nothing to do.
-        return 0;
-    }
-
-    output = av_frame_alloc();
-    if (!output)
-        return AVERROR(ENOMEM);
-
-    output->format = output_format;
-
-    err = av_hwframe_transfer_data(output, input, 0);
-    if (err < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Failed to transfer data to "
-            "output frame: %d.\n", err);
-        av_frame_free(&output);
-        return err;
-    }
-
-    err = av_frame_copy_props(output, input);
-    if (err < 0) {
-        av_frame_unref(output);
-        av_frame_free(&output);
-        return err;
-    }
-
-    av_frame_unref(input);
-    av_frame_move_ref(input, output);
-    av_frame_free(&output);
-
-    return 0;
-
-}
-
-int FFFMPEGMediaTracks::IsRealtime(AVFormatContext *s) {
-	if (!strcmp(s->iformat->name, "rtp")
-		|| !strcmp(s->iformat->name, "rtsp")
-		|| !strcmp(s->iformat->name, "sdp")
-		)
-		return 1;
-
-	if (s->pb && (!strncmp(s->url, "rtp:", 4)
-		|| !strncmp(s->url, "udp:", 4)
-		)
-		)
-		return 1;
-	return 0;
-}
-
-
-
-#undef LOCTEXT_NAMESPACE
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTracks.h"
+#include "FFMPEGMediaPrivate.h"
+#include "LambdaFunctionRunnable.h"
+#include "FFMPEGMediaSettings.h"
+#include "FFMPEGMediaMemoryBudget.h"
+#include "FFMPEGMediaDecoderCache.h"
+
+#include "FFMPEGDecoder.h"
+#include "FFMPEGFrame.h"
+
+#include "IMediaOptions.h"
+#include "MediaHelpers.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/Class.h"
+#include "IMediaBinarySample.h"
+#include "IMediaEventSink.h"
+#include "MediaPlayerOptions.h"
+
+
+#if WITH_ENGINE
+	#include "Engine/Engine.h"
+#endif
+
+#include "FFMPEGMediaBinarySample.h"
+#include "FFMPEGMediaOverlaySample.h"
+#include "FFMPEGMediaAudioSample.h"
+#include "FFMPEGMediaTextureSample.h"
+
+extern  "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/time.h"
+#include "libswscale/swscale.h"
+#include "libswresample/swresample.h"
+
+}
+
+/* polls for possible required screen refresh at least this often, should be less than 1/fps */
+#define REFRESH_RATE 0.01
+#define HIDDEN_REFRESH_RATE 0.1
+
+/* AV sync correction is done if above the maximum AV sync threshold */
+#define AV_SYNC_THRESHOLD_MAX 0.1
+
+/* no AV sync correction is done if below the minimum AV sync threshold */
+#define AV_SYNC_THRESHOLD_MIN 0.04
+/* AV sync correction is done if above the maximum AV sync threshold */
+#define AV_SYNC_THRESHOLD_MAX 0.1
+/* If a frame duration is longer than this, it will not be duplicated to compensate AV sync */
+#define AV_SYNC_FRAMEDUP_THRESHOLD 0.1
+
+#define EXTERNAL_CLOCK_MIN_FRAMES 2
+#define EXTERNAL_CLOCK_MAX_FRAMES 10
+
+/* external clock speed adjustment constants for realtime sources based on buffer fullness */
+#define EXTERNAL_CLOCK_SPEED_MIN  0.900
+#define EXTERNAL_CLOCK_SPEED_MAX  1.010
+#define EXTERNAL_CLOCK_SPEED_STEP 0.001
+
+/* Minimum  audio buffer size, in samples. */
+#define AUDIO_MIN_BUFFER_SIZE 512
+
+/* Calculate actual buffer size keeping in mind not cause too frequent audio callbacks */
+#define AUDIO_MAX_CALLBACKS_PER_SEC 30
+
+/* no AV correction is done if too big error */
+#define AV_NOSYNC_THRESHOLD 10.0
+
+/* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
+#define AUDIO_DIFF_AVG_NB   20
+
+/* maximum audio speed change to get correct sync */
+#define SAMPLE_CORRECTION_PERCENT_MAX 10
+
+
+#define LOCTEXT_NAMESPACE "FFMPEGMediaTracks"
+
+
+/* Local helpers
+ *****************************************************************************/
+
+namespace FFMPEGMediaTracks
+{
+	/** Bytes held by a decoded subtitle, the bitmaps with their palettes and the texts. */
+	int64 GetSubtitleBytes(const AVSubtitle& Subtitle)
+	{
+		int64 Bytes = sizeof(AVSubtitle);
+
+		for (unsigned Index = 0; Index < Subtitle.num_rects; ++Index)
+		{
+			const AVSubtitleRect* Rect = Subtitle.rects[Index];
+
+			Bytes += sizeof(AVSubtitleRect) + (int64)Rect->linesize[0] * Rect->h + (Rect->data[1] ? AVPALETTE_SIZE : 0);
+			Bytes += (Rect->text ? strlen(Rect->text) : 0) + (Rect->ass ? strlen(Rect->ass) : 0);
+		}
+
+		return Bytes;
+	}
+}
+
+
+
+
+
+/* FFFMPEGMediaTracks structors
+ *****************************************************************************/
+
+FFFMPEGMediaTracks::FFFMPEGMediaTracks()
+	: AudioSamplePool(new FFFMPEGMediaAudioSamplePool)
+	, TrackSnapshot(MakeShared<FTrackSnapshot, ESPMode::ThreadSafe>())
+	, FormatContext(NULL)
+	, MediaSourceChanged(false)
+	, SelectedAudioTrack(INDEX_NONE)
+	, SelectedCaptionTrack(INDEX_NONE)
+	, SelectedMetadataTrack(INDEX_NONE)
+	, SelectedVideoTrack(INDEX_NONE)
+	, SelectionChanged(false)
+	, VideoSamplePool(new FFFMPEGMediaTextureSamplePool)
+	, CurrentRate(0.0f)
+  , CurrentState (EMediaState::Closed)
+  , LastState (EMediaState::Closed)
+	, CurrentTime(FTimespan::Zero())
+  , Duration(FTimespan::Zero())
+  , ShouldLoop(false)
+  , bPrerolled(false)
+	, readThread(nullptr)
+	, audioThread(nullptr)
+	, videoThread(nullptr)
+	, subtitleThread(nullptr)
+	, audioStream(NULL)
+	, videoStream(NULL)
+	, subTitleStream(NULL)
+	, video_ctx(NULL)
+	, hw_device_ctx(NULL)
+	, hw_frames_ctx(NULL)
+	, swrContext(NULL)
+  , displayRunning(false)
+  , audioRunning(false)
+  , eof(0)
+  , step(false)  
+  , seekPos(0)
+  , seekRel(0)
+  , seekFlags(0)
+  , queueAttachmentsReq(false)
+  , videoStreamIdx(-1)
+  , audioStreamIdx(-1)
+  , subtitleStreamIdx(-1)
+  , forceRefresh(false)
+  , uploadPending(false)
+  , audioStarved(false)
+  , frameDropsLate(0)
+  , frameDropsEarly(0)
+  , frameTimer(0.0)
+  , maxFrameDuration(0.0)
+  , realtime(false)
+  , videoBufferPool(NULL)
+  , videoBufferPoolSize(0)
+  , nativeYUVOutput(false)
+  , fastYUVConversion(false)
+  , conversionSlices(1)
+  , maxOutputWidth(0)
+  , maxOutputHeight(0)
+  , outputLOD(0)
+  , videoLowres(0)
+  , videoFrameQueueSize(VIDEO_PICTURE_QUEUE_SIZE)
+  , audioFrameQueueSize(SAMPLE_QUEUE_SIZE)
+  , subtitleFrameQueueSize(SUBPICTURE_QUEUE_SIZE)
+  , minQueuedPackets(30)
+  , maxQueueSize(15 * 1024 * 1024)
+  , videoWatermarks({ 1.0, 3.0 })
+  , audioWatermarks({ 1.0, 3.0 })
+  , subtitleWatermarks({ 0.0, 0.0 })
+  , readingAhead(true)
+  , packetBudget(MAX_int64)
+  , frameBudget(MAX_int64)
+  , memoryPriority(0)
+  , videoFrameBytes(0)
+  , videoSampleBytes(0)
+  , audioFrameBytes(0)
+  , audioSampleBytes(0)
+  , subtitleFrameBytes(0)
+  , videoOverBudget(false)
+  , audioOverBudget(false)
+  , subtitleOverBudget(false)
+  , frameBudgetOverruns(0)
+  , maxVideoSamples(4)
+  , maxAudioSamples(16)
+  , sampleQueueOverflow(ESampleQueueOverflow::DropOldest)
+  , droppedVideoSamples(0)
+  , droppedAudioSamples(0)
+  , skippedConversions(0)
+  , skippedAudioSamples(0)
+  , qosClass(EFFMPEGMediaQoS::Normal)
+  , waitKeyFrame(false)
+  , lastQueuedPts(NAN)
+  , lastQueuedSerial(-1)
+  , qosSkippedFrames(0)
+  , videoThreadType(0)
+  , videoThreadCount(0)
+  , videoThreadReason("")
+  , sampleSequenceIndex(0)
+  , audioBuf(NULL)
+  , audioBuf1(NULL)
+  , audioBufSize(0)
+  , audioBuf1Size(0)
+  , audioClockSerial(0)
+  , audioClock(0)
+  , audioCallbackTime(0)
+  , audioDiffAvgCoef(0)
+  , audioDiffThreshold(0)
+  , audioDiffAvgCount(0)
+  , audioDiffCum(0)
+  , totalStreams(0)
+	, currentStreams(0)
+	, hwAccelPixFmt(AV_PIX_FMT_NONE)
+	, hwAccelDeviceType(AV_HWDEVICE_TYPE_NONE){
+    
+    /* the stages on the task pool don't block, the pipeline state and the frame queues resume them */
+    pipelineState.SetChangeCallback([this] {
+        WakeTasks();
+    });
+    pictq.SetPushCallback([this] {
+        FFMPEGTaskPool::Get().Wake(std::atomic_load(&convertTask));
+    });
+    sampq.SetPushCallback([this] {
+        if (audioStarved.exchange(false))
+            FFMPEGTaskPool::Get().Wake(std::atomic_load(&audioRenderTask));
+    });
+}
+
+
+FFFMPEGMediaTracks::~FFFMPEGMediaTracks()
+{
+	Shutdown();
+
+	delete AudioSamplePool;
+	AudioSamplePool = nullptr;
+
+	delete VideoSamplePool;
+	VideoSamplePool = nullptr;
+}
+
+
+/* FFFMPEGMediaTracks interface
+ *****************************************************************************/
+
+void FFFMPEGMediaTracks::AppendStats(FString &OutStats) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+
+	// audio tracks
+	OutStats += TEXT("Audio Tracks\n");
+	
+	if (Snapshot->AudioTracks.Num() == 0)
+	{
+		OutStats += TEXT("\tnone\n");
+	}
+	else
+	{
+		for (const FTrack& Track : Snapshot->AudioTracks)
+		{
+			OutStats += FString::Printf(TEXT("\t%s\n"), *Track.DisplayName.ToString());
+			OutStats += TEXT("\t\tNot implemented yet");
+		}
+
+		OutStats += FString::Printf(TEXT("\n\tDecoder: %.2f ms per frame\n"), auddec.IsValid() ? auddec->GetDecodeTimePerFrame() * 1000.0 : 0.0);
+	}
+
+	// video tracks
+	OutStats += TEXT("Video Tracks\n");
+
+	if (Snapshot->VideoTracks.Num() == 0)
+	{
+		OutStats += TEXT("\tnone\n");
+	}
+	else
+	{
+		for (const FTrack& Track : Snapshot->VideoTracks)
+		{
+			OutStats += FString::Printf(TEXT("\t%s\n"), *Track.DisplayName.ToString());
+			OutStats += TEXT("\t\tNot implemented yet");
+		}
+
+		OutStats += FString::Printf(TEXT("\n\tDecode buffers: %lld pool hits, %lld misses, %.1f KB per frame\n"),
+			videoAllocator.GetHits(), videoAllocator.GetMisses(), videoAllocator.GetFrameSize() / 1024.0);
+		OutStats += FString::Printf(TEXT("\tDecoder threads: %s x%d (%s), %.2f ms per frame, %d video decoders open\n"),
+			UTF8_TO_TCHAR(FFMPEGDecoderThreadingPolicy::GetThreadTypeName(videoThreadType)), (int32)videoThreadCount, UTF8_TO_TCHAR(videoThreadReason.load()),
+			viddec.IsValid() ? viddec->GetDecodeTimePerFrame() * 1000.0 : 0.0, FFMPEGDecoderThreadingPolicy::GetNumVideoDecoders());
+	}
+
+	// memory
+	int64 PacketBytes = 0;
+	int64 FrameBytes = 0;
+	GetMemoryUsage(PacketBytes, FrameBytes);
+
+	OutStats += TEXT("Memory\n");
+	OutStats += FString::Printf(TEXT("\tPackets: %.1f MB, Frames: %.1f MB, Frame queue depths: video %d, audio %d, subtitles %d, %lld times over budget\n"),
+		PacketBytes / (1024.0 * 1024.0), FrameBytes / (1024.0 * 1024.0), pictq.GetDepth(), sampq.GetDepth(), subpq.GetDepth(), (int64)frameBudgetOverruns);
+
+	// sample queues
+	OutStats += TEXT("Sample Queues\n");
+	OutStats += FString::Printf(TEXT("\tVideo: %d/%d, dropped %lld, stale %lld, conversions skipped %lld\n"),
+		VideoSampleQueue.Num(), maxVideoSamples, (int64)droppedVideoSamples, VideoSampleQueue.GetNumStale(), (int64)skippedConversions);
+	OutStats += FString::Printf(TEXT("\tAudio: %d/%d, dropped %lld, stale %lld, skipped %lld\n"),
+		AudioSampleQueue.Num(), maxAudioSamples, (int64)droppedAudioSamples, AudioSampleQueue.GetNumStale(), (int64)skippedAudioSamples);
+	OutStats += FString::Printf(TEXT("\tCaptions: %d, stale %lld\n"),
+		CaptionSampleQueue.Num(), CaptionSampleQueue.GetNumStale());
+
+	// task pool
+	const FFMPEGTaskPool& TaskPool = FFMPEGTaskPool::Get();
+	const TCHAR* QoSNames[] = { TEXT("Hero"), TEXT("Normal"), TEXT("Background"), TEXT("Hidden") };
+
+	OutStats += TEXT("Task Pool\n");
+	OutStats += FString::Printf(TEXT("\tWorkers: %d, Tasks: %d, Runs: %llu, Steals: %llu\n"),
+		TaskPool.GetNumWorkers(), TaskPool.GetNumTasks(), (uint64)TaskPool.GetNumRuns(), (uint64)TaskPool.GetNumSteals());
+	OutStats += FString::Printf(TEXT("\tQoS: %s, video frames skipped %lld\n"), QoSNames[(int32)GetQoS()], (int64)qosSkippedFrames);
+
+	// packet queues
+	OutStats += TEXT("Packet Queues\n");
+
+	const TCHAR* QueueNames[] = { TEXT("Audio"), TEXT("Video"), TEXT("Subtitle") };
+	const FFMPEGPacketQueue* Queues[] = { &audioq, &videoq, &subtitleq };
+
+	for (int32 QueueIndex = 0; QueueIndex < 3; ++QueueIndex)
+	{
+		FFMPEGPacketQueueStats QueueStats = Queues[QueueIndex]->GetStats();
+		OutStats += FString::Printf(TEXT("\t%s: %lld packets, %.1f%% reused slots, peak %d of %d, %lld flushes releasing %lld packets\n"),
+			QueueNames[QueueIndex], QueueStats.puts, QueueStats.puts > 0 ? 100.0 * QueueStats.reused_slots / QueueStats.puts : 0.0,
+			QueueStats.peak_packets, Queues[QueueIndex]->GetCapacity(), QueueStats.flushes, QueueStats.flushed_packets);
+	}
+}
+
+
+void FFFMPEGMediaTracks::ClearFlags()
+{
+	FScopeLock Lock(&CriticalSection);
+
+	MediaSourceChanged = false;
+	SelectionChanged = false;
+}
+
+void FFFMPEGMediaTracks::GetEvents(TArray<EMediaEvent>& OutEvents) {
+    EMediaEvent Event;
+
+    while (DeferredEvents.Dequeue(Event))
+    {
+        OutEvents.Add(Event);
+    }
+}
+
+
+
+void FFFMPEGMediaTracks::GetFlags(bool& OutMediaSourceChanged, bool& OutSelectionChanged) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	OutMediaSourceChanged = MediaSourceChanged;
+	OutSelectionChanged = SelectionChanged;
+}
+
+
+void FFFMPEGMediaTracks::SetQueueDepths(const IMediaOptions* Options)
+{
+	const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+	auto GetDepth = [Options](const TCHAR* Name, int64 Default, int64 Min, int64 Max)
+	{
+		int64 Value = (Options != nullptr) ? Options->GetMediaOption(FName(Name), Default) : Default;
+		return (int)FMath::Clamp(Value, Min, Max);
+	};
+
+	videoFrameQueueSize = GetDepth(TEXT("VideoFrameQueueSize"), Settings->VideoFrameQueueSize, 2, FRAME_QUEUE_MAX_SIZE);
+	audioFrameQueueSize = GetDepth(TEXT("AudioFrameQueueSize"), Settings->AudioFrameQueueSize, 2, FRAME_QUEUE_MAX_SIZE);
+	subtitleFrameQueueSize = GetDepth(TEXT("SubtitleFrameQueueSize"), Settings->SubtitleFrameQueueSize, 1, FRAME_QUEUE_MAX_SIZE);
+	minQueuedPackets = GetDepth(TEXT("MinQueuedPackets"), Settings->MinQueuedPackets, 1, PACKET_QUEUE_MAX_CAPACITY / 2);
+	maxQueueSize = GetDepth(TEXT("MaxQueueSizeMB"), Settings->MaxQueueSizeMB, 1, 1024) * 1024 * 1024;
+
+	if (Options != nullptr && Options->HasMediaOption(TEXT("MemoryPriority")))
+	{
+		SetMemoryPriority(GetDepth(TEXT("MemoryPriority"), 0, 0, 100));
+	}
+
+	if (Options != nullptr && Options->HasMediaOption(TEXT("QoS")))
+	{
+		SetQoS((EFFMPEGMediaQoS)GetDepth(TEXT("QoS"), (int64)EFFMPEGMediaQoS::Normal, (int64)EFFMPEGMediaQoS::Hero, (int64)EFFMPEGMediaQoS::Hidden));
+	}
+
+	auto GetWatermarks = [Options](const TCHAR* LowName, double LowDefault, const TCHAR* HighName, double HighDefault, double Min)
+	{
+		auto GetSeconds = [Options, Min](const TCHAR* Name, double Default)
+		{
+			double Value = (Options != nullptr) ? Options->GetMediaOption(FName(Name), Default) : Default;
+			return FMath::Clamp(Value, Min, 60.0);
+		};
+
+		FBufferWatermarks Watermarks;
+		Watermarks.Low = GetSeconds(LowName, LowDefault);
+		Watermarks.High = FMath::Max(Watermarks.Low, GetSeconds(HighName, HighDefault));
+
+		return Watermarks;
+	};
+
+	videoWatermarks = GetWatermarks(TEXT("BufferLowWatermark"), Settings->BufferLowWatermark, TEXT("BufferHighWatermark"), Settings->BufferHighWatermark, 0.1);
+	audioWatermarks = GetWatermarks(TEXT("AudioBufferLowWatermark"), Settings->AudioBufferLowWatermark, TEXT("AudioBufferHighWatermark"), Settings->AudioBufferHighWatermark, 0.1);
+	subtitleWatermarks = GetWatermarks(TEXT("SubtitleBufferLowWatermark"), Settings->SubtitleBufferLowWatermark, TEXT("SubtitleBufferHighWatermark"), Settings->SubtitleBufferHighWatermark, 0.0);
+
+	maxVideoSamples = GetDepth(TEXT("MaxVideoSamples"), Settings->MaxVideoSamples, 0, 64);
+	maxAudioSamples = GetDepth(TEXT("MaxAudioSamples"), Settings->MaxAudioSamples, 0, 256);
+	sampleQueueOverflow = Settings->SampleQueueOverflow;
+
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: Queue depths video %d, audio %d, subtitles %d, %d packets, %d MB, watermarks video %.1f-%.1f s, audio %.1f-%.1f s, subtitles %.1f-%.1f s"), this,
+		videoFrameQueueSize, audioFrameQueueSize, subtitleFrameQueueSize, minQueuedPackets, maxQueueSize / (1024 * 1024),
+		videoWatermarks.Low, videoWatermarks.High, audioWatermarks.Low, audioWatermarks.High, subtitleWatermarks.Low, subtitleWatermarks.High);
+}
+
+
+bool FFFMPEGMediaTracks::QueryCacheState(EMediaCacheState State, TRangeSet<FTimespan>& OutTimeRanges) const
+{
+	if (FormatContext == nullptr || (State != EMediaCacheState::Loaded && State != EMediaCacheState::Loading))
+	{
+		return false;
+	}
+
+	double HighWatermark = 0.0;
+	const double Level = GetBufferLevel(&HighWatermark);
+	if (!FMath::IsFinite(Level))
+	{
+		return false;
+	}
+
+	const FTimespan Start = CurrentTime;
+	const FTimespan LoadedEnd = Start + FTimespan::FromSeconds(Level);
+
+	if (State == EMediaCacheState::Loaded)
+	{
+		OutTimeRanges.Add(TRange<FTimespan>(Start, LoadedEnd));
+	}
+	else if (readingAhead && Level < HighWatermark)
+	{
+		OutTimeRanges.Add(TRange<FTimespan>(LoadedEnd, Start + FTimespan::FromSeconds(HighWatermark)));
+	}
+
+	return true;
+}
+
+
+void FFFMPEGMediaTracks::SetMemoryBudget(int64 PacketBytes, int64 FrameBytes)
+{
+	packetBudget = PacketBytes;
+	frameBudget = FrameBytes;
+}
+
+
+void FFFMPEGMediaTracks::GetMemoryUsage(int64& OutPacketBytes, int64& OutFrameBytes) const
+{
+	OutPacketBytes = (int64)audioq.GetSize() + videoq.GetSize() + subtitleq.GetSize();
+
+	// every queued video frame also holds its converted sample, the output queues only hold samples
+	const int64 QueuedFrames = pictq.GetNumRemaining() + pictq.GetIndexShown();
+	const int64 QueuedAudioFrames = sampq.GetNumRemaining() + sampq.GetIndexShown();
+
+	OutFrameBytes = QueuedFrames * (videoFrameBytes + videoSampleBytes) + VideoSampleQueue.Num() * videoSampleBytes
+		+ QueuedAudioFrames * audioFrameBytes + AudioSampleQueue.Num() * audioSampleBytes
+		+ subpq.GetNumRemaining() * subtitleFrameBytes;
+}
+
+
+void FFFMPEGMediaTracks::SetMemoryPriority(int32 Priority)
+{
+	// the budget only knows the player between Initialize and Shutdown
+	FScopeLock Lock(&CriticalSection);
+
+	memoryPriority = Priority;
+	FFFMPEGMediaMemoryBudget::Get().SetPriority(this, Priority);
+}
+
+
+int32 FFFMPEGMediaTracks::GetMemoryPriority() const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	return memoryPriority;
+}
+
+
+FString FFFMPEGMediaTracks::GetMediaUrl() const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	return SourceUrl;
+}
+
+
+int32 FFFMPEGMediaTracks::GetSampleCount(EMediaCacheState State) const
+{
+	switch (State)
+	{
+	case EMediaCacheState::Loaded:
+		return audioq.GetNumPackets() + videoq.GetNumPackets() + subtitleq.GetNumPackets();
+
+	case EMediaCacheState::Cached:
+		return pictq.GetNumRemaining() + sampq.GetNumRemaining();
+
+	default:
+		return 0;
+	}
+}
+
+
+void FFFMPEGMediaTracks::Initialize(AVFormatContext* ic, const FString& Url, const FMediaPlayerOptions* PlayerOptions )
+{
+	Shutdown();
+    
+    FMediaPlayerTrackOptions TrackOptions;
+    if (PlayerOptions != nullptr)
+    {
+        TrackOptions = PlayerOptions->Tracks;
+    }
+    
+   
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: Initializing (media source %p)"), this, ic);
+
+	FScopeLock Lock(&CriticalSection);
+
+	MediaSourceChanged = true;
+	SelectionChanged = true;
+	SourceUrl = Url;
+
+	FFFMPEGMediaMemoryBudget::Get().Register(this, memoryPriority, Url);
+
+	if (!ic)
+	{
+        CurrentState = EMediaState::Error;
+		return;
+	}
+
+
+    if (pictq.Init(&videoq, videoFrameQueueSize, 1) < 0) {
+        Shutdown();
+        CurrentState = EMediaState::Error;
+        return ;
+    }
+
+    realtime = IsRealtime(ic) != 0;
+
+    if (subpq.Init(&subtitleq, subtitleFrameQueueSize, 0) < 0) {
+        Shutdown();
+        CurrentState = EMediaState::Error;
+        return;
+    }
+
+    if (sampq.Init(&audioq, audioFrameQueueSize, 1) < 0) {
+        Shutdown();
+        CurrentState = EMediaState::Error;
+        return;
+    }
+
+    vidclk.Init(&videoq);
+    audclk.Init(&audioq);
+    extclk.Init(&extclk);
+    
+    this->FormatContext = ic;
+    audioClockSerial = -1;
+
+    CurrentState = EMediaState::Preparing;
+    pipelineState.Start(EPipelineState::Prerolling);
+
+    //
+
+    bool AllStreamsAdded = true;
+
+    for (int i = 0; i < (int)ic->nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+        bool streamAdded = AddStreamToTracks(i, false, TrackOptions, Info);
+        AllStreamsAdded &= streamAdded;
+        if ( streamAdded) {
+            totalStreams++;
+        }
+        enum AVMediaType type = st->codecpar->codec_type;
+        st->discard = AVDISCARD_ALL;
+    }
+
+    if (!AllStreamsAdded)
+    {
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Not all available streams were added to the track collection"), this);
+    }
+
+    PublishTracks();
+
+    int64_t duration = ic->duration + (ic->duration <= INT64_MAX - 5000 ? 5000 : 0);
+
+    Duration = duration * 10;
+
+    maxFrameDuration = (ic->iformat->flags & AVFMT_TS_DISCONT) ? 10.0 : 3600.0;
+
+    SetRate(0.0f);
+
+    DeferredEvents.Enqueue(EMediaEvent::MediaOpened);
+    //Start the read thread
+
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+    sychronizationType = Settings->SyncType;
+    nativeYUVOutput = Settings->UseNativeYUVFormats;
+    fastYUVConversion = Settings->UseFastYUVConversion;
+    conversionSlices = FMath::Max(Settings->ConversionSlices, 0);
+
+    FFMPEGTaskPool::Get().SetWorkerThreadSettings(Settings->WorkerThreads.GetThreadPriority(), Settings->WorkerThreads.GetAffinityMask());
+
+    readThread = LambdaFunctionRunnable::RunThreaded(TEXT("ReadThread"), [this] {
+        ReadThread();
+    }, Settings->ReadThread.GetThreadPriority(), Settings->ReadThread.GetAffinityMask()); 
+    
+
+}
+
+void FFFMPEGMediaTracks::ReInitialize()
+{
+	/*if (MediaSource != NULL)
+	{
+		TComPtr<IMFMediaSource> lMediaSource = WmfMedia::ResolveMediaSource(nullptr, SourceUrl, false);
+		int32 lTrack = GetSelectedTrack(EMediaTrackType::Video);
+		int32 lFormat = GetTrackFormat(EMediaTrackType::Video, lTrack);
+		Initialize(lMediaSource, SourceUrl);
+		SetTrackFormat(EMediaTrackType::Video, lTrack, lFormat);
+		SelectTrack(EMediaTrackType::Video, lTrack);
+	}*/
+}
+
+void FFFMPEGMediaTracks::Shutdown()
+{
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: Shutting down (context %p)"), this, FormatContext);
+
+	FFFMPEGMediaMemoryBudget::Get().Unregister(this);
+
+    displayRunning = false;
+    /* wakes every pipeline thread, including the read thread */
+    pipelineState.Abort();
+
+    maxFrameDuration = 0.0;
+
+    /* close each stream */
+    if (SelectedAudioTrack >= 0)
+        StreamComponentClose(audioStreamIdx);
+    if (SelectedCaptionTrack >= 0)
+        StreamComponentClose(subtitleStreamIdx);
+    if (SelectedVideoTrack >= 0)
+        StreamComponentClose(videoStreamIdx);
+
+    videoStreamIdx = -1;
+    audioStreamIdx = -1;
+    subtitleStreamIdx = -1;
+    
+    StopDisplayTask();
+    StopAudioRenderTask();
+    
+    if ( readThread != nullptr) {
+        readThread->WaitForCompletion();
+        readThread = nullptr;
+    }
+    if ( audioThread != nullptr) {
+        audioThread->WaitForCompletion();
+        audioThread = nullptr;
+    }
+    if ( videoThread != nullptr) {
+        videoThread->Kill(true);
+        videoThread = nullptr;
+    }
+    if ( subtitleThread != nullptr) {
+        subtitleThread->WaitForCompletion();
+        subtitleThread = nullptr;
+    }
+    
+    
+    
+    
+    imgConverter.Reset();
+    
+    hwaccel_retrieve_data = nullptr;
+    auddec = MakeShareable(new FFMPEGDecoder());
+    viddec = MakeShareable(new FFMPEGDecoder());
+    subdec= MakeShareable(new FFMPEGDecoder());
+   
+
+     /*hw_device_ctx(NULL)
+    , hw_frames_ctx(NULL)
+    , hwaccel_ctx(NULL)
+    , hwAccelPixFmt(AV_PIX_FMT_NONE)*/
+    
+	FScopeLock Lock(&CriticalSection);
+
+    pictq.Destroy();
+    subpq.Destroy();
+    sampq.Destroy();
+
+    audioq.Flush();
+    videoq.Flush();
+    subtitleq.Flush();
+    
+	AudioSamplePool->Reset();
+	VideoSamplePool->Reset();
+
+	SelectedAudioTrack = INDEX_NONE;
+	SelectedCaptionTrack = INDEX_NONE;
+	SelectedMetadataTrack = INDEX_NONE;
+	SelectedVideoTrack = INDEX_NONE;
+
+    frameDropsLate = 0;
+    frameDropsEarly = 0;
+
+	AudioTracks.Empty();
+	MetadataTracks.Empty();
+	CaptionTracks.Empty();
+	VideoTracks.Empty();
+
+	PublishTracks();
+
+	Info.Empty();
+
+	MediaSourceChanged = false;
+	SelectionChanged = false;
+    bPrerolled = false;
+    
+    CurrentState =  EMediaState::Closed;
+
+    currentStreams = 0;
+    totalStreams = 0;
+    frameTimer = 0.0;
+    maxFrameDuration = 0.0;
+
+    /* the buffers still held by samples keep the pool alive until they are released */
+    av_buffer_pool_uninit(&videoBufferPool);
+    videoBufferPoolSize = 0;
+}
+
+void FFFMPEGMediaTracks::SetMaxOutputResolution(const FIntPoint& Resolution) {
+    maxOutputWidth = FMath::Max(0, Resolution.X);
+    maxOutputHeight = FMath::Max(0, Resolution.Y);
+}
+
+FIntPoint FFFMPEGMediaTracks::GetMaxOutputResolution() const {
+    return FIntPoint(maxOutputWidth, maxOutputHeight);
+}
+
+void FFFMPEGMediaTracks::SetOutputLOD(int32 Level) {
+    Level = FMath::Clamp(Level, 0, 8);
+    outputLOD = Level;
+
+    /* a decoder opened with lowres can't output a larger size, it's opened again with the new one */
+    if (Level < videoLowres) {
+        FScopeLock Lock(&CriticalSection);
+        const int32 VideoTrack = SelectedVideoTrack;
+
+        if (VideoTrack != INDEX_NONE) {
+            UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Reopening video track %i for LOD %i"), this, VideoTrack, Level);
+            SelectTrack(EMediaTrackType::Video, INDEX_NONE);
+            SelectTrack(EMediaTrackType::Video, VideoTrack);
+        }
+    }
+}
+
+void FFFMPEGMediaTracks::SetQoS(EFFMPEGMediaQoS QoS) {
+    qosClass = QoS;
+
+    FFMPEGTaskPool& pool = FFMPEGTaskPool::Get();
+    pool.SetPriority(std::atomic_load(&displayTask), GetVideoTaskPriority());
+    pool.SetPriority(std::atomic_load(&convertTask), GetVideoTaskPriority());
+
+    /* the display task polls slowly while hidden */
+    WakeTasks();
+
+    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: QoS class %d"), this, (int32)QoS);
+}
+
+EFFMPEGMediaQoS FFFMPEGMediaTracks::GetQoS() const {
+    return qosClass;
+}
+
+FFMPEGTaskPriority FFFMPEGMediaTracks::GetVideoTaskPriority() const {
+    switch (qosClass.load()) {
+    case EFFMPEGMediaQoS::Hero:
+        return FFMPEG_TASK_HIGH;
+    case EFFMPEGMediaQoS::Normal:
+        return FFMPEG_TASK_NORMAL;
+    default:
+        return FFMPEG_TASK_LOW;
+    }
+}
+
+FFMPEGTaskPriority FFFMPEGMediaTracks::GetAudioTaskPriority() const {
+    /* the audio of the lower classes is still heard, a gap is worse than a late frame whatever the class.
+       A render is a copy into a pooled sample, it can't hold the workers back from the video stages for long */
+    return FFMPEG_TASK_AUDIO;
+}
+
+int32 FFFMPEGMediaTracks::GetOutputLOD() const {
+    return outputLOD;
+}
+
+void FFFMPEGMediaTracks::TickInput(FTimespan DeltaTime, FTimespan Timecode) {
+    TargetTime = Timecode;
+
+    double time = Timecode.GetTotalSeconds();
+    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: TimeCode %.3f"), this, (float)time);
+}
+
+
+/* IMediaSamples interface
+ *****************************************************************************/
+
+bool FFFMPEGMediaTracks::FetchAudio(TRange<FTimespan> TimeRange, TSharedPtr<IMediaAudioSample, ESPMode::ThreadSafe>& OutSample)
+{
+	TSharedPtr<IMediaAudioSample, ESPMode::ThreadSafe> Sample;
+
+    FTimespan timeSpan = TimeRange.Size<FTimespan>();
+
+    double time = timeSpan.GetTotalSeconds();
+    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: TimeCode %.3f"), this, (float)time);
+
+
+	FScopeLock Lock(&sampleQueueMutex);
+
+	if (!AudioSampleQueue.Fetch(TimeRange, Sample))
+	{
+		return false;
+	}
+
+	sampleQueueCond.broadcast();
+
+	OutSample = Sample;
+
+	return true;
+}
+
+
+bool FFFMPEGMediaTracks::FetchCaption(TRange<FTimespan> TimeRange, TSharedPtr<IMediaOverlaySample, ESPMode::ThreadSafe>& OutSample)
+{
+	TSharedPtr<IMediaOverlaySample, ESPMode::ThreadSafe> Sample;
+
+	FScopeLock Lock(&sampleQueueMutex);
+
+	if (!CaptionSampleQueue.Fetch(TimeRange, Sample))
+	{
+		return false;
+	}
+
+	OutSample = Sample;
+
+	return true;
+}
+
+
+bool FFFMPEGMediaTracks::FetchMetadata(TRange<FTimespan> TimeRange, TSharedPtr<IMediaBinarySample, ESPMode::ThreadSafe>& OutSample)
+{
+	TSharedPtr<IMediaBinarySample, ESPMode::ThreadSafe> Sample;
+
+	if (!MetadataSampleQueue.Peek(Sample))
+	{
+		return false;
+	}
+
+    const FTimespan SampleTime = Sample->GetTime().Time;
+
+	if (!TimeRange.Overlaps(TRange<FTimespan>(SampleTime, SampleTime + Sample->GetDuration())))
+	{
+		return false;
+	}
+
+	if (!MetadataSampleQueue.Dequeue(Sample))
+	{
+		return false;
+	}
+
+	OutSample = Sample;
+
+	return true;
+}
+
+
+bool FFFMPEGMediaTracks::FetchVideo(TRange<FTimespan> TimeRange, TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe>& OutSample)
+{
+	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample;
+
+	FScopeLock Lock(&sampleQueueMutex);
+
+	if (!VideoSampleQueue.Fetch(TimeRange, Sample))
+	{
+		return false;
+	}
+
+	sampleQueueCond.broadcast();
+
+	OutSample = Sample;
+
+	return true;
+}
+
+
+void FFFMPEGMediaTracks::FlushSamples()
+{
+	FScopeLock Lock(&sampleQueueMutex);
+
+	AudioSampleQueue.Flush();
+	CaptionSampleQueue.Flush();
+	MetadataSampleQueue.RequestFlush();
+	VideoSampleQueue.Flush();
+
+	sampleQueueCond.broadcast();
+}
+
+bool  FFFMPEGMediaTracks::PeekVideoSampleTime(FMediaTimeStamp& TimeStamp) {
+    FScopeLock Lock(&sampleQueueMutex);
+
+    /* after a seek the samples of the previous sequence would give the player the old time */
+    VideoSampleQueue.RemoveStale();
+
+    TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample;
+    if (!VideoSampleQueue.Peek(Sample))
+    {
+        return false;
+    }
+    TimeStamp = FMediaTimeStamp(Sample->GetTime());
+    return true;
+
+}
+
+
+/* IMediaTracks interface
+ *****************************************************************************/
+
+bool FFFMPEGMediaTracks::GetAudioTrackFormat(int32 TrackIndex, int32 FormatIndex, FMediaAudioTrackFormat& OutFormat) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(EMediaTrackType::Audio, TrackIndex);
+	
+	if (Track == nullptr)
+	{
+		return false; // format not found
+	}
+
+	const FFormat* Format = &Track->Format;
+
+	OutFormat.BitsPerSample = Format->Audio.FrameSize*8;
+	OutFormat.NumChannels = Format->Audio.NumChannels;
+	OutFormat.SampleRate = Format->Audio.SampleRate;
+	OutFormat.TypeName = Format->TypeName;
+
+	return true;
+}
+
+
+int32 FFFMPEGMediaTracks::GetNumTracks(EMediaTrackType TrackType) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const TArray<FTrack>* Tracks = Snapshot->GetTracks(TrackType);
+
+	return (Tracks != nullptr) ? Tracks->Num() : 0;
+}
+
+
+int32 FFFMPEGMediaTracks::GetNumTrackFormats(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+
+	// every track has a single format
+	return (Snapshot->GetTrack(TrackType, TrackIndex) != nullptr) ? 1 : 0;
+}
+
+
+int32 FFFMPEGMediaTracks::GetSelectedTrack(EMediaTrackType TrackType) const
+{
+	return GetTrackSnapshot()->GetSelectedTrack(TrackType);
+}
+
+
+FText FFFMPEGMediaTracks::GetTrackDisplayName(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(TrackType, TrackIndex);
+
+	return (Track != nullptr) ? Track->DisplayName : FText::GetEmpty();
+}
+
+
+int32 FFFMPEGMediaTracks::GetTrackFormat(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(TrackType, TrackIndex);
+
+	return (Track != nullptr) ? 0/*Track->SelectedFormat*/ : INDEX_NONE;
+}
+
+
+
+FString FFFMPEGMediaTracks::GetTrackLanguage(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(TrackType, TrackIndex);
+
+	return (Track != nullptr) ? Track->Language : FString();
+}
+
+
+FString FFFMPEGMediaTracks::GetTrackName(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(TrackType, TrackIndex);
+
+	return (Track != nullptr) ? Track->Name : FString();
+}
+
+
+bool FFFMPEGMediaTracks::GetVideoTrackFormat(int32 TrackIndex, int32 FormatIndex, FMediaVideoTrackFormat& OutFormat) const
+{
+	const FTrackSnapshotRef Snapshot = GetTrackSnapshot();
+	const FTrack* Track = Snapshot->GetTrack(EMediaTrackType::Video, TrackIndex);
+	
+	if (Track == nullptr)
+	{
+		return false; // format not found
+	}
+
+	const FFormat* Format = &Track->Format;
+
+	OutFormat.Dim = Format->Video.OutputDim;
+	OutFormat.FrameRate = Format->Video.FrameRate;
+	OutFormat.FrameRates = TRange<float>(Format->Video.FrameRate);
+	OutFormat.TypeName = Format->TypeName;
+
+	return true;
+}
+
+
+
+bool FFFMPEGMediaTracks::SelectTrack(EMediaTrackType TrackType, int32 TrackIndex)
+{
+	if (!FormatContext)
+	{
+		return false; // not initialized
+	}
+
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Selecting %s track %i"), this, *MediaUtils::TrackTypeToString(TrackType), TrackIndex);
+
+	FScopeLock Lock(&CriticalSection);
+
+	int32* SelectedTrack = nullptr;
+	TArray<FTrack>* Tracks = nullptr;
+
+	switch (TrackType)
+	{
+	case EMediaTrackType::Audio:
+		SelectedTrack = &SelectedAudioTrack;
+		Tracks = &AudioTracks;
+		break;
+
+	case EMediaTrackType::Caption:
+		SelectedTrack = &SelectedCaptionTrack;
+		Tracks = &CaptionTracks;
+		break;
+
+	case EMediaTrackType::Metadata:
+		SelectedTrack = &SelectedMetadataTrack;
+		Tracks = &MetadataTracks;
+		break;
+
+	case EMediaTrackType::Video:
+		SelectedTrack = &SelectedVideoTrack;
+		Tracks = &VideoTracks;
+		break;
+
+	default:
+		return false; // unsupported track type
+	}
+
+	check(SelectedTrack != nullptr);
+	check(Tracks != nullptr);
+
+	if (TrackIndex == *SelectedTrack)
+	{
+		return true; // already selected
+	}
+
+	if ((TrackIndex != INDEX_NONE) && !Tracks->IsValidIndex(TrackIndex))
+	{
+		return false; // invalid track
+	}
+
+	// deselect stream for old track
+	if (*SelectedTrack != INDEX_NONE)
+	{
+        const int StreamIndex = (*Tracks)[*SelectedTrack].StreamIndex;
+        StreamComponentClose(StreamIndex);
+
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Disabled stream %i"), this, StreamIndex);
+			
+		*SelectedTrack = INDEX_NONE;
+		SelectionChanged = true;
+        currentStreams--;
+       
+	}
+
+	// select stream for new track
+	if (TrackIndex != INDEX_NONE)
+	{
+		const int StreamIndex = (*Tracks)[TrackIndex].StreamIndex;
+        const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+        if (TrackType != EMediaTrackType::Audio || (TrackType == EMediaTrackType::Audio && !Settings->DisableAudio) ) {
+            StreamComponentOpen(StreamIndex);
+            currentStreams++;
+            WakeReadThread();
+		    UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Enabled stream %i"), this, StreamIndex);
+        }
+
+		*SelectedTrack = TrackIndex;
+		SelectionChanged = true;
+
+        if (TrackType == EMediaTrackType::Video) {
+            StartDisplayTask();
+        }
+        else if (TrackType == EMediaTrackType::Audio) {
+
+            srcAudio =  (*Tracks)[TrackIndex].Format.Audio;
+            targetAudio = srcAudio;
+
+            audioDiffAvgCoef  = exp(log(0.01) / AUDIO_DIFF_AVG_NB);
+            audioDiffAvgCount = 0;
+        
+            audioDiffThreshold = (double)(targetAudio.HardwareSize) / targetAudio.BytesPerSec;
+
+            StartAudioRenderTask();
+        }
+	}
+
+	PublishTracks();
+
+	return true;
+}
+
+
+bool FFFMPEGMediaTracks::SetTrackFormat(EMediaTrackType TrackType, int32 TrackIndex, int32 FormatIndex)
+{
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Setting format on %s track %i to %i"), this, *MediaUtils::TrackTypeToString(TrackType), TrackIndex, FormatIndex);
+
+	FScopeLock Lock(&CriticalSection);
+
+	TArray<FTrack>* Tracks = nullptr;
+
+	switch (TrackType)
+	{
+	case EMediaTrackType::Audio:
+		Tracks = &AudioTracks;
+		break;
+
+	case EMediaTrackType::Caption:
+		Tracks = &CaptionTracks;
+		break;
+
+	case EMediaTrackType::Metadata:
+		Tracks = &MetadataTracks;
+		break;
+
+	case EMediaTrackType::Video:
+		Tracks = &VideoTracks;
+		break;
+
+	default:
+		return false; // unsupported track type
+	};
+
+	check(Tracks != nullptr);
+
+	if (!Tracks->IsValidIndex(TrackIndex))
+	{
+		return false; // invalid track index
+	}
+
+
+	return true;
+}
+
+
+bool FFFMPEGMediaTracks::SetVideoTrackFrameRate(int32 TrackIndex, int32 FormatIndex, float FrameRate)
+{
+	UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Setting frame rate on format %i of video track %i to %f"), this, FormatIndex, TrackIndex, FrameRate);
+
+	FScopeLock Lock(&CriticalSection);
+
+	const FFormat* Format = GetVideoFormat(TrackIndex, FormatIndex);
+
+	if (Format == nullptr)
+	{
+		return false; // format not found
+	}
+
+	if (Format->Video.FrameRate == FrameRate)
+	{
+		return true; // frame rate already set
+	}
+
+	
+    return false;
+}
+
+
+/* IMediaControls interface
+ *****************************************************************************/
+
+
+bool FFFMPEGMediaTracks::CanControl(EMediaControl Control) const {
+    if (!bPrerolled)
+    {
+        return false;
+    }
+
+    if (Control == EMediaControl::Pause)
+    {
+        return (CurrentState == EMediaState::Playing);
+    }
+
+    if (Control == EMediaControl::Resume)
+    {
+        return (CurrentState != EMediaState::Playing);
+    }
+
+    if ((Control == EMediaControl::Scrub) || (Control == EMediaControl::Seek))
+    {
+        return true;
+    }
+
+    return false;
+}
+
+FTimespan FFFMPEGMediaTracks::GetDuration() const
+{
+    return Duration;
+}
+
+float FFFMPEGMediaTracks::GetRate() const {
+    return CurrentRate;
+}
+EMediaState FFFMPEGMediaTracks::GetState() const {
+    return CurrentState;
+}
+EMediaStatus FFFMPEGMediaTracks::GetStatus() const
+{
+    //TODO: 
+    return EMediaStatus::None;
+}
+
+TRangeSet<float> FFFMPEGMediaTracks::GetSupportedRates(EMediaRateThinning Thinning) const {
+    TRangeSet<float> Result;
+
+    //Result.Add(TRange<float>(PlayerItem.canPlayFastReverse ? -8.0f : -1.0f, 0.0f));
+    //Result.Add(TRange<float>(0.0f, PlayerItem.canPlayFastForward ? 8.0f : 0.0f));
+
+    Result.Add(TRange<float>(0.0f, 1.0f));
+
+    return Result;
+}
+
+FTimespan FFFMPEGMediaTracks::GetTime() const {
+    return CurrentTime;    
+}
+
+bool FFFMPEGMediaTracks::IsLooping() const {
+    return ShouldLoop;
+}
+
+bool FFFMPEGMediaTracks::Seek(const FTimespan& Time) {
+    int64_t pos = Time.GetTicks()/10;
+    StreamSeek(pos, 0, 0);
+    return true;
+}
+
+bool FFFMPEGMediaTracks::SetLooping(bool Looping) {
+    ShouldLoop = Looping;   
+    return true;
+}
+
+bool FFFMPEGMediaTracks::SetRate(float Rate) {
+    CurrentRate = Rate;
+
+
+    if (bPrerolled) {
+        if (FMath::IsNearlyZero(Rate))
+        {
+            CurrentState = EMediaState::Paused;
+            DeferredEvents.Enqueue(EMediaEvent::PlaybackSuspended);
+        }
+        else
+        {
+            CurrentState = EMediaState::Playing;
+            DeferredEvents.Enqueue(EMediaEvent::PlaybackResumed);
+        }
+        UpdatePipelineState();
+        WakeReadThread();
+    }
+
+    return true;
+}
+
+
+/* FFFMPEGMediaTracks implementation
+ *****************************************************************************/
+
+bool FFFMPEGMediaTracks::AddStreamToTracks(uint32 StreamIndex, bool IsVideoDevice, const FMediaPlayerTrackOptions& TrackOptions, FString& OutInfo)
+{
+	OutInfo += FString::Printf(TEXT("Stream %i\n"), StreamIndex);
+
+
+    AVStream* StreamDescriptor = FormatContext->streams[StreamIndex];
+    AVCodecParameters* CodecParams = StreamDescriptor->codecpar;
+    AVMediaType MediaType = CodecParams->codec_type;
+    
+    if ( MediaType != AVMEDIA_TYPE_VIDEO && MediaType != AVMEDIA_TYPE_AUDIO && MediaType != AVMEDIA_TYPE_SUBTITLE) {
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks %p: Unsupported major type %s of stream %i"), this,av_get_media_type_string(MediaType), StreamIndex);
+        OutInfo += TEXT("\tUnsupported stream type\n");
+
+        return false;
+    }
+
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+   if ( Settings->DisableAudio && MediaType == AVMEDIA_TYPE_AUDIO ) {
+       return false;
+   }
+
+	// create & add track
+	FTrack* Track = nullptr;
+	int32 TrackIndex = INDEX_NONE;
+	int32* SelectedTrack = nullptr;
+
+	if (MediaType == AVMEDIA_TYPE_AUDIO)
+	{
+		SelectedTrack = &SelectedAudioTrack;
+		TrackIndex = AudioTracks.AddDefaulted();
+		Track = &AudioTracks[TrackIndex];
+	}
+	else if (MediaType == AVMEDIA_TYPE_SUBTITLE)
+	{
+		SelectedTrack = &SelectedCaptionTrack;
+		TrackIndex = CaptionTracks.AddDefaulted();
+		Track = &CaptionTracks[TrackIndex];
+	}
+	else if (MediaType == AVMEDIA_TYPE_VIDEO)
+	{
+		SelectedTrack = &SelectedVideoTrack;
+		TrackIndex = VideoTracks.AddDefaulted();
+		Track = &VideoTracks[TrackIndex];
+	}
+
+	check(Track != nullptr);
+	check(TrackIndex != INDEX_NONE);
+	check(SelectedTrack != nullptr);
+    
+   
+
+    const FString TypeName =  avcodec_get_name(CodecParams->codec_id);
+    OutInfo += FString::Printf(TEXT("\t\tCodec: %s\n"), *TypeName);
+
+    if ( FormatContext->metadata ) {
+        AVDictionaryEntry *t = av_dict_get(FormatContext->metadata, "language", NULL, 0);
+        if ( t ) {
+            Track->Language = t->value;    
+        } 
+        
+    }
+
+    if (MediaType == AVMEDIA_TYPE_AUDIO)
+    {
+        int samples = FFMAX(AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(CodecParams->sample_rate / AUDIO_MAX_CALLBACKS_PER_SEC));
+
+        Track->Format = { 
+            MediaType,
+            CodecParams->codec_id,
+            TypeName, 
+            {
+                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, 1, AV_SAMPLE_FMT_S16, 1),
+                (uint32)CodecParams->channels,
+                (uint32)CodecParams->sample_rate,
+                CodecParams->channel_layout,
+                AV_SAMPLE_FMT_S16,
+                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, CodecParams->sample_rate,  AV_SAMPLE_FMT_S16, 1),
+                (uint32)av_samples_get_buffer_size(NULL, CodecParams->channels, samples, AV_SAMPLE_FMT_S16, 1)
+            }, 
+            {0} 
+        };
+
+        OutInfo += FString::Printf(TEXT("\t\tChannels: %i\n"), Track->Format.Audio.NumChannels);
+        OutInfo += FString::Printf(TEXT("\t\tSample Rate: %i Hz\n"),  Track->Format.Audio.SampleRate);
+        OutInfo += FString::Printf(TEXT("\t\tBits Per Sample: %i\n"),  Track->Format.Audio.FrameSize * 8);
+
+    } else if ( MediaType == AVMEDIA_TYPE_VIDEO) {
+              
+        float fps = av_q2d(StreamDescriptor->r_frame_rate);
+        if (fps < 0.000025) {
+            fps = av_q2d(StreamDescriptor->avg_frame_rate);
+        }
+
+     
+
+        OutInfo += FString::Printf(TEXT("\t\tFrame Rate: %g fps\n"), fps);
+
+        int line_sizes[4] = {0};
+        av_image_fill_linesizes(line_sizes, (AVPixelFormat)CodecParams->format, CodecParams->width);
+
+        FIntPoint OutputDim = {CodecParams->width, CodecParams->height};
+
+        OutInfo += FString::Printf(TEXT("\t\tDimensions: %i x %i\n"), OutputDim.X, OutputDim.Y);
+
+
+        Track->Format = {
+            MediaType,
+            CodecParams->codec_id,
+            TypeName,
+            {
+               0
+            },
+            {
+                0
+            }
+        };
+
+        Track->Format.Video.BitRate = CodecParams->bit_rate;
+        Track->Format.Video.OutputDim = OutputDim;
+        Track->Format.Video.FrameRate = fps;
+        Track->Format.Video.LineSize[0] = line_sizes[0];
+        Track->Format.Video.LineSize[1] = line_sizes[1];
+        Track->Format.Video.LineSize[2] = line_sizes[2];
+        Track->Format.Video.LineSize[3] = line_sizes[3];
+
+    } else {
+        Track->Format = {
+            MediaType,
+            CodecParams->codec_id,
+            TypeName,
+            {
+               0
+            },
+            {
+               0
+            }
+        };
+    }
+    
+
+	Track->DisplayName = (Track->Name.IsEmpty())
+		? FText::Format(LOCTEXT("UnnamedStreamFormat", "Unnamed Track (Stream {0})"), FText::AsNumber((uint32)StreamIndex))
+		: FText::FromString(Track->Name);
+
+	
+	Track->StreamIndex = StreamIndex;
+    
+    if (MediaType == AVMEDIA_TYPE_SUBTITLE && TrackOptions.Caption == INDEX_NONE) {
+        return false;
+    }
+
+	return true;
+}
+
+
+
+
+const TArray<FFFMPEGMediaTracks::FTrack>* FFFMPEGMediaTracks::FTrackSnapshot::GetTracks(EMediaTrackType TrackType) const
+{
+	switch (TrackType)
+	{
+	case EMediaTrackType::Audio:
+		return &AudioTracks;
+
+	case EMediaTrackType::Metadata:
+		return &MetadataTracks;
+
+	case EMediaTrackType::Caption:
+		return &CaptionTracks;
+
+	case EMediaTrackType::Video:
+		return &VideoTracks;
+
+	default:
+		break; // unsupported track type
+	}
+
+	return nullptr;
+}
+
+
+const FFFMPEGMediaTracks::FTrack* FFFMPEGMediaTracks::FTrackSnapshot::GetTrack(EMediaTrackType TrackType, int32 TrackIndex) const
+{
+	const TArray<FTrack>* Tracks = GetTracks(TrackType);
+
+	if ((Tracks != nullptr) && Tracks->IsValidIndex(TrackIndex))
+	{
+		return &(*Tracks)[TrackIndex];
+	}
+
+	return nullptr;
+}
+
+
+int32 FFFMPEGMediaTracks::FTrackSnapshot::GetSelectedTrack(EMediaTrackType TrackType) const
+{
+	switch (TrackType)
+	{
+	case EMediaTrackType::Audio:
+		return SelectedAudioTrack;
+
+	case EMediaTrackType::Caption:
+		return SelectedCaptionTrack;
+
+	case EMediaTrackType::Metadata:
+		return SelectedMetadataTrack;
+
+	case EMediaTrackType::Video:
+		return SelectedVideoTrack;
+
+	default:
+		break; // unsupported track type
+	}
+
+	return INDEX_NONE;
+}
+
+
+FFFMPEGMediaTracks::FTrackSnapshotRef FFFMPEGMediaTracks::GetTrackSnapshot() const
+{
+	FScopeLock Lock(&TrackSnapshotCriticalSection);
+
+	return TrackSnapshot;
+}
+
+
+void FFFMPEGMediaTracks::PublishTracks()
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const TSharedRef<FTrackSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FTrackSnapshot, ESPMode::ThreadSafe>();
+
+	Snapshot->AudioTracks = AudioTracks;
+	Snapshot->CaptionTracks = CaptionTracks;
+	Snapshot->MetadataTracks = MetadataTracks;
+	Snapshot->VideoTracks = VideoTracks;
+	Snapshot->SelectedAudioTrack = SelectedAudioTrack;
+	Snapshot->SelectedCaptionTrack = SelectedCaptionTrack;
+	Snapshot->SelectedMetadataTrack = SelectedMetadataTrack;
+	Snapshot->SelectedVideoTrack = SelectedVideoTrack;
+
+	// readers holding the previous snapshot keep it alive until they are done
+	FScopeLock SnapshotLock(&TrackSnapshotCriticalSection);
+	TrackSnapshot = Snapshot;
+}
+
+
+const FFFMPEGMediaTracks::FFormat* FFFMPEGMediaTracks::GetVideoFormat(int32 TrackIndex, int32 FormatIndex) const
+{
+	if (VideoTracks.IsValidIndex(TrackIndex))
+	{
+		const FTrack& Track = VideoTracks[TrackIndex];
+
+		
+		return &Track.Format;
+		
+	}
+
+	return nullptr;
+}
+
+
+/************************************************************************/
+/* FFMPEGMediaTracks Implementation                                    */
+/************************************************************************/
+
+bool FFFMPEGMediaTracks::isHwAccel(const AVCodec* codec) {
+    const AVCodecHWConfig *config;
+    enum AVHWDeviceType type;
+
+     if (!avcodec_get_hw_config(codec, 0)) {
+         return false;
+     }
+     bool ret = false;
+     for (int i = 0; ; i++) {
+         config = avcodec_get_hw_config(codec, i);
+         if (!config)
+             break;
+
+         type = config->device_type;
+
+         if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
+             continue;
+
+        
+         const char* type_name = av_hwdevice_get_type_name(type);
+         UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Format found: %s"), UTF8_TO_TCHAR(type_name) );
+         ret = true;
+     }
+
+     return ret;
+}
+
+TArray<const AVCodec*>  FFFMPEGMediaTracks::FindDecoders(int codecId, bool hwaccell) {
+   
+    TArray<const AVCodec*> codecs;
+    TArray<const AVCodec*> candidates;
+
+    if (FFFMPEGMediaDecoderCache::Get().FindDecoders(codecId, hwaccell, codecs)) {
+        return codecs;
+    }
+
+    void* iter = NULL;
+    const AVCodec* codec = av_codec_iterate(&iter);
+    
+    while (codec) {
+        if (codec->id == codecId && av_codec_is_decoder(codec)) {
+            candidates.Add(codec);
+        }
+        codec = av_codec_iterate(&iter);
+    }
+
+    if (hwaccell) {
+
+        TArray<const AVCodec*> tmp;
+
+        candidates.Sort([](const AVCodec a, const AVCodec b) {
+            FString aname = a.name;
+            FString bname = b.name;
+            return aname < bname;
+        });
+
+        for ( int i = 0; i < candidates.Num(); i++) {
+            FString name = candidates[i]->name;
+            if ( name.Contains(TEXT("cuda"))  || name.Contains(TEXT("cuvid"))) {
+                tmp.Add((candidates[i]));
+                candidates.RemoveAt(i);
+                i--;
+            }
+        }
+        
+
+        tmp.Insert(candidates, tmp.Num()); 
+       
+        for (const AVCodec* c : tmp) {
+            if (isHwAccel(c)) {
+                codecs.Add(c);
+            }
+        }
+    }
+
+    if (candidates.Num() > 0) {
+        if (!hwaccell) {
+            for (const AVCodec* c : candidates) {
+                if (!isHwAccel(c)) {
+                    codecs.Add(c);
+                }
+            }
+        }
+    }
+
+    FFFMPEGMediaDecoderCache::Get().AddDecoders(codecId, hwaccell, codecs);
+    return codecs;
+}
+
+bool FFFMPEGMediaTracks::CreateHardwareDevice(AVCodecContext* avctx, const AVCodec* hwCodec, enum AVHWDeviceType type) {
+    AVBufferRef *device_ref = NULL;
+    int ret = av_hwdevice_ctx_create(&device_ref, type, NULL, NULL, 0);
+    FFFMPEGMediaDecoderCache::Get().SetDeviceTypeResult(type, ret);
+
+    if (ret < 0) {
+        hw_device_ctx = NULL;
+        hwAccelDeviceType = AV_HWDEVICE_TYPE_NONE;
+        hwaccel_retrieve_data = nullptr;
+        return false;
+    }
+
+    hw_device_ctx = device_ref;
+    avctx->hw_device_ctx = av_buffer_ref(device_ref);
+
+    const char* type_name = av_hwdevice_get_type_name(type);
+    UE_LOG(LogFFMPEGMedia, Display, TEXT("Using hardware context type: %s"), UTF8_TO_TCHAR(type_name));
+
+    hwAccelDeviceType = type;
+    hwaccel_retrieve_data = HWAccelRetrieveDataCallback;
+
+    avctx->opaque = this;
+    avctx->get_format = GetFormatCallback;
+    avctx->thread_safe_callbacks = 1;
+    return true;
+}
+
+AVHWDeviceType FFFMPEGMediaTracks::FindBetterDeviceType(const AVCodec* codec, int& lastSelection) {
+    const AVCodecHWConfig *config;
+    enum AVHWDeviceType type;
+    TArray<enum AVHWDeviceType> availableTypes;
+    for (int i = 0; ; i++) {
+        config = avcodec_get_hw_config(codec, i);
+        if (!config)
+            break;
+
+        type = config->device_type;
+
+        if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
+            continue;
+
+        availableTypes.Add(type);
+    }
+
+    if (availableTypes.Num() == 0 ) {
+        lastSelection = -1;
+        return AV_HWDEVICE_TYPE_NONE;
+    }
+
+
+    const enum AVHWDeviceType* possibleType =  availableTypes.FindByKey(AV_HWDEVICE_TYPE_CUDA);
+    if ( possibleType && (lastSelection < 1) ) {
+        lastSelection = 1;
+        return *possibleType;
+    }
+
+    possibleType = availableTypes.FindByKey(AV_HWDEVICE_TYPE_VIDEOTOOLBOX);
+    if (possibleType && (lastSelection < 2)) {
+        lastSelection = 2;
+        return *possibleType;
+    }
+
+    possibleType = availableTypes.FindByKey(AV_HWDEVICE_TYPE_OPENCL);
+    if (possibleType && (lastSelection < 3)) {
+        lastSelection = 3;
+        return *possibleType;
+    }
+
+    if ( lastSelection < 4) lastSelection = 4;
+    else lastSelection++;
+
+    if ( (lastSelection - 4) < availableTypes.Num() ) {
+        return availableTypes[lastSelection - 4];
+    }
+
+    lastSelection = -1;
+    return AV_HWDEVICE_TYPE_NONE;
+}
+
+
+double FFFMPEGMediaTracks::GetStreamBufferLevel(const AVStream *st, int stream_id, const FFMPEGPacketQueue *queue, const FBufferWatermarks& watermarks) const {
+    if (stream_id < 0 || !st ||
+        watermarks.High <= 0.0 ||
+        queue->IsAbortRequest() ||
+        queue->IsFull() ||
+        (st->disposition & AV_DISPOSITION_ATTACHED_PIC))
+        return INFINITY;
+
+    int64_t duration = queue->GetDuration();
+    if (duration <= 0) {
+        /* the packets don't carry a duration, map the packet count onto the watermarks */
+        return watermarks.High * queue->GetNumPackets() / FFMAX(minQueuedPackets, 1);
+    }
+
+    return av_q2d(st->time_base) * duration;
+}
+
+double FFFMPEGMediaTracks::GetBufferLevel(double *high_watermark) const {
+    /* subtitles are sparse, by default they have no high watermark so a stream without
+       an event for minutes doesn't keep the reader going until the byte cap */
+    const double levels[] = {
+        GetStreamBufferLevel(videoStream, videoStreamIdx, &videoq, videoWatermarks),
+        GetStreamBufferLevel(audioStream, audioStreamIdx, &audioq, audioWatermarks),
+        GetStreamBufferLevel(subTitleStream, subtitleStreamIdx, &subtitleq, subtitleWatermarks)
+    };
+    const FBufferWatermarks* watermarks[] = { &videoWatermarks, &audioWatermarks, &subtitleWatermarks };
+
+    int lowest = 0;
+    for (int i = 1; i < 3; i++) {
+        if (levels[i] < levels[lowest])
+            lowest = i;
+    }
+
+    if (high_watermark)
+        *high_watermark = watermarks[lowest]->High;
+    return levels[lowest];
+}
+
+int FFFMPEGMediaTracks::GetPacketQueueCapacity(const AVStream *st) const {
+    double rate = 0.0;
+
+    switch (st->codecpar->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        rate = av_q2d(av_guess_frame_rate(FormatContext, (AVStream*)st, NULL));
+        if (rate <= 0.0 || rate > 1000.0)
+            rate = 60.0;
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        /* most codecs don't set the frame size before decoding, 1024 samples is the common one */
+        rate = st->codecpar->sample_rate > 0 ? (double)st->codecpar->sample_rate / (st->codecpar->frame_size > 0 ? st->codecpar->frame_size : 1024) : 50.0;
+        break;
+    default:
+        /* sparse, a few events a second for the densest bitmap subtitles */
+        rate = 10.0;
+        break;
+    }
+
+    /* the reader goes on until every stream reached its own high watermark, this one can get up to the
+       largest of them. The other streams can also lag behind in the file, leave room for twice that.
+       A full ring stops the reading of the stream, like the byte cap */
+    double high = FFMAX(videoWatermarks.High, FFMAX(audioWatermarks.High, subtitleWatermarks.High));
+    int packets = (int)ceil(2.0 * high * rate);
+    return FFMAX(packets, 2 * minQueuedPackets);
+}
+
+void FFFMPEGMediaTracks::ApplyFrameBudget(FFMPEGFrameQueue& fq, int64 frame_bytes, int max_depth, const TCHAR* name, bool& over_budget) {
+    if (frame_bytes <= 0)
+        return;
+
+    /* the share covers every queue of the player, this one gets what the others leave */
+    int64 packet_bytes = 0;
+    int64 frame_usage = 0;
+    GetMemoryUsage(packet_bytes, frame_usage);
+
+    int64 own_bytes = (int64)(fq.GetNumRemaining() + fq.GetIndexShown()) * frame_bytes;
+    int64 available = FFMAX(frameBudget.load() - FFMAX(frame_usage - own_bytes, (int64)0), (int64)0);
+    int wanted = (int)FFMIN(available / frame_bytes, (int64)max_depth);
+    int depth = fq.SetDepth(wanted);
+
+    /* the queue can't go below its minimum depth, it's then over the budget */
+    if (depth > wanted) {
+        if (!over_budget) {
+            over_budget = true;
+            frameBudgetOverruns++;
+            UE_LOG(LogFFMPEGMedia, Warning, TEXT("Tracks: %p: The %s frame queue needs %d frames, %.1f MB over its memory budget"), this,
+                name, depth, ((int64)depth * frame_bytes - available) / (1024.0 * 1024.0));
+        }
+    } else if (over_budget) {
+        over_budget = false;
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Tracks: %p: The %s frame queue is back within its memory budget"), this, name);
+    }
+}
+
+bool FFFMPEGMediaTracks::NeedsMorePackets() {
+    if (audioq.GetSize() + videoq.GetSize() + subtitleq.GetSize() > FFMIN((int64)maxQueueSize, packetBudget.load())) {
+        readingAhead = false;
+        return false;
+    }
+
+    /* read in bursts, from the first stream under its low watermark until every stream reached its high one */
+    const double levels[] = {
+        GetStreamBufferLevel(videoStream, videoStreamIdx, &videoq, videoWatermarks),
+        GetStreamBufferLevel(audioStream, audioStreamIdx, &audioq, audioWatermarks),
+        GetStreamBufferLevel(subTitleStream, subtitleStreamIdx, &subtitleq, subtitleWatermarks)
+    };
+    const FBufferWatermarks* watermarks[] = { &videoWatermarks, &audioWatermarks, &subtitleWatermarks };
+
+    bool below_low = false;
+    bool below_high = false;
+    for (int i = 0; i < 3; i++) {
+        below_low |= levels[i] < watermarks[i]->Low;
+        below_high |= levels[i] < watermarks[i]->High;
+    }
+
+    if (readingAhead) {
+        if (!below_high)
+            readingAhead = false;
+    } else if (below_low) {
+        readingAhead = true;
+    }
+
+    return readingAhead;
+}
+
+
+enum AVPixelFormat FFFMPEGMediaTracks::GetFormatCallback(AVCodecContext *s, const enum AVPixelFormat *pix_fmts) {
+    const enum AVPixelFormat *p;
+    //int ret;
+    FFFMPEGMediaTracks* tracks = (FFFMPEGMediaTracks*)s->opaque;
+    for (p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(*p);
+        const AVCodecHWConfig  *config = NULL;
+        int i;
+
+        if (!(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            break;
+
+        for (i = 0;; i++) {
+            config = avcodec_get_hw_config(s->codec, i);
+            if (!config)
+                break;
+            if (!(config->methods &
+                AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
+                continue;
+            if (config->pix_fmt == *p)
+                break;
+        }
+
+        if (config) {
+            if (config->device_type != tracks->hwAccelDeviceType) {
+                // Different hwaccel offered, ignore.
+                continue;
+            }
+
+        } else {
+            continue;
+           
+        }
+
+      
+        tracks->hwAccelPixFmt = *p;
+        break;
+
+    }
+
+    return *p;
+}
+
+
+int FFFMPEGMediaTracks::StreamComponentOpen(int stream_index) {
+
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+    AVCodecContext *avctx;
+    const AVCodec *codec;
+    const char *forced_codec_name = NULL;
+    AVDictionary *opts = NULL;
+
+    AVDictionaryEntry *t = NULL;
+    int ret = 0;
+    
+    int stream_lowres = 0;
+
+    if (stream_index < 0 || stream_index >= (int)FormatContext->nb_streams)
+        return -1;
+
+    avctx = avcodec_alloc_context3(NULL);
+
+    ret = avcodec_parameters_to_context(avctx, FormatContext->streams[stream_index]->codecpar);
+    if (ret < 0) {
+        avcodec_free_context(&avctx);
+        return ret;
+    }
+
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+        stream_lowres = outputLOD;
+    avctx->pkt_timebase = FormatContext->streams[stream_index]->time_base;
+    
+#ifdef UE_BUILD_DEBUG
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ) {
+        UE_LOG(LogFFMPEGMedia, Display, TEXT("Video Codec: %s "), UTF8_TO_TCHAR(avcodec_get_name( avctx->codec_id)));
+    }
+    
+    if (avctx->codec_type == AVMEDIA_TYPE_AUDIO ) {
+        UE_LOG(LogFFMPEGMedia, Display, TEXT("Audio Codec: %s "), UTF8_TO_TCHAR(avcodec_get_name( avctx->codec_id)));
+    }
+#endif
+   
+
+    if (Settings->UseHardwareAcceleratedCodecs && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        FFFMPEGMediaDecoderCache& decoderCache = FFFMPEGMediaDecoderCache::Get();
+        const FFFMPEGMediaDecoderKey decoderKey = FFFMPEGMediaDecoderKey::FromParameters(FormatContext->streams[stream_index]->codecpar);
+        const AVCodec* cachedCodec = NULL;
+        enum AVHWDeviceType cachedType = AV_HWDEVICE_TYPE_NONE;
+        codec = NULL;
+
+        /* a stream probed by a previous open only needs the device of this player */
+        bool probed = decoderCache.FindHardwareDecoder(decoderKey, cachedCodec, cachedType);
+        if (probed && cachedCodec) {
+            if (CreateHardwareDevice(avctx, cachedCodec, cachedType)) {
+                codec = cachedCodec;
+            } else {
+                UE_LOG(LogFFMPEGMedia, Warning, TEXT("Coudn't create the %s device used before, probing again"), UTF8_TO_TCHAR(av_hwdevice_get_type_name(cachedType)));
+                decoderCache.RemoveHardwareDecoder(decoderKey);
+                probed = false;
+            }
+        }
+
+        if (!probed) {
+            TArray<const AVCodec*> hwCodecs = FindDecoders(avctx->codec_id, true);
+            /* a device that failed for a reason that can go away, the stream is probed again later */
+            bool retry = false;
+
+            for (const AVCodec* hwCodec : hwCodecs) {
+                AVCodecContext* avctx2 = avcodec_alloc_context3(NULL);
+                avcodec_parameters_to_context(avctx2, FormatContext->streams[stream_index]->codecpar);
+                if (avcodec_open2(avctx2, hwCodec, NULL) >= 0) {
+                    int lastSelection = 0;
+                    while (lastSelection >= 0) {
+                        enum AVHWDeviceType type = FindBetterDeviceType(hwCodec, lastSelection);
+                        if (type == AV_HWDEVICE_TYPE_NONE) {
+                            continue;
+                        }
+                        if (decoderCache.IsDeviceTypeUnusable(type)) {
+                            retry |= !decoderCache.IsDeviceTypeUnsupported(type);
+                            continue;
+                        }
+                        if (CreateHardwareDevice(avctx, hwCodec, type)) {
+                            codec = hwCodec;
+                            break;
+                        }
+                        retry |= !decoderCache.IsDeviceTypeUnsupported(type);
+                    }
+                }
+                avcodec_free_context(&avctx2);
+                if (codec) break;
+            }
+
+            decoderCache.SetHardwareDecoder(decoderKey, codec, hwAccelDeviceType, retry);
+        }
+
+        if (!codec) {
+            codec = avcodec_find_decoder(avctx->codec_id);
+        }
+    } else {
+        codec = avcodec_find_decoder(avctx->codec_id);
+    }
+
+    if ( !codec) {
+        const AVCodecDescriptor * desc = avcodec_descriptor_get(avctx->codec_id);
+        UE_LOG(LogFFMPEGMedia, Error, TEXT("coudn't find a decoder for %s"), UTF8_TO_TCHAR(desc->long_name));
+        return -1;
+    }
+    
+    
+    UE_LOG(LogFFMPEGMedia, Display, TEXT("Using codec: %s - %d"), UTF8_TO_TCHAR(codec->name), codec->id);
+    
+
+    avctx->codec_id = codec->id;
+    if (stream_lowres > codec->max_lowres) {
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("The maximum value for lowres supported by the decoder is %d, the frames will be scaled down"), codec->max_lowres);
+        stream_lowres = codec->max_lowres;
+    }
+     avctx->lowres = stream_lowres;
+
+    if (Settings->SpeedUpTricks)
+        avctx->flags2 |= AV_CODEC_FLAG2_FAST;
+
+
+    int max_threads = 0;
+    if ( avctx->codec_type == AVMEDIA_TYPE_VIDEO ) max_threads = Settings->VideoThreads;
+    if ( avctx->codec_type == AVMEDIA_TYPE_AUDIO ) max_threads = Settings->AudioThreads;
+
+    FFMPEGDecoderThreading threading = FFMPEGDecoderThreadingPolicy::Choose(codec, avctx, realtime || Settings->ZeroLatencyStreaming, max_threads);
+    avctx->thread_type = threading.thread_type;
+    avctx->thread_count = threading.thread_count;
+
+    /* avcodec_open2 consumes the options it uses, they're set again for every open */
+    auto set_opts = [&]() {
+        av_dict_free(&opts);
+        av_dict_set_int(&opts, "threads", threading.thread_count, 0);
+
+        if (stream_lowres)
+            av_dict_set_int(&opts, "lowres", stream_lowres, 0);
+        if (avctx->codec_type == AVMEDIA_TYPE_VIDEO || avctx->codec_type == AVMEDIA_TYPE_AUDIO)
+            av_dict_set(&opts, "refcounted_frames", "1", 0);
+
+        if (Settings->ZeroLatencyStreaming && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+            av_dict_set(&opts, "tune", "zerolatency", 0);
+        }
+    };
+    set_opts();
+
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        videoAllocator.Init(avctx, Settings->UseHugePages);
+        avctx->opaque = this;
+        avctx->get_buffer2 = GetBufferCallback;
+    }
+
+    if ((ret = avcodec_open2(avctx, codec, &opts)) < 0) {
+        if (Settings->UseHardwareAcceleratedCodecs && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+            UE_LOG(LogFFMPEGMedia, Warning, TEXT("Coudn't open the hwaccel codec, trying a different one"));
+            /* the software decoder doesn't use the device, and the threading policy
+               would keep it on a single thread while it's set */
+            av_buffer_unref(&avctx->hw_device_ctx);
+            av_buffer_unref(&hw_device_ctx);
+            avctx->get_format = avcodec_default_get_format;
+            hwaccel_retrieve_data = nullptr;
+            hwAccelDeviceType = AV_HWDEVICE_TYPE_NONE;
+            hwAccelPixFmt = AV_PIX_FMT_NONE;
+
+            codec = avcodec_find_decoder(avctx->codec_id);
+            avctx->codec_id = codec->id;
+            if (stream_lowres > codec->max_lowres) {
+                UE_LOG(LogFFMPEGMedia, Verbose, TEXT("The maximum value for lowres supported by the decoder is %d, the frames will be scaled down"),  codec->max_lowres);
+                stream_lowres =  codec->max_lowres;
+            }
+            avctx->lowres= stream_lowres;
+            threading = FFMPEGDecoderThreadingPolicy::Choose(codec, avctx, realtime || Settings->ZeroLatencyStreaming, max_threads);
+            avctx->thread_type = threading.thread_type;
+            avctx->thread_count = threading.thread_count;
+            set_opts();
+
+            if ((ret = avcodec_open2(avctx, codec, &opts)) < 0) {
+                av_dict_free(&opts);
+                avcodec_free_context(&avctx);
+                return ret;
+            }
+
+        }
+        else {
+            av_dict_free(&opts);
+            avcodec_free_context(&avctx);
+            return ret;
+        }
+    }
+  
+    eof = 0;
+    FormatContext->streams[stream_index]->discard = AVDISCARD_DEFAULT;
+
+    switch (avctx->codec_type) {
+    case AVMEDIA_TYPE_AUDIO:
+        audioStream = FormatContext->streams[stream_index];
+        audioStreamIdx = stream_index;
+        audioq.SetCapacity(GetPacketQueueCapacity(audioStream));
+        auddec->Init(avctx, &audioq, [this] { WakeReadThread(); });
+        if ((FormatContext->iformat->flags & (AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH | AVFMT_NO_BYTE_SEEK)) && !FormatContext->iformat->read_seek) {
+            auddec->SetTime(audioStream->start_time, audioStream->time_base);
+        }
+        if ((ret = auddec->Start([this](void * data) {return AudioThread();}, NULL, TEXT("AudioDecoder"),
+            Settings->AudioDecodeThread.GetThreadPriority(), Settings->AudioDecodeThread.GetAffinityMask())) < 0) {
+            av_dict_free(&opts);
+            return ret;
+        }
+        break;
+    case AVMEDIA_TYPE_VIDEO:
+        videoStream = FormatContext->streams[stream_index];
+        videoStreamIdx = stream_index;
+        videoLowres = avctx->lowres;
+        videoq.SetCapacity(GetPacketQueueCapacity(videoStream));
+        viddec->Init(avctx, &videoq, [this] { WakeReadThread(); });
+        viddec->SetPacketCallback([this] { ApplyVideoQoS(); });
+        if ((ret = viddec->Start([this](void * data) {return VideoThread();}, NULL, TEXT("VideoDecoder"),
+            Settings->VideoDecodeThread.GetThreadPriority(), Settings->VideoDecodeThread.GetAffinityMask())) < 0) {
+            av_dict_free(&opts);
+            return ret;
+        }
+        /* what the codec accepted, it falls back to fewer threads or no threading at all */
+        videoThreadType = avctx->active_thread_type;
+        videoThreadReason = threading.reason;
+        if (videoThreadCount.exchange(FFMAX(avctx->thread_count, 1)) == 0)
+            FFMPEGDecoderThreadingPolicy::AddVideoDecoder();
+        UE_LOG(LogFFMPEGMedia, Verbose, TEXT("Video decoder threading: %s x%d (%s)"),
+            UTF8_TO_TCHAR(FFMPEGDecoderThreadingPolicy::GetThreadTypeName(avctx->active_thread_type)), avctx->thread_count, UTF8_TO_TCHAR(threading.reason));
+        StartConvertTask();
+        queueAttachmentsReq = true;
+        video_ctx = avctx;
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        subTitleStream = FormatContext->streams[stream_index];
+        subtitleStreamIdx = stream_index;
+        subtitleq.SetCapacity(GetPacketQueueCapacity(subTitleStream));
+        subdec->Init(avctx, &subtitleq, [this] { WakeReadThread(); });
+        if ((ret = subdec->Start([this](void * data) {return SubtitleThread();}, NULL, TEXT("SubtitleDecoder"),
+            Settings->AudioDecodeThread.GetThreadPriority(), Settings->AudioDecodeThread.GetAffinityMask())) < 0) {
+            av_dict_free(&opts);
+            return ret;
+        }
+        break;
+    default:
+        break;
+    }
+
+    av_dict_free(&opts);
+
+    return ret;
+
+}
+void FFFMPEGMediaTracks::StreamComponentClose(int stream_index) {
+    AVCodecParameters *codecpar;
+
+    if (stream_index < 0 || stream_index >= (int)FormatContext->nb_streams)
+        return;
+    codecpar = FormatContext->streams[stream_index]->codecpar;
+
+    switch (codecpar->codec_type) {
+    case AVMEDIA_TYPE_AUDIO:
+        auddec->Abort(&sampq);
+        StopAudioRenderTask();
+    
+        auddec->Destroy();
+        swr_free(&swrContext);
+        swrContext = NULL;
+        av_freep(&audioBuf1);
+        audioBuf1Size = 0;
+        audioBuf = NULL;
+        audioClock = 0;
+        break;
+    case AVMEDIA_TYPE_VIDEO:
+        viddec->Abort(&pictq);
+        StopConvertTask();
+        StopDisplayTask();
+
+        video_ctx = NULL;
+        videoLowres = 0;
+        viddec->Destroy();
+        videoAllocator.Reset();
+        SelectedVideoTrack = -1;
+
+        if (videoThreadCount.exchange(0) > 0)
+            FFMPEGDecoderThreadingPolicy::RemoveVideoDecoder();
+
+        if ( hw_device_ctx ) {
+            av_buffer_unref(&hw_device_ctx); 
+        }
+       
+        hwaccel_retrieve_data = nullptr;
+        hwAccelPixFmt = AV_PIX_FMT_NONE;
+       
+
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        subdec->Abort(&subpq);
+        subdec->Destroy();
+        break;
+    default:
+        break;
+    }
+
+    FormatContext->streams[stream_index]->discard = AVDISCARD_ALL;
+    switch (codecpar->codec_type) {
+    case AVMEDIA_TYPE_AUDIO:
+        audioStream = NULL;
+        SelectedAudioTrack = -1;
+        break;
+    case AVMEDIA_TYPE_VIDEO:
+        videoStream = NULL;
+        SelectedVideoTrack = -1;
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        subTitleStream = NULL;
+        SelectedCaptionTrack = -1;
+        break;
+    default:
+        break;
+    }
+}
+
+void FFFMPEGMediaTracks::StepToNextFrame() {
+    if (CurrentState == EMediaState::Paused) {
+        SetRate(1.0f);
+        StreamTogglePause();
+    }
+
+    step = true;
+}
+
+void FFFMPEGMediaTracks::StreamTogglePause() {
+    if (CurrentState == EMediaState::Paused) {
+        frameTimer += av_gettime_relative() / 1000000.0 - vidclk.GetLastUpdated();
+        if (readPauseReturn != AVERROR(ENOSYS)) {
+            vidclk.SetPaused(false);
+        }
+        vidclk.Set(vidclk.Get(), vidclk.GetSerial());
+    }
+    extclk.Set(extclk.Get(), extclk.GetSerial());
+    bool paused = CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped;
+    paused = !paused;
+
+    audclk.SetPaused(paused);
+    vidclk.SetPaused(paused);
+    extclk.SetPaused(paused);
+}
+
+double FFFMPEGMediaTracks::ComputeTargetDelay(double delay) {
+    double sync_threshold, diff = 0;
+
+    /* update delay to follow master synchronisation source */
+    if (getMasterSyncType() != ESynchronizationType::VideoMaster) {
+        /* if video is slave, we try to correct big delays by
+            duplicating or deleting a FFMPEGFrame */
+        diff = vidclk.Get() - GetMasterClock();
+
+        /* skip or repeat frame. We take into account the
+            delay to compute the threshold. I still don't know
+            if it is the best guess */
+        sync_threshold = FFMAX(AV_SYNC_THRESHOLD_MIN, FFMIN(AV_SYNC_THRESHOLD_MAX, delay));
+        if (!isnan(diff) && fabs(diff) < maxFrameDuration) {
+            if (diff <= -sync_threshold)
+                delay = FFMAX(0, delay + diff);
+            else if (diff >= sync_threshold && delay > AV_SYNC_FRAMEDUP_THRESHOLD)
+                delay = delay + diff;
+            else if (diff >= sync_threshold)
+                delay = 2 * delay;
+        }
+    }
+
+    /*OFX_LOGP(ofx_trace,  "video: delay=%0.3f A-V=%f\n",
+            delay, -diff);*/
+
+    return delay;
+}
+
+ESynchronizationType FFFMPEGMediaTracks::getMasterSyncType() {
+    /* a hidden video doesn't decode anything, it can't drive the clock */
+    bool hasVideo = videoStream && qosClass != EFFMPEGMediaQoS::Hidden;
+
+    if (sychronizationType == ESynchronizationType::VideoMaster) {
+        if (hasVideo)
+            return ESynchronizationType::VideoMaster;
+        else
+            return ESynchronizationType::AudioMaster;
+    }
+    else if (sychronizationType == ESynchronizationType::AudioMaster) {
+        if (audioStream)
+            return ESynchronizationType::AudioMaster;
+        else if (hasVideo)
+            return ESynchronizationType::VideoMaster;
+    }
+    
+    return ESynchronizationType::ExternalClock;
+}
+
+void FFFMPEGMediaTracks::UpdateVideoPts(double pts, int64_t pos, int serial) {
+    vidclk.Set(pts, serial);
+    extclk.SyncToSlave(&vidclk);
+}
+
+void FFFMPEGMediaTracks::CheckExternalClockSpeed() {
+    if (videoStreamIdx >= 0 && videoq.GetNumPackets() <= EXTERNAL_CLOCK_MIN_FRAMES ||
+        audioStreamIdx >= 0 && audioq.GetNumPackets() <= EXTERNAL_CLOCK_MIN_FRAMES) {
+        extclk.SetSpeed(FFMAX(EXTERNAL_CLOCK_SPEED_MIN, extclk.GetSpeed() - EXTERNAL_CLOCK_SPEED_STEP));
+    }
+    else if ((videoStreamIdx < 0 || videoq.GetNumPackets() > EXTERNAL_CLOCK_MAX_FRAMES) &&
+        (audioStreamIdx < 0 || audioq.GetNumPackets() > EXTERNAL_CLOCK_MAX_FRAMES)) {
+        extclk.SetSpeed(FFMIN(EXTERNAL_CLOCK_SPEED_MAX, extclk.GetSpeed() + EXTERNAL_CLOCK_SPEED_STEP));
+    }
+    else {
+        double speed = extclk.GetSpeed();
+        if (speed != 1.0)
+            extclk.SetSpeed(speed + EXTERNAL_CLOCK_SPEED_STEP * (1.0 - speed) / fabs(1.0 - speed));
+    }
+}
+
+double FFFMPEGMediaTracks::GetMasterClock() {
+    double val;
+
+    switch (getMasterSyncType()) {
+    case ESynchronizationType::VideoMaster:
+        val = vidclk.Get();
+        break;
+    case ESynchronizationType::AudioMaster:
+        val = audclk.Get();
+        break;
+    default:
+        val = extclk.Get();
+        break;
+    }
+    return val;
+}
+
+FIntPoint FFFMPEGMediaTracks::GetOutputSize(int width, int height) const {
+    /* the decoder already applied part of the LOD when it supports lowres */
+    int lod = FMath::Max(0, outputLOD.load() - videoLowres.load());
+    FIntPoint size(FMath::Max(1, width >> lod), FMath::Max(1, height >> lod));
+
+    int maxWidth = maxOutputWidth;
+    int maxHeight = maxOutputHeight;
+    double scale = 1.0;
+    if (maxWidth > 0 && size.X > maxWidth)
+        scale = FMath::Min(scale, (double)maxWidth / size.X);
+    if (maxHeight > 0 && size.Y > maxHeight)
+        scale = FMath::Min(scale, (double)maxHeight / size.Y);
+
+    if (scale < 1.0) {
+        size.X = FMath::Max(1, (int)(size.X * scale));
+        size.Y = FMath::Max(1, (int)(size.Y * scale));
+    }
+    return size;
+}
+
+int FFFMPEGMediaTracks::GetConversionSlices(int height) const {
+    if (conversionSlices > 0)
+        return conversionSlices;
+
+    /* every open video converts on the same workers, the cores and the rows are split between them */
+    int videos = FMath::Max(FFMPEGDecoderThreadingPolicy::GetNumVideoDecoders(), 1);
+    int slices = FMath::Min(FPlatformMisc::NumberOfCores(), height / SLICE_SCALER_MIN_ROWS) / videos;
+    return FMath::Max(slices, 1);
+}
+
+AVBufferRef* FFFMPEGMediaTracks::AcquireVideoBuffer(int size) {
+    if (videoBufferPoolSize != size) {
+        av_buffer_pool_uninit(&videoBufferPool);
+        videoBufferPool = av_buffer_pool_init(size, NULL);
+        videoBufferPoolSize = videoBufferPool ? size : 0;
+    }
+
+    AVBufferRef* buffer = videoBufferPool ? av_buffer_pool_get(videoBufferPool) : NULL;
+    if (!buffer) {
+        UE_LOG(LogFFMPEGMedia, Error, TEXT("Cannot allocate the texture buffer"));
+    }
+    return buffer;
+}
+
+bool FFFMPEGMediaTracks::GetNativeYUVBuffer(AVFrame *frame, AVBufferRef** buffer, uint8_t** data, int* pitch, FIntPoint& Dim, EMediaTextureSampleFormat& Format) {
+    int width = frame->width;
+    int height = frame->height;
+    int bytesPerSample = 1;
+
+    /* the chroma planes are subsampled, odd sizes go through sws_scale */
+    if ((width & 1) || (height & 1))
+        return false;
+
+    switch (frame->format) {
+    case AV_PIX_FMT_YUYV422:
+        if (!frame->buf[0] || frame->buf[1] || frame->linesize[0] <= 0)
+            return false;
+        *buffer = av_buffer_ref(frame->buf[0]);
+        *data = frame->data[0];
+        *pitch = frame->linesize[0];
+        Dim = FIntPoint(width, height);
+        Format = EMediaTextureSampleFormat::CharYUY2;
+        return *buffer != NULL;
+
+    case AV_PIX_FMT_P010LE:
+        bytesPerSample = 2;
+        Format = EMediaTextureSampleFormat::P010;
+        break;
+
+    case AV_PIX_FMT_NV12:
+        Format = EMediaTextureSampleFormat::CharNV12;
+        break;
+
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+        /* there's no planar 4:2:0 sample format, the chroma planes are interleaved into NV12 */
+        Format = EMediaTextureSampleFormat::CharNV12;
+        break;
+
+    default:
+        return false;
+    }
+
+    /* semi-planar formats are read as a single plane of height * 3 / 2 rows */
+    Dim = FIntPoint(width, height * 3 / 2);
+
+    if (Format != EMediaTextureSampleFormat::CharNV12 || frame->format == AV_PIX_FMT_NV12) {
+        /* the pooled frames keep the padded rows of the decoder between the planes,
+           the sample is then taller than the picture and cropped to the output size */
+        ptrdiff_t offset = frame->data[1] - frame->data[0];
+        int rows = frame->linesize[0] > 0 ? (int)(offset / frame->linesize[0]) : 0;
+        bool contiguous = frame->buf[0] && !frame->buf[1] && frame->linesize[0] > 0
+            && frame->linesize[0] == frame->linesize[1]
+            && offset == (ptrdiff_t)frame->linesize[0] * rows
+            && rows >= height && !(rows & 1)
+            && frame->data[1] + frame->linesize[1] * (rows / 2) <= frame->buf[0]->data + frame->buf[0]->size;
+
+        if (contiguous) {
+            *buffer = av_buffer_ref(frame->buf[0]);
+            *data = frame->data[0];
+            *pitch = frame->linesize[0];
+            Dim = FIntPoint(width, rows * 3 / 2);
+            return *buffer != NULL;
+        }
+
+        *pitch = width * bytesPerSample;
+        *buffer = AcquireVideoBuffer(*pitch * Dim.Y);
+        if (!*buffer)
+            return false;
+        *data = (*buffer)->data;
+
+        av_image_copy_plane(*data, *pitch, frame->data[0], frame->linesize[0], *pitch, height);
+        av_image_copy_plane(*data + *pitch * height, *pitch, frame->data[1], frame->linesize[1], *pitch, height / 2);
+        return true;
+    }
+
+    *pitch = width;
+    *buffer = AcquireVideoBuffer(*pitch * Dim.Y);
+    if (!*buffer)
+        return false;
+    *data = (*buffer)->data;
+
+    av_image_copy_plane(*data, *pitch, frame->data[0], frame->linesize[0], width, height);
+    for (int y = 0; y < height / 2; y++) {
+        const uint8_t* u = frame->data[1] + y * frame->linesize[1];
+        const uint8_t* v = frame->data[2] + y * frame->linesize[2];
+        uint8_t* uv = *data + *pitch * (height + y);
+        for (int x = 0; x < width / 2; x++) {
+            uv[2 * x] = u[x];
+            uv[2 * x + 1] = v[x];
+        }
+    }
+    return true;
+}
+
+TSharedPtr<FFFMPEGMediaTextureSample, ESPMode::ThreadSafe> FFFMPEGMediaTracks::ConvertFrame(FFMPEGFrame* vp, AVFrame *frame) {
+    int pitch[4] = { 0, 0, 0, 0 };
+    uint8_t* data[4] = { 0 };
+    AVBufferRef* buffer = NULL;
+
+    FIntPoint OutputDim = GetOutputSize(frame->width, frame->height);
+    FIntPoint Dim = OutputDim;
+    EMediaTextureSampleFormat Format = EMediaTextureSampleFormat::CharBGRA;
+    bool scaled = OutputDim.X != frame->width || OutputDim.Y != frame->height;
+
+    if (!scaled && nativeYUVOutput && GetNativeYUVBuffer(frame, &buffer, &data[0], &pitch[0], Dim, Format)) {
+        /* the GPU does the color conversion */
+    } else if (!scaled && frame->format == AV_PIX_FMT_BGRA && frame->buf[0] && frame->linesize[0] > 0 && !frame->buf[1]) {
+        /* already in the texture format, share the decoded buffer */
+        Dim = OutputDim;
+        Format = EMediaTextureSampleFormat::CharBGRA;
+        buffer = av_buffer_ref(frame->buf[0]);
+        data[0] = frame->data[0];
+        pitch[0] = frame->linesize[0];
+    } else {
+        Dim = OutputDim;
+        Format = EMediaTextureSampleFormat::CharBGRA;
+
+        int size = av_image_get_buffer_size(AV_PIX_FMT_BGRA, OutputDim.X, OutputDim.Y, 1);
+        if (size < 0) {
+            return nullptr;
+        }
+
+        buffer = AcquireVideoBuffer(size);
+        if (!buffer) {
+            return nullptr;
+        }
+
+        av_image_fill_linesizes(pitch, AV_PIX_FMT_BGRA, OutputDim.X);
+        av_image_fill_pointers(data, AV_PIX_FMT_BGRA, OutputDim.Y, buffer->data, pitch);
+
+        int slices = GetConversionSlices(frame->height);
+
+        if (!scaled && fastYUVConversion && FFMPEGYUVConverter::Convert(frame, data[0], pitch[0], slices)) {
+            /* converted by the SIMD kernels */
+        } else if (!imgConverter.Scale(frame, OutputDim.X, OutputDim.Y, AV_PIX_FMT_BGRA, data, pitch, slices)) {
+            UE_LOG(LogFFMPEGMedia, Error, TEXT("Cannot initialize the conversion context"));
+            av_buffer_unref(&buffer);
+            return nullptr;
+        }
+    }
+
+
+    /* samples sharing the decoded buffer don't take memory on top of the frame */
+    videoSampleBytes = (frame->buf[0] && buffer->buffer == frame->buf[0]->buffer) ? 0 : buffer->size;
+
+    /* the pool is lock free, taking CriticalSection here would deadlock with SelectTrack closing the stream */
+    TSharedPtr<FFFMPEGMediaTextureSample, ESPMode::ThreadSafe> TextureSample = VideoSamplePool->AcquireShared();
+
+    FMediaTimeStamp time(FTimespan::FromSeconds(vp->GetPts()), GetSampleSequence(vp->GetSerial(), videoq));
+    FTimespan duration = FTimespan::FromSeconds(vp->GetDuration());
+
+    if (!TextureSample->Initialize(
+        buffer,
+        data[0],
+        Dim,
+        OutputDim,
+        Format,
+        pitch[0],
+        time,
+        duration))
+    {
+        return nullptr;
+    }
+
+    bool rec709, fullRange;
+    FFMPEGYUVConverter::GetColorSpace(frame, &rec709, &fullRange);
+    TextureSample->SetColorSpace(rec709, fullRange);
+
+    return TextureSample;
+}
+
+void FFFMPEGMediaTracks::StartSampleSequence() {
+    const int64 sequence = ++sampleSequenceIndex;
+
+    AudioSampleQueue.SetSequenceIndex(sequence);
+    CaptionSampleQueue.SetSequenceIndex(sequence);
+    VideoSampleQueue.SetSequenceIndex(sequence);
+
+    /* producers blocked on a full queue can now drop the stale samples */
+    FScopeLock Lock(&sampleQueueMutex);
+    sampleQueueCond.broadcast();
+}
+
+int64 FFFMPEGMediaTracks::GetSampleSequence(int serial, const FFMPEGPacketQueue& queue) const {
+    /* read the sequence before the serial, the read thread changes them in the opposite order */
+    const int64 sequence = sampleSequenceIndex;
+    return (serial == queue.GetSerial()) ? sequence : sequence - 1;
+}
+
+template <typename SampleType>
+bool FFFMPEGMediaTracks::WouldDropSample(TFFMPEGMediaSampleStore<SampleType>& Queue, int MaxSamples, const FMediaTimeStamp& Time, FTimespan Duration) {
+    FScopeLock Lock(&sampleQueueMutex);
+
+    /* same state EnqueueSample starts from, only the engine can make room until the sample is handed over */
+    Queue.RemoveStale();
+
+    /* DropOldest would keep it, but the engine already asked for a later time */
+    if (Queue.IsBehindFetch(Time, Duration))
+        return true;
+
+    return MaxSamples > 0 && Queue.Num() >= MaxSamples && sampleQueueOverflow == ESampleQueueOverflow::DropNewest;
+}
+
+bool FFFMPEGMediaTracks::WouldBlockSample(int NumSamples, int MaxSamples) const {
+    return MaxSamples > 0 && NumSamples >= MaxSamples && sampleQueueOverflow == ESampleQueueOverflow::Block;
+}
+
+template <typename SampleType, typename InSampleType>
+bool FFFMPEGMediaTracks::EnqueueSample(TFFMPEGMediaSampleStore<SampleType>& Queue, const TSharedRef<InSampleType, ESPMode::ThreadSafe>& Sample, int MaxSamples, std::atomic<int64>& Dropped) {
+    FScopeLock Lock(&sampleQueueMutex);
+
+    /* stale samples don't count against the bound */
+    Queue.RemoveStale();
+
+    if (MaxSamples > 0 && Queue.Num() >= MaxSamples) {
+        switch (sampleQueueOverflow) {
+        case ESampleQueueOverflow::DropOldest:
+            while (Queue.Num() >= MaxSamples && Queue.Pop())
+                Dropped++;
+            break;
+        case ESampleQueueOverflow::DropNewest:
+            Dropped++;
+            return false;
+        case ESampleQueueOverflow::Block:
+            /* state changes don't signal the condition, wake up regularly to notice pauses and shutdowns */
+            while (!sampleQueueCond.waitTimeout(sampleQueueMutex, 10, [&Queue, MaxSamples] { Queue.RemoveStale(); return Queue.Num() < MaxSamples; })) {
+                if (pipelineState.IsAborted() || !pipelineState.IsPlaying()) {
+                    Dropped++;
+                    return false;
+                }
+            }
+            break;
+        }
+    }
+
+    return Queue.Enqueue(Sample);
+}
+
+double FFFMPEGMediaTracks::ConvertTick() {
+    FFMPEGFrame *vp = pictq.PeekConvertible();
+    if (!vp) {
+        /* the next pushed picture wakes the task */
+        return videoq.IsAbortRequest() ? FFMPEG_TASK_DONE : FFMPEG_TASK_PARK;
+    }
+
+    /* frames decoded before a seek are dropped by VideoRefresh and the hidden ones by DisplayTick, don't waste time on them */
+    if (vp->GetSerial() == videoq.GetSerial() && qosClass != EFFMPEGMediaQoS::Hidden) {
+        vp->SetVerticalFlip(vp->GetFrame()->linesize[0] < 0);
+        FMediaTimeStamp time(FTimespan::FromSeconds(vp->GetPts()), GetSampleSequence(vp->GetSerial(), videoq));
+        /* nobody will fetch the sample, leave the frame without one and the display skips it */
+        if (WouldDropSample(VideoSampleQueue, maxVideoSamples, time, FTimespan::FromSeconds(vp->GetDuration())))
+            skippedConversions++;
+        else
+            vp->SetSample(ConvertFrame(vp, vp->GetFrame()));
+    }
+    pictq.NextConverted();
+
+    /* the display task found this picture still converting */
+    if (uploadPending)
+        FFMPEGTaskPool::Get().Wake(std::atomic_load(&displayTask));
+
+    /* one picture per run, the stages of the other players get their turn in between */
+    return 0.0;
+}
+
+bool FFFMPEGMediaTracks::VideoDisplay () {
+    if (videoStream) {
+            FFMPEGFrame *vp;
+            FFMPEGFrame *sp = NULL;
+            
+
+            vp = pictq.PeekLast();
+            if (subTitleStream) {
+                if (subpq.GetNumRemaining() > 0) {
+                    sp = subpq.Peek();
+
+                    if (vp->GetPts() >= sp->GetPts() + ((float)sp->GetSub().start_display_time / 1000)) {
+                        if (!sp->IsUploaded()) {
+                            
+                            int i;
+                            if (!sp->GetWidth() || !sp->GetHeight()) {
+                                sp->UpdateSize(vp);
+                            }
+                            
+                            FMediaTimeStamp Time(FTimespan::FromSeconds(sp->GetPts()), GetSampleSequence(sp->GetSerial(), subtitleq));
+                            FTimespan CurrentDuration = FTimespan::FromSeconds(sp->GetDuration());
+
+                            for (i = 0; i < (int)sp->GetSub().num_rects; i++) {
+                                AVSubtitleRect *sub_rect = sp->GetSub().rects[i];
+                                sub_rect->x = av_clip(sub_rect->x, 0, sp->GetWidth());
+                                sub_rect->y = av_clip(sub_rect->y, 0, sp->GetHeight());
+                                sub_rect->w = av_clip(sub_rect->w, 0, sp->GetWidth() - sub_rect->x);
+                                sub_rect->h = av_clip(sub_rect->h, 0, sp->GetHeight() - sub_rect->y);
+
+                                if ( sub_rect->type == SUBTITLE_TEXT ||  sub_rect->type == SUBTITLE_ASS) {
+                                    const auto CaptionSample = MakeShared<FFFMPEGMediaOverlaySample, ESPMode::ThreadSafe>();
+
+                                    if (CaptionSample->Initialize(sub_rect->type == SUBTITLE_TEXT?sub_rect->text:sub_rect->ass, FVector2D(sub_rect->x, sub_rect->y), Time, CurrentDuration))
+                                    {
+                                        FScopeLock Lock(&sampleQueueMutex);
+                                        CaptionSampleQueue.Enqueue(CaptionSample);
+                                    }
+                                }
+
+                            }
+                            sp->SetUploaded(true);
+                        }
+                    }
+                    else
+                        sp = NULL;
+                }
+            }
+
+            if (!vp->IsUploaded()) {
+                /* the sample is normally ready, when the convert task fell behind it wakes the display task once it's done.
+                   Flag first and check after, so either the convert task sees the flag or this sees the sample */
+                uploadPending = true;
+                if (!pictq.IsConverted(vp))
+                    return false;
+                uploadPending = false;
+
+                TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> sample = vp->GetSample();
+                if (sample.IsValid()) {
+                    EnqueueSample(VideoSampleQueue, sample.ToSharedRef(), maxVideoSamples, droppedVideoSamples);
+                }
+                vp->SetUploaded(true);
+            } 
+        }   
+    return true;
+}
+
+void FFFMPEGMediaTracks::StreamSeek( int64_t pos, int64_t rel, int seek_by_bytes) {
+    if (!pipelineState.IsPending(EPipelineCommand::Seek)) {
+        seekPos = pos;
+        seekRel = rel;
+        seekFlags &= ~AVSEEK_FLAG_BYTE;
+        if (seek_by_bytes)
+            seekFlags |= AVSEEK_FLAG_BYTE;
+        /* the display and audio render tasks wake up too and drop what they were waiting on */
+        pipelineState.Post(EPipelineCommand::Seek);
+    }
+}
+
+void FFFMPEGMediaTracks::WakeReadThread() {
+    pipelineState.Post(EPipelineCommand::Read);
+}
+
+void FFFMPEGMediaTracks::WaitReadThread(unsigned int ms) {
+    const uint32 generation = pipelineState.GetGeneration();
+    auto woken = [this, generation] {
+        return pipelineState.Take(EPipelineCommand::Read) || pipelineState.IsPending(EPipelineCommand::Seek) ||
+            pipelineState.GetGeneration() != generation;
+    };
+    if (ms == 0) {
+        pipelineState.Wait(woken);
+    } else {
+        pipelineState.WaitTimeout(ms, woken);
+    }
+}
+
+int FFFMPEGMediaTracks::ReadThread() {
+
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+    AVPacket pkt1, *pkt = &pkt1;
+    int64_t stream_start_time;
+    int pkt_in_play_range = 0;
+
+    int scan_all_pmts_set = 0;
+    int64_t pkt_ts;
+    int ret = 0;
+    int read_pause_return = -1;
+
+    bool paused = CurrentState == EMediaState::Paused;
+    bool last_paused = false;
+
+    readingAhead = true;
+
+    
+
+    for (;;) {
+        if (pipelineState.IsAborted())
+            break;
+
+        if (currentStreams < totalStreams) {
+            /* SelectTrack wakes us up once the stream is open */
+            WaitReadThread(0);
+            continue;
+        }
+
+        paused = ( CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped);
+
+        
+
+        if (paused != last_paused) {
+            last_paused = paused;
+
+            if (paused)
+                read_pause_return = av_read_pause(FormatContext);
+            else
+                av_read_play(FormatContext);
+        }      
+
+        if (pipelineState.IsPending(EPipelineCommand::Seek)) {
+            int64_t seek_target = seekPos;
+            int64_t seek_min = seekRel > 0 ? seek_target - seekRel + 2 : INT64_MIN;
+            int64_t seek_max = seekRel < 0 ? seek_target - seekRel - 2 : INT64_MAX;
+
+            ret = avformat_seek_file(FormatContext, -1, seek_min, seek_target, seek_max, seekFlags);
+            if (ret < 0) {
+                UE_LOG(LogFFMPEGMedia, Error, TEXT("%s: error while seeking"), UTF8_TO_TCHAR(FormatContext->url));
+            } else {
+                if (SelectedAudioTrack  != INDEX_NONE) {
+                    audioq.Flush();
+                    audioq.PutFlush();
+                }
+                if (SelectedCaptionTrack != INDEX_NONE) {
+                    subtitleq.Flush();
+                    subtitleq.PutFlush();
+                }
+                if (SelectedVideoTrack != INDEX_NONE) {
+                    videoq.Flush();
+                    videoq.PutFlush();
+                }
+                if (seekFlags & AVSEEK_FLAG_BYTE) {
+                    extclk.Set(NAN, 0);
+                }
+                else {
+                    extclk.Set(seek_target / (double)AV_TIME_BASE, 0);
+                }
+
+                /* after the queue flushes, see GetSampleSequence */
+                StartSampleSequence();
+                DeferredEvents.Enqueue(EMediaEvent::SeekCompleted);
+            }
+            pipelineState.Take(EPipelineCommand::Seek);
+            queueAttachmentsReq = true;
+            eof = 0;
+            
+            if (CurrentState == EMediaState::Paused)
+                StepToNextFrame();
+        }
+
+
+        if (queueAttachmentsReq) {
+            if (videoStream && videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC) {
+                AVPacket copy = { 0 };
+                if ((ret = av_packet_ref(&copy, &videoStream->attached_pic)) < 0) {
+                    return -1;
+                }
+
+                videoq.Put(&copy);
+                videoq.PutNullPacket(videoStreamIdx);
+            }
+            queueAttachmentsReq = false;
+        }
+
+        if (!Settings->UseInfiniteBuffer && !NeedsMorePackets()) {
+            /* wait 20 ms, the decoders don't drain the queues while paused */
+            WaitReadThread(paused ? 0 : 20);
+            continue;
+        }
+
+        if (!paused &&
+            (!audioStream || (auddec->GetFinished() == audioq.GetSerial() && sampq.GetNumRemaining() == 0)) &&
+            (!videoStream || (viddec->GetFinished() == videoq.GetSerial() && pictq.GetNumRemaining() == 0))) {
+            
+            if (ShouldLoop) {
+                /* the seek starts a new sample sequence, the last samples can still be fetched until then */
+                DeferredEvents.Enqueue(EMediaEvent::PlaybackEndReached);
+                StreamSeek(0, 0, 0);
+            }
+            else {
+                FlushSamples();
+                CurrentState = EMediaState::Stopped;
+                DeferredEvents.Enqueue(EMediaEvent::PlaybackEndReached);
+                DeferredEvents.Enqueue(EMediaEvent::PlaybackSuspended);
+                bPrerolled = false;
+                UpdatePipelineState();
+            }
+        }
+        try {
+            ret = av_read_frame(FormatContext, pkt);
+		} catch(...) {
+		    ret = -1;
+		}
+
+        if (ret < 0) {
+            if ((ret == AVERROR_EOF || avio_feof(FormatContext->pb)) && !eof) {
+                if (videoStreamIdx >= 0)
+                    videoq.PutNullPacket(videoStreamIdx);
+                if (audioStreamIdx >= 0)
+                    audioq.PutNullPacket(audioStreamIdx);
+                if (subtitleStreamIdx >= 0)
+                    subtitleq.PutNullPacket(subtitleStreamIdx);
+                eof = 1;
+            }
+            if (FormatContext->pb && FormatContext->pb->error)
+                break;
+
+            WaitReadThread(paused ? 0 : 5);
+            continue;
+        }
+        else {
+            eof = 0;
+        }
+        /* check if packet is in play range specified by user, then queue, otherwise discard */
+        stream_start_time = FormatContext->streams[pkt->stream_index]->start_time;
+        pkt_ts = pkt->pts == AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+        pkt_in_play_range = 1;
+        if (pkt->stream_index == audioStreamIdx && pkt_in_play_range) {
+            audioq.Put(pkt);
+        }
+        else if (pkt->stream_index == videoStreamIdx && pkt_in_play_range
+            && !(videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            videoq.Put(pkt);
+        }
+        else if (pkt->stream_index == subtitleStreamIdx && pkt_in_play_range) {
+            subtitleq.Put(pkt);
+        }
+        else {
+            av_packet_unref(pkt);
+        }
+    }
+    return 0;
+}
+
+int FFFMPEGMediaTracks::AudioThread() {
+  
+    AVFrame *frame = av_frame_alloc();
+    FFMPEGFrame *af;
+
+    int got_frame = 0;
+    AVRational tb;
+    int ret = 0;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    do {
+        if ((got_frame = auddec->DecodeFrame(frame, NULL)) < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+
+        if (got_frame) {
+            int frame_size = av_samples_get_buffer_size(NULL, frame->channels, frame->nb_samples, (AVSampleFormat)frame->format, 1);
+            audioFrameBytes = FFMAX(frame_size, 0);
+            ApplyFrameBudget(sampq, audioFrameBytes, audioFrameQueueSize, TEXT("audio"), audioOverBudget);
+
+            tb = { 1, frame->sample_rate };
+            af = sampq.PeekWritable();
+            if (!af) {
+                av_frame_free(&frame);
+                return ret;
+            }
+
+            af->SetPts((frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb));
+            af->SetPos(frame->pkt_pos);
+            af->SetSerial(auddec->GetPktSerial());
+            af->SetDuration(av_q2d({ frame->nb_samples, frame->sample_rate }));
+
+            av_frame_move_ref(af->GetFrame(), frame);
+            sampq.Push();
+
+            /* a hidden video doesn't decode anything */
+            if (!videoStream || qosClass == EFFMPEGMediaQoS::Hidden)
+                Preroll();
+
+        }
+    } while (ret >= 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF);
+
+    av_frame_free(&frame);
+    return ret;
+}
+
+int FFFMPEGMediaTracks::SubtitleThread() {
+    FFMPEGFrame *sp;
+    int got_subtitle;
+    double pts;
+
+    for (;;) {
+        sp = subpq.PeekWritable();
+        if (!sp)
+            return 0;
+
+        if ((got_subtitle = subdec->DecodeFrame(NULL, &sp->GetSub())) < 0)
+            break;
+
+        pts = 0;
+
+        if (got_subtitle && sp->GetSub().format == 0) {
+            if (sp->GetSub().pts != AV_NOPTS_VALUE)
+                pts = sp->GetSub().pts / (double)AV_TIME_BASE;
+
+
+            sp->SetPts(pts);
+            sp->SetSerial(subdec->GetPktSerial());
+            sp->SetWidth(subdec->GetAvctx()->width);
+            sp->SetHeight(subdec->GetAvctx()->height);
+            sp->SetUploaded(false);
+
+            /* the bitmaps of the next subtitles are about the size of this one */
+            subtitleFrameBytes = FFMPEGMediaTracks::GetSubtitleBytes(sp->GetSub());
+
+            /* now we can update the picture count */
+            subpq.Push();
+            ApplyFrameBudget(subpq, subtitleFrameBytes, subtitleFrameQueueSize, TEXT("subtitle"), subtitleOverBudget);
+        }
+        else if (got_subtitle) {
+            avsubtitle_free(&sp->GetSub());
+        }
+    }
+    return 0;
+}
+
+int FFFMPEGMediaTracks::SynchronizeAudio( int nb_samples) {
+     int wanted_nb_samples = nb_samples;
+
+        /* if not master, then we try to remove or add samples to correct the clock */
+        if (getMasterSyncType() != ESynchronizationType::AudioMaster) {
+            double diff, avg_diff;
+            int min_nb_samples, max_nb_samples;
+
+            diff = audclk.Get() - GetMasterClock();
+
+            if (!isnan(diff) && fabs(diff) < AV_NOSYNC_THRESHOLD) {
+                audioDiffCum = diff + audioDiffAvgCoef * audioDiffCum;
+                if (audioDiffAvgCount < AUDIO_DIFF_AVG_NB) {
+                    /* not enough measures to have a correct estimate */
+                    audioDiffAvgCount++;
+                } else {
+                    /* estimate the A-V difference */
+                    avg_diff = audioDiffCum * (1.0 - audioDiffAvgCoef);
+
+                    if (fabs(avg_diff) >= audioDiffThreshold) {
+                        wanted_nb_samples = nb_samples + (int)(diff * srcAudio.SampleRate);
+                        min_nb_samples = ((nb_samples * (100 - SAMPLE_CORRECTION_PERCENT_MAX) / 100));
+                        max_nb_samples = ((nb_samples * (100 + SAMPLE_CORRECTION_PERCENT_MAX) / 100));
+                        wanted_nb_samples = av_clip(wanted_nb_samples, min_nb_samples, max_nb_samples);
+                    }
+                    /*OFX_LOGP(ofx_trace, "diff=%f adiff=%f sample_diff=%d apts=%0.3f %f\n",
+                            diff, avg_diff, wanted_nb_samples - nb_samples,
+                            audioClock, audioDiffThreshold);*/
+                }
+            } else {
+                /* too big difference : may be initial PTS errors, so
+                   reset A-V filter */
+                audioDiffAvgCount = 0;
+                audioDiffCum       = 0;
+            }
+        }
+
+        return wanted_nb_samples;
+}
+
+int FFFMPEGMediaTracks::AudioDecodeFrame(FTimespan& time, FTimespan& duration) {
+    int data_size, resampled_data_size;
+    int64_t dec_channel_layout;
+    av_unused double audio_clock0;
+    int wanted_nb_samples;
+    FFMPEGFrame *af;
+
+    if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped)
+        return -1;
+
+    /* this runs on a pool worker, it never waits for the decoder: the frames of
+       the previous serials are skipped while there are some, then it gives up */
+    do {
+        if (sampq.GetNumRemaining() == 0)
+            return AVERROR(EAGAIN);
+        af = sampq.PeekReadable();
+        if (!af)
+            return -1;
+        sampq.Next();
+    } while (af->GetSerial() != audioq.GetSerial());
+
+    data_size = av_samples_get_buffer_size(NULL, af->GetFrame()->channels, af->GetFrame()->nb_samples, (AVSampleFormat)af->GetFrame()->format, 1);
+
+    dec_channel_layout =
+        (af->GetFrame()->channel_layout && af->GetFrame()->channels == av_get_channel_layout_nb_channels(af->GetFrame()->channel_layout)) ?
+        af->GetFrame()->channel_layout : av_get_default_channel_layout(af->GetFrame()->channels);
+    wanted_nb_samples = SynchronizeAudio(af->GetFrame()->nb_samples);
+
+    if (getMasterSyncType() == ESynchronizationType::AudioMaster) {
+        CurrentTime = FTimespan::FromSeconds(af->GetPts());
+        //CurrentTime = FTimespan::FromSeconds(audclk.get());
+    }
+
+    if (af->GetFrame()->format != srcAudio.Format ||
+        dec_channel_layout != srcAudio.ChannelLayout ||
+        af->GetFrame()->sample_rate != srcAudio.SampleRate||
+        (wanted_nb_samples != af->GetFrame()->nb_samples && !swrContext)) {
+        swr_free(&swrContext);
+        swrContext = swr_alloc_set_opts(NULL,
+            targetAudio.ChannelLayout, targetAudio.Format,targetAudio.SampleRate,
+            dec_channel_layout, (AVSampleFormat)af->GetFrame()->format, af->GetFrame()->sample_rate,
+            0, NULL);
+        if (!swrContext || swr_init(swrContext) < 0) {
+            UE_LOG(LogFFMPEGMedia, Error, 
+                TEXT("Cannot create sample rate converter for conversion of %d Hz %s %d channels to %d Hz %s %d channels!"),
+                af->GetFrame()->sample_rate, UTF8_TO_TCHAR( av_get_sample_fmt_name((AVSampleFormat)af->GetFrame()->format)), af->GetFrame()->channels,
+                targetAudio.SampleRate,  UTF8_TO_TCHAR(av_get_sample_fmt_name(targetAudio.Format)), targetAudio.NumChannels);
+            swr_free(&swrContext);
+            return -1;
+        }
+        srcAudio.ChannelLayout = dec_channel_layout;
+        srcAudio.NumChannels = af->GetFrame()->channels;
+        srcAudio.SampleRate = af->GetFrame()->sample_rate;
+        srcAudio.Format = (AVSampleFormat)af->GetFrame()->format;
+    }
+
+    if (swrContext) {
+        const uint8_t **in = (const uint8_t **)af->GetFrame()->extended_data;
+        uint8_t **out = &audioBuf1;
+        int out_count = (int64_t)wanted_nb_samples * targetAudio.SampleRate / af->GetFrame()->sample_rate + 256;
+        int out_size = av_samples_get_buffer_size(NULL, targetAudio.NumChannels, out_count,targetAudio.Format, 0);
+        int len2;
+        if (out_size < 0) {
+            UE_LOG(LogFFMPEGMedia, Error,  TEXT("av_samples_get_buffer_size() failed"));
+            return -1;
+        }
+        if (wanted_nb_samples != af->GetFrame()->nb_samples) {
+            if (swr_set_compensation(swrContext, (wanted_nb_samples - af->GetFrame()->nb_samples) * targetAudio.SampleRate / af->GetFrame()->sample_rate,
+                wanted_nb_samples *targetAudio.SampleRate / af->GetFrame()->sample_rate) < 0) {
+                UE_LOG(LogFFMPEGMedia, Error,  TEXT("swr_set_compensation() failed"));
+                return -1;
+            }
+        }
+        av_fast_malloc(&audioBuf1, &audioBuf1Size, out_size);
+        if (!audioBuf1)
+            return AVERROR(ENOMEM);
+        len2 = swr_convert(swrContext, out, out_count, in, af->GetFrame()->nb_samples);
+        if (len2 < 0) {
+            UE_LOG(LogFFMPEGMedia, Error,  TEXT("swr_convert() failed"));
+            return -1;
+        }
+        if (len2 == out_count) {
+            UE_LOG(LogFFMPEGMedia, Warning,  TEXT("audio buffer is probably too small"));
+            if (swr_init(swrContext) < 0)
+                swr_free(&swrContext);
+        }
+        audioBuf = audioBuf1;
+        resampled_data_size = len2 * targetAudio.NumChannels * av_get_bytes_per_sample(targetAudio.Format);
+    }
+    else {
+        audioBuf = af->GetFrame()->data[0];
+        resampled_data_size = data_size;
+    }
+
+    audio_clock0 = audioClock;
+    /* update the audio clock with the pts */
+    if (!isnan(af->GetPts()))
+        audioClock = af->GetPts() + (double)af->GetFrame()->nb_samples / af->GetFrame()->sample_rate;
+    else
+        audioClock = NAN;
+    audioClockSerial = af->GetSerial();
+
+    time = FTimespan::FromSeconds(audioClock);
+    duration = FTimespan::FromSeconds(af->GetDuration());
+    
+    return resampled_data_size;
+}
+
+
+
+bool FFFMPEGMediaTracks::RenderAudio() {
+    int audio_size, len1;
+
+    audioCallbackTime = av_gettime_relative();
+    FTimespan time = 0;
+    FTimespan duration = 0;
+
+    audio_size = AudioDecodeFrame(time, duration);
+    if (audio_size == AVERROR(EAGAIN))
+        return false;
+    if (audio_size < 0) {
+        /* if error, just output silence */
+        audioBuf = NULL;
+        audioBufSize = AUDIO_MIN_BUFFER_SIZE / targetAudio.FrameSize * targetAudio.FrameSize;
+    }
+    else {
+        audioBufSize = audio_size;
+    }
+    len1 = audioBufSize ;
+
+    if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped) {
+        //Ignore the frame
+    } else {
+        if ( audioBuf != NULL ) {
+            const FMediaTimeStamp timeStamp(time, GetSampleSequence(audioClockSerial, audioq));
+
+            /* don't copy a buffer that is going to be thrown away */
+            if (WouldDropSample(AudioSampleQueue, maxAudioSamples, timeStamp, duration)) {
+                skippedAudioSamples++;
+            } else {
+                const TSharedRef<FFFMPEGMediaAudioSample, ESPMode::ThreadSafe> AudioSample = AudioSamplePool->AcquireShared();
+
+                audioSampleBytes = len1;
+
+                if (AudioSample->Initialize((uint8_t *)audioBuf, len1, targetAudio.NumChannels, targetAudio.SampleRate, timeStamp, duration))
+                {
+                    EnqueueSample(AudioSampleQueue, AudioSample, maxAudioSamples, droppedAudioSamples);
+                }
+            }
+        }
+    }
+
+    if (!isnan(audioClock)) {
+        audclk.SetAt(audioClock - (double)(2 * targetAudio.HardwareSize + audioBufSize) / targetAudio.BytesPerSec, audioClockSerial, audioCallbackTime / 1000000.0);
+        extclk.SyncToSlave(&audclk);
+    }
+
+    return true;
+}
+
+void FFFMPEGMediaTracks::UpdatePipelineState() {
+    EPipelineState state;
+
+    if (CurrentState == EMediaState::Closed || CurrentState == EMediaState::Error)
+        state = EPipelineState::Closed;
+    else if (!bPrerolled)
+        state = CurrentState == EMediaState::Stopped ? EPipelineState::Stopped : EPipelineState::Prerolling;
+    else if (CurrentState == EMediaState::Playing)
+        state = EPipelineState::Playing;
+    else if (CurrentState == EMediaState::Paused)
+        state = EPipelineState::Paused;
+    else
+        state = EPipelineState::Stopped;
+
+    pipelineState.Set(state);
+}
+
+void FFFMPEGMediaTracks::Preroll() {
+    if (!bPrerolled) {
+        bPrerolled = true;
+        SetRate(CurrentRate);
+    }
+}
+
+void FFFMPEGMediaTracks::WakeTasks() {
+    FFMPEGTaskPool& pool = FFMPEGTaskPool::Get();
+    pool.Wake(std::atomic_load(&displayTask));
+    pool.Wake(std::atomic_load(&audioRenderTask));
+}
+
+void FFFMPEGMediaTracks::StartDisplayTask() {
+    StopDisplayTask();
+    displayRunning = true;
+    std::atomic_store(&displayTask, FFMPEGTaskPool::Get().Schedule([this] {
+        return DisplayTick();
+    }, 0.0, GetVideoTaskPriority()));
+}
+
+void FFFMPEGMediaTracks::StopDisplayTask() {
+    displayRunning = false;
+    FFMPEGTaskPool::Get().Cancel(std::atomic_exchange(&displayTask, FFMPEGTaskRef()));
+    uploadPending = false;
+}
+
+void FFFMPEGMediaTracks::StartAudioRenderTask() {
+    StopAudioRenderTask();
+    audioRunning = true;
+    std::atomic_store(&audioRenderTask, FFMPEGTaskPool::Get().Schedule([this] {
+        return AudioRenderTick();
+    }, 0.0, GetAudioTaskPriority()));
+}
+
+void FFFMPEGMediaTracks::StopAudioRenderTask() {
+    audioRunning = false;
+    FFMPEGTaskPool::Get().Cancel(std::atomic_exchange(&audioRenderTask, FFMPEGTaskRef()));
+    audioStarved = false;
+}
+
+void FFFMPEGMediaTracks::StartConvertTask() {
+    StopConvertTask();
+    std::atomic_store(&convertTask, FFMPEGTaskPool::Get().Schedule([this] {
+        return ConvertTick();
+    }, 0.0, GetVideoTaskPriority()));
+}
+
+void FFFMPEGMediaTracks::StopConvertTask() {
+    FFMPEGTaskPool::Get().Cancel(std::atomic_exchange(&convertTask, FFMPEGTaskRef()));
+}
+
+double FFFMPEGMediaTracks::DisplayTick() {
+    if (!displayRunning || pipelineState.IsAborted())
+        return FFMPEG_TASK_DONE;
+
+    /* the shown picture is converted now, present it even if paused */
+    if (uploadPending.exchange(false))
+        forceRefresh = true;
+
+    /* nothing to present until the pipeline is playing, the state change wakes the task */
+    if (!pipelineState.IsPlaying() && !forceRefresh)
+        return FFMPEG_TASK_PARK;
+
+    /* drop what was decoded before the player was hidden, the end of the playback waits for an empty queue */
+    if (qosClass == EFFMPEGMediaQoS::Hidden) {
+        while (pictq.GetNumRemaining() > 0)
+            pictq.Next();
+        return HIDDEN_REFRESH_RATE;
+    }
+
+    if (pipelineState.IsPlaying() && WouldBlockSample(VideoSampleQueue.Num(), maxVideoSamples))
+        return REFRESH_RATE;
+
+    double remaining_time = REFRESH_RATE;
+    VideoRefresh(&remaining_time);
+    return FFMAX(remaining_time, 0.0);
+}
+
+double FFFMPEGMediaTracks::AudioRenderTick() {
+    if (!audioRunning || pipelineState.IsAborted())
+        return FFMPEG_TASK_DONE;
+
+    /* the state change wakes the task */
+    if (!pipelineState.IsPlaying())
+        return FFMPEG_TASK_PARK;
+
+    /* RenderAudio has nothing to play on an empty queue, park until the decoder pushes a frame.
+       Flag first and check after, so either the push sees the flag or this sees the frame */
+    audioStarved = true;
+    if (sampq.GetNumRemaining() == 0)
+        return FFMPEG_TASK_PARK;
+    audioStarved = false;
+
+    if (WouldBlockSample(AudioSampleQueue.Num(), maxAudioSamples))
+        return REFRESH_RATE;
+
+    int64_t startTime = av_gettime_relative();
+    if (!RenderAudio()) {
+        /* only frames of a previous serial were queued, same handshake as above */
+        audioStarved = true;
+        if (sampq.GetNumRemaining() == 0)
+            return FFMPEG_TASK_PARK;
+        audioStarved = false;
+        return 0.0;
+    }
+    int64_t dif = av_gettime_relative() - startTime;
+
+    return dif < 33333 ? (33333 - dif) / 1000000.0 : 0.0;
+}
+
+
+void FFFMPEGMediaTracks::VideoRefresh(double *remaining_time) {
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+    double time;
+
+    FFMPEGFrame *sp, *sp2;
+
+    if (CurrentState == EMediaState::Playing && getMasterSyncType() == ESynchronizationType::ExternalClock && realtime)
+        CheckExternalClockSpeed();
+
+      if (videoStream) {
+        bool retry = true;
+
+        while (retry && displayRunning) {
+            if (pictq.GetNumRemaining() == 0) {
+                // nothing to do, no picture to display in the queue
+            } else {
+                double last_duration, duration, delay;
+                FFMPEGFrame *vp, *lastvp;
+
+
+                /* dequeue the picture */
+                lastvp = pictq.PeekLast();
+                vp = pictq.Peek();
+                ESynchronizationType sync_type = getMasterSyncType();
+                if ( sync_type  == ESynchronizationType::VideoMaster) {
+                    //CurrentTime = FTimespan::FromSeconds(vidclk.get());
+                    CurrentTime = FTimespan::FromSeconds(vp->GetPts());
+                } else if (sync_type == ESynchronizationType::ExternalClock) {
+                    CurrentTime = FTimespan::FromSeconds(extclk.Get());
+                }
+
+
+                if (vp->GetSerial() != videoq.GetSerial()) {
+                    pictq.Next();
+                    continue;
+                }
+
+                if (lastvp->GetSerial() != vp->GetSerial())
+                    frameTimer = av_gettime_relative() / 1000000.0;
+
+                if (CurrentState == EMediaState::Paused || CurrentState == EMediaState::Stopped) {
+                    if (forceRefresh && pictq.GetIndexShown())
+                        VideoDisplay();
+                   
+                    forceRefresh = false;
+                    return;
+                }
+
+               
+                /* compute nominal last_duration */
+                last_duration = lastvp->GetDifference(vp, maxFrameDuration);
+                delay = ComputeTargetDelay(last_duration);
+
+                time= av_gettime_relative()/1000000.0;
+                if (time < frameTimer + delay) {
+                    *remaining_time = FFMIN(frameTimer + delay - time, *remaining_time);
+                    if (forceRefresh && pictq.GetIndexShown())
+                        VideoDisplay();
+
+                    forceRefresh = false;
+                    return;
+                }
+
+
+                frameTimer += delay;
+                if (delay > 0 && time - frameTimer > AV_SYNC_THRESHOLD_MAX)
+                    frameTimer = time;
+
+                pictq.Lock();
+                if (!isnan(vp->GetPts()))
+                    UpdateVideoPts(vp->GetPts(), vp->GetPos(), vp->GetSerial());
+                pictq.Unlock();
+
+                if (pictq.GetNumRemaining() > 1) {
+                    FFMPEGFrame *nextvp = pictq.PeekNext();
+                    duration = vp->GetDifference(nextvp, maxFrameDuration);
+                    if(!step && (Settings->AllowFrameDrop && getMasterSyncType() != ESynchronizationType::VideoMaster) && time > frameTimer + duration){
+                        frameDropsLate++;
+                        pictq.Next();
+                        continue;
+                    }
+                }
+
+                if (subTitleStream) {
+                        while (subpq.GetNumRemaining() > 0) {
+                            sp = subpq.Peek();
+
+                            if (subpq.GetNumRemaining() > 1)
+                                sp2 = subpq.PeekNext();
+                            else
+                                sp2 = NULL;
+
+                            if (sp->GetSerial() != subtitleq.GetSerial()
+                                    || (vidclk.GetPts() > (sp->GetPts() + ((float) sp->GetSub().end_display_time / 1000)))
+                                    || (sp2 && vidclk.GetPts() > (sp2->GetPts() + ((float) sp2->GetSub().start_display_time / 1000))))
+                            {
+                                subpq.Next();
+                            } else {
+                                break;
+                            }
+                        }
+                }
+
+                pictq.Next();
+                forceRefresh = true;
+
+                if (step && CurrentState == EMediaState::Playing)
+                    StreamTogglePause();
+
+                retry = false;
+            }
+        }
+
+        /* display picture */
+        if (forceRefresh && pictq.GetIndexShown())
+            VideoDisplay();
+    }
+    forceRefresh = false;
+ /*   if (show_status) {
+        static int64_t last_time;
+        int64_t cur_time;
+        int aqsize, vqsize, sqsize;
+        double av_diff;
+
+        cur_time = av_gettime_relative();
+        if (!last_time || (cur_time - last_time) >= 30000) {
+            aqsize = 0;
+            vqsize = 0;
+            sqsize = 0;
+            if (audioStream)
+                aqsize = audioq.get_size();
+            if (videoStream)
+                vqsize = videoq.get_size();
+            if (subTitleStream)
+                sqsize = subtitleq.get_size();
+            av_diff = 0;
+            if (audioStream && videoStream)
+                av_diff = audclk.get() - vidclk.get();
+            else if (videoStream)
+                av_diff = get_master_clock(is) - vidclk.get();
+            else if (audioStream)
+                av_diff = get_master_clock(is) - audclk.get();
+            / *av_log(NULL, AV_LOG_INFO,
+                   "%7.2f %s:%7.3f fd=%4d aq=%5dKB vq=%5dKB sq=%5dB f=%"PRId64"/%"PRId64"   \r",
+                   get_master_clock(is),
+                   (audioStream && videoStream) ? "A-V" : (videoStream ? "M-V" : (audioStream ? "M-A" : "   ")),
+                   av_diff,
+                   frameDropsEarly + frameDropsLate,
+                   aqsize / 1024,
+                   vqsize / 1024,
+                   sqsize,
+                   videoStream ? viddec.avctx->pts_correction_num_faulty_dts : 0,
+                   videoStream ? viddec.avctx->pts_correction_num_faulty_pts : 0);* /
+            fflush(stdout);
+            last_time = cur_time;
+        }
+    }*/
+
+
+
+}
+
+
+int FFFMPEGMediaTracks::GetVideoFrame(AVFrame *frame) {
+
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+    int got_picture = viddec->DecodeFrame(frame, NULL);
+
+    if (got_picture < 0)
+        return -1;
+
+    if ( got_picture ) {
+        Preroll();
+
+        if (hwaccel_retrieve_data && frame->format == hwAccelPixFmt) {
+            int err = hwaccel_retrieve_data(video_ctx, frame);
+            if (err < 0) {
+                av_frame_unref(frame);
+                return -1;
+            }
+        }
+
+        double dpts = NAN;
+
+        if (frame->pts != AV_NOPTS_VALUE)
+            dpts = av_q2d(videoStream->time_base) * frame->pts;
+
+        frame->sample_aspect_ratio = av_guess_sample_aspect_ratio(FormatContext, videoStream, frame);
+
+
+        if ((Settings->AllowFrameDrop && getMasterSyncType() != ESynchronizationType::VideoMaster)) {
+            if (frame->pts != AV_NOPTS_VALUE) {
+                double diff = dpts - GetMasterClock();
+                if (!isnan(diff) && fabs(diff) < AV_NOSYNC_THRESHOLD &&
+                    diff /*- frame_last_filter_delay*/ < 0 &&
+                    viddec->GetPktSerial() == vidclk.GetSerial() &&
+                    videoq.GetNumPackets()) {
+                    frameDropsEarly++;
+                    av_frame_unref(frame);
+                    got_picture = 0;
+                }
+            }
+        }
+
+        if (got_picture && waitKeyFrame) {
+            /* the references were skipped while hidden, nothing before the next key frame decodes cleanly */
+            if (frame->key_frame && qosClass != EFFMPEGMediaQoS::Hidden) {
+                waitKeyFrame = false;
+            } else {
+                qosSkippedFrames++;
+                av_frame_unref(frame);
+                got_picture = 0;
+            }
+        }
+
+        double interval = GetQoSFrameInterval();
+        if (got_picture && interval > 0.0 && !isnan(dpts)) {
+            /* a tenth of the interval covers the rounding of the timestamps, 30 fps capped to 15 keeps every other frame */
+            if (viddec->GetPktSerial() == lastQueuedSerial && dpts >= lastQueuedPts && dpts - lastQueuedPts < interval * 0.9) {
+                qosSkippedFrames++;
+                av_frame_unref(frame);
+                got_picture = 0;
+            } else {
+                lastQueuedPts = dpts;
+                lastQueuedSerial = viddec->GetPktSerial();
+            }
+        }
+    }
+
+    return got_picture;
+}
+
+void FFFMPEGMediaTracks::ApplyVideoQoS() {
+    AVCodecContext *avctx = viddec->GetAvctx();
+    enum AVDiscard skip;
+
+    switch (qosClass.load()) {
+    case EFFMPEGMediaQoS::Hidden:
+        skip = AVDISCARD_ALL;
+        waitKeyFrame = true;
+        break;
+    case EFFMPEGMediaQoS::Background:
+        skip = AVDISCARD_NONREF;
+        break;
+    default:
+        skip = AVDISCARD_DEFAULT;
+        break;
+    }
+
+    /* coming back from hidden, decode the key frames only until the first one is out */
+    if (waitKeyFrame && skip != AVDISCARD_ALL)
+        skip = AVDISCARD_NONKEY;
+
+    /* between two decode calls, frame threading copies it to the worker contexts with the next packet */
+    if (avctx && avctx->skip_frame != skip)
+        avctx->skip_frame = skip;
+}
+
+double FFFMPEGMediaTracks::GetQoSFrameInterval() const {
+    const auto Settings = GetDefault<UFFMPEGMediaSettings>();
+
+    if (qosClass == EFFMPEGMediaQoS::Background && Settings->BackgroundFrameRate > 0.0f)
+        return 1.0 / Settings->BackgroundFrameRate;
+
+    return 0.0;
+}
+
+int FFFMPEGMediaTracks::VideoThread() {
+
+    AVFrame *frame = av_frame_alloc();
+    double pts;
+    double duration;
+    int ret;
+    AVRational tb = videoStream->time_base;
+    AVRational frame_rate = av_guess_frame_rate(FormatContext, videoStream, NULL);
+
+    if (!frame) {
+        return AVERROR(ENOMEM);
+    }
+
+    for (;;) {
+        ret = GetVideoFrame(frame);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return 0;
+        }
+        if (!ret)
+            continue;
+
+        duration = (frame_rate.num && frame_rate.den ? av_q2d({ frame_rate.den, frame_rate.num }) : 0);
+        pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb);
+
+        /* keep the queued frames inside this player's share of the memory budget */
+        int frame_size = av_image_get_buffer_size((AVPixelFormat)frame->format, frame->width, frame->height, 1);
+        videoFrameBytes = FFMAX(frame_size, 0);
+        ApplyFrameBudget(pictq, videoFrameBytes + videoSampleBytes, videoFrameQueueSize, TEXT("video"), videoOverBudget);
+
+        ret = pictq.QueuePicture(frame, pts, duration, frame->pkt_pos, viddec->GetPktSerial());
+        
+        av_frame_unref(frame);
+
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return 0;
+        }
+    }
+
+    av_frame_free(&frame);
+    return 0;
+}
+
+
+int FFFMPEGMediaTracks::GetBufferCallback(AVCodecContext *avctx, AVFrame *frame, int flags) {
+    FFFMPEGMediaTracks* tracks = (FFFMPEGMediaTracks*)avctx->opaque;
+    return tracks->videoAllocator.GetBuffer(avctx, frame, flags);
+}
+
+int FFFMPEGMediaTracks::HWAccelRetrieveDataCallback(AVCodecContext *avctx, AVFrame *input) {
+    FFFMPEGMediaTracks *ist = (FFFMPEGMediaTracks*)avctx->opaque;
+    AVFrame *output = NULL;
+    //enum AVPixelFormat output_format = ist->hwaccel_output_format;
+    enum AVPixelFormat output_format = AV_PIX_FMT_NONE;
+    int err;
+
+    if (input->format == output_format) {
+        // Nothing to do.
+        return 0;
+    }
+
+    output = av_frame_alloc();
+    if (!output)
+        return AVERROR(ENOMEM);
+
+    output->format = output_format;
+
+    err = av_hwframe_transfer_data(output, input, 0);
+    if (err < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to transfer data to "
+            "output frame: %d.\n", err);
+        av_frame_free(&output);
+        return err;
+    }
+
+    err = av_frame_copy_props(output, input);
+    if (err < 0) {
+        av_frame_unref(output);
+        av_frame_free(&output);
+        return err;
+    }
+
+    av_frame_unref(input);
+    av_frame_move_ref(input, output);
+    av_frame_free(&output);
+
+    return 0;
+
+}
+
+int FFFMPEGMediaTracks::IsRealtime(AVFormatContext *s) {
+	if (!strcmp(s->iformat->name, "rtp")
+		|| !strcmp(s->iformat->name, "rtsp")
+		|| !strcmp(s->iformat->name, "sdp")
+		)
+		return 1;
+
+	if (s->pb && (!strncmp(s->url, "rtp:", 4)
+		|| !strncmp(s->url, "udp:", 4)
+		)
+		)
+		return 1;
+	return 0;
+}
+
+
+
+#undef LOCTEXT_NAMESPACE
@@ -5,8 +5,15 @@
 
 #include "FFMPEGMediaSettings.h"
 #include "FFMPEGMediaPrivate.h"
+#include "IFFMPEGMediaPlayer.h"
 #include "FFMPEGFrameQueue.h"
 #include "FFMPEGClock.h"
+#include "FFMPEGDecoderThreading.h"
+#include "FFMPEGFrameAllocator.h"
+#include "FFMPEGPipelineState.h"
+#include "FFMPEGSliceScaler.h"
+#include "FFMPEGTaskPool.h"
+#include "FFMPEGYUVConverter.h"
 
 
 #include "CoreTypes.h"
@@ -14,18 +21,25 @@
 #include "Containers/UnrealString.h"
 #include "Internationalization/Text.h"
 #include "IMediaSamples.h"
+#include "IMediaTextureSample.h"
 #include "IMediaTracks.h"
 #include "IMediaControls.h"
+#include "IMediaCache.h"
 #include "Math/IntPoint.h"
 #include "MediaSampleQueue.h"
+#include "FFMPEGMediaSampleStore.h"
 #include "Templates/SharedPointer.h"
 #include "MediaPlayerOptions.h"
 
 #include "HAL/RunnableThread.h"
 
+#include <atomic>
+
 
 class FFFMPEGMediaAudioSamplePool;
+class FFFMPEGMediaTextureSample;
 class FFFMPEGMediaTextureSamplePool;
+class IMediaOptions;
 
 struct AVFormatContext;
 struct AVCodec;
@@ -84,6 +98,43 @@ class FFFMPEGMediaTracks
 		int StreamIndex;
 	};
 
+	/**
+	 * Immutable copy of the tracks and the selection.
+	 *
+	 * The game thread queries read the latest published snapshot, so they
+	 * never wait on SelectTrack or on the pipeline threads.
+	 */
+	struct FTrackSnapshot
+	{
+		TArray<FTrack> AudioTracks;
+		TArray<FTrack> CaptionTracks;
+		TArray<FTrack> MetadataTracks;
+		TArray<FTrack> VideoTracks;
+
+		int32 SelectedAudioTrack = INDEX_NONE;
+		int32 SelectedCaptionTrack = INDEX_NONE;
+		int32 SelectedMetadataTrack = INDEX_NONE;
+		int32 SelectedVideoTrack = INDEX_NONE;
+
+		/** Get the tracks of the given type, nullptr for unsupported types. */
+		const TArray<FTrack>* GetTracks(EMediaTrackType TrackType) const;
+
+		/** Get the specified track, nullptr if not found. */
+		const FTrack* GetTrack(EMediaTrackType TrackType, int32 TrackIndex) const;
+
+		/** Get the selected track of the given type. */
+		int32 GetSelectedTrack(EMediaTrackType TrackType) const;
+	};
+
+	typedef TSharedRef<const FTrackSnapshot, ESPMode::ThreadSafe> FTrackSnapshotRef;
+
+	/** Read ahead watermarks of a stream type, in seconds. A high watermark of 0 doesn't keep the reader going. */
+	struct FBufferWatermarks
+	{
+		double Low;
+		double High;
+	};
+
 public:
 
 	/** Default constructor. */
@@ -147,6 +198,49 @@ public:
 	 */
 	void Initialize(AVFormatContext *ic, const FString& Url, const FMediaPlayerOptions* PlayerOptions );
 
+	/**
+	 * Set the frame and packet queue depths used by the next Initialize.
+	 *
+	 * The defaults come from the plugin settings, the media options with the
+	 * same names as the settings override them for this player.
+	 *
+	 * @param Options The media options passed to the player, can be null.
+	 */
+	void SetQueueDepths(const IMediaOptions* Options);
+
+	/**
+	 * Get the time ranges covered by the queued packets.
+	 *
+	 * @see IMediaCache::QueryCacheState
+	 */
+	bool QueryCacheState(EMediaCacheState State, TRangeSet<FTimespan>& OutTimeRanges) const;
+
+	/**
+	 * Get the number of queued packets or decoded frames.
+	 *
+	 * @see IMediaCache::GetSampleCount
+	 */
+	int32 GetSampleCount(EMediaCacheState State) const;
+
+	/**
+	 * Set this player's share of the global memory budget.
+	 *
+	 * @param PacketBytes Maximum size of the queued packets.
+	 * @param FrameBytes Maximum size of the decoded frames and converted samples of every stream.
+	 * @see FFFMPEGMediaMemoryBudget
+	 */
+	void SetMemoryBudget(int64 PacketBytes, int64 FrameBytes);
+
+	/** Get the memory currently used by the queued packets, the decoded frames and the converted samples. */
+	void GetMemoryUsage(int64& OutPacketBytes, int64& OutFrameBytes) const;
+
+	/** Set the weight of this player's share of the memory budget. */
+	void SetMemoryPriority(int32 Priority);
+	int32 GetMemoryPriority() const;
+
+	/** Get the URL of the opened media. */
+	FString GetMediaUrl() const;
+
 	/**
 	 * Reinitialize the track collection
 	 *
@@ -179,6 +273,33 @@ public:
      */
     void TickInput(FTimespan DeltaTime, FTimespan Timecode);
 
+	/**
+	 * Limit the size of the converted video frames.
+	 *
+	 * @param Resolution The maximum width and height, a zero component means no limit.
+	 */
+	void SetMaxOutputResolution(const FIntPoint& Resolution);
+	FIntPoint GetMaxOutputResolution() const;
+
+	/**
+	 * Set the video level of detail, each level halves the output size.
+	 *
+	 * A level below the decoder lowres reopens the video track.
+	 *
+	 * @param Level The level of detail, also used as decoder lowres when the video track is opened.
+	 */
+	void SetOutputLOD(int32 Level);
+	int32 GetOutputLOD() const;
+
+	/**
+	 * Set the quality of service class.
+	 *
+	 * @param QoS The new class, the task priorities change now and the decoder picks it up at the next frame.
+	 * @see EFFMPEGMediaQoS
+	 */
+	void SetQoS(EFFMPEGMediaQoS QoS);
+	EFFMPEGMediaQoS GetQoS() const;
+
 
 
 public:
@@ -256,48 +377,34 @@ protected:
 
 private:
 
-	/**
-	 * Get the specified audio format.
-	 *
-	 * @param TrackIndex Index of the audio track that contains the format.
-	 * @param FormatIndex Index of the format to return.
-	 * @return Pointer to format, or nullptr if not found.
-	 * @see GetVideoFormat
-	 */
-	const FFormat* GetAudioFormat(int32 TrackIndex, int32 FormatIndex) const;
-
-	/**
-	 * Get the specified track information.
-	 *
-	 * @param TrackType The type of track.
-	 * @param TrackIndex Index of the track to return.
-	 * @return Pointer to track, or nullptr if not found.
-	 */
-	const FTrack* GetTrack(EMediaTrackType TrackType, int32 TrackIndex) const;
-
 	/**
 	 * Get the specified video format.
 	 *
 	 * @param TrackIndex Index of the video track that contains the format.
 	 * @param FormatIndex Index of the format to return.
 	 * @return Pointer to format, or nullptr if not found.
-	 * @see GetAudioFormat
 	 */
 	const FFormat* GetVideoFormat(int32 TrackIndex, int32 FormatIndex) const;
 
+	/** Get the latest published copy of the tracks. */
+	FTrackSnapshotRef GetTrackSnapshot() const;
+
+	/** Publish a copy of the tracks and the selection, called after every change. */
+	void PublishTracks();
+
 private:
 
 	/** Audio sample object pool. */
 	FFFMPEGMediaAudioSamplePool* AudioSamplePool;
 
 	/** Audio sample queue. */
-	TMediaSampleQueue<IMediaAudioSample> AudioSampleQueue;
+	TFFMPEGMediaSampleStore<IMediaAudioSample> AudioSampleQueue;
 
 	/** The available audio tracks. */
 	TArray<FTrack> AudioTracks;
 
 	/** Overlay sample queue. */
-	TMediaSampleQueue<IMediaOverlaySample> CaptionSampleQueue;
+	TFFMPEGMediaSampleStore<IMediaOverlaySample> CaptionSampleQueue;
 
 	/** The available caption tracks. */
 	TArray<FTrack> CaptionTracks;
@@ -305,6 +412,12 @@ private:
 	/** Synchronizes write access to track arrays, selections & sinks. */
 	mutable FCriticalSection CriticalSection;
 
+	/** The tracks as last published, see PublishTracks. */
+	FTrackSnapshotRef TrackSnapshot;
+
+	/** Only held to copy or replace the TrackSnapshot reference. */
+	mutable FCriticalSection TrackSnapshotCriticalSection;
+
 	/** Media information string. */
 	FString Info;
 
@@ -345,7 +458,7 @@ private:
 	FFFMPEGMediaTextureSamplePool* VideoSamplePool;
 
 	/** Video sample queue. */
-	TMediaSampleQueue<IMediaTextureSample> VideoSampleQueue;
+	TFFMPEGMediaSampleStore<IMediaTextureSample> VideoSampleQueue;
 
 	/** The available video tracks. */
 	TArray<FTrack> VideoTracks;
@@ -356,8 +469,8 @@ private:
     /** Media events to be forwarded to main thread. */
     TQueue<EMediaEvent> DeferredEvents;
 
-    /** Media playback state. */
-    EMediaState CurrentState;
+    /** Media playback state, written by the game and read threads and read by all of them. */
+    std::atomic<EMediaState> CurrentState;
 
     EMediaState LastState;
 
@@ -373,7 +486,7 @@ private:
     bool ShouldLoop;
 
 
-    bool bPrerolled;
+    std::atomic<bool> bPrerolled;
 
 
     /** FFMPEG methods */
@@ -386,17 +499,35 @@ private:
     /** Find the better accelerated device type for the given codec*/
     static enum AVHWDeviceType FindBetterDeviceType(const AVCodec* codec, int& lastSelection);
 
+    /** Create the hardware device of the decoder and attach it to the codec context, false if the device isn't available */
+    bool CreateHardwareDevice(AVCodecContext* avctx, const AVCodec* hwCodec, enum AVHWDeviceType type);
+
     /** Callback for ffmpeg to return the right format when is hardware accelerated*/
     static enum AVPixelFormat GetFormatCallback(AVCodecContext *s, const enum AVPixelFormat *pix_fmts);
 
     /** Callback for ffmpeg to transfer the gpu data to the cpu when is harware accelerated*/
     static int HWAccelRetrieveDataCallback(AVCodecContext *avctx, AVFrame *input);
 
+    /** Callback for ffmpeg to get the video frame buffers from the pools */
+    static int GetBufferCallback(AVCodecContext *avctx, AVFrame *frame, int flags);
+
     /** Invoked to seek in the stream*/
     void StreamSeek( int64_t pos, int64_t rel, int seek_by_bytes);
 
-    /** Check if the stream buffer has enought callbacks*/
-    int StreamHasEnoughPackets(AVStream *st, int stream_id, FFMPEGPacketQueue *queue);
+    /** Seconds of packets queued for a stream, infinite when the stream doesn't need buffering */
+    double GetStreamBufferLevel(const AVStream *st, int stream_id, const FFMPEGPacketQueue *queue, const FBufferWatermarks& watermarks) const;
+
+    /** Seconds queued for the stream that is the furthest behind, and the high watermark of that stream */
+    double GetBufferLevel(double *high_watermark = NULL) const;
+
+    /** Packet slots for a stream, enough to reach the high watermark */
+    int GetPacketQueueCapacity(const AVStream *st) const;
+
+    /** Limit the depth of a frame queue to what the other queues leave of the frame budget */
+    void ApplyFrameBudget(FFMPEGFrameQueue& fq, int64 frame_bytes, int max_depth, const TCHAR* name, bool& over_budget);
+
+    /** Decide if the read thread should read more packets, switching between the watermarks */
+    bool NeedsMorePackets();
 
     /** Open the given stream using the stream_index*/
     int  StreamComponentOpen(int stream_index);
@@ -408,7 +539,28 @@ private:
     ESynchronizationType getMasterSyncType();
 
     /** Transfer the obtained ffmpeg texture to the IMediaTexture */
-    int UploadTexture(FFMPEGFrame* vp, AVFrame *frame, struct SwsContext **img_convert_ctx);
+    TSharedPtr<FFFMPEGMediaTextureSample, ESPMode::ThreadSafe> ConvertFrame(FFMPEGFrame* vp, AVFrame *frame);
+    AVBufferRef* AcquireVideoBuffer(int size);
+    FIntPoint GetOutputSize(int width, int height) const;
+    int GetConversionSlices(int height) const;
+    bool GetNativeYUVBuffer(AVFrame *frame, AVBufferRef** buffer, uint8_t** data, int* pitch, FIntPoint& Dim, EMediaTextureSampleFormat& Format);
+
+    /** Hands a sample to the engine, applying the overflow policy when the queue already holds MaxSamples */
+    template <typename SampleType, typename InSampleType>
+    bool EnqueueSample(TFFMPEGMediaSampleStore<SampleType>& Queue, const TSharedRef<InSampleType, ESPMode::ThreadSafe>& Sample, int MaxSamples, std::atomic<int64>& Dropped);
+
+    /** Makes the samples already handed to the engine stale, called after a seek or a loop flushed the packet queues */
+    void StartSampleSequence();
+
+    /** Sequence index for a sample decoded from a packet of the given serial */
+    int64 GetSampleSequence(int serial, const FFMPEGPacketQueue& queue) const;
+
+    /** Whether a new sample would be thrown away, decided under the queue lock so the producers can skip making it */
+    template <typename SampleType>
+    bool WouldDropSample(TFFMPEGMediaSampleStore<SampleType>& Queue, int MaxSamples, const FMediaTimeStamp& Time, FTimespan Duration);
+
+    /** Whether a new sample for the queue would have to wait for the engine, the tasks retry later instead of holding a worker */
+    bool WouldBlockSample(int NumSamples, int MaxSamples) const;
 
     /** Waits for the audio to be in sync when the synchronization is not made through the audio clock */
     int SynchronizeAudio( int nb_samples);
@@ -416,9 +568,25 @@ private:
     /** Decode a frame from the packet queue and extract the AVFrame*/
     int GetVideoFrame(AVFrame *frame);
 
+    /** Sets the frames the video decoder skips for the QoS class, called by the video decoder thread before every packet*/
+    void ApplyVideoQoS();
+
+    /** Minimum time between two queued pictures for the QoS class, 0 when there's no limit*/
+    double GetQoSFrameInterval() const;
+
+    /** Priorities of the tasks of the video stages for the QoS class, and of the audio render which is above all of them*/
+    FFMPEGTaskPriority GetVideoTaskPriority() const;
+    FFMPEGTaskPriority GetAudioTaskPriority() const;
+
 
     /** Function to run while is reading the file*/
     int  ReadThread();
+
+    /** Wakes up the read thread when it's waiting for buffer space or stream changes*/
+    void WakeReadThread();
+
+    /** Blocks the read thread until it's woken up or the timeout expires*/
+    void WaitReadThread(unsigned int ms);
     
     /** Decode the audio frames from the packet queue*/
     int AudioThread();
@@ -429,34 +597,53 @@ private:
     /** Extract the picture queue */
     int VideoThread();
 
-    /** Thread to convert the video frames*/
-    int DisplayThread();
+    /** Presents the next picture, returns the delay until the next refresh*/
+    double DisplayTick();
 
-    /** Decode an audio frame and extract the current time and duration for each sample*/
+    /** Converts the next decoded picture into a texture sample ahead of presentation, parks when there's none*/
+    double ConvertTick();
+
+    /** Decode an audio frame and extract the current time and duration for each sample, AVERROR(EAGAIN) when no frame of the current serial is ready*/
     int AudioDecodeFrame (FTimespan& Time, FTimespan& Duration);
 
-    /** Convert the audio frame to be played by the media player*/
-    void RenderAudio();
+    /** Convert the audio frame to be played by the media player, false when no frame of the current serial is ready*/
+    bool RenderAudio();
     
-    /** Thread to convert the audio frames */
-    int AudioRenderThread();
+    /** Converts the next audio frame, parks when the sample queue is empty */
+    double AudioRenderTick();
 
     /** Refresh the media sample when is need it */
     void VideoRefresh(double *remaining_time);
 
-    /** Starts the display thread*/
-    void StartDisplayThread();
+    /** Maps the media state and the preroll flag to the pipeline state and wakes the waiting threads*/
+    void UpdatePipelineState();
+
+    /** Marks the pipeline as prerolled once the first frame has been decoded*/
+    void Preroll();
+
+    /** Wakes the tasks parked until the pipeline state changes*/
+    void WakeTasks();
 
-    /** Stops the display thread*/
-    void StopDisplayThread();
+    /** Schedules the display task*/
+    void StartDisplayTask();
 
-    /** Starts the audio render thread*/
-    void StartAudioRenderThread();
+    /** Cancels the display task*/
+    void StopDisplayTask();
 
-    /** Stops the audio render thread*/
-    void StopAudioRenderThread();
+    /** Schedules the audio render task*/
+    void StartAudioRenderTask();
 
-    void VideoDisplay ();
+    /** Cancels the audio render task*/
+    void StopAudioRenderTask();
+
+    /** Schedules the convert task*/
+    void StartConvertTask();
+
+    /** Cancels the convert task*/
+    void StopConvertTask();
+
+    /** Hands the shown picture to the engine, returns false when it's still being converted*/
+    bool VideoDisplay ();
     void StepToNextFrame();
     void StreamTogglePause();
     double ComputeTargetDelay(double delay);
@@ -465,15 +652,18 @@ private:
     double GetMasterClock();
     static int  IsRealtime(AVFormatContext *s);
 
-    struct SwsContext *imgConvertCtx;
+    FFMPEGSliceScaler imgConverter;
+    FFMPEGFrameAllocator videoAllocator;
     
     FRunnableThread* readThread;
     FRunnableThread* audioThread;
     FRunnableThread* videoThread;
     FRunnableThread* subtitleThread;
-    FRunnableThread* displayThread;
-    
-    FRunnableThread* audioRenderThread;
+
+    /* the display, convert and audio render stages run on the shared task pool */
+    FFMPEGTaskRef displayTask;
+    FFMPEGTaskRef convertTask;
+    FFMPEGTaskRef audioRenderTask;
 
     AVStream *audioStream;
     AVStream *videoStream;
@@ -499,21 +689,24 @@ private:
 
     struct SwrContext *swrContext;
 
-    CondWait continueReadCond;
-
-
     TSharedPtr<FFMPEGDecoder> auddec;
     TSharedPtr<FFMPEGDecoder> viddec;
     TSharedPtr<FFMPEGDecoder> subdec;
 
-    bool             aborted;
-    bool             displayRunning;
-    bool             audioRunning;
-    int              eof;
-    bool             step;
+    /* threading picked for the open video decoder, a count of 0 means none is open */
+    std::atomic<int> videoThreadType;
+    std::atomic<int> videoThreadCount;
+    std::atomic<const char*> videoThreadReason;
+
+    /* state and commands shared by the pipeline threads, seeks are posted on it */
+    FFMPEGPipelineState pipelineState;
+
+    std::atomic<bool> displayRunning;
+    std::atomic<bool> audioRunning;
+    std::atomic<int>  eof;
+    std::atomic<bool> step;
 
-    //Seek options
-    bool             seekReq;
+    //Seek options, written before the Seek command is posted
     int64_t          seekPos;
     int64_t          seekRel;
     int              seekFlags;
@@ -524,7 +717,13 @@ private:
     int              audioStreamIdx;
     int              subtitleStreamIdx;
 
-    bool             forceRefresh;
+    std::atomic<bool> forceRefresh;
+
+    /* the shown picture was still being converted, the convert task wakes the display task when it's done */
+    std::atomic<bool> uploadPending;
+
+    /* the audio render task parked on an empty sample queue, the next pushed frame wakes it */
+    std::atomic<bool> audioStarved;
 
     int              frameDropsLate;
     int              frameDropsEarly;
@@ -534,7 +733,89 @@ private:
 
     bool             realtime;
 
-    TArray<uint8>	 dataBuffer;
+    /* pixel buffers handed to the texture samples, they return here when the sample is released */
+    struct AVBufferPool* videoBufferPool;
+    int              videoBufferPoolSize;
+
+    /* hand NV12, YUY2 and P010 frames to the engine instead of converting them to BGRA */
+    bool             nativeYUVOutput;
+
+    /* convert the common YUV formats to BGRA with FFMPEGYUVConverter instead of sws_scale */
+    bool             fastYUVConversion;
+
+    /* number of slices the BGRA conversion is split into, 0 splits the cores between the open videos */
+    int              conversionSlices;
+
+    /* output size limits, read by the convert task for every frame */
+    std::atomic<int> maxOutputWidth;
+    std::atomic<int> maxOutputHeight;
+    std::atomic<int> outputLOD;
+
+    /* lowres the video decoder was opened with */
+    std::atomic<int> videoLowres;
+
+    /* queue depths, see SetQueueDepths */
+    int              videoFrameQueueSize;
+    int              audioFrameQueueSize;
+    int              subtitleFrameQueueSize;
+    int              minQueuedPackets;
+    int              maxQueueSize;
+
+    /* read ahead watermarks in seconds, by stream type */
+    FBufferWatermarks videoWatermarks;
+    FBufferWatermarks audioWatermarks;
+    FBufferWatermarks subtitleWatermarks;
+
+    /* the read thread is filling the queues up to the high watermark */
+    std::atomic<bool> readingAhead;
+
+    /* share of the global memory budget */
+    std::atomic<int64> packetBudget;
+    std::atomic<int64> frameBudget;
+
+    /* weight of the share, kept for the next Initialize */
+    int32            memoryPriority;
+
+    /* size of the last decoded frame and of the buffer of the last converted sample */
+    std::atomic<int64> videoFrameBytes;
+    std::atomic<int64> videoSampleBytes;
+    std::atomic<int64> audioFrameBytes;
+    std::atomic<int64> audioSampleBytes;
+    std::atomic<int64> subtitleFrameBytes;
+
+    /* a queue is at its minimum depth and still over the budget, used by its decoder thread only */
+    bool             videoOverBudget;
+    bool             audioOverBudget;
+    bool             subtitleOverBudget;
+    std::atomic<int64> frameBudgetOverruns;
+
+    /* bounds of the queues the engine fetches the samples from, 0 means unbounded */
+    int              maxVideoSamples;
+    int              maxAudioSamples;
+    ESampleQueueOverflow sampleQueueOverflow;
+
+    /* protects the audio, caption and video sample stores */
+    FCriticalSection sampleQueueMutex;
+    /* signaled when the engine fetched a sample, blocked producers wait on it */
+    CondWait         sampleQueueCond;
+
+    std::atomic<int64> droppedVideoSamples;
+    std::atomic<int64> droppedAudioSamples;
+    std::atomic<int64> skippedConversions;
+    std::atomic<int64> skippedAudioSamples;
+
+    /* quality of service class, see SetQoS */
+    std::atomic<EFFMPEGMediaQoS> qosClass;
+    /* the video decoder skips everything but key frames until one comes out, used by the video decoder thread only */
+    bool             waitKeyFrame;
+    /* pts and serial of the last picture queued under the frame rate cap */
+    double           lastQueuedPts;
+    int              lastQueuedSerial;
+    /* decoded pictures thrown away by the QoS class */
+    std::atomic<int64> qosSkippedFrames;
+
+    /* bumped by every seek and loop, carried in the time stamps of the samples */
+    std::atomic<int64> sampleSequenceIndex;
 
     ESynchronizationType         sychronizationType;
 
@@ -0,0 +1,119 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGDecoderThreading.h"
+
+#include "Math/UnrealMathUtility.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+extern "C" {
+#include "libavutil/cpu.h"
+}
+
+
+namespace FFMPEGDecoderThreadingTest
+{
+	/** Pick the threading of a decoder with the given capabilities, the real codecs differ between FFMPEG builds. */
+	FFMPEGDecoderThreading Choose(int Capabilities, AVMediaType Type, int Width, int Height, bool bLive, int MaxThreads = 0)
+	{
+		AVCodec Codec = {};
+		Codec.capabilities = Capabilities;
+
+		AVCodecContext* Context = avcodec_alloc_context3(nullptr);
+		Context->codec_type = Type;
+		Context->width = Width;
+		Context->height = Height;
+
+		const FFMPEGDecoderThreading Threading = FFMPEGDecoderThreadingPolicy::Choose(&Codec, Context, bLive, MaxThreads);
+
+		avcodec_free_context(&Context);
+
+		return Threading;
+	}
+
+	/** Threads each video decoder gets from the cores, this one included. */
+	int GetCoresPerDecoder()
+	{
+		return FMath::Max(av_cpu_count() / (FFMPEGDecoderThreadingPolicy::GetNumVideoDecoders() + 1), 1);
+	}
+
+	const int FrameAndSlice = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGDecoderThreadingTypeTest, "System.Plugins.FFMPEGMedia.DecoderThreading.Type",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGDecoderThreadingTypeTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGDecoderThreadingTest;
+
+	// a file goes through fastest with frame threads
+	TestEqual(TEXT("File uses frame threads"), Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 1920, 1080, false).thread_type, FF_THREAD_FRAME);
+
+	// frame threads hold frames back, a live source avoids them when it can
+	TestEqual(TEXT("Live uses slice threads"), Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 1920, 1080, true).thread_type, FF_THREAD_SLICE);
+
+	const FFMPEGDecoderThreading LiveFrame = Choose(AV_CODEC_CAP_FRAME_THREADS, AVMEDIA_TYPE_VIDEO, 1920, 1080, true);
+	TestEqual(TEXT("Live without slice threads uses frame threads"), LiveFrame.thread_type, FF_THREAD_FRAME);
+	TestTrue(FString::Printf(TEXT("Live frame threads are limited (%d)"), LiveFrame.thread_count), LiveFrame.thread_count <= 2);
+
+	TestEqual(TEXT("Slice only codec"), Choose(AV_CODEC_CAP_SLICE_THREADS, AVMEDIA_TYPE_VIDEO, 1920, 1080, false).thread_type, FF_THREAD_SLICE);
+
+	const FFMPEGDecoderThreading Single = Choose(0, AVMEDIA_TYPE_VIDEO, 1920, 1080, false);
+	TestEqual(TEXT("Single threaded codec has no thread type"), Single.thread_type, 0);
+	TestEqual(TEXT("Single threaded codec has one thread"), Single.thread_count, 1);
+
+	const FFMPEGDecoderThreading Hardware = Choose(FrameAndSlice | AV_CODEC_CAP_HARDWARE, AVMEDIA_TYPE_VIDEO, 3840, 2160, false);
+	TestEqual(TEXT("Hardware decoder has one thread"), Hardware.thread_count, 1);
+
+	// the audio packets are too small to split
+	TestEqual(TEXT("Audio has one thread"), Choose(FrameAndSlice, AVMEDIA_TYPE_AUDIO, 0, 0, false).thread_count, 1);
+	TestEqual(TEXT("Configured audio threads"), Choose(FrameAndSlice, AVMEDIA_TYPE_AUDIO, 0, 0, false, 3).thread_count, 3);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGDecoderThreadingCountTest, "System.Plugins.FFMPEGMedia.DecoderThreading.Count",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGDecoderThreadingCountTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGDecoderThreadingTest;
+
+	// the thread count follows the resolution, within the cores of this decoder
+	const int Small = Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 640, 360, false).thread_count;
+	const int Large = Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 3840, 2160, false).thread_count;
+
+	TestEqual(TEXT("Small picture"), Small, FMath::Min(2, GetCoresPerDecoder()));
+	TestEqual(TEXT("Large picture"), Large, FMath::Min(12, GetCoresPerDecoder()));
+	TestTrue(TEXT("Small pictures never get more threads than large ones"), Small <= Large);
+
+	TestEqual(TEXT("Configured count wins"), Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 640, 360, false, 6).thread_count, 6);
+	TestEqual(TEXT("Configured count is capped"), Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 640, 360, false, 64).thread_count, 16);
+
+	// more players open, fewer threads each
+	const int NumOthers = 7;
+
+	for (int Index = 0; Index < NumOthers; ++Index)
+	{
+		FFMPEGDecoderThreadingPolicy::AddVideoDecoder();
+	}
+
+	const int Shared = Choose(FrameAndSlice, AVMEDIA_TYPE_VIDEO, 3840, 2160, false).thread_count;
+	const int Expected = FMath::Min(12, GetCoresPerDecoder());
+
+	for (int Index = 0; Index < NumOthers; ++Index)
+	{
+		FFMPEGDecoderThreadingPolicy::RemoveVideoDecoder();
+	}
+
+	TestEqual(TEXT("The cores are split between the decoders"), Shared, Expected);
+	TestTrue(TEXT("Other decoders never add threads"), Shared <= Large);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,209 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGFrameQueue.h"
+#include "FFMPEGFrame.h"
+#include "FFMPEGPacketQueue.h"
+#include "LambdaFunctionRunnable.h"
+
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGFrameQueueTest
+{
+	/** Errors found by one round, counted from every thread. */
+	struct FErrors
+	{
+		FThreadSafeCounter Order;
+		FThreadSafeCounter Stage;
+	};
+
+	/**
+	 * Run the decoder, convert and display roles over one frame queue.
+	 *
+	 * The producer numbers the frames through their position, the convert thread
+	 * must see them in order and the reader must get every one of them. A third of
+	 * them are shown without waiting for their conversion, Next takes them away
+	 * from the convert thread when it didn't get to them yet.
+	 *
+	 * @return false if the round didn't finish in time.
+	 */
+	bool RunRound(int32 NumFrames, int32 QueueSize, FErrors& Errors)
+	{
+		FFMPEGPacketQueue PacketQueue;
+		FFMPEGFrameQueue FrameQueue;
+
+		PacketQueue.Start();
+
+		if (FrameQueue.Init(&PacketQueue, QueueSize, 1) < 0)
+		{
+			return false;
+		}
+
+		FThreadSafeBool bReaderDone;
+
+		FRunnableThread* Producer = LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGFrameQueueTestProducer"), [&] {
+			for (int32 Index = 0; Index < NumFrames; ++Index)
+			{
+				FFMPEGFrame* Frame = FrameQueue.PeekWritable();
+
+				if (Frame == nullptr)
+				{
+					return;
+				}
+
+				Frame->SetPos(Index);
+				Frame->SetSerial(1);
+				Frame->SetUploaded(false);
+				FrameQueue.Push();
+			}
+		});
+
+		FRunnableThread* Converter = LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGFrameQueueTestConverter"), [&] {
+			int64 LastPos = -1;
+
+			while (!bReaderDone && !PacketQueue.IsAbortRequest())
+			{
+				FFMPEGFrame* Frame = FrameQueue.PeekConvertible();
+
+				if (Frame == nullptr)
+				{
+					FPlatformProcess::Yield();
+					continue;
+				}
+
+				if (Frame->GetPos() <= LastPos)
+				{
+					Errors.Order.Increment();
+				}
+
+				// claimed twice, or after the reader was done with it
+				if (Frame->IsUploaded())
+				{
+					Errors.Stage.Increment();
+				}
+
+				LastPos = Frame->GetPos();
+				Frame->SetUploaded(true);
+				FrameQueue.NextConverted();
+			}
+		});
+
+		FRunnableThread* Reader = LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGFrameQueueTestReader"), [&] {
+			for (int32 Index = 0; Index < NumFrames; ++Index)
+			{
+				FFMPEGFrame* Frame = FrameQueue.PeekReadable();
+
+				if (Frame == nullptr)
+				{
+					break;
+				}
+
+				if (Frame->GetPos() != Index)
+				{
+					Errors.Order.Increment();
+				}
+
+				// the shown frame is kept, it has to stay where PeekLast finds it
+				if ((Index > 0) && (FrameQueue.PeekLast()->GetPos() != Index - 1))
+				{
+					Errors.Order.Increment();
+				}
+
+				if (Index % 3 != 0)
+				{
+					while (!FrameQueue.IsConverted(Frame) && !PacketQueue.IsAbortRequest())
+					{
+						FPlatformProcess::Yield();
+					}
+
+					// the conversion has to be visible once the slot says it's done
+					if (!PacketQueue.IsAbortRequest() && !Frame->IsUploaded())
+					{
+						Errors.Stage.Increment();
+					}
+				}
+
+				FrameQueue.Next();
+			}
+
+			bReaderDone = true;
+		});
+
+		// a lost wakeup hangs one of the threads, abort the queues so they all return
+		const double EndTime = FPlatformTime::Seconds() + 60.0;
+
+		while (!bReaderDone && (FPlatformTime::Seconds() < EndTime))
+		{
+			FPlatformProcess::Sleep(0.01f);
+		}
+
+		const bool bFinished = bReaderDone;
+
+		if (!bFinished)
+		{
+			PacketQueue.Abort();
+			FrameQueue.Signal();
+		}
+
+		for (FRunnableThread* Thread : { Producer, Converter, Reader })
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+
+		FrameQueue.Destroy();
+
+		return bFinished;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGFrameQueueHandOverTest, "System.Plugins.FFMPEGMedia.FrameQueue.HandOver",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGFrameQueueHandOverTest::RunTest(const FString& Parameters)
+{
+	FFMPEGFrameQueueTest::FErrors Errors;
+
+	for (int32 QueueSize : { 2, VIDEO_PICTURE_QUEUE_SIZE, SUBPICTURE_QUEUE_SIZE })
+	{
+		if (!TestTrue(FString::Printf(TEXT("Round with %i slots finished"), QueueSize), FFMPEGFrameQueueTest::RunRound(10000, QueueSize, Errors)))
+		{
+			return false;
+		}
+	}
+
+	TestEqual(TEXT("Frames out of order"), Errors.Order.GetValue(), 0);
+	TestEqual(TEXT("Frames read before their conversion"), Errors.Stage.GetValue(), 0);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGFrameQueueStressTest, "System.Plugins.FFMPEGMedia.FrameQueue.Stress",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::StressFilter)
+
+bool FFFMPEGFrameQueueStressTest::RunTest(const FString& Parameters)
+{
+	FFMPEGFrameQueueTest::FErrors Errors;
+
+	for (int32 Round = 0; Round < 20; ++Round)
+	{
+		if (!TestTrue(FString::Printf(TEXT("Round %i finished"), Round), FFMPEGFrameQueueTest::RunRound(200000, VIDEO_PICTURE_QUEUE_SIZE, Errors)))
+		{
+			return false;
+		}
+	}
+
+	TestEqual(TEXT("Frames out of order"), Errors.Order.GetValue(), 0);
+	TestEqual(TEXT("Frames read before their conversion"), Errors.Stage.GetValue(), 0);
+
+	return true;
+}
+
+#endif
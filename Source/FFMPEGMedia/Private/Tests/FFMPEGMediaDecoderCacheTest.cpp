@@ -0,0 +1,94 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaDecoderCache.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaDecoderCacheKeyTest, "System.Plugins.FFMPEGMedia.DecoderCache.Key",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaDecoderCacheKeyTest::RunTest(const FString& Parameters)
+{
+	// the players share the singleton, the test uses a cache of its own
+	FFFMPEGMediaDecoderCache Cache;
+
+	AVCodecParameters* Main8 = avcodec_parameters_alloc();
+	Main8->codec_id = AV_CODEC_ID_HEVC;
+	Main8->profile = FF_PROFILE_HEVC_MAIN;
+	Main8->format = AV_PIX_FMT_YUV420P;
+
+	AVCodecParameters* Main10 = avcodec_parameters_alloc();
+	Main10->codec_id = AV_CODEC_ID_HEVC;
+	Main10->profile = FF_PROFILE_HEVC_MAIN_10;
+	Main10->format = AV_PIX_FMT_YUV420P10LE;
+
+	const FFFMPEGMediaDecoderKey Key8 = FFFMPEGMediaDecoderKey::FromParameters(Main8);
+	const FFFMPEGMediaDecoderKey Key10 = FFFMPEGMediaDecoderKey::FromParameters(Main10);
+
+	// without a pixel format the depth comes from the raw sample size
+	Main8->format = AV_PIX_FMT_NONE;
+	Main8->bits_per_raw_sample = 8;
+
+	TestEqual(TEXT("8 bit depth"), Key8.BitDepth, 8);
+	TestEqual(TEXT("10 bit depth"), Key10.BitDepth, 10);
+	TestTrue(TEXT("Same key from the raw sample size"), FFFMPEGMediaDecoderKey::FromParameters(Main8) == Key8);
+
+	avcodec_parameters_free(&Main8);
+	avcodec_parameters_free(&Main10);
+
+	// a decoder picked for the 8 bit stream isn't reused for the 10 bit one
+	const AVCodec* FakeDecoder = avcodec_find_decoder(AV_CODEC_ID_HEVC);
+	Cache.SetHardwareDecoder(Key8, FakeDecoder, AV_HWDEVICE_TYPE_CUDA, false);
+
+	const AVCodec* Decoder = nullptr;
+	AVHWDeviceType DeviceType = AV_HWDEVICE_TYPE_NONE;
+
+	TestTrue(TEXT("8 bit stream was probed"), Cache.FindHardwareDecoder(Key8, Decoder, DeviceType));
+	TestEqual(TEXT("8 bit device"), (int32)DeviceType, (int32)AV_HWDEVICE_TYPE_CUDA);
+	TestFalse(TEXT("10 bit stream wasn't probed"), Cache.FindHardwareDecoder(Key10, Decoder, DeviceType));
+
+	// no hardware decoder because of a device failure, the result isn't kept forever
+	Cache.SetHardwareDecoder(Key10, nullptr, AV_HWDEVICE_TYPE_NONE, true);
+	TestTrue(TEXT("Failed probe is kept for a while"), Cache.FindHardwareDecoder(Key10, Decoder, DeviceType));
+	TestNull(TEXT("Failed probe has no decoder"), Decoder);
+
+	Cache.RemoveHardwareDecoder(Key8);
+	TestFalse(TEXT("Removed stream is probed again"), Cache.FindHardwareDecoder(Key8, Decoder, DeviceType));
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaDecoderCacheDeviceTest, "System.Plugins.FFMPEGMedia.DecoderCache.Device",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaDecoderCacheDeviceTest::RunTest(const FString& Parameters)
+{
+	FFFMPEGMediaDecoderCache Cache;
+
+	TestFalse(TEXT("Untried device type is usable"), Cache.IsDeviceTypeUnusable(AV_HWDEVICE_TYPE_CUDA));
+
+	// not built in, never tried again
+	Cache.SetDeviceTypeResult(AV_HWDEVICE_TYPE_VDPAU, AVERROR(ENOSYS));
+	TestTrue(TEXT("Missing device type is unusable"), Cache.IsDeviceTypeUnusable(AV_HWDEVICE_TYPE_VDPAU));
+	TestTrue(TEXT("Missing device type is unsupported"), Cache.IsDeviceTypeUnsupported(AV_HWDEVICE_TYPE_VDPAU));
+
+	// anything else waits for the retry delay only
+	Cache.SetDeviceTypeResult(AV_HWDEVICE_TYPE_CUDA, AVERROR(EIO));
+	TestTrue(TEXT("Failed device type waits"), Cache.IsDeviceTypeUnusable(AV_HWDEVICE_TYPE_CUDA));
+	TestFalse(TEXT("Failed device type is still supported"), Cache.IsDeviceTypeUnsupported(AV_HWDEVICE_TYPE_CUDA));
+
+	Cache.SetDeviceTypeResult(AV_HWDEVICE_TYPE_CUDA, 0);
+	TestFalse(TEXT("Created device type is usable again"), Cache.IsDeviceTypeUnusable(AV_HWDEVICE_TYPE_CUDA));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,84 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGMediaPlayer.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGMediaIdleTest
+{
+	/**
+	 * CPU a player may use per second while it's idle.
+	 *
+	 * The process CPU time also counts the engine threads, the tests compare
+	 * against a baseline taken without a player, this only absorbs the noise.
+	 */
+	const double MaxIdleCPUTime = 0.05;
+
+	/** Get the CPU time used while ticking the player for a second. */
+	double MeasureCPUTime(FFFMPEGMediaTestPlayer& Player)
+	{
+		const double Start = FFMPEGMediaTests::GetProcessCPUTime();
+		Player.TickFor(1.0);
+
+		return FFMPEGMediaTests::GetProcessCPUTime() - Start;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaIdlePausedCPUTest, "System.Plugins.FFMPEGMedia.Idle.PausedUsesNoCPU",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaIdlePausedCPUTest::RunTest(const FString& Parameters)
+{
+	FString Path;
+	FFFMPEGMediaTestClip Clip;
+	Clip.bAudio = true;
+
+	if (!FFMPEGMediaTests::WriteClip(TEXT("Idle"), Clip, Path))
+	{
+		AddError(TEXT("Couldn't write the test clip"));
+		return false;
+	}
+
+	// the same tick loop without a media, whatever the engine uses meanwhile
+	double Baseline;
+	{
+		FFFMPEGMediaTestPlayer Closed;
+		Baseline = FFMPEGMediaIdleTest::MeasureCPUTime(Closed);
+	}
+
+	FFFMPEGMediaTestPlayer Player;
+
+	if (!TestTrue(TEXT("Clip opened"), Player.Open(Path, true)))
+	{
+		return false;
+	}
+
+	// opened and never played, nothing is prerolled yet
+	Player.TickFor(0.5);
+
+	const double Opened = FFMPEGMediaIdleTest::MeasureCPUTime(Player) - Baseline;
+	TestTrue(FString::Printf(TEXT("CPU before preroll is near zero (%.3f s)"), Opened), Opened < FFMPEGMediaIdleTest::MaxIdleCPUTime);
+
+	Player.SetRate(1.0f);
+
+	if (!TestTrue(TEXT("Frames before pausing"), Player.TickUntil([&Player] { return Player.GetNumVideoSamples() >= 5; }, 5.0)))
+	{
+		return false;
+	}
+
+	// the queues are full once the decoders park
+	Player.SetRate(0.0f);
+	Player.TickFor(0.5);
+
+	const double Paused = FFMPEGMediaIdleTest::MeasureCPUTime(Player) - Baseline;
+	TestTrue(FString::Printf(TEXT("CPU while paused is near zero (%.3f s)"), Paused), Paused < FFMPEGMediaIdleTest::MaxIdleCPUTime);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGMediaPlayer.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaQoSHiddenResumeTest, "System.Plugins.FFMPEGMedia.QoS.HiddenResumes",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaQoSHiddenResumeTest::RunTest(const FString& Parameters)
+{
+	FString Path;
+	FFFMPEGMediaTestClip Clip;
+
+	if (!FFMPEGMediaTests::WriteClip(TEXT("QoS"), Clip, Path))
+	{
+		AddError(TEXT("Couldn't write the test clip"));
+		return false;
+	}
+
+	FFFMPEGMediaTestPlayer Player;
+
+	if (!TestTrue(TEXT("Clip opened"), Player.Open(Path)))
+	{
+		return false;
+	}
+
+	Player.SetRate(1.0f);
+
+	if (!TestTrue(TEXT("Frames before hiding"), Player.TickUntil([&Player] { return Player.GetNumVideoSamples() >= 5; }, 5.0)))
+	{
+		return false;
+	}
+
+	// the decoder discards every frame while hidden, let the converted ones drain
+	Player.GetPlayer().SetQoS(EFFMPEGMediaQoS::Hidden);
+	Player.TickFor(0.5);
+
+	const int64 HiddenStart = Player.GetNumVideoSamples();
+	Player.TickFor(1.0);
+	TestTrue(TEXT("No frames while hidden"), Player.GetNumVideoSamples() - HiddenStart <= 1);
+
+	// the decoder has to pick the new class up while it's consuming packets
+	Player.GetPlayer().SetQoS(EFFMPEGMediaQoS::Normal);
+
+	const int64 ShownStart = Player.GetNumVideoSamples();
+	TestTrue(TEXT("Frames resume after hidden"), Player.TickUntil([&Player, ShownStart] { return Player.GetNumVideoSamples() >= ShownStart + 5; }, 3.0));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,77 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGFrameQueue.h"
+#include "FFMPEGMediaPlayer.h"
+#include "FFMPEGMediaSettings.h"
+
+#include "IMediaCache.h"
+#include "Misc/AutomationTest.h"
+#include "Templates/UnrealTemplate.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGMediaQueueDepthTest
+{
+	/**
+	 * Play a clip with the given video frame queue depth.
+	 *
+	 * @return The most decoded frames seen waiting for the display, -1 if the clip didn't play.
+	 */
+	int32 GetMaxDecodedFrames(const FString& Path, int32 Depth)
+	{
+		TGuardValue<int> DepthGuard(GetMutableDefault<UFFMPEGMediaSettings>()->VideoFrameQueueSize, Depth);
+
+		FFFMPEGMediaTestPlayer Player;
+
+		if (!Player.Open(Path))
+		{
+			return -1;
+		}
+
+		Player.SetRate(1.0f);
+
+		// the decoder is much faster than the display, the queue stays full
+		int32 MaxDecodedFrames = 0;
+
+		Player.TickUntil([&Player, &MaxDecodedFrames] {
+			MaxDecodedFrames = FMath::Max(MaxDecodedFrames, Player.GetPlayer().GetCache().GetSampleCount(EMediaCacheState::Cached));
+			return false;
+		}, 1.5);
+
+		return (Player.GetNumVideoSamples() > 0) ? MaxDecodedFrames : -1;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaQueueDepthSettingTest, "System.Plugins.FFMPEGMedia.QueueDepth.FollowsSettings",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaQueueDepthSettingTest::RunTest(const FString& Parameters)
+{
+	FString Path;
+	FFFMPEGMediaTestClip Clip;
+
+	if (!FFMPEGMediaTests::WriteClip(TEXT("QueueDepth"), Clip, Path))
+	{
+		AddError(TEXT("Couldn't write the test clip"));
+		return false;
+	}
+
+	// the shown frame is kept in the queue and isn't counted
+	const int32 Shallow = FFMPEGMediaQueueDepthTest::GetMaxDecodedFrames(Path, 2);
+	const int32 Deep = FFMPEGMediaQueueDepthTest::GetMaxDecodedFrames(Path, 12);
+
+	if (!TestTrue(TEXT("Clip played with both depths"), (Shallow >= 0) && (Deep >= 0)))
+	{
+		return false;
+	}
+
+	TestTrue(FString::Printf(TEXT("Shallow queue holds at most one frame (%i)"), Shallow), Shallow <= 1);
+	TestTrue(FString::Printf(TEXT("Deep queue holds more than the default depth (%i)"), Deep), Deep > VIDEO_PICTURE_QUEUE_SIZE);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGMediaPlayer.h"
+#include "FFMPEGMediaSettings.h"
+
+#include "Misc/AutomationTest.h"
+#include "Templates/UnrealTemplate.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGMediaSampleQueueTest
+{
+	/** Samples the tests let the player queue. */
+	const int32 MaxVideoSamples = 4;
+
+	/** What was waiting in the video sample queue after a second without fetching. */
+	struct FQueued
+	{
+		int64 NumSamples = -1;
+		FTimespan LastSampleTime;
+	};
+
+	/** Play a clip for a second without fetching the video samples, then fetch them once. */
+	FQueued PlayWithoutFetching(const FString& Path, ESampleQueueOverflow Overflow)
+	{
+		UFFMPEGMediaSettings* Settings = GetMutableDefault<UFFMPEGMediaSettings>();
+		TGuardValue<int> MaxGuard(Settings->MaxVideoSamples, MaxVideoSamples);
+		TGuardValue<ESampleQueueOverflow> OverflowGuard(Settings->SampleQueueOverflow, Overflow);
+
+		FQueued Queued;
+		FFFMPEGMediaTestPlayer Player;
+
+		if (!Player.Open(Path))
+		{
+			return Queued;
+		}
+
+		Player.SetFetchVideo(false);
+		Player.SetRate(1.0f);
+		Player.TickFor(1.0);
+
+		Player.SetFetchVideo(true);
+
+		const int64 Fetched = Player.GetNumVideoSamples();
+		Player.Tick(0.0);
+
+		Queued.NumSamples = Player.GetNumVideoSamples() - Fetched;
+		Queued.LastSampleTime = Player.GetLastVideoSampleTime();
+
+		return Queued;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaSampleQueueOverflowTest, "System.Plugins.FFMPEGMedia.SampleQueue.Overflow",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaSampleQueueOverflowTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGMediaSampleQueueTest;
+
+	FString Path;
+	FFFMPEGMediaTestClip Clip;
+
+	if (!FFMPEGMediaTests::WriteClip(TEXT("SampleQueue"), Clip, Path))
+	{
+		AddError(TEXT("Couldn't write the test clip"));
+		return false;
+	}
+
+	// the first samples stay, the clock went on for a second
+	const FQueued Newest = PlayWithoutFetching(Path, ESampleQueueOverflow::DropNewest);
+
+	TestTrue(FString::Printf(TEXT("DropNewest queued samples (%lld)"), Newest.NumSamples), Newest.NumSamples > 0);
+	TestTrue(FString::Printf(TEXT("DropNewest keeps the bound (%lld)"), Newest.NumSamples), Newest.NumSamples <= MaxVideoSamples);
+	TestTrue(TEXT("DropNewest keeps the first samples"), Newest.LastSampleTime < FTimespan::FromSeconds(0.5));
+
+	// the last samples stay
+	const FQueued Oldest = PlayWithoutFetching(Path, ESampleQueueOverflow::DropOldest);
+
+	TestTrue(FString::Printf(TEXT("DropOldest queued samples (%lld)"), Oldest.NumSamples), Oldest.NumSamples > 0);
+	TestTrue(FString::Printf(TEXT("DropOldest keeps the bound (%lld)"), Oldest.NumSamples), Oldest.NumSamples <= MaxVideoSamples);
+	TestTrue(TEXT("DropOldest keeps the latest samples"), Oldest.LastSampleTime > FTimespan::FromSeconds(0.5));
+
+	// the display waits for the engine, nothing is thrown away
+	const FQueued Block = PlayWithoutFetching(Path, ESampleQueueOverflow::Block);
+
+	TestEqual(TEXT("Block fills the queue"), Block.NumSamples, (int64)MaxVideoSamples);
+
+	return true;
+}
+
+#endif
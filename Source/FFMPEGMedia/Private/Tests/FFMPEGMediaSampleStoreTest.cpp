@@ -0,0 +1,155 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaSampleStore.h"
+
+#include "IMediaTimeSource.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGMediaSampleStoreTest
+{
+	/** The part of a media sample the store looks at. */
+	class FSample
+	{
+	public:
+
+		FSample(double InTime, int64 InSequenceIndex)
+			: Time(FTimespan::FromSeconds(InTime), InSequenceIndex)
+		{ }
+
+		FMediaTimeStamp GetTime() const
+		{
+			return Time;
+		}
+
+		FTimespan GetDuration() const
+		{
+			return FTimespan::FromMilliseconds(100);
+		}
+
+	private:
+
+		FMediaTimeStamp Time;
+	};
+
+	typedef TFFMPEGMediaSampleStore<FSample> FStore;
+
+	/** Add a 100 ms sample. */
+	bool Enqueue(FStore& Store, double Time, int64 SequenceIndex = 0)
+	{
+		return Store.Enqueue(MakeShared<FSample, ESPMode::ThreadSafe>(Time, SequenceIndex));
+	}
+
+	/** Fetch the sample for a 10 ms range, -1 if there is none. */
+	double Fetch(FStore& Store, double Time)
+	{
+		FStore::FSamplePtr Sample;
+
+		if (!Store.Fetch(TRange<FTimespan>(FTimespan::FromSeconds(Time), FTimespan::FromSeconds(Time + 0.01)), Sample))
+		{
+			return -1.0;
+		}
+
+		return Sample->GetTime().Time.GetTotalSeconds();
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaSampleStoreFetchTest, "System.Plugins.FFMPEGMedia.SampleStore.Fetch",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaSampleStoreFetchTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGMediaSampleStoreTest;
+
+	FStore Store;
+
+	Enqueue(Store, 1.0);
+	Enqueue(Store, 1.1);
+	Enqueue(Store, 1.2);
+
+	// the clock hasn't reached the samples yet
+	TestEqual(TEXT("Fetch before the samples misses"), Fetch(Store, 0.5), -1.0);
+	TestEqual(TEXT("A miss before the samples keeps them"), Store.Num(), 3);
+
+	// the first sample ended before the range
+	TestEqual(TEXT("Fetch returns the overlapping sample"), Fetch(Store, 1.15), 1.1, 1e-6);
+	TestEqual(TEXT("The fetched and older samples are gone"), Store.Num(), 1);
+	TestEqual(TEXT("The skipped sample is counted"), Store.GetNumStale(), (int64)1);
+
+	// a gap between the samples, only what the clock passed goes
+	Enqueue(Store, 2.0);
+	TestEqual(TEXT("Fetch in a gap misses"), Fetch(Store, 1.5), -1.0);
+	TestEqual(TEXT("A miss in a gap keeps the later samples"), Store.Num(), 1);
+	TestEqual(TEXT("Fetch after the gap"), Fetch(Store, 2.05), 2.0, 1e-6);
+	TestEqual(TEXT("The store is empty"), Store.Num(), 0);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaSampleStoreSequenceTest, "System.Plugins.FFMPEGMedia.SampleStore.Sequence",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaSampleStoreSequenceTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGMediaSampleStoreTest;
+
+	FStore Store;
+
+	Enqueue(Store, 5.0);
+	Enqueue(Store, 5.1);
+
+	// a seek back to the start, the old samples are later than the new ones
+	Store.SetSequenceIndex(1);
+
+	TestFalse(TEXT("Samples of the previous sequence are refused"), Enqueue(Store, 5.2, 0));
+	TestEqual(TEXT("Samples of the previous sequence are dropped"), Store.Num(), 0);
+
+	TestTrue(TEXT("Samples of the new sequence are added"), Enqueue(Store, 0.0, 1));
+	TestEqual(TEXT("Fetch after the seek"), Fetch(Store, 0.05), 0.0, 1e-6);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGMediaSampleStoreBehindFetchTest, "System.Plugins.FFMPEGMedia.SampleStore.BehindFetch",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGMediaSampleStoreBehindFetchTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGMediaSampleStoreTest;
+
+	FStore Store;
+	const FTimespan Duration = FTimespan::FromMilliseconds(100);
+
+	auto IsBehind = [&Store, &Duration](double Time, int64 SequenceIndex)
+	{
+		return Store.IsBehindFetch(FMediaTimeStamp(FTimespan::FromSeconds(Time), SequenceIndex), Duration);
+	};
+
+	TestFalse(TEXT("Nothing is behind before the first fetch"), IsBehind(0.0, 0));
+
+	Fetch(Store, 2.0);
+
+	TestTrue(TEXT("A sample ending before the fetch is behind"), IsBehind(1.5, 0));
+	TestFalse(TEXT("A sample overlapping the fetch isn't behind"), IsBehind(1.95, 0));
+	TestFalse(TEXT("A later sample isn't behind"), IsBehind(2.5, 0));
+
+	// the fetch time belongs to the sequence it was made in
+	Store.SetSequenceIndex(1);
+
+	TestTrue(TEXT("A sample of the previous sequence is behind"), IsBehind(3.0, 0));
+	TestFalse(TEXT("An early sample of the new sequence isn't behind"), IsBehind(0.0, 1));
+
+	Fetch(Store, 1.0);
+	Store.Flush();
+
+	TestFalse(TEXT("A flush forgets the fetch time"), IsBehind(0.5, 1));
+
+	return true;
+}
+
+#endif
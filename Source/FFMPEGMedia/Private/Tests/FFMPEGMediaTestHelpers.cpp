@@ -0,0 +1,412 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FFMPEGMediaPrivate.h"
+#include "FFMPEGMediaPlayer.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/UnrealMemory.h"
+#include "IMediaControls.h"
+#include "IMediaSamples.h"
+#include "IMediaTextureSample.h"
+#include "IMediaTracks.h"
+#include "Math/Range.h"
+#include "Math/UnrealMathUtility.h"
+#include "Misc/Paths.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#else
+#include <sys/resource.h>
+#endif
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/channel_layout.h"
+}
+
+
+/* Local helpers
+ *****************************************************************************/
+
+namespace FFMPEGMediaTests
+{
+	/** Send a frame to the encoder, NULL flushes it, and write the packets that come out. */
+	bool Encode(AVFormatContext* Format, AVCodecContext* Codec, AVStream* Stream, AVFrame* Frame)
+	{
+		if (avcodec_send_frame(Codec, Frame) < 0)
+		{
+			return false;
+		}
+
+		AVPacket* Packet = av_packet_alloc();
+		int Ret = 0;
+
+		while ((Ret = avcodec_receive_packet(Codec, Packet)) >= 0)
+		{
+			av_packet_rescale_ts(Packet, Codec->time_base, Stream->time_base);
+			Packet->stream_index = Stream->index;
+			Ret = av_interleaved_write_frame(Format, Packet);
+
+			if (Ret < 0)
+			{
+				break;
+			}
+		}
+
+		av_packet_free(&Packet);
+
+		return (Ret == AVERROR(EAGAIN)) || (Ret == AVERROR_EOF);
+	}
+
+	/** Add a stream for the given encoder. */
+	AVCodecContext* AddStream(AVFormatContext* Format, AVCodecID CodecId, const FFFMPEGMediaTestClip& Clip, AVStream*& OutStream)
+	{
+		const AVCodec* Encoder = avcodec_find_encoder(CodecId);
+
+		if (Encoder == nullptr)
+		{
+			return nullptr;
+		}
+
+		AVCodecContext* Codec = avcodec_alloc_context3(Encoder);
+
+		if (Encoder->type == AVMEDIA_TYPE_VIDEO)
+		{
+			Codec->width = Clip.Width;
+			Codec->height = Clip.Height;
+			Codec->pix_fmt = AV_PIX_FMT_YUV420P;
+			Codec->time_base = { 1, Clip.FrameRate };
+			Codec->framerate = { Clip.FrameRate, 1 };
+			Codec->gop_size = Clip.KeyFrameInterval;
+			Codec->max_b_frames = 0;
+		}
+		else
+		{
+			Codec->sample_fmt = AV_SAMPLE_FMT_S16;
+			Codec->sample_rate = 48000;
+			Codec->channels = 2;
+			Codec->channel_layout = AV_CH_LAYOUT_STEREO;
+			Codec->time_base = { 1, Codec->sample_rate };
+		}
+
+		if (Format->oformat->flags & AVFMT_GLOBALHEADER)
+		{
+			Codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+		}
+
+		OutStream = avformat_new_stream(Format, nullptr);
+
+		if ((OutStream == nullptr) || (avcodec_open2(Codec, Encoder, nullptr) < 0) || (avcodec_parameters_from_context(OutStream->codecpar, Codec) < 0))
+		{
+			avcodec_free_context(&Codec);
+			return nullptr;
+		}
+
+		OutStream->time_base = Codec->time_base;
+
+		return Codec;
+	}
+
+	/** Encode the frames of the clip into an opened file. */
+	bool EncodeClip(AVFormatContext* Format, AVCodecContext* Video, AVStream* VideoStream, AVCodecContext* Audio, AVStream* AudioStream, const FFFMPEGMediaTestClip& Clip)
+	{
+		AVFrame* Frame = av_frame_alloc();
+		bool Result = true;
+
+		const int32 SamplesPerFrame = 48000 / Clip.FrameRate;
+		int64 NextSample = 0;
+
+		for (int32 FrameIndex = 0; Result && (FrameIndex < Clip.NumFrames); ++FrameIndex)
+		{
+			Frame->format = Video->pix_fmt;
+			Frame->width = Video->width;
+			Frame->height = Video->height;
+			Result = (av_frame_get_buffer(Frame, 0) >= 0);
+
+			for (int32 Y = 0; Result && (Y < Video->height); ++Y)
+			{
+				for (int32 X = 0; X < Video->width; ++X)
+				{
+					Frame->data[0][Y * Frame->linesize[0] + X] = (uint8)(X + Y + FrameIndex * 3);
+				}
+			}
+
+			for (int32 Y = 0; Result && (Y < Video->height / 2); ++Y)
+			{
+				FMemory::Memset(Frame->data[1] + Y * Frame->linesize[1], 128 + FrameIndex % 64, Video->width / 2);
+				FMemory::Memset(Frame->data[2] + Y * Frame->linesize[2], 128, Video->width / 2);
+			}
+
+			Frame->pts = FrameIndex;
+			Result = Result && Encode(Format, Video, VideoStream, Frame);
+			av_frame_unref(Frame);
+
+			if (Result && (Audio != nullptr))
+			{
+				Frame->format = Audio->sample_fmt;
+				Frame->channel_layout = Audio->channel_layout;
+				Frame->channels = Audio->channels;
+				Frame->sample_rate = Audio->sample_rate;
+				Frame->nb_samples = SamplesPerFrame;
+				Result = (av_frame_get_buffer(Frame, 0) >= 0);
+
+				int16* Samples = (int16*)Frame->data[0];
+
+				for (int32 Sample = 0; Result && (Sample < SamplesPerFrame); ++Sample)
+				{
+					// 440 Hz, quiet
+					const int16 Value = (int16)(2000.0 * FMath::Sin(2.0 * PI * 440.0 * (NextSample + Sample) / 48000.0));
+					Samples[Sample * 2] = Value;
+					Samples[Sample * 2 + 1] = Value;
+				}
+
+				Frame->pts = NextSample;
+				NextSample += SamplesPerFrame;
+				Result = Result && Encode(Format, Audio, AudioStream, Frame);
+				av_frame_unref(Frame);
+			}
+		}
+
+		av_frame_free(&Frame);
+
+		Result = Result && Encode(Format, Video, VideoStream, nullptr);
+
+		if (Audio != nullptr)
+		{
+			Result = Result && Encode(Format, Audio, AudioStream, nullptr);
+		}
+
+		return Result;
+	}
+}
+
+
+/* FFMPEGMediaTests interface
+ *****************************************************************************/
+
+bool FFMPEGMediaTests::WriteClip(const FString& Name, const FFFMPEGMediaTestClip& Clip, FString& OutPath)
+{
+	OutPath = FPaths::ConvertRelativePathToFull(FPaths::AutomationTransientDir() / TEXT("FFMPEGMedia") / Name + TEXT(".mkv"));
+
+	if (IFileManager::Get().FileSize(*OutPath) > 0)
+	{
+		return true;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutPath), true);
+
+	AVFormatContext* Format = nullptr;
+
+	if (avformat_alloc_output_context2(&Format, nullptr, "matroska", TCHAR_TO_UTF8(*OutPath)) < 0)
+	{
+		return false;
+	}
+
+	AVStream* VideoStream = nullptr;
+	AVStream* AudioStream = nullptr;
+	AVCodecContext* Video = AddStream(Format, AV_CODEC_ID_MPEG4, Clip, VideoStream);
+	AVCodecContext* Audio = Clip.bAudio ? AddStream(Format, AV_CODEC_ID_PCM_S16LE, Clip, AudioStream) : nullptr;
+
+	bool Result = (Video != nullptr) && (!Clip.bAudio || (Audio != nullptr))
+		&& (avio_open(&Format->pb, TCHAR_TO_UTF8(*OutPath), AVIO_FLAG_WRITE) >= 0);
+
+	if (Result)
+	{
+		Result = (avformat_write_header(Format, nullptr) >= 0)
+			&& EncodeClip(Format, Video, VideoStream, Audio, AudioStream, Clip)
+			&& (av_write_trailer(Format) >= 0);
+
+		avio_closep(&Format->pb);
+	}
+
+	avcodec_free_context(&Video);
+	avcodec_free_context(&Audio);
+	avformat_free_context(Format);
+
+	if (!Result)
+	{
+		IFileManager::Get().Delete(*OutPath);
+	}
+
+	return Result;
+}
+
+
+double FFMPEGMediaTests::GetProcessCPUTime()
+{
+#if PLATFORM_WINDOWS
+	FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+
+	if (!::GetProcessTimes(::GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+	{
+		return 0.0;
+	}
+
+	const uint64 Kernel = ((uint64)KernelTime.dwHighDateTime << 32) | KernelTime.dwLowDateTime;
+	const uint64 User = ((uint64)UserTime.dwHighDateTime << 32) | UserTime.dwLowDateTime;
+
+	// 100 ns units
+	return (Kernel + User) / 10000000.0;
+#else
+	struct rusage Usage;
+
+	if (getrusage(RUSAGE_SELF, &Usage) != 0)
+	{
+		return 0.0;
+	}
+
+	return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec + (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
+
+bool FFMPEGMediaTests::WaitFor(TFunctionRef<bool()> Condition, double Timeout)
+{
+	const double EndTime = FPlatformTime::Seconds() + Timeout;
+
+	while (!Condition())
+	{
+		if (FPlatformTime::Seconds() > EndTime)
+		{
+			return false;
+		}
+
+		FPlatformProcess::Sleep(0.001f);
+	}
+
+	return true;
+}
+
+
+/* FFFMPEGMediaTestPlayer structors
+ *****************************************************************************/
+
+FFFMPEGMediaTestPlayer::FFFMPEGMediaTestPlayer()
+	: Player(MakeUnique<FFFMPEGMediaPlayer>(*this))
+	, bFetchVideo(true)
+	, NumVideoSamples(0)
+	, LastVideoSampleTime(FTimespan::MinValue())
+{ }
+
+
+FFFMPEGMediaTestPlayer::~FFFMPEGMediaTestPlayer()
+{
+	Player->Close();
+}
+
+
+/* IMediaEventSink interface
+ *****************************************************************************/
+
+void FFFMPEGMediaTestPlayer::ReceiveMediaEvent(EMediaEvent Event)
+{
+	Events.Add(Event);
+}
+
+
+/* FFFMPEGMediaTestPlayer interface
+ *****************************************************************************/
+
+bool FFFMPEGMediaTestPlayer::Open(const FString& Path, bool bSelectAudio)
+{
+	if (!Player->Open(TEXT("file://") + Path, nullptr))
+	{
+		return false;
+	}
+
+	const bool Opened = TickUntil([this]
+	{
+		return HasReceived(EMediaEvent::MediaOpened) || HasReceived(EMediaEvent::MediaOpenFailed);
+	}, 10.0);
+
+	if (!Opened || !HasReceived(EMediaEvent::MediaOpened))
+	{
+		return false;
+	}
+
+	IMediaTracks& Tracks = Player->GetTracks();
+
+	if (!Tracks.SelectTrack(EMediaTrackType::Video, 0))
+	{
+		return false;
+	}
+
+	return !bSelectAudio || Tracks.SelectTrack(EMediaTrackType::Audio, 0);
+}
+
+
+void FFFMPEGMediaTestPlayer::SetRate(float Rate)
+{
+	Player->GetControls().SetRate(Rate);
+}
+
+
+bool FFFMPEGMediaTestPlayer::TickUntil(TFunctionRef<bool()> Condition, double Timeout)
+{
+	const double EndTime = FPlatformTime::Seconds() + Timeout;
+	double LastTime = FPlatformTime::Seconds();
+
+	while (!Condition())
+	{
+		const double Now = FPlatformTime::Seconds();
+
+		if (Now > EndTime)
+		{
+			return false;
+		}
+
+		Tick(Now - LastTime);
+		LastTime = Now;
+		FPlatformProcess::Sleep(0.005f);
+	}
+
+	return true;
+}
+
+
+void FFFMPEGMediaTestPlayer::TickFor(double Seconds)
+{
+	const double EndTime = FPlatformTime::Seconds() + Seconds;
+
+	TickUntil([EndTime] { return FPlatformTime::Seconds() >= EndTime; }, Seconds + 1.0);
+}
+
+
+bool FFFMPEGMediaTestPlayer::HasReceived(EMediaEvent Event) const
+{
+	return Events.Contains(Event);
+}
+
+
+/* FFFMPEGMediaTestPlayer implementation
+ *****************************************************************************/
+
+void FFFMPEGMediaTestPlayer::Tick(double DeltaTime)
+{
+	Player->TickInput(FTimespan::FromSeconds(DeltaTime), FTimespan::Zero());
+	Player->TickFetch(FTimespan::FromSeconds(DeltaTime), FTimespan::Zero());
+
+	if (!bFetchVideo)
+	{
+		return;
+	}
+
+	const TRange<FTimespan> AnyTime(FTimespan::MinValue(), FTimespan::MaxValue());
+	TSharedPtr<IMediaTextureSample, ESPMode::ThreadSafe> Sample;
+
+	while (Player->GetSamples().FetchVideo(AnyTime, Sample))
+	{
+		LastVideoSampleTime = Sample->GetTime().Time;
+		Sample.Reset();
+		++NumVideoSamples;
+	}
+}
+
+#endif
@@ -0,0 +1,137 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Containers/Array.h"
+#include "Containers/UnrealString.h"
+#include "IMediaEventSink.h"
+#include "Misc/Timespan.h"
+#include "Templates/Function.h"
+#include "Templates/UniquePtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FFFMPEGMediaPlayer;
+
+
+/** Description of a clip written by FFMPEGMediaTests::WriteClip. */
+struct FFFMPEGMediaTestClip
+{
+	int32 Width = 320;
+	int32 Height = 240;
+	int32 FrameRate = 30;
+	int32 NumFrames = 300;
+	int32 KeyFrameInterval = 15;
+	bool bAudio = false;
+};
+
+
+namespace FFMPEGMediaTests
+{
+	/**
+	 * Encode a clip with a moving pattern, MPEG-4 video and PCM audio in Matroska.
+	 *
+	 * Only the encoders built into every FFMPEG are used, the clips are written
+	 * to the automation transient directory and reused by the next runs.
+	 *
+	 * @param Name File name of the clip, without extension.
+	 * @param Clip What to encode.
+	 * @param OutPath Will contain the path of the clip.
+	 * @return false if the clip couldn't be written.
+	 */
+	bool WriteClip(const FString& Name, const FFFMPEGMediaTestClip& Clip, FString& OutPath);
+
+	/** Get the CPU time used by the process so far, in seconds. */
+	double GetProcessCPUTime();
+
+	/**
+	 * Wait for a condition set by another thread.
+	 *
+	 * @param Condition Checked every millisecond.
+	 * @param Timeout Seconds to wait at most.
+	 * @return false if the condition is still false after the timeout.
+	 */
+	bool WaitFor(TFunctionRef<bool()> Condition, double Timeout);
+}
+
+
+/**
+ * Drives a FFMPEG player outside of the media framework.
+ *
+ * The tests tick the player themselves and fetch every video sample as soon
+ * as it's ready, the way a media texture with an unbounded time range would.
+ */
+class FFFMPEGMediaTestPlayer
+	: public IMediaEventSink
+{
+public:
+
+	FFFMPEGMediaTestPlayer();
+	virtual ~FFFMPEGMediaTestPlayer();
+
+	//~ IMediaEventSink interface
+	virtual void ReceiveMediaEvent(EMediaEvent Event) override;
+
+	/**
+	 * Open a file and select its first tracks.
+	 *
+	 * @param Path The file to open.
+	 * @param bSelectAudio Whether the audio track is selected too.
+	 * @return false if the file couldn't be opened in time.
+	 */
+	bool Open(const FString& Path, bool bSelectAudio = false);
+
+	/** Set the play rate, 0 pauses. */
+	void SetRate(float Rate);
+
+	/**
+	 * Tick the player until the condition is true.
+	 *
+	 * @return false if the timeout expired first.
+	 */
+	bool TickUntil(TFunctionRef<bool()> Condition, double Timeout);
+
+	/** Tick the player for the given time. */
+	void TickFor(double Seconds);
+
+	/** Tick the player once and fetch the ready samples. */
+	void Tick(double DeltaTime);
+
+	/** Check if the player sent the given event. */
+	bool HasReceived(EMediaEvent Event) const;
+
+	/** Set whether the ticks fetch the video samples, the player queues them meanwhile. */
+	void SetFetchVideo(bool bFetch)
+	{
+		bFetchVideo = bFetch;
+	}
+
+	/** Get the number of video samples fetched so far. */
+	int64 GetNumVideoSamples() const
+	{
+		return NumVideoSamples;
+	}
+
+	/** Get the time of the last video sample fetched. */
+	FTimespan GetLastVideoSampleTime() const
+	{
+		return LastVideoSampleTime;
+	}
+
+	/** Get the player. */
+	FFFMPEGMediaPlayer& GetPlayer()
+	{
+		return *Player;
+	}
+
+private:
+
+	TUniquePtr<FFFMPEGMediaPlayer> Player;
+	TArray<EMediaEvent> Events;
+	bool bFetchVideo;
+	int64 NumVideoSamples;
+	FTimespan LastVideoSampleTime;
+};
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGPacketQueue.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+
+namespace FFMPEGPacketQueueTest
+{
+	/** Add empty packets until the ring is full, returns how many were added. */
+	int32 Fill(FFMPEGPacketQueue& Queue)
+	{
+		int32 NumPackets = 0;
+
+		while (!Queue.IsFull() && (Queue.PutNullPacket(0) == 0))
+		{
+			++NumPackets;
+		}
+
+		return NumPackets;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGPacketQueueCapacityTest, "System.Plugins.FFMPEGMedia.PacketQueue.Capacity",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGPacketQueueCapacityTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGPacketQueueTest;
+
+	// a queue started without a size gets the smallest ring
+	{
+		FFMPEGPacketQueue Queue;
+
+		TestEqual(TEXT("No slots before the queue is used"), Queue.GetCapacity(), 0);
+
+		Queue.Start();
+		TestEqual(TEXT("Default capacity"), Queue.GetCapacity(), PACKET_QUEUE_MIN_CAPACITY);
+
+		Queue.Abort();
+	}
+
+	FFMPEGPacketQueue Queue;
+
+	TestEqual(TEXT("Capacity is rounded up to a power of two"), Queue.SetCapacity(100), 128);
+	TestEqual(TEXT("Capacity has a minimum"), Queue.SetCapacity(1), PACKET_QUEUE_MIN_CAPACITY);
+	TestEqual(TEXT("Capacity has a maximum"), Queue.SetCapacity(1000000), PACKET_QUEUE_MAX_CAPACITY);
+	TestEqual(TEXT("Sized again"), Queue.SetCapacity(200), 256);
+
+	// the start puts a flush packet in the ring
+	Queue.Start();
+	TestEqual(TEXT("The ring holds the capacity"), Fill(Queue) + 1, 256);
+	TestTrue(TEXT("The ring is full"), Queue.IsFull());
+
+	TestEqual(TEXT("A running queue keeps its slots"), Queue.SetCapacity(1024), 256);
+
+	// the decoder stopped, the slots can be replaced
+	Queue.Abort();
+
+	TestEqual(TEXT("A stopped queue is sized again"), Queue.SetCapacity(1024), 1024);
+	TestEqual(TEXT("The packets are released"), Queue.GetNumPackets(), 0);
+	TestEqual(TEXT("The bytes are released"), Queue.GetSize(), 0);
+	TestFalse(TEXT("The new ring is empty"), Queue.IsFull());
+
+	Queue.Start();
+	TestEqual(TEXT("The new ring holds the new capacity"), Fill(Queue) + 1, 1024);
+
+	Queue.Abort();
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGPacketQueueStatsTest, "System.Plugins.FFMPEGMedia.PacketQueue.Stats",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGPacketQueueStatsTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGPacketQueueTest;
+
+	FFMPEGPacketQueue Queue;
+	Queue.SetCapacity(PACKET_QUEUE_MIN_CAPACITY);
+	Queue.Start();
+
+	// the first packets go into fresh slots
+	const int32 NumFirst = 10;
+
+	for (int32 Index = 0; Index < NumFirst; ++Index)
+	{
+		Queue.PutNullPacket(0);
+	}
+
+	TestEqual(TEXT("Fresh slots aren't reused"), Queue.GetStats().reused_slots, (int64)0);
+
+	// the decoder takes them, the ring goes around once more
+	AVPacket Packet;
+	int Serial;
+
+	while (Queue.Get(&Packet, 0, &Serial) > 0)
+	{
+		av_packet_unref(&Packet);
+	}
+
+	const int32 NumSecond = PACKET_QUEUE_MIN_CAPACITY;
+
+	for (int32 Index = 0; Index < NumSecond; ++Index)
+	{
+		Queue.PutNullPacket(0);
+	}
+
+	// the start put a flush packet in the first slot
+	const FFMPEGPacketQueueStats Stats = Queue.GetStats();
+
+	TestEqual(TEXT("Puts"), Stats.puts, (int64)(1 + NumFirst + NumSecond));
+	TestEqual(TEXT("Only the slots written before are reused"), Stats.reused_slots, (int64)(1 + NumFirst + NumSecond - PACKET_QUEUE_MIN_CAPACITY));
+	TestEqual(TEXT("Peak"), Stats.peak_packets, NumSecond);
+
+	Queue.Flush();
+	TestEqual(TEXT("Flushes"), Queue.GetStats().flushes, (int64)1);
+	TestEqual(TEXT("Flushed packets"), Queue.GetStats().flushed_packets, (int64)NumSecond);
+
+	Queue.Abort();
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,198 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGPipelineState.h"
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGMediaPlayer.h"
+#include "LambdaFunctionRunnable.h"
+
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeBool.h"
+#include "IMediaControls.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace FFMPEGPipelineStateTest
+{
+	/** Time a blocked thread gets to notice a change. */
+	const double WakeTimeout = 1.0;
+
+	/** A thread blocked on the pipeline state until its condition is true. */
+	class FWaiter
+	{
+	public:
+
+		FWaiter(FFMPEGPipelineState& State, TFunction<bool()> Condition)
+		{
+			Thread = LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGPipelineStateTestWaiter"), [this, &State, Condition] {
+				bResult = State.Wait([&Condition] { return Condition(); });
+				bDone = true;
+			});
+		}
+
+		~FWaiter()
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+
+		/** Wait for the thread to return from Wait, false if it's still blocked after the timeout. */
+		bool WaitDone(double Timeout) const
+		{
+			const double EndTime = FPlatformTime::Seconds() + Timeout;
+
+			while (!bDone && (FPlatformTime::Seconds() < EndTime))
+			{
+				FPlatformProcess::Sleep(0.001f);
+			}
+
+			return bDone;
+		}
+
+		bool IsDone() const
+		{
+			return bDone;
+		}
+
+		/** What FFMPEGPipelineState::Wait returned. */
+		bool GetResult() const
+		{
+			return bResult;
+		}
+
+	private:
+
+		FRunnableThread* Thread;
+		FThreadSafeBool bDone;
+		FThreadSafeBool bResult;
+	};
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGPipelineStateWakeTest, "System.Plugins.FFMPEGMedia.PipelineState.Wake",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGPipelineStateWakeTest::RunTest(const FString& Parameters)
+{
+	using namespace FFMPEGPipelineStateTest;
+
+	FFMPEGPipelineState State;
+	State.Start(EPipelineState::Paused);
+
+	// a state change wakes the threads waiting for it
+	{
+		FWaiter Waiter(State, [&State] { return State.IsPlaying(); });
+
+		FPlatformProcess::Sleep(0.05f);
+		TestFalse(TEXT("Waiter blocks while paused"), Waiter.IsDone());
+
+		State.Set(EPipelineState::Playing);
+		TestTrue(TEXT("Playing wakes the waiter"), Waiter.WaitDone(WakeTimeout));
+		TestTrue(TEXT("Wait returns true when the condition is met"), Waiter.GetResult());
+	}
+
+	// a command wakes them too and stays pending until taken
+	{
+		FWaiter Waiter(State, [&State] { return State.IsPending(EPipelineCommand::Seek); });
+
+		State.Post(EPipelineCommand::Seek);
+		TestTrue(TEXT("Seek wakes the waiter"), Waiter.WaitDone(WakeTimeout));
+		TestTrue(TEXT("Seek is pending"), State.IsPending(EPipelineCommand::Seek));
+		TestTrue(TEXT("Take returns the pending seek"), State.Take(EPipelineCommand::Seek));
+		TestFalse(TEXT("Take clears the seek"), State.Take(EPipelineCommand::Seek));
+	}
+
+	// an abort releases every waiter whatever it waits for
+	{
+		FWaiter Waiter(State, [] { return false; });
+
+		State.Abort();
+		TestTrue(TEXT("Abort wakes the waiter"), Waiter.WaitDone(WakeTimeout));
+		TestFalse(TEXT("Wait returns false when aborted"), Waiter.GetResult());
+		TestTrue(TEXT("Aborted"), State.IsAborted());
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGPipelineStateGenerationTest, "System.Plugins.FFMPEGMedia.PipelineState.Generation",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGPipelineStateGenerationTest::RunTest(const FString& Parameters)
+{
+	FFMPEGPipelineState State;
+	int32 NumChanges = 0;
+
+	State.SetChangeCallback([&NumChanges] { ++NumChanges; });
+	State.Start(EPipelineState::Prerolling);
+
+	uint32 Generation = State.GetGeneration();
+
+	// the reader's own wake up isn't a change for the other stages
+	State.Post(EPipelineCommand::Read);
+	TestEqual(TEXT("Read doesn't change the generation"), State.GetGeneration(), Generation);
+	TestEqual(TEXT("Read doesn't call the change callback"), NumChanges, 1);
+
+	State.Set(EPipelineState::Prerolling);
+	TestEqual(TEXT("Setting the same state isn't a change"), State.GetGeneration(), Generation);
+
+	State.Set(EPipelineState::Playing);
+	TestNotEqual(TEXT("A new state changes the generation"), State.GetGeneration(), Generation);
+	Generation = State.GetGeneration();
+
+	State.Post(EPipelineCommand::Seek);
+	TestNotEqual(TEXT("A seek changes the generation"), State.GetGeneration(), Generation);
+	TestEqual(TEXT("Every change called the callback"), NumChanges, 3);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGPipelineStateSeekTest, "System.Plugins.FFMPEGMedia.PipelineState.Seek",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGPipelineStateSeekTest::RunTest(const FString& Parameters)
+{
+	FString Path;
+	FFFMPEGMediaTestClip Clip;
+
+	if (!FFMPEGMediaTests::WriteClip(TEXT("PipelineState"), Clip, Path))
+	{
+		AddError(TEXT("Couldn't write the test clip"));
+		return false;
+	}
+
+	FFFMPEGMediaTestPlayer Player;
+
+	if (!TestTrue(TEXT("Clip opened"), Player.Open(Path)))
+	{
+		return false;
+	}
+
+	Player.SetRate(1.0f);
+
+	if (!TestTrue(TEXT("Frames before seeking"), Player.TickUntil([&Player] { return Player.GetNumVideoSamples() >= 5; }, 5.0)))
+	{
+		return false;
+	}
+
+	// the read thread is blocked on full queues, the seek has to wake it
+	const FTimespan SeekTime = FTimespan::FromSeconds(6.0);
+
+	TestTrue(TEXT("Seek accepted"), Player.GetPlayer().GetControls().Seek(SeekTime));
+	TestTrue(TEXT("Frames after the seek position"), Player.TickUntil([&Player, SeekTime] { return Player.GetLastVideoSampleTime() >= SeekTime; }, 3.0));
+
+	// paused, the seek is served without resuming playback
+	Player.SetRate(0.0f);
+	Player.TickFor(0.2);
+
+	TestTrue(TEXT("Seek back accepted"), Player.GetPlayer().GetControls().Seek(FTimespan::FromSeconds(1.0)));
+	TestTrue(TEXT("Paused seek shows its frame"), Player.TickUntil([&Player] { return Player.GetLastVideoSampleTime() < FTimespan::FromSeconds(2.0); }, 3.0));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGTaskPool.h"
+#include "FFMPEGMediaTestHelpers.h"
+
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/AutomationTest.h"
+#include "Templates/SharedPointer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGTaskPoolRunTest, "System.Plugins.FFMPEGMedia.TaskPool.Run",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGTaskPoolRunTest::RunTest(const FString& Parameters)
+{
+	// the pool is shared with the players, only look at what the test adds
+	FFMPEGTaskPool& Pool = FFMPEGTaskPool::Get();
+	const int32 NumTasks = Pool.GetNumTasks();
+
+	const int32 NumYielding = 100;
+	const int32 NumRuns = 100;
+
+	// the tasks may outlive the test when a wait times out, they share the state with it
+	struct FRunState
+	{
+		FThreadSafeCounter Runs;
+		TArray<int32> RunsPerTask;
+		FThreadSafeCounter Delayed;
+		double RunTime = 0.0;
+	};
+
+	const TSharedRef<FRunState, ESPMode::ThreadSafe> State = MakeShared<FRunState, ESPMode::ThreadSafe>();
+	State->RunsPerTask.SetNumZeroed(NumYielding);
+
+	// each one yields to the others between its runs, on every priority
+	for (int32 Index = 0; Index < NumYielding; ++Index)
+	{
+		Pool.Schedule([State, Index, NumRuns] {
+			State->Runs.Increment();
+			return (++State->RunsPerTask[Index] < NumRuns) ? 0.0 : FFMPEG_TASK_DONE;
+		}, 0.0, (FFMPEGTaskPriority)(Index % FFMPEG_TASK_PRIORITIES));
+	}
+
+	TestTrue(TEXT("Every task ran to the end"), FFMPEGMediaTests::WaitFor([&State, NumYielding, NumRuns] { return State->Runs.GetValue() == NumYielding * NumRuns; }, 10.0));
+	TestTrue(TEXT("Finished tasks are released"), FFMPEGMediaTests::WaitFor([&Pool, NumTasks] { return Pool.GetNumTasks() == NumTasks; }, 1.0));
+
+	// a delayed task doesn't run before its time
+	const double ScheduleTime = FPlatformTime::Seconds();
+
+	Pool.Schedule([State] {
+		State->RunTime = FPlatformTime::Seconds();
+		State->Delayed.Increment();
+		return FFMPEG_TASK_DONE;
+	}, 0.1);
+
+	if (TestTrue(TEXT("Delayed task ran"), FFMPEGMediaTests::WaitFor([&State] { return State->Delayed.GetValue() == 1; }, 2.0)))
+	{
+		TestTrue(FString::Printf(TEXT("Delayed task waited (%.3f s)"), State->RunTime - ScheduleTime), State->RunTime - ScheduleTime >= 0.09);
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGTaskPoolParkTest, "System.Plugins.FFMPEGMedia.TaskPool.ParkAndCancel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGTaskPoolParkTest::RunTest(const FString& Parameters)
+{
+	FFMPEGTaskPool& Pool = FFMPEGTaskPool::Get();
+
+	// a parked task only runs when it's woken up
+	FThreadSafeCounter ParkedRuns;
+	FFMPEGTaskRef Parked = Pool.Schedule([&ParkedRuns] {
+		ParkedRuns.Increment();
+		return FFMPEG_TASK_PARK;
+	});
+
+	TestTrue(TEXT("Parked task ran once"), FFMPEGMediaTests::WaitFor([&ParkedRuns] { return ParkedRuns.GetValue() == 1; }, 1.0));
+	FPlatformProcess::Sleep(0.05f);
+	TestEqual(TEXT("Parked task stays parked"), ParkedRuns.GetValue(), 1);
+
+	for (int32 Wake = 2; Wake <= 10; ++Wake)
+	{
+		Pool.Wake(Parked);
+
+		if (!TestTrue(FString::Printf(TEXT("Wake %i ran the task"), Wake), FFMPEGMediaTests::WaitFor([&ParkedRuns, Wake] { return ParkedRuns.GetValue() >= Wake; }, 1.0)))
+		{
+			break;
+		}
+	}
+
+	Pool.Cancel(Parked);
+	Pool.Wake(Parked);
+
+	const int32 ParkedRunsAtCancel = ParkedRuns.GetValue();
+	FPlatformProcess::Sleep(0.05f);
+	TestEqual(TEXT("Cancelled parked task doesn't run"), ParkedRuns.GetValue(), ParkedRunsAtCancel);
+
+	// a cancelled task doesn't run anymore once Cancel returned
+	FThreadSafeCounter SleepingRuns;
+	FFMPEGTaskRef Sleeping = Pool.Schedule([&SleepingRuns] {
+		SleepingRuns.Increment();
+		return 0.001;
+	}, 0.0, FFMPEG_TASK_HIGH);
+
+	TestTrue(TEXT("Sleeping task runs"), FFMPEGMediaTests::WaitFor([&SleepingRuns] { return SleepingRuns.GetValue() >= 10; }, 1.0));
+
+	Pool.Cancel(Sleeping);
+
+	const int32 SleepingRunsAtCancel = SleepingRuns.GetValue();
+	FPlatformProcess::Sleep(0.05f);
+	TestEqual(TEXT("Cancelled sleeping task doesn't run"), SleepingRuns.GetValue(), SleepingRunsAtCancel);
+
+	return true;
+}
+
+#endif
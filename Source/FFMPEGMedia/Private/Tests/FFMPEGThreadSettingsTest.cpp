@@ -0,0 +1,167 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaSettings.h"
+#include "FFMPEGMediaTestHelpers.h"
+#include "FFMPEGTaskPool.h"
+#include "LambdaFunctionRunnable.h"
+
+#include "HAL/PlatformAffinity.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/AutomationTest.h"
+#include "Templates/SharedPointer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#elif PLATFORM_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGThreadSettingsPriorityTest, "System.Plugins.FFMPEGMedia.ThreadSettings.Priority",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGThreadSettingsPriorityTest::RunTest(const FString& Parameters)
+{
+	FFFMPEGMediaThreadSettings Settings;
+
+	TestEqual(TEXT("Default priority"), (int32)Settings.GetThreadPriority(), (int32)TPri_Normal);
+	TestEqual(TEXT("No mask runs on any core"), Settings.GetAffinityMask(), FPlatformAffinity::GetNoAffinityMask());
+
+	Settings.Priority = EFFMPEGThreadPriority::BelowNormal;
+	Settings.AffinityMask = 1;
+
+	TestEqual(TEXT("Below normal priority"), (int32)Settings.GetThreadPriority(), (int32)TPri_BelowNormal);
+	TestEqual(TEXT("Affinity mask"), Settings.GetAffinityMask(), (uint64)1);
+
+	// lowering the priority works without privileges everywhere
+	bool bApplied = false;
+	FString Details;
+
+	FRunnableThread* Thread = LambdaFunctionRunnable::RunThreaded(TEXT("FFMPEGThreadSettingsTest"), [&bApplied, &Details] {
+#if PLATFORM_WINDOWS
+		const int Priority = ::GetThreadPriority(::GetCurrentThread());
+		bApplied = (Priority == THREAD_PRIORITY_BELOW_NORMAL);
+		Details = FString::Printf(TEXT("thread priority %d"), Priority);
+#elif PLATFORM_LINUX
+		// normal threads ignore their pthread priority, the nice value is what the scheduler uses
+		const int ProcessNice = getpriority(PRIO_PROCESS, (id_t)getpid());
+		const int ThreadNice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+		bApplied = (ThreadNice > ProcessNice);
+		Details = FString::Printf(TEXT("nice %d, process %d"), ThreadNice, ProcessNice);
+#else
+		const FRunnableThread* Current = FRunnableThread::GetRunnableThread();
+		bApplied = (Current != nullptr) && (Current->GetThreadPriority() == TPri_BelowNormal);
+		Details = TEXT("runnable thread priority");
+#endif
+	}, Settings.GetThreadPriority(), Settings.GetAffinityMask());
+
+	if (!TestNotNull(TEXT("Thread started"), Thread))
+	{
+		return false;
+	}
+
+	Thread->WaitForCompletion();
+	delete Thread;
+
+	TestTrue(FString::Printf(TEXT("Priority applied to the thread (%s)"), *Details), bApplied);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFFMPEGThreadSettingsAudioFirstTest, "System.Plugins.FFMPEGMedia.ThreadSettings.AudioRunsFirst",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFFMPEGThreadSettingsAudioFirstTest::RunTest(const FString& Parameters)
+{
+	FFMPEGTaskPool& Pool = FFMPEGTaskPool::Get();
+
+	// the tasks may outlive the test when a wait times out, they share the state with it
+	struct FOrderState
+	{
+		FThreadSafeCounter Started;
+		FThreadSafeCounter Blocked;
+		FThreadSafeCounter Released;
+		FThreadSafeCounter Finished;
+		TArray<FString> Order;
+		FCriticalSection OrderMutex;
+
+		double Record(const TCHAR* Name)
+		{
+			FScopeLock Lock(&OrderMutex);
+			Order.Add(Name);
+			return FFMPEG_TASK_DONE;
+		}
+
+		bool HasRecorded(int32 Num)
+		{
+			FScopeLock Lock(&OrderMutex);
+			return Order.Num() == Num;
+		}
+	};
+
+	const TSharedRef<FOrderState, ESPMode::ThreadSafe> State = MakeShared<FOrderState, ESPMode::ThreadSafe>();
+
+	// the workers are started with the first task
+	Pool.Schedule([State] { State->Started.Increment(); return FFMPEG_TASK_DONE; });
+	FFMPEGMediaTests::WaitFor([&State] { return State->Started.GetValue() == 1; }, 1.0);
+
+	// keep every worker busy, so the queued tasks wait for the one that's released first
+	const int32 NumWorkers = Pool.GetNumWorkers();
+
+	for (int32 Index = 0; Index < NumWorkers; ++Index)
+	{
+		Pool.Schedule([State, Index] {
+			State->Blocked.Increment();
+
+			while (State->Released.GetValue() <= Index)
+			{
+				FPlatformProcess::Sleep(0.001f);
+			}
+
+			State->Finished.Increment();
+			return FFMPEG_TASK_DONE;
+		}, 0.0, FFMPEG_TASK_HIGH);
+	}
+
+	// don't leave the workers blocked for the next tests
+	auto ReleaseAll = [&State, NumWorkers] {
+		State->Released.Set(NumWorkers);
+		FFMPEGMediaTests::WaitFor([&State, NumWorkers] { return State->Finished.GetValue() == NumWorkers; }, 5.0);
+	};
+
+	if (!TestTrue(TEXT("Every worker is busy"), FFMPEGMediaTests::WaitFor([&State, NumWorkers] { return State->Blocked.GetValue() == NumWorkers; }, 2.0)))
+	{
+		ReleaseAll();
+		return false;
+	}
+
+	// a video stage queued before the audio render
+	Pool.Schedule([State] { return State->Record(TEXT("Convert")); }, 0.0, FFMPEG_TASK_HIGH);
+	Pool.Schedule([State] { return State->Record(TEXT("AudioRender")); }, 0.0, FFMPEG_TASK_AUDIO);
+
+	// one worker free, it picks the highest priority task first
+	State->Released.Set(1);
+
+	const bool bRan = FFMPEGMediaTests::WaitFor([&State] { return State->HasRecorded(2); }, 2.0);
+
+	ReleaseAll();
+
+	if (!TestTrue(TEXT("Both tasks ran"), bRan || FFMPEGMediaTests::WaitFor([&State] { return State->HasRecorded(2); }, 2.0)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Audio render ran before the convert task queued ahead of it"), State->Order[0], FString(TEXT("AudioRender")));
+
+	return true;
+}
+
+#endif
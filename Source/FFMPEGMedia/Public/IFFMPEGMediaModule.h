@@ -5,6 +5,7 @@
 #include "Templates/SharedPointer.h"
 #include "Modules/ModuleInterface.h"
 
+class IFFMPEGMediaPlayer;
 class IMediaEventSink;
 class IMediaPlayer;
 
@@ -29,6 +30,14 @@ public:
 
     virtual TArray<FString> GetSupportedUriSchemes() = 0;
 
+	/**
+	 * Get the FFMPEG specific controls of a media player.
+	 *
+	 * @param Player The media player, i.e. UMediaPlayer::GetPlayerFacade()->GetPlayer().
+	 * @return The player controls, or nullptr if the player wasn't created by this module.
+	 */
+	virtual IFFMPEGMediaPlayer* GetFFMPEGPlayer(const TSharedPtr<IMediaPlayer, ESPMode::ThreadSafe>& Player) = 0;
+
 public:
 
 	/** Virtual destructor. */
@@ -0,0 +1,105 @@
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "Math/IntPoint.h"
+
+
+/** Quality of service classes of the FFMPEG players, from the most to the least important. */
+enum class EFFMPEGMediaQoS : uint8
+{
+	/** Full rate, its pipeline stages run before the other players'. */
+	Hero,
+
+	/** Full rate (default). */
+	Normal,
+
+	/** Frame rate capped to the BackgroundFrameRate setting, non reference frames skipped, converted after the other players. */
+	Background,
+
+	/** No video decoding nor conversion, the audio and the clock keep going. */
+	Hidden
+};
+
+
+/**
+ * Runtime controls specific to the FFMPEG media player.
+ *
+ * Use IFFMPEGMediaModule::GetFFMPEGPlayer to get them from a media player.
+ */
+class IFFMPEGMediaPlayer
+{
+public:
+
+	/**
+	 * Limit the size of the video frames handed to the engine.
+	 *
+	 * Larger frames are scaled down keeping their aspect ratio, the new size
+	 * is used from the next converted frame on.
+	 *
+	 * @param Resolution The maximum width and height, a zero component means no limit.
+	 */
+	virtual void SetMaxOutputResolution(const FIntPoint& Resolution) = 0;
+
+	/** Get the maximum size of the video frames, (0, 0) when there's no limit. */
+	virtual FIntPoint GetMaxOutputResolution() const = 0;
+
+	/**
+	 * Set the video level of detail, each level halves the output size.
+	 *
+	 * Decoders supporting lowres decode directly at the reduced size when the
+	 * video track is opened, the rest of the reduction is done when converting
+	 * the frames, so raising the level takes effect at the next frame.
+	 * Such a decoder can't go back to a larger size, lowering the level below
+	 * the one the track was opened with reopens the video track, the picture
+	 * resumes at the next key frame.
+	 *
+	 * @param Level The level of detail, 0 keeps the decoded size.
+	 */
+	virtual void SetOutputLOD(int32 Level) = 0;
+
+	/** Get the video level of detail. */
+	virtual int32 GetOutputLOD() const = 0;
+
+	/**
+	 * Set the weight of this player's share of the global memory budget.
+	 *
+	 * The packet and decoded frame budgets from the settings are split between
+	 * all the players in proportion to their priorities, the media option
+	 * MemoryPriority sets it when the media is opened.
+	 *
+	 * @param Priority 0 is the default, each step adds one default share.
+	 */
+	virtual void SetMemoryPriority(int32 Priority) = 0;
+
+	/** Get the weight of this player's share of the memory budget. */
+	virtual int32 GetMemoryPriority() const = 0;
+
+	/**
+	 * Get the memory this player is using for buffering.
+	 *
+	 * @param OutPacketBytes Will contain the size of the queued packets.
+	 * @param OutFrameBytes Will contain the size of the decoded and converted video frames.
+	 */
+	virtual void GetMemoryUsage(int64& OutPacketBytes, int64& OutFrameBytes) const = 0;
+
+	/**
+	 * Set the quality of service class of this player.
+	 *
+	 * The class decides how much of the shared pipeline the player gets when
+	 * there are many of them, changes take effect at the next decoded frame.
+	 * The media option QoS sets it when the media is opened.
+	 *
+	 * @param QoS The new class.
+	 */
+	virtual void SetQoS(EFFMPEGMediaQoS QoS) = 0;
+
+	/** Get the quality of service class of this player. */
+	virtual EFFMPEGMediaQoS GetQoS() const = 0;
+
+public:
+
+	/** Virtual destructor. */
+	virtual ~IFFMPEGMediaPlayer() { }
+};
@@ -1,17 +1,38 @@
-// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
-
-#include "FFMPEGMediaSettings.h"
-
-
-UFFMPEGMediaSettings::UFFMPEGMediaSettings()
-    : UseInfiniteBuffer (false)
-	, AllowFrameDrop(true)
-	, UseHardwareAcceleratedCodecs (true)
-    , DisableAudio (false)
-    , ZeroLatencyStreaming(false)
-    , RtspTransport(ERTSPTransport::Default)
-    , SpeedUpTricks (false)
-    , AudioThreads(0)
-    , VideoThreads(0)
-    , SyncType  (ESynchronizationType::AudioMaster)
-{ }
+// Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
+
+#include "FFMPEGMediaSettings.h"
+
+
+UFFMPEGMediaSettings::UFFMPEGMediaSettings()
+    : UseInfiniteBuffer (false)
+	, AllowFrameDrop(true)
+	, UseHardwareAcceleratedCodecs (true)
+    , DisableAudio (false)
+    , ZeroLatencyStreaming(false)
+    , RtspTransport(ERTSPTransport::Default)
+    , SpeedUpTricks (false)
+    , AudioThreads(0)
+    , VideoThreads(0)
+    , SyncType  (ESynchronizationType::AudioMaster)
+    , UseNativeYUVFormats(true)
+    , UseFastYUVConversion(false)
+    , ConversionSlices(0)
+    , UseHugePages(false)
+    , VideoFrameQueueSize(3)
+    , AudioFrameQueueSize(9)
+    , SubtitleFrameQueueSize(16)
+    , MinQueuedPackets(30)
+    , MaxQueueSizeMB(15)
+    , BufferLowWatermark(1.0f)
+    , BufferHighWatermark(3.0f)
+    , AudioBufferLowWatermark(1.0f)
+    , AudioBufferHighWatermark(3.0f)
+    , SubtitleBufferLowWatermark(0.0f)
+    , SubtitleBufferHighWatermark(0.0f)
+    , MemoryBudgetPacketsMB(256)
+    , MemoryBudgetFramesMB(1024)
+    , MaxVideoSamples(4)
+    , MaxAudioSamples(16)
+    , SampleQueueOverflow(ESampleQueueOverflow::DropOldest)
+    , BackgroundFrameRate(15.0f)
+{ }
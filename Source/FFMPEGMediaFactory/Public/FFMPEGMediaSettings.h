@@ -4,6 +4,7 @@
 
 #include "UObject/Object.h"
 #include "UObject/ObjectMacros.h"
+#include "HAL/PlatformAffinity.h"
 
 #include "FFMPEGMediaSettings.generated.h"
 
@@ -25,6 +26,64 @@ enum class ERTSPTransport : uint8 {
     Https
 };
 
+UENUM()
+enum class ESampleQueueOverflow : uint8 {
+    DropOldest = 0,
+    DropNewest,
+    Block
+};
+
+UENUM()
+enum class EFFMPEGThreadPriority : uint8 {
+    Lowest = 0,
+    BelowNormal,
+    Normal,
+    AboveNormal,
+    Highest,
+    TimeCritical
+};
+
+
+/**
+ * Priority and cores of a pipeline thread.
+ */
+USTRUCT()
+struct FFFMPEGMediaThreadSettings
+{
+	GENERATED_BODY()
+
+	//Scheduling priority of the thread. On Linux raising it above Normal needs CAP_SYS_NICE or a RLIMIT_NICE allowance.
+	UPROPERTY(EditAnywhere, Category = Media)
+	EFFMPEGThreadPriority Priority;
+
+	//Cores the thread can run on, one bit per core, 0 lets it run on any core.
+	UPROPERTY(EditAnywhere, Category = Media)
+	int64 AffinityMask;
+
+	FFFMPEGMediaThreadSettings()
+		: Priority(EFFMPEGThreadPriority::Normal)
+		, AffinityMask(0)
+	{ }
+
+	EThreadPriority GetThreadPriority() const
+	{
+		switch (Priority)
+		{
+		case EFFMPEGThreadPriority::Lowest: return TPri_Lowest;
+		case EFFMPEGThreadPriority::BelowNormal: return TPri_BelowNormal;
+		case EFFMPEGThreadPriority::AboveNormal: return TPri_AboveNormal;
+		case EFFMPEGThreadPriority::Highest: return TPri_Highest;
+		case EFFMPEGThreadPriority::TimeCritical: return TPri_TimeCritical;
+		default: return TPri_Normal;
+		}
+	}
+
+	uint64 GetAffinityMask() const
+	{
+		return (AffinityMask != 0) ? (uint64)AffinityMask : FPlatformAffinity::GetNoAffinityMask();
+	}
+};
+
 
 
 /**
@@ -68,12 +127,114 @@ public:
     UPROPERTY(config, EditAnywhere, Category = Media)
     bool SpeedUpTricks;
 
+    //Audio decoder threads, 0 uses a single thread.
     UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 16))
     int AudioThreads;
 
+    //Video decoder threads, 0 picks them from the resolution and the number of videos open. Live sources use slice threads when the codec has them.
     UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 16))
     int VideoThreads;
 
 	UPROPERTY(config, EditAnywhere, Category = Media)
 	ESynchronizationType SyncType;
+
+	//Output NV12, YUY2 and P010 frames as they are and let the GPU do the color conversion.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	bool UseNativeYUVFormats;
+
+	//Use the SIMD YUV to BGRA kernels instead of libswscale when a BGRA conversion is needed. They are faster but repeat the chroma samples instead of interpolating them and convert P010 with 8 bits of precision.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	bool UseFastYUVConversion;
+
+	//Number of slices the BGRA conversion is split into, 0 splits the cores and the frame rows between the videos open.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 32))
+	int ConversionSlices;
+
+	//Back the pooled video decode buffers with large pages, on Windows the process needs the "Lock pages in memory" privilege, on Linux and Android transparent huge pages are used.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	bool UseHugePages;
+
+	//Decoded video frames kept ahead of the display. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=2, UIMax = 128))
+	int VideoFrameQueueSize;
+
+	//Decoded audio frames kept ahead of the audio renderer. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=2, UIMax = 128))
+	int AudioFrameQueueSize;
+
+	//Decoded subtitles kept ahead of the display. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=1, UIMax = 128))
+	int SubtitleFrameQueueSize;
+
+	//Packets a stream needs to have queued before the reader stops reading ahead for it. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=1, UIMax = 1000))
+	int MinQueuedPackets;
+
+	//Maximum size in MB of the packets queued for all the streams. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=1, UIMax = 1024))
+	int MaxQueueSizeMB;
+
+	//The reader starts reading ahead when the video stream has less than this many seconds queued. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0.1, UIMax = 60))
+	float BufferLowWatermark;
+
+	//The reader stops reading ahead once the video stream has this many seconds queued, and the other streams their own high watermark. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0.1, UIMax = 60))
+	float BufferHighWatermark;
+
+	//The reader starts reading ahead when the audio stream has less than this many seconds queued. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0.1, UIMax = 60))
+	float AudioBufferLowWatermark;
+
+	//Seconds of audio the reader queues before it stops reading ahead. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0.1, UIMax = 60))
+	float AudioBufferHighWatermark;
+
+	//The reader starts reading ahead when the subtitle stream has less than this many seconds queued. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 60))
+	float SubtitleBufferLowWatermark;
+
+	//Seconds of subtitles the reader queues before it stops reading ahead, 0 means the sparse subtitle streams don't keep the reader going. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 60))
+	float SubtitleBufferHighWatermark;
+
+	//Packet memory in MB shared by all the players in proportion to their memory priority, 0 means no global limit.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 4096))
+	int MemoryBudgetPacketsMB;
+
+	//Decoded frame and sample memory in MB of the video, audio and subtitle queues, shared by all the players in proportion to their memory priority, 0 means no global limit.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 16384))
+	int MemoryBudgetFramesMB;
+
+	//Converted video samples waiting for the engine to fetch them, 0 means no limit. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 64))
+	int MaxVideoSamples;
+
+	//Audio samples waiting for the engine to fetch them, 0 means no limit. Can be overridden per player with the media option of the same name.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 256))
+	int MaxAudioSamples;
+
+	//What happens to a new sample when its queue is full.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	ESampleQueueOverflow SampleQueueOverflow;
+
+	//Frame rate the players in the Background QoS class present at most, 0 doesn't limit it.
+	UPROPERTY(config, EditAnywhere, Category = Media, meta = (UIMin=0, UIMax = 60))
+	float BackgroundFrameRate;
+
+	//Priority and cores of the threads reading the media.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	FFFMPEGMediaThreadSettings ReadThread;
+
+	//Priority and cores of the video decoder threads.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	FFFMPEGMediaThreadSettings VideoDecodeThread;
+
+	//Priority and cores of the audio and subtitle decoder threads.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	FFFMPEGMediaThreadSettings AudioDecodeThread;
+
+	//Priority and cores of the shared workers running the convert, display and audio render stages of every player. The audio render tasks always run before the video ones on them.
+	UPROPERTY(config, EditAnywhere, Category = Media)
+	FFFMPEGMediaThreadSettings WorkerThreads;
 };